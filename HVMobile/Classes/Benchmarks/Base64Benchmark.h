@@ -0,0 +1,28 @@
+//
+//  Base64Benchmark.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+
+
+/// Measures base64 encoding and decoding throughput of 1 KB, 64 KB and 4 MB payloads,
+/// compared with the property list based decoder used before.
+@interface Base64Benchmark : BenchmarkTestCase {
+
+}
+
+@end
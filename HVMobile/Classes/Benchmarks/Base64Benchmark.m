@@ -0,0 +1,135 @@
+//
+//  Base64Benchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "Base64Benchmark.h"
+#import "Base64.h"
+
+
+@implementation Base64Benchmark
+
+/// The decoder used before, kept here as the baseline.
++ (NSData *)decodeWithPropertyList: (NSString *)stringToDecode {
+	NSMutableData* data = [[[NSMutableData alloc] init] autorelease];
+	data = [[[NSPropertyListSerialization dataFromPropertyList: data
+														format: NSPropertyListXMLFormat_v1_0 errorDescription: nil] mutableCopy] autorelease];
+	char endByte = 0;
+	[data appendBytes: &endByte length: 1];
+	NSMutableString* plist = [NSMutableString stringWithUTF8String: ([data bytes])];
+	[plist replaceOccurrencesOfString: @"<data>"
+						   withString: [@"<data>" stringByAppendingString: stringToDecode]
+							  options: 0
+								range: NSMakeRange(0, [plist length])];
+
+	data = [[[NSPropertyListSerialization propertyListFromData: [NSData dataWithBytes: [plist UTF8String]
+																			   length: [plist length]]
+											  mutabilityOption: NSPropertyListImmutable
+														format: nil
+											  errorDescription: nil] mutableCopy] autorelease];
+	return data;
+}
+
+- (void)measure: (NSString *)name text: (NSString *)text expected: (NSData *)expected usePropertyList: (BOOL)usePropertyList {
+	NSUInteger iterations = MAX(4, 16 * 1024 * 1024 / text.length);
+	double start = [BenchmarkTestCase currentTime];
+
+	for (NSUInteger i = 0; i < iterations; i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+		NSData *data = usePropertyList ? [Base64Benchmark decodeWithPropertyList: text] : [Base64 decodeBase64WithString: text];
+
+		if (i == 0) {
+			STAssertEqualObjects(data, expected, @"Decoded data isn't equal to expected");
+		}
+
+		[pool release];
+	}
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u bytes: %.1f MB/s of decoded data", expected.length,
+		expected.length * iterations / elapsed / (1024 * 1024)];
+}
+
++ (NSData *)dataOfLength: (NSUInteger)length {
+	NSMutableData *data = [NSMutableData dataWithLength: length];
+	uint8_t *bytes = data.mutableBytes;
+	for (NSUInteger j = 0; j < length; j++) {
+		bytes[j] = (uint8_t)(j * 2654435761u >> 13);
+	}
+	return data;
+}
+
+- (void)testEncode {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSUInteger sizes[] = { 32, 1024, 64 * 1024, 4 * 1024 * 1024 };
+
+	for (NSUInteger i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+		NSData *data = [Base64Benchmark dataOfLength: sizes[i]];
+		NSUInteger iterations = MAX(4, 16 * 1024 * 1024 / sizes[i]);
+
+		double start = [BenchmarkTestCase currentTime];
+		for (NSUInteger j = 0; j < iterations; j++) {
+			NSAutoreleasePool *innerPool = [NSAutoreleasePool new];
+			[Base64 encodeBase64WithData: data];
+			[innerPool release];
+		}
+		double elapsed = [BenchmarkTestCase currentTime] - start;
+
+		[self report: @"Base64 encoder" format: @"%u bytes: %.1f MB/s, %.2f us per call", sizes[i],
+			sizes[i] * iterations / elapsed / (1024 * 1024), elapsed * 1e6 / iterations];
+
+		// encoding into a reused buffer shows the cost of the string allocation
+		char *buffer = malloc([Base64 encodedLengthOfLength: sizes[i] options: 0]);
+
+		start = [BenchmarkTestCase currentTime];
+		for (NSUInteger j = 0; j < iterations; j++) {
+			[Base64 encodeBase64WithBytes: data.bytes length: data.length toBuffer: buffer options: 0];
+		}
+		elapsed = [BenchmarkTestCase currentTime] - start;
+
+		free(buffer);
+
+		[self report: @"Base64 encoder to buffer" format: @"%u bytes: %.1f MB/s, %.2f us per call", sizes[i],
+			sizes[i] * iterations / elapsed / (1024 * 1024), elapsed * 1e6 / iterations];
+
+		[pool release];
+	}
+}
+
+- (void)testDecode {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSUInteger sizes[] = { 1024, 64 * 1024, 4 * 1024 * 1024 };
+
+	for (NSUInteger i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+		NSData *data = [Base64Benchmark dataOfLength: sizes[i]];
+		NSString *text = [Base64 encodeBase64WithData: data];
+
+		[self measure: @"Base64 table decoder" text: text expected: data usePropertyList: NO];
+		[self measure: @"Base64 property list decoder" text: text expected: data usePropertyList: YES];
+
+		[pool release];
+	}
+}
+
+@end
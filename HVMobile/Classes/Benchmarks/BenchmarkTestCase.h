@@ -0,0 +1,65 @@
+//
+//  BenchmarkTestCase.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <Foundation/Foundation.h>
+
+/// Name of the environment variable which enables benchmarks.
+#define BENCHMARKS_ENVIRONMENT_VARIABLE "HV_BENCHMARKS"
+
+/// Base class for benchmarks.
+/// Benchmarks are built into the test bundle, but they are skipped unless
+/// HV_BENCHMARKS environment variable is set, so regular test runs stay fast.
+/// Results are written to the log.
+@interface BenchmarkTestCase : SenTestCase {
+
+}
+
+/// Returns YES if benchmarks should be run.
++ (BOOL)isEnabled;
+
+/// Returns current time in seconds, suitable for measuring intervals.
++ (double)currentTime;
+
+/// Returns CPU time used so far by the calling thread, in seconds.
++ (double)threadCpuTime;
+
+/// Returns count of heap blocks currently allocated by the process.
++ (NSUInteger)allocatedBlocks;
+
+/// Returns count of heap bytes currently allocated by the process.
++ (NSUInteger)allocatedBytes;
+
+/// Returns current resident memory size in bytes.
++ (NSUInteger)residentSize;
+
+/// Returns peak resident memory size of the process in bytes.
++ (NSUInteger)peakResidentSize;
+
+/// Builds info section of GetThings response with the given count of weight things.
+/// Display of the thing i is 100 + i % 100.
+/// @param count - count of things.
+/// @returns <wc:info> element of the response.
++ (NSString *)weightsInfoXml: (NSUInteger)count;
+
+/// Writes benchmark result to the log.
+/// @param name - benchmark name.
+/// @param format - result format.
+- (void)report: (NSString *)name format: (NSString *)format, ...;
+
+@end
@@ -0,0 +1,128 @@
+//
+//  BenchmarkTestCase.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+#import "Logger.h"
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+#import <sys/resource.h>
+
+
+@implementation BenchmarkTestCase
+
++ (BOOL)isEnabled {
+
+	return getenv(BENCHMARKS_ENVIRONMENT_VARIABLE) != NULL;
+}
+
++ (double)currentTime {
+
+	static mach_timebase_info_data_t timebase;
+
+	if (timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+}
+
++ (double)threadCpuTime {
+
+	thread_basic_info_data_t info;
+	mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+	mach_port_t thread = mach_thread_self();
+
+	kern_return_t result = thread_info(thread, THREAD_BASIC_INFO, (thread_info_t)&info, &count);
+	mach_port_deallocate(mach_task_self(), thread);
+
+	if (result != KERN_SUCCESS) {
+		return 0;
+	}
+
+	return info.user_time.seconds + info.user_time.microseconds / 1e6
+		+ info.system_time.seconds + info.system_time.microseconds / 1e6;
+}
+
++ (NSUInteger)allocatedBlocks {
+
+	malloc_statistics_t statistics;
+	malloc_zone_statistics(NULL, &statistics);
+
+	return statistics.blocks_in_use;
+}
+
++ (NSUInteger)allocatedBytes {
+
+	malloc_statistics_t statistics;
+	malloc_zone_statistics(NULL, &statistics);
+
+	return statistics.size_in_use;
+}
+
++ (NSUInteger)residentSize {
+
+	struct task_basic_info info;
+	mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+		return 0;
+	}
+
+	return info.resident_size;
+}
+
++ (NSUInteger)peakResidentSize {
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	// ru_maxrss is reported in bytes on Darwin
+	return usage.ru_maxrss;
+}
+
++ (NSString *)weightsInfoXml: (NSUInteger)count {
+
+	NSMutableString *xml = [NSMutableString stringWithCapacity: count * 600];
+	[xml appendString: @"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"];
+
+	for (NSUInteger i = 0; i < count; i++) {
+
+		[xml appendFormat: @"<thing><thing-id version-stamp=\"6fa3752a-deeb-4900-9774-%012u\">e2a124d8-0390-4c4b-aad6-%012u</thing-id>"
+			"<type-id name=\"Weight Measurement\">3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id><thing-state>Active</thing-state><flags>0</flags>"
+			"<eff-date>2011-04-20T12:25:29.218</eff-date><data-xml><weight><when><date><y>2011</y><m>4</m><d>20</d></date>"
+			"<time><h>12</h><m>25</m><s>29</s><f>218</f></time></when><value><kg>65.7894736842105</kg>"
+			"<display units=\"pounds\">%u</display></value></weight><common /></data-xml></thing>", i, i, 100 + i % 100];
+	}
+
+	[xml appendString: @"</group></wc:info>"];
+	return xml;
+}
+
+- (void)report: (NSString *)name format: (NSString *)format, ... {
+
+	va_list arguments;
+	va_start(arguments, format);
+	NSString *result = [[NSString alloc] initWithFormat: format arguments: arguments];
+	va_end(arguments);
+
+	[Logger write: [NSString stringWithFormat: @"[Benchmark %@] %@", name, result]];
+	[result release];
+}
+
+@end
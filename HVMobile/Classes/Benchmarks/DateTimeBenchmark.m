@@ -0,0 +1,131 @@
+//
+//  DateTimeBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "DateTimeBenchmark.h"
+#import "DateTimeUtils.h"
+
+/// Count of timestamps in every measurement.
+#define TIMESTAMP_COUNT 10000
+
+
+@implementation DateTimeBenchmark
+
+/// The formatter used before, kept here as the baseline.
++ (NSString *)formatterDateToUtcString: (NSDate *)date {
+	NSDateFormatter *formatter = [NSDateFormatter new];
+	[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'"];
+	[formatter setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
+	NSString *utcDateString = [formatter stringFromDate: date];
+	[formatter release];
+
+	return utcDateString;
+}
+
+/// The parser used before, kept here as the baseline.
++ (NSDate *)formatterUtcStringToDate: (NSString *)string {
+	NSDateFormatter *formatter = [NSDateFormatter new];
+	[formatter setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
+
+	[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss.SSS"];
+	NSDate *utcDate = [formatter dateFromString: string];
+
+	if (utcDate == nil) {
+		[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss"];
+		utcDate = [formatter dateFromString: string];
+	}
+
+	[formatter release];
+
+	return utcDate;
+}
+
+- (void)report: (NSString *)name start: (double)start blocks: (NSUInteger)blocks {
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u timestamps: %.2f us per timestamp, %d heap blocks held by the autorelease pool",
+		TIMESTAMP_COUNT, elapsed * 1e6 / TIMESTAMP_COUNT, (int)([BenchmarkTestCase allocatedBlocks] - blocks)];
+}
+
+- (void)testFormatAndParse {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	// eff-date of weights is written without fraction, which makes the old parser fall back to the second format.
+	NSMutableArray *dates = [NSMutableArray arrayWithCapacity: TIMESTAMP_COUNT];
+	NSMutableArray *strings = [NSMutableArray arrayWithCapacity: TIMESTAMP_COUNT];
+
+	for (NSUInteger i = 0; i < TIMESTAMP_COUNT; i++) {
+		NSDate *date = [NSDate dateWithTimeIntervalSinceReferenceDate: 300000000.0 + i * 3600.0];
+		[dates addObject: date];
+		[strings addObject: [[DateTimeUtils dateToUtcString: date] substringToIndex: 19]];
+	}
+
+	NSTimeInterval *times = malloc(TIMESTAMP_COUNT * sizeof(NSTimeInterval));
+
+	for (int useFormatter = 1; useFormatter >= 0; useFormatter--) {
+		NSString *implementation = useFormatter ? @"NSDateFormatter" : @"DateTimeUtils";
+
+		// Results are autoreleased, so the blocks are counted before the pool is drained.
+		NSAutoreleasePool *innerPool = [NSAutoreleasePool new];
+		NSUInteger blocks = [BenchmarkTestCase allocatedBlocks];
+		double start = [BenchmarkTestCase currentTime];
+
+		for (NSDate *date in dates) {
+			if (useFormatter) {
+				[DateTimeBenchmark formatterDateToUtcString: date];
+			}
+			else {
+				[DateTimeUtils dateToUtcString: date];
+			}
+		}
+
+		[self report: [implementation stringByAppendingString: @" format"] start: start blocks: blocks];
+		[innerPool release];
+
+		innerPool = [NSAutoreleasePool new];
+		blocks = [BenchmarkTestCase allocatedBlocks];
+		start = [BenchmarkTestCase currentTime];
+
+		for (NSString *string in strings) {
+			NSDate *date = useFormatter ? [DateTimeBenchmark formatterUtcStringToDate: string] : [DateTimeUtils UtcStringToDate: string];
+
+			if (date == nil) {
+				STFail(@"Timestamp %@ hasn't been parsed", string);
+			}
+		}
+
+		[self report: [implementation stringByAppendingString: @" parse"] start: start blocks: blocks];
+		[innerPool release];
+	}
+
+	// Bulk parsing creates no NSDate objects at all.
+	NSUInteger blocks = [BenchmarkTestCase allocatedBlocks];
+	double start = [BenchmarkTestCase currentTime];
+
+	NSUInteger validCount = [DateTimeUtils parseUtcStrings: strings times: times];
+
+	[self report: @"DateTimeUtils bulk parse" start: start blocks: blocks];
+	STAssertTrue(validCount == TIMESTAMP_COUNT, @"Timestamps haven't been parsed");
+
+	free(times);
+
+	[pool release];
+}
+
+@end
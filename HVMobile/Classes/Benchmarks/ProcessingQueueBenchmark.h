@@ -0,0 +1,40 @@
+//
+//  ProcessingQueueBenchmark.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+
+@class LocalHttpServer;
+
+/// Measures how much of the main thread a request occupies, with the work done on the main
+/// thread and with HealthVaultService processing queue: CPU time of the main thread per request
+/// and the longest time the main run loop hasn't been able to fire a timer.
+/// The local server runs on the main thread as well; it answers with canned bodies,
+/// so its share is small and the same in both cases.
+@interface ProcessingQueueBenchmark : BenchmarkTestCase {
+
+	LocalHttpServer *_server;
+	NSString *_getThingsResponse;
+	NSUInteger _completedCount;
+	NSUInteger _expectedCount;
+	BOOL _isDone;
+
+	double _lastTimerTime;
+	double _longestStall;
+}
+
+@end
@@ -0,0 +1,169 @@
+//
+//  ProcessingQueueBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "ProcessingQueueBenchmark.h"
+#import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+#import "LocalHttpServer.h"
+#import "Base64.h"
+
+/// Count of requests sent in every measurement.
+#define REQUEST_COUNT 16
+
+/// Count of things in the canned GetThings response, about 1 MB.
+#define RESPONSE_THING_COUNT 2000
+
+/// Length of the info section of the PutThings request.
+#define REQUEST_INFO_LENGTH (256 * 1024)
+
+/// Interval of the timer which detects stalls of the main run loop, in seconds.
+#define STALL_TIMER_INTERVAL 0.005
+
+
+@implementation ProcessingQueueBenchmark
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	if ([requestBody rangeOfString: @"<method>GetThings</method>"].location != NSNotFound) {
+		return _getThingsResponse;
+	}
+
+	return @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings\">"
+		"<thing-id version-stamp=\"1\">1</thing-id></wc:info></response>";
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+
+	STAssertFalse(response.hasError, @"Request has failed: %@", response.errorText);
+
+	// The application reads the info section, with the processing queue it has been parsed already.
+	[response infoElement];
+
+	_completedCount++;
+	_isDone = (_completedCount == _expectedCount);
+}
+
+- (void)stallTimerFired: (NSTimer *)timer {
+
+	double now = [BenchmarkTestCase currentTime];
+
+	_longestStall = MAX(_longestStall, now - _lastTimerTime);
+	_lastTimerTime = now;
+}
+
+- (void)measure: (NSString *)name methodName: (NSString *)methodName infoSection: (NSString *)infoSection useProcessingQueue: (BOOL)useProcessingQueue {
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultService *service = [[HealthVaultService alloc] initWithUrl: _server.url
+																 shellUrl: nil
+															  masterAppId: @"c55cf02c-7de7-487a-8b8f-f694a7d9d737"];
+	service.authorizationSessionToken = @"token";
+	service.sessionSharedSecret = [Base64 encodeBase64WithData: [@"session secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	NSOperationQueue *processingQueue = nil;
+
+	if (useProcessingQueue) {
+
+		processingQueue = [NSOperationQueue new];
+		processingQueue.maxConcurrentOperationCount = DEFAULT_MAX_CONCURRENT_PROCESSING;
+		service.processingQueue = processingQueue;
+	}
+
+	_completedCount = 0;
+	_expectedCount = REQUEST_COUNT;
+	_isDone = NO;
+
+	_longestStall = 0;
+	_lastTimerTime = [BenchmarkTestCase currentTime];
+	NSTimer *timer = [NSTimer scheduledTimerWithTimeInterval: STALL_TIMER_INTERVAL
+													  target: self
+													selector: @selector(stallTimerFired:)
+													userInfo: nil
+													 repeats: YES];
+
+	double start = [BenchmarkTestCase currentTime];
+	double startCpuTime = [BenchmarkTestCase threadCpuTime];
+
+	for (NSUInteger i = 0; i < REQUEST_COUNT; i++) {
+
+		HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: methodName
+																	   methodVersion: 3
+																		 infoSection: infoSection
+																			  target: self
+																			callBack: @selector(requestCompleted:)];
+		[service sendRequest: request];
+		[request release];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: 60], @"Request timeout");
+
+	double cpuTime = [BenchmarkTestCase threadCpuTime] - startCpuTime;
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[timer invalidate];
+
+	[self report: name format: @"%u requests: %.2f ms of main thread CPU per request, %.1f ms longest stall, %.0f ms total",
+		REQUEST_COUNT, cpuTime * 1000 / REQUEST_COUNT, _longestStall * 1000, elapsed * 1000];
+
+	[service release];
+	[processingQueue release];
+
+	[pool release];
+}
+
+- (void)testMainThreadOccupancy {
+
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSMutableString *response = [NSMutableString stringWithString: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"];
+
+	for (NSUInteger i = 0; i < RESPONSE_THING_COUNT; i++) {
+
+		[response appendFormat: @"<thing><thing-id version-stamp=\"%u\">%u</thing-id>"
+			"<type-id name=\"Weight Measurement\">3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
+			"<thing-state>Active</thing-state><flags>0</flags><eff-date>2011-05-12T10:15:00</eff-date>"
+			"<data-xml><weight><when><date><y>2011</y><m>5</m><d>12</d></date><time><h>10</h><m>15</m><s>0</s></time></when>"
+			"<value><kg>%u.5</kg><display units=\"lb\">%u.1</display></value></weight>"
+			"<common><note>Measured in the morning, before breakfast</note></common></data-xml></thing>", i, i, 60 + i % 40, 130 + i % 90];
+	}
+
+	[response appendString: @"</group></wc:info></response>"];
+
+	NSString *getInfo = @"<info><group><filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter></group></info>";
+	NSString *putInfo = [NSString stringWithFormat: @"<info><thing><data-xml><common><note>%@</note></common></data-xml></thing></info>",
+						 [@"" stringByPaddingToLength: REQUEST_INFO_LENGTH withString: @"x" startingAtIndex: 0]];
+
+	_getThingsResponse = [response retain];
+
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	STAssertTrue([_server start], @"Couldn't start local server");
+
+	[self measure: @"GetThings 1 MB on main thread" methodName: @"GetThings" infoSection: getInfo useProcessingQueue: NO];
+	[self measure: @"GetThings 1 MB on processing queue" methodName: @"GetThings" infoSection: getInfo useProcessingQueue: YES];
+
+	[self measure: @"PutThings 256 KB on main thread" methodName: @"PutThings" infoSection: putInfo useProcessingQueue: NO];
+	[self measure: @"PutThings 256 KB on processing queue" methodName: @"PutThings" infoSection: putInfo useProcessingQueue: YES];
+
+	[_server stop];
+	[_server release];
+	[_getThingsResponse release];
+}
+
+@end
@@ -0,0 +1,33 @@
+//
+//  RequestBatchingBenchmark.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+
+@class LocalHttpServer;
+
+/// Measures how long it takes to load several GetThings requests from a local server
+/// with injected latency, sent one by one and merged by HealthVaultRequestBatcher.
+@interface RequestBatchingBenchmark : BenchmarkTestCase {
+
+	LocalHttpServer *_server;
+	NSUInteger _completedCount;
+	NSUInteger _expectedCount;
+	BOOL _isDone;
+}
+
+@end
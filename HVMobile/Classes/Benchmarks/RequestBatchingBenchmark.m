@@ -0,0 +1,116 @@
+//
+//  RequestBatchingBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RequestBatchingBenchmark.h"
+#import "HealthVaultService.h"
+#import "HealthVaultRequestBatcher.h"
+#import "LocalHttpServer.h"
+#import "Base64.h"
+
+/// Latency of every round trip to the local server, in seconds.
+#define INJECTED_LATENCY 0.15
+
+
+@implementation RequestBatchingBenchmark
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+	NSMutableString *response = [NSMutableString stringWithString: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\">"];
+
+	NSUInteger groupCount = [requestBody componentsSeparatedByString: @"<group>"].count - 1;
+	for (NSUInteger i = 0; i < groupCount; i++) {
+		[response appendString: @"<group><thing><thing-id version-stamp=\"1\">1</thing-id></thing></group>"];
+	}
+
+	[response appendString: @"</wc:info></response>"];
+	return response;
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+	STAssertFalse(response.hasError, @"Request has failed: %@", response.errorText);
+
+	_completedCount++;
+	_isDone = (_completedCount == _expectedCount);
+}
+
+- (void)measure: (NSString *)name requestCount: (NSUInteger)requestCount useBatcher: (BOOL)useBatcher {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultService *service = [[HealthVaultService alloc] initWithUrl: _server.url
+																 shellUrl: nil
+															  masterAppId: @"c55cf02c-7de7-487a-8b8f-f694a7d9d737"];
+	service.authorizationSessionToken = @"token";
+	service.sessionSharedSecret = [Base64 encodeBase64WithData: [@"session secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	HealthVaultRequestBatcher *batcher = [[HealthVaultRequestBatcher alloc] initWithService: service];
+
+	NSUInteger serverRequests = _server.requestCount;
+	_completedCount = 0;
+	_expectedCount = requestCount;
+	_isDone = NO;
+
+	double start = [BenchmarkTestCase currentTime];
+
+	for (NSUInteger i = 0; i < requestCount; i++) {
+		HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																	   methodVersion: 3
+																		 infoSection: @"<info><group><filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter></group></info>"
+																			  target: self
+																			callBack: @selector(requestCompleted:)];
+		if (useBatcher) {
+			[batcher sendRequest: request];
+		}
+		else {
+			[service sendRequest: request];
+		}
+
+		[request release];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: 60], @"Request timeout");
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u requests, %.0f ms latency: %.0f ms total, %u round trips",
+		requestCount, INJECTED_LATENCY * 1000, elapsed * 1000, _server.requestCount - serverRequests];
+
+	[batcher release];
+	[service release];
+
+	[pool release];
+}
+
+- (void)testBatching {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	_server = [LocalHttpServer new];
+	_server.responseDelay = INJECTED_LATENCY;
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	STAssertTrue([_server start], @"Couldn't start local server");
+
+	NSUInteger counts[] = { 2, 8, 32 };
+
+	for (NSUInteger i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		[self measure: @"GetThings one by one" requestCount: counts[i] useBatcher: NO];
+		[self measure: @"GetThings batched" requestCount: counts[i] useBatcher: YES];
+	}
+
+	[_server stop];
+	[_server release];
+}
+
+@end
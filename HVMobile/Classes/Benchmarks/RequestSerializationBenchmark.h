@@ -0,0 +1,30 @@
+//
+//  RequestSerializationBenchmark.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+
+
+/// Measures serialization of signed HealthVault requests.
+/// Reports requests per second and heap usage per call of toXmlData, and of the string
+/// concatenation toXml it has replaced followed by UTF-8 conversion, for small and 1 MB
+/// info sections, and the cost of timing serialization when the request carries metrics.
+@interface RequestSerializationBenchmark : BenchmarkTestCase {
+
+}
+
+@end
@@ -0,0 +1,185 @@
+//
+//  RequestSerializationBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RequestSerializationBenchmark.h"
+#import "HealthVaultRequest.h"
+#import "HealthVaultRequestMetrics.h"
+#import "MobilePlatform.h"
+#import "DateTimeUtils.h"
+#import "Base64.h"
+
+
+@implementation RequestSerializationBenchmark
+
+/// Builds signed request with info section of about the given size.
+- (HealthVaultRequest *)requestWithInfoSize: (NSUInteger)size {
+	NSMutableString *info = [NSMutableString stringWithCapacity: size + 64];
+	[info appendString: @"<info><thing><data-other content-type=\"image/jpeg\">"];
+
+	while (info.length < size) {
+		[info appendString: @"QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5ejAxMjM0NTY3ODk="];
+	}
+
+	[info appendString: @"</data-other></thing></info>"];
+
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"PutThings"
+																   methodVersion: 2
+																	 infoSection: info
+																		  target: nil
+																		callBack: nil];
+	request.msgTime = [NSDate date];
+	request.recordId = @"99999999-9999-9999-9999-999999999999";
+	request.personId = @"68701ce3-00f5-4407-a741-d20f13c375d6";
+	request.authorizationSessionToken = @"ASAAADNt1JwbxFbbO8w+wsXjPFs00soe9w==";
+	request.sessionSharedSecret = [Base64 encodeBase64WithData: [@"benchmark shared secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	return [request autorelease];
+}
+
+/// Serializes the request the way HealthVaultRequest -toXml did before the buffer writer,
+/// by string concatenation with the hash and HMAC computed over intermediate strings.
+- (NSString *)baselineXmlOfRequest: (HealthVaultRequest *)request {
+
+	NSMutableString *xml = [NSMutableString new];
+
+	[xml appendString:@"<wc-request:request xmlns:wc-request=\"urn:com.microsoft.wc.request\">"];
+
+	NSMutableString *header = [NSMutableString new];
+
+	[header appendString: @"<header>"];
+
+	[header appendFormat: @"<method>%@</method>", request.methodName];
+	[header appendFormat: @"<method-version>%.0f</method-version>", request.methodVersion];
+
+	if (request.recordId) {
+		[header appendFormat: @"<record-id>%@</record-id>", request.recordId];
+	}
+
+	if (request.authorizationSessionToken && request.authorizationSessionToken.length > 0) {
+
+		[header appendString: @"<auth-session>"];
+		[header appendFormat: @"<auth-token>%@</auth-token>", request.authorizationSessionToken];
+
+		if (request.personId) {
+
+			[header appendString: @"<offline-person-info>"];
+			[header appendFormat: @"<offline-person-id>%@</offline-person-id>", request.personId];
+			[header appendString: @"</offline-person-info>"];
+		}
+
+		[header appendString: @"</auth-session>"];
+	}
+	else {
+
+		[header appendFormat: @"<app-id>%@</app-id>", request.appIdInstance];
+	}
+
+	[header appendFormat: @"<language>%@</language>", request.language];
+	[header appendFormat: @"<country>%@</country>", request.country];
+
+	[header appendFormat: @"<msg-time>%@</msg-time>", [DateTimeUtils dateToUtcString: request.msgTime]];
+	[header appendFormat: @"<msg-ttl>%d</msg-ttl>", request.msgTTL];
+	[header appendFormat: @"<version>%@</version>", [MobilePlatform platformAbbreviationAndVersion]];
+
+	NSMutableString *infoString = [NSMutableString new];
+	if (request.infoXml) {
+		[infoString appendFormat: @"%@", request.infoXml];
+	} else {
+		[infoString appendFormat: @"<info />"];
+	}
+
+	BOOL isCreateAuthSessionTokenMethod = [@"CreateAuthenticatedSessionToken" compare: request.methodName] == NSOrderedSame;
+
+	if (!isCreateAuthSessionTokenMethod) {
+
+		[header appendFormat: @"<info-hash>%@</info-hash>", [MobilePlatform computeSha256HashAndWrap: infoString]];
+	}
+
+	[header appendString: @"</header>"];
+
+	if (request.sessionSharedSecret && !isCreateAuthSessionTokenMethod) {
+		NSData *decodedKey = [Base64 decodeBase64WithString: request.sessionSharedSecret];
+
+		[xml appendFormat: @"<auth>%@</auth>", [MobilePlatform computeSha256HmacAndWrap: decodedKey : header]];
+	}
+
+	[xml appendString: header];
+	[xml appendFormat: @"%@", infoString];
+
+	[xml appendString: @"</wc-request:request>"];
+
+	[header release];
+	[infoString release];
+	return [xml autorelease];
+}
+
+- (void)measure: (NSString *)name request: (HealthVaultRequest *)request iterations: (NSUInteger)iterations useData: (BOOL)useData {
+	NSUInteger totalBytes = 0;
+	NSUInteger totalBlocks = 0;
+	NSUInteger length = 0;
+
+	double start = [BenchmarkTestCase currentTime];
+
+	for (NSUInteger i = 0; i < iterations; i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+		NSUInteger blocksBefore = [BenchmarkTestCase allocatedBlocks];
+		NSUInteger bytesBefore = [BenchmarkTestCase allocatedBytes];
+
+		// the body handed to the transport is measured in both cases
+		NSData *body = useData ? [request toXmlData] : [[self baselineXmlOfRequest: request] dataUsingEncoding: NSUTF8StringEncoding];
+		length = body.length;
+
+		// temporaries are still held by the pool here
+		totalBlocks += [BenchmarkTestCase allocatedBlocks] - blocksBefore;
+		totalBytes += [BenchmarkTestCase allocatedBytes] - bytesBefore;
+
+		[pool release];
+	}
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u byte requests: %.0f requests/s, %u allocations and %u bytes held per call",
+		length, iterations / elapsed, totalBlocks / iterations, totalBytes / iterations];
+}
+
+- (void)testSerialization {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSUInteger sizes[] = { 256, 1024 * 1024 };
+	NSUInteger iterations[] = { 10000, 20 };
+
+	for (NSUInteger i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+		HealthVaultRequest *request = [self requestWithInfoSize: sizes[i]];
+
+		[self measure: @"toXmlData" request: request iterations: iterations[i] useData: YES];
+		[self measure: @"baseline toXml + UTF-8" request: request iterations: iterations[i] useData: NO];
+
+		// the span adds three timestamps per call
+		HealthVaultRequestMetrics *metrics = [[HealthVaultRequestMetrics alloc] initWithMethodName: request.methodName];
+		request.metrics = metrics;
+		[metrics release];
+
+		[self measure: @"toXmlData with metrics" request: request iterations: iterations[i] useData: YES];
+
+		[pool release];
+	}
+}
+
+@end
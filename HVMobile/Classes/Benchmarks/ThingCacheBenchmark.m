@@ -0,0 +1,151 @@
+//
+//  ThingCacheBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "ThingCacheBenchmark.h"
+#import "HealthVaultService.h"
+#import "HealthVaultThingCache.h"
+#import "HealthVaultThingSync.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "Base64.h"
+
+/// Latency of every round trip to the local server, in seconds.
+#define INJECTED_LATENCY 0.15
+
+/// Count of weights on the server.
+#define WEIGHT_COUNT 10000
+
+/// Count of weights shown at once.
+#define FIRST_PAGE_SIZE 30
+
+
+@implementation ThingCacheBenchmark
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+	XmlElement *group = [[XmlDocument documentWithString: requestBody].rootElement selectSingleNode: @"info/group"];
+	NSMutableString *response = [NSMutableString stringWithString: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"];
+
+	NSArray *idNodes = [group selectNodes: @"id"];
+
+	if (idNodes.count > 0) {
+
+		for (XmlElement *idNode in idNodes) {
+			[response appendFormat: @"<thing><thing-id version-stamp=\"1\">%@</thing-id><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
+				"<thing-state>Active</thing-state><eff-date>2011-05-01T10:00:00</eff-date><data-xml><weight>"
+				"<when><date><y>2011</y><m>5</m><d>1</d></date><time><h>10</h><m>0</m><s>0</s></time></when>"
+				"<value><kg>70</kg><display units=\"pounds\">154.3</display></value></weight><common/></data-xml></thing>", idNode.text];
+		}
+	}
+	else {
+
+		for (NSUInteger i = 0; i < _thingCount; i++) {
+			[response appendFormat: @"<unprocessed-thing-key-info><thing-id version-stamp=\"1\">%08u-0000-0000-0000-000000000000</thing-id></unprocessed-thing-key-info>", i];
+		}
+	}
+
+	[response appendString: @"</group></wc:info></response>"];
+	return response;
+}
+
+- (void)syncCompleted: (HealthVaultThingSync *)sync {
+	STAssertFalse(sync.hasError, @"Sync has failed: %@", sync.errorText);
+
+	_isDone = YES;
+}
+
+- (void)measureSync: (NSString *)name cache: (HealthVaultThingCache *)cache service: (HealthVaultService *)service {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultThingSync *sync = [[HealthVaultThingSync alloc] initWithService: service
+																		 cache: cache
+																	 filterXml: @"<filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter>"
+																	 formatXml: @"<format><section>core</section><xml/></format>"
+																		target: self
+																	  callBack: @selector(syncCompleted:)];
+	sync.pageSize = 200;
+
+	NSUInteger serverRequests = _server.requestCount;
+	_isDone = NO;
+
+	double start = [BenchmarkTestCase currentTime];
+
+	[sync start];
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: 600], @"Sync timeout");
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u weights, %.0f ms latency: %.0f ms, %u round trips, %u downloaded",
+		_thingCount, INJECTED_LATENCY * 1000, elapsed * 1000, _server.requestCount - serverRequests, sync.changedThingCount];
+
+	[sync release];
+	[pool release];
+}
+
+- (void)measureRead: (NSString *)name cache: (HealthVaultThingCache *)cache range: (NSRange)range {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	double start = [BenchmarkTestCase currentTime];
+
+	NSString *xml = [cache infoXmlWithThingsInRange: range];
+	NSArray *things = [[[XmlDocument documentWithString: xml].rootElement selectSingleNode: @"group"] selectNodes: @"thing"];
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u of %u weights read and parsed: %.2f ms", things.count, cache.count, elapsed * 1000];
+
+	[pool release];
+}
+
+- (void)testColdAndWarmLoad {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	_thingCount = WEIGHT_COUNT;
+
+	_server = [LocalHttpServer new];
+	_server.responseDelay = INJECTED_LATENCY;
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	STAssertTrue([_server start], @"Couldn't start local server");
+
+	HealthVaultService *service = [[HealthVaultService alloc] initWithUrl: _server.url
+																 shellUrl: nil
+															  masterAppId: @"c55cf02c-7de7-487a-8b8f-f694a7d9d737"];
+	service.authorizationSessionToken = @"token";
+	service.sessionSharedSecret = [Base64 encodeBase64WithData: [@"session secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent: @"ThingCacheBenchmark"];
+	HealthVaultThingCache *cache = [[HealthVaultThingCache alloc] initWithDirectory: directory
+																		   recordId: @"record"
+																			 typeId: @"3d34d87e-7fc1-4153-800f-f56592cb0d17"];
+	[cache clear];
+
+	[self measureSync: @"Cold load" cache: cache service: service];
+	[self measureSync: @"Warm load" cache: cache service: service];
+
+	[self measureRead: @"Cached first page" cache: cache range: NSMakeRange(0, FIRST_PAGE_SIZE)];
+	[self measureRead: @"Cached last page" cache: cache range: NSMakeRange(WEIGHT_COUNT - FIRST_PAGE_SIZE, FIRST_PAGE_SIZE)];
+	[self measureRead: @"Cached weights" cache: cache range: NSMakeRange(0, WEIGHT_COUNT)];
+
+	[cache clear];
+	[cache release];
+	[service release];
+
+	[_server stop];
+	[_server release];
+}
+
+@end
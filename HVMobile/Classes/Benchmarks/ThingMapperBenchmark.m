@@ -0,0 +1,235 @@
+//
+//  ThingMapperBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#import "ThingMapperBenchmark.h"
+#import "WeightMapper.h"
+#import "RecordImageMapper.h"
+#import "XmlTextReader.h"
+#import "XmlPath.h"
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+
+/// Count of weights in the response.
+#define THING_COUNT 10000
+
+/// Size of the record image in bytes.
+#define IMAGE_SIZE (2 * 1024 * 1024)
+
+
+@implementation ThingMapperBenchmark
+
+/// Builds GetThings response with record image of the given size.
+- (NSString *)getImageXml: (NSUInteger)size {
+	NSMutableData *data = [NSMutableData dataWithLength: size];
+	uint8_t *bytes = data.mutableBytes;
+	for (NSUInteger i = 0; i < size; i++) {
+		bytes[i] = (uint8_t)(i * 7);
+	}
+
+	RecordImage *image = [[RecordImage new] autorelease];
+	image.imageData = data;
+	image.contentType = @"image/jpeg";
+
+	return [NSString stringWithFormat: @"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>%@</group></wc:info>",
+		[RecordImageMapper xmlOfThing: image]];
+}
+
+#pragma mark Hand-written baseline
+
+/// Creates Weight from thing node the way Weight did before mappers were generated.
+- (void)readWeightNode: (XmlElement *)thingNode context: (NSMutableArray *)weights {
+	static XmlPathExtractor *extractor = nil;
+	if (!extractor) {
+		extractor = [[XmlPathExtractor alloc] initWithPaths: [NSArray arrayWithObjects:
+			@"thing-id", @"thing-id/@version-stamp", @"data-xml/weight/value/display", @"data-xml/weight/value/display/@units", @"eff-date", nil]];
+	}
+
+	NSString *values[5];
+	[extractor extractValuesFrom: thingNode values: values];
+
+	Weight *weight = [[Weight new] autorelease];
+	weight.weightId = values[0];
+	weight.versionStamp = values[1];
+	weight.display = values[2];
+	weight.units = values[3];
+	weight.effDate = [DateTimeUtils UtcStringToDate: values[4]];
+
+	[weights addObject: weight];
+}
+
+- (NSArray *)parseWeightsByReader: (NSString *)xml {
+	XmlTextReader *reader = [[XmlTextReader new] autorelease];
+	NSMutableArray *weights = [NSMutableArray array];
+
+	[reader read: xml nodesAtPath: @"group/thing" context: weights target: self callBack: @selector(readWeightNode:context:)];
+
+	return weights;
+}
+
+/// Generates when xml the way Weight did before mappers were generated.
+- (NSString *)getWhenXmlForDate: (NSDate *)date {
+	NSUInteger calendarUnits = NSDayCalendarUnit | NSMonthCalendarUnit | NSYearCalendarUnit |
+		NSHourCalendarUnit | NSMinuteCalendarUnit | NSSecondCalendarUnit;
+
+	NSCalendar *calendar = [[NSCalendar alloc] initWithCalendarIdentifier: NSGregorianCalendar];
+	[calendar setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
+
+	NSDateComponents *components = [calendar components: calendarUnits fromDate: date];
+	[calendar release];
+
+	return [NSString stringWithFormat:
+		@"<when><date><y>%i</y><m>%i</m><d>%i</d></date><time><h>%i</h><m>%i</m><s>%i</s><f>%i</f></time></when>",
+		[components year], [components month], [components day], [components hour], [components minute], [components second], 0];
+}
+
+/// Generates thing xml the way Weight did before mappers were generated.
+- (NSString *)thingXmlByFormat: (Weight *)weight {
+	NSString *kgsString = [NSString stringWithFormat: @"%f", [weight.display doubleValue] / 2.204];
+
+	NSString *dataXml = [NSString stringWithFormat:
+		@"<data-xml><weight>%@<value><kg>%@</kg><display units=\"pounds\">%@</display></value></weight><common/></data-xml>",
+		[self getWhenXmlForDate: weight.effDate], kgsString, weight.display];
+
+	NSString *effDateString = [[DateTimeUtils dateToUtcString: weight.effDate] substringToIndex: 19];
+
+	return [NSString stringWithFormat:
+		@"<thing><thing-id version-stamp=\"%@\">%@</thing-id><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
+		"<thing-state>Active</thing-state><flags>0</flags><eff-date>%@</eff-date>%@</thing>",
+		weight.versionStamp, weight.weightId, effDateString, dataXml];
+}
+
+/// Decodes record image the way RecordImage did before mappers were generated.
+- (NSData *)imageDataByReader: (NSString *)xml {
+	XmlTextReader *reader = [[XmlTextReader new] autorelease];
+	XmlElement *infoNode = [reader read: xml];
+
+	XmlElement *blobNode = [[[infoNode selectSingleNode: @"group"] selectSingleNode: @"thing"] selectSingleNode: @"blob-payload"];
+	return [[blobNode selectSingleNode: @"blob"] selectSingleNode: @"base64data"].base64Value;
+}
+
+#pragma mark Hand-written baseline End
+
+- (void)testParseWeights {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+	NSString *xml = [BenchmarkTestCase weightsInfoXml: THING_COUNT];
+
+	for (int mapper = 0; mapper < 2; mapper++) {
+		NSAutoreleasePool *runPool = [NSAutoreleasePool new];
+
+		NSUInteger bytesBefore = [BenchmarkTestCase allocatedBytes];
+		double start = [BenchmarkTestCase currentTime];
+
+		NSArray *weights = mapper ? [WeightMapper parseThingsFromXml: xml] : [self parseWeightsByReader: xml];
+
+		double elapsed = [BenchmarkTestCase currentTime] - start;
+		NSInteger bytes = [BenchmarkTestCase allocatedBytes] - bytesBefore;
+
+		STAssertTrue(weights.count == THING_COUNT, @"Received incorrect count of weights");
+		STAssertEqualObjects([[weights lastObject] display], @"199", @"Display of the last weight isn't equal to expected");
+
+		[self report: mapper ? @"Parse weights, WeightMapper" : @"Parse weights, XmlTextReader and XmlPathExtractor"
+			  format: @"%u things: %.0f ns per thing, %.0f heap bytes per thing held by the autorelease pool",
+			THING_COUNT, elapsed * 1e9 / THING_COUNT, (double)bytes / THING_COUNT];
+
+		[runPool release];
+	}
+
+	[pool release];
+}
+
+- (void)testSerializeWeights {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+	NSArray *weights = [WeightMapper parseThingsFromXml: [BenchmarkTestCase weightsInfoXml: THING_COUNT]];
+
+	for (int mapper = 0; mapper < 2; mapper++) {
+		NSAutoreleasePool *runPool = [NSAutoreleasePool new];
+
+		NSUInteger bytesBefore = [BenchmarkTestCase allocatedBytes];
+		double start = [BenchmarkTestCase currentTime];
+
+		NSString *xml = nil;
+
+		if (mapper) {
+			XmlWriter *writer = [[[XmlWriter alloc] initWithCapacity: THING_COUNT * 600] autorelease];
+
+			for (Weight *weight in weights) {
+				[WeightMapper appendThing: weight toWriter: writer];
+			}
+
+			xml = writer.string;
+		}
+		else {
+			NSMutableString *text = [NSMutableString stringWithCapacity: THING_COUNT * 600];
+
+			for (Weight *weight in weights) {
+				[text appendString: [self thingXmlByFormat: weight]];
+			}
+
+			xml = text;
+		}
+
+		double elapsed = [BenchmarkTestCase currentTime] - start;
+		NSInteger bytes = [BenchmarkTestCase allocatedBytes] - bytesBefore;
+
+		STAssertTrue(xml.length > 0, @"Weights haven't been serialized");
+
+		[self report: mapper ? @"Serialize weights, WeightMapper and XmlWriter" : @"Serialize weights, stringWithFormat"
+			  format: @"%u things: %.0f ns per thing, %.0f heap bytes per thing held by the autorelease pool, %u characters",
+			THING_COUNT, elapsed * 1e9 / THING_COUNT, (double)bytes / THING_COUNT, xml.length];
+
+		[runPool release];
+	}
+
+	[pool release];
+}
+
+- (void)testParseImage {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+	NSString *xml = [self getImageXml: IMAGE_SIZE];
+
+	for (int mapper = 0; mapper < 2; mapper++) {
+		NSAutoreleasePool *runPool = [NSAutoreleasePool new];
+
+		NSUInteger residentBefore = [BenchmarkTestCase residentSize];
+		double start = [BenchmarkTestCase currentTime];
+
+		NSData *data = mapper
+			? [[[RecordImageMapper parseThingsFromXml: xml] lastObject] imageData]
+			: [self imageDataByReader: xml];
+
+		double elapsed = [BenchmarkTestCase currentTime] - start;
+		NSInteger resident = [BenchmarkTestCase residentSize] - residentBefore;
+
+		STAssertTrue(data.length == IMAGE_SIZE, @"Image data length isn't equal to expected");
+
+		[self report: mapper ? @"Parse image, RecordImageMapper" : @"Parse image, XmlTextReader tree"
+			  format: @"%u bytes: %.1f ms, resident size grown by %d KB",
+			IMAGE_SIZE, elapsed * 1e3, resident / 1024];
+
+		[runPool release];
+	}
+
+	[pool release];
+}
+
+@end
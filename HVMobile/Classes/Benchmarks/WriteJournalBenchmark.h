@@ -0,0 +1,35 @@
+//
+//  WriteJournalBenchmark.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "BenchmarkTestCase.h"
+
+@class LocalHttpServer;
+@class HealthVaultWriteJournal;
+
+/// Measures appends to the write journal with fsync after every append and with batched fsync,
+/// and replay of 200 weights saved offline to a local server with injected latency:
+/// one request at a time, pipelined, and pipelined with coalescing.
+@interface WriteJournalBenchmark : BenchmarkTestCase {
+
+	LocalHttpServer *_server;
+	/// Journal being replayed.
+	HealthVaultWriteJournal *_journal;
+	BOOL _isDone;
+}
+
+@end
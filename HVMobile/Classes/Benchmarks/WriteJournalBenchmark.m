@@ -0,0 +1,153 @@
+//
+//  WriteJournalBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "WriteJournalBenchmark.h"
+#import "HealthVaultService.h"
+#import "HealthVaultWriteJournal.h"
+#import "HealthVaultConfig.h"
+#import "LocalHttpServer.h"
+#import "Base64.h"
+
+/// Latency of every round trip to the local server, in seconds.
+#define INJECTED_LATENCY 0.15
+
+/// Count of journaled appends.
+#define APPEND_COUNT 1000
+
+/// Count of weights replayed.
+#define REPLAY_COUNT 200
+
+
+@implementation WriteJournalBenchmark
+
++ (HealthVaultRequest *)weightRequest: (NSUInteger)index {
+	NSString *info = [NSString stringWithFormat: @"<info><thing><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
+		"<thing-state>Active</thing-state><flags>0</flags><data-xml><weight>"
+		"<when><date><y>2011</y><m>5</m><d>1</d></date><time><h>10</h><m>%u</m><s>0</s></time></when>"
+		"<value><kg>70</kg><display units=\"pounds\">154.3</display></value></weight><common/></data-xml></thing></info>", index % 60];
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: @"PutThings"
+																	methodVersion: 2
+																	  infoSection: info
+																		   target: nil
+																		 callBack: nil] autorelease];
+	request.recordId = @"record";
+
+	return request;
+}
+
++ (HealthVaultWriteJournal *)emptyJournal: (NSString *)name {
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: name];
+	[[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+
+	return [[[HealthVaultWriteJournal alloc] initWithPath: path] autorelease];
+}
+
+- (void)measureAppends: (NSString *)name syncInterval: (NSTimeInterval)syncInterval {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultWriteJournal *journal = [WriteJournalBenchmark emptyJournal: @"WriteJournalBenchmark.log"];
+	journal.syncInterval = syncInterval;
+
+	double start = [BenchmarkTestCase currentTime];
+
+	for (NSUInteger i = 0; i < APPEND_COUNT; i++) {
+		[journal appendRequest: [WriteJournalBenchmark weightRequest: i] isSending: NO];
+	}
+
+	[journal synchronize];
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u appends: %.1f ms, %.1f us per append, %u fsync calls",
+		APPEND_COUNT, elapsed * 1000, elapsed * 1000000 / APPEND_COUNT, journal.syncCount];
+
+	[pool release];
+}
+
+- (void)writeJournalReplayed: (HealthVaultResponse *)response {
+	STAssertFalse(response.hasError, @"Replay has failed: %@", response.errorText);
+
+	if (_journal.pendingCount == 0) {
+		_isDone = YES;
+	}
+}
+
+- (void)measureReplay: (NSString *)name concurrency: (NSInteger)concurrency coalescedLength: (NSUInteger)coalescedLength {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultWriteJournal *journal = [WriteJournalBenchmark emptyJournal: @"WriteJournalReplayBenchmark.log"];
+	journal.maxCoalescedLength = coalescedLength;
+	_journal = journal;
+
+	for (NSUInteger i = 0; i < REPLAY_COUNT; i++) {
+		[journal appendRequest: [WriteJournalBenchmark weightRequest: i] isSending: NO];
+	}
+
+	HealthVaultService *service = [[[HealthVaultService alloc] initWithUrl: _server.url
+																  shellUrl: nil
+															   masterAppId: @"c55cf02c-7de7-487a-8b8f-f694a7d9d737"] autorelease];
+	service.authorizationSessionToken = @"token";
+	service.sessionSharedSecret = [Base64 encodeBase64WithData: [@"session secret" dataUsingEncoding: NSUTF8StringEncoding]];
+	service.requestQueue.maxConcurrentRequests = concurrency;
+	service.writeJournal = journal;
+	[service setWriteJournalTarget: self callBack: @selector(writeJournalReplayed:)];
+
+	NSUInteger serverRequests = _server.requestCount;
+	_isDone = NO;
+
+	double start = [BenchmarkTestCase currentTime];
+
+	[service replayWriteJournal];
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: 600], @"Replay timeout");
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+
+	[self report: name format: @"%u weights, %.0f ms latency: %.0f ms, %u round trips",
+		REPLAY_COUNT, INJECTED_LATENCY * 1000, elapsed * 1000, _server.requestCount - serverRequests];
+
+	[service cancelWriteJournalReplay];
+	_journal = nil;
+	[pool release];
+}
+
+- (void)testAppend {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	[self measureAppends: @"Append, fsync every append" syncInterval: 0];
+	[self measureAppends: @"Append, batched fsync" syncInterval: DEFAULT_JOURNAL_SYNC_INTERVAL];
+}
+
+- (void)testReplay {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	_server = [LocalHttpServer new];
+	_server.responseDelay = INJECTED_LATENCY;
+	_server.responseBody = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings\"><thing-id>1</thing-id></wc:info></response>";
+	STAssertTrue([_server start], @"Couldn't start local server");
+
+	[self measureReplay: @"Replay one at a time" concurrency: 1 coalescedLength: 0];
+	[self measureReplay: @"Replay pipelined" concurrency: DEFAULT_MAX_CONCURRENT_REQUESTS coalescedLength: 0];
+	[self measureReplay: @"Replay pipelined and coalesced" concurrency: DEFAULT_MAX_CONCURRENT_REQUESTS coalescedLength: DEFAULT_JOURNAL_COALESCED_LENGTH];
+
+	[_server stop];
+	[_server release];
+	_server = nil;
+}
+
+@end
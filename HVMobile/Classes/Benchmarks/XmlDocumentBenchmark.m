@@ -0,0 +1,94 @@
+//
+//  XmlDocumentBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlDocumentBenchmark.h"
+#import "XmlDocument.h"
+#import "XmlTextReader.h"
+
+
+@implementation XmlDocumentBenchmark
+
+/// Reads every thing display value, so both representations are measured with the same access pattern.
+- (NSUInteger)walkThings: (XmlElement *)root {
+	NSUInteger found = 0;
+	NSArray *things = [[root selectSingleNode: @"info/group"] selectNodes: @"thing"];
+
+	for (XmlElement *thing in things) {
+		if ([thing selectSingleNode: @"data-xml/weight/value/display"].text) {
+			found++;
+		}
+	}
+
+	return found;
+}
+
+- (void)measure: (NSString *)name xml: (NSString *)xml count: (NSUInteger)count useDocument: (BOOL)useDocument {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	NSUInteger blocksBefore = [BenchmarkTestCase allocatedBlocks];
+	NSUInteger bytesBefore = [BenchmarkTestCase allocatedBytes];
+	NSUInteger residentBefore = [BenchmarkTestCase residentSize];
+	double start = [BenchmarkTestCase currentTime];
+
+	XmlTextReader *reader = nil;
+	XmlElement *root = nil;
+
+	if (useDocument) {
+		root = [XmlDocument documentWithString: xml].rootElement;
+	}
+	else {
+		reader = [XmlTextReader new];
+		root = [reader read: xml];
+	}
+
+	double parsed = [BenchmarkTestCase currentTime];
+	NSUInteger blocks = [BenchmarkTestCase allocatedBlocks] - blocksBefore;
+	NSUInteger bytes = [BenchmarkTestCase allocatedBytes] - bytesBefore;
+	NSUInteger resident = [BenchmarkTestCase residentSize] - residentBefore;
+
+	NSUInteger found = [self walkThings: root];
+	double walked = [BenchmarkTestCase currentTime];
+
+	STAssertTrue(found == count, @"Received incorrect count of things");
+
+	[self report: name format: @"%u things: parse %.1f ms, walk %.1f ms, %u allocations, %u KB heap, %u KB resident, %u KB peak resident",
+		count, (parsed - start) * 1000, (walked - parsed) * 1000, blocks, bytes / 1024, resident / 1024,
+		[BenchmarkTestCase peakResidentSize] / 1024];
+
+	[reader release];
+	[pool release];
+}
+
+- (void)testParse {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSUInteger counts[] = { 1000, 10000, 100000 };
+
+	for (NSUInteger i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+		NSString *xml = [NSString stringWithFormat: @"<response><status><code>0</code></status>%@</response>", [BenchmarkTestCase weightsInfoXml: counts[i]]];
+
+		// compact document goes first, so peak resident size is not inflated by the tree
+		[self measure: @"XmlDocument" xml: xml count: counts[i] useDocument: YES];
+		[self measure: @"XmlTextReader" xml: xml count: counts[i] useDocument: NO];
+
+		[pool release];
+	}
+}
+
+@end
@@ -0,0 +1,144 @@
+//
+//  XmlPathBenchmark.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlPathBenchmark.h"
+#import "XmlPath.h"
+#import "XmlDocument.h"
+
+/// Count of things in the response.
+#define THING_COUNT 100000
+
+/// Count of fields read from every thing.
+#define FIELD_COUNT 5
+
+/// Ways fields are read.
+typedef enum {
+
+	XmlPathBenchmarkChained,
+	XmlPathBenchmarkStringPaths,
+	XmlPathBenchmarkCompiledPaths,
+	XmlPathBenchmarkExtractor,
+	XmlPathBenchmarkBulkExtractor
+
+} XmlPathBenchmarkMode;
+
+
+@implementation XmlPathBenchmark
+
+/// Reads the fields the way Weight did before paths were compiled.
+- (void)readChained: (XmlElement *)thing values: (NSString **)values {
+	XmlElement *thingIdNode = [thing selectSingleNode: @"thing-id"];
+	values[0] = thingIdNode.text;
+	values[1] = [thingIdNode.attributes objectForKey: @"version-stamp"];
+
+	XmlElement *displayNode = [[[[thing selectSingleNode: @"data-xml"]
+		selectSingleNode: @"weight"] selectSingleNode: @"value"] selectSingleNode: @"display"];
+	values[2] = displayNode.text;
+	values[3] = [displayNode.attributes objectForKey: @"units"];
+
+	values[4] = [thing selectSingleNode: @"eff-date"].text;
+}
+
+- (void)readStringPaths: (XmlElement *)thing values: (NSString **)values {
+	values[0] = [thing selectSingleNode: @"thing-id"].text;
+	values[1] = [[thing selectSingleNode: @"thing-id"] attrValue: @"version-stamp"];
+	values[2] = [thing selectSingleNode: @"data-xml/weight/value/display"].text;
+	values[3] = [[thing selectSingleNode: @"data-xml/weight/value/display"] attrValue: @"units"];
+	values[4] = [thing selectSingleNode: @"eff-date"].text;
+}
+
+- (void)measure: (NSString *)name mode: (XmlPathBenchmarkMode)mode things: (NSArray *)things paths: (NSArray *)paths {
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	XmlPathExtractor *extractor = [[XmlPathExtractor alloc] initWithPaths: paths];
+	NSString **values = malloc(things.count * FIELD_COUNT * sizeof(NSString *));
+
+	NSUInteger blocksBefore = [BenchmarkTestCase allocatedBlocks];
+	double start = [BenchmarkTestCase currentTime];
+
+	if (mode == XmlPathBenchmarkBulkExtractor) {
+		[extractor extractValuesFromElements: things values: values];
+	}
+	else {
+		NSString **thingValues = values;
+
+		for (XmlElement *thing in things) {
+			switch (mode) {
+				case XmlPathBenchmarkChained:
+					[self readChained: thing values: thingValues];
+					break;
+
+				case XmlPathBenchmarkStringPaths:
+					[self readStringPaths: thing values: thingValues];
+					break;
+
+				case XmlPathBenchmarkCompiledPaths:
+					for (NSUInteger i = 0; i < FIELD_COUNT; i++) {
+						thingValues[i] = [thing valueAtPath: [paths objectAtIndex: i]];
+					}
+					break;
+
+				default:
+					[extractor extractValuesFrom: thing values: thingValues];
+					break;
+			}
+
+			thingValues += FIELD_COUNT;
+		}
+	}
+
+	double elapsed = [BenchmarkTestCase currentTime] - start;
+	NSUInteger blocks = [BenchmarkTestCase allocatedBlocks] - blocksBefore;
+
+	STAssertEqualObjects(values[(things.count - 1) * FIELD_COUNT + 2], @"199", @"Display of the last thing isn't equal to expected");
+
+	[self report: name format: @"%u things: %.0f ns per thing, %.1f heap blocks per thing held by the autorelease pool",
+		things.count, elapsed * 1e9 / things.count, (double)blocks / things.count];
+
+	free(values);
+	[extractor release];
+	[pool release];
+}
+
+- (void)testExtract {
+	if (![BenchmarkTestCase isEnabled]) return;
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	XmlDocument *document = [XmlDocument documentWithString: [BenchmarkTestCase weightsInfoXml: THING_COUNT]];
+	NSArray *things = [[document.rootElement selectSingleNode: @"group"] selectNodes: @"thing"];
+	STAssertTrue(things.count == THING_COUNT, @"Received incorrect count of things");
+
+	NSArray *paths = [NSArray arrayWithObjects:
+		[XmlPath pathWithString: @"thing-id"],
+		[XmlPath pathWithString: @"thing-id/@version-stamp"],
+		[XmlPath pathWithString: @"data-xml/weight/value/display"],
+		[XmlPath pathWithString: @"data-xml/weight/value/display/@units"],
+		[XmlPath pathWithString: @"eff-date"],
+		nil];
+
+	[self measure: @"Chained selectSingleNode" mode: XmlPathBenchmarkChained things: things paths: paths];
+	[self measure: @"String paths" mode: XmlPathBenchmarkStringPaths things: things paths: paths];
+	[self measure: @"XmlPath" mode: XmlPathBenchmarkCompiledPaths things: things paths: paths];
+	[self measure: @"XmlPathExtractor per thing" mode: XmlPathBenchmarkExtractor things: things paths: paths];
+	[self measure: @"XmlPathExtractor bulk" mode: XmlPathBenchmarkBulkExtractor things: things paths: paths];
+
+	[pool release];
+}
+
+@end
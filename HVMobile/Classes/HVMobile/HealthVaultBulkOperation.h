@@ -0,0 +1,123 @@
+//
+//  HealthVaultBulkOperation.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#import "HealthVaultRequest.h"
+#import "HealthVaultResponse.h"
+
+@class HealthVaultService;
+
+/// Sends many info elements of one method, like <thing> of PutThings or <thing-id> of RemoveThings,
+/// as several requests instead of one huge request.
+/// Elements are packed into chunks bounded by maxChunkLength characters and maxChunkElements
+/// elements, and up to maxConcurrentChunks chunks are in flight at the same time.
+/// Every chunk succeeds or fails on its own: progress callBack gets the response of each chunk,
+/// the completion callBack gets the operation once all chunks are done.
+@interface HealthVaultBulkOperation : NSObject {
+
+	HealthVaultService *_service;
+	NSString *_methodName;
+	float _methodVersion;
+	NSArray *_elements;
+
+	NSUInteger _maxChunkLength;
+	NSUInteger _maxChunkElements;
+	NSUInteger _maxConcurrentChunks;
+
+	NSObject *_target;
+	SEL _callBack;
+	NSObject *_progressTarget;
+	SEL _progressCallBack;
+
+	/// Ranges of elements of every chunk.
+	NSMutableArray *_chunkRanges;
+	NSUInteger _nextChunk;
+	NSUInteger _runningChunkCount;
+
+	/// Responses by chunk, NSNull until the chunk is completed.
+	NSMutableArray *_responses;
+	NSMutableArray *_failedElements;
+	NSUInteger _completedChunkCount;
+	NSUInteger _failedChunkCount;
+	NSString *_errorText;
+	BOOL _isStarted;
+}
+
+/// Gets or sets the maximum length of the info section of one chunk, in characters.
+/// An element longer than that is sent alone. The default is DEFAULT_BULK_CHUNK_LENGTH.
+@property (assign) NSUInteger maxChunkLength;
+
+/// Gets or sets the maximum count of elements in one chunk.
+/// The default is DEFAULT_BULK_CHUNK_ELEMENTS.
+@property (assign) NSUInteger maxChunkElements;
+
+/// Gets or sets count of chunks which can be in flight at the same time.
+/// The default is DEFAULT_BULK_CONCURRENT_CHUNKS.
+@property (assign) NSUInteger maxConcurrentChunks;
+
+/// Gets count of chunks, known after the operation has started.
+@property (readonly) NSUInteger chunkCount;
+
+/// Gets count of completed chunks, including failed ones.
+@property (readonly) NSUInteger completedChunkCount;
+
+/// Gets count of failed chunks.
+@property (readonly) NSUInteger failedChunkCount;
+
+/// Gets responses of chunks in chunk order.
+@property (readonly) NSArray *responses;
+
+/// Gets elements of failed chunks, they may be sent again.
+@property (readonly) NSArray *failedElements;
+
+/// Gets text of the first error, nil if all chunks have succeeded.
+@property (readonly) NSString *errorText;
+
+/// Indicates whether any chunk has failed.
+@property (readonly, getter=getHasError) BOOL hasError;
+
+/// Initializes a new instance of the HealthVaultBulkOperation class.
+/// @param service - the service requests are sent through.
+/// @param methodName - the name of the method.
+/// @param methodVersion - the version of the method.
+/// @param elements - xml strings of info section elements.
+/// @param target - callback method owner.
+/// @param callBack - method invoked with the operation when all chunks are done.
+- (id)initWithService: (HealthVaultService *)service
+		   methodName: (NSString *)methodName
+		methodVersion: (float)methodVersion
+			 elements: (NSArray *)elements
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack;
+
+/// Sets method invoked with HealthVaultResponse of every chunk.
+/// @param target - callback method owner.
+/// @param callBack - the method.
+- (void)setProgressTarget: (NSObject *)target callBack: (SEL)callBack;
+
+/// Splits elements into chunks and starts sending them.
+- (void)start;
+
+/// Creates element which identifies a thing in RemoveThings info section.
+/// @param thingId - the thing id.
+/// @param versionStamp - the version stamp.
+/// @returns <thing-id> element.
++ (NSString *)thingIdElement: (NSString *)thingId versionStamp: (NSString *)versionStamp;
+
+@end
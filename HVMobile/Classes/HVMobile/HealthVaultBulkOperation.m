@@ -0,0 +1,256 @@
+//
+//  HealthVaultBulkOperation.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultBulkOperation.h"
+#import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+
+/// Length of <info></info> around chunk elements.
+#define INFO_TAGS_LENGTH 13
+
+
+@interface HealthVaultBulkOperation (Private)
+
+/// Splits elements into chunks bounded by length and count.
+- (void)makeChunks;
+
+/// Sends chunks while there are free slots.
+- (void)sendChunks;
+
+/// Handles response of one chunk.
+/// @param response - the response of the chunk.
+- (void)chunkCompleted: (HealthVaultResponse *)response;
+
+@end
+
+
+@implementation HealthVaultBulkOperation
+
+@synthesize maxChunkLength = _maxChunkLength;
+@synthesize maxChunkElements = _maxChunkElements;
+@synthesize maxConcurrentChunks = _maxConcurrentChunks;
+@synthesize completedChunkCount = _completedChunkCount;
+@synthesize failedChunkCount = _failedChunkCount;
+@synthesize responses = _responses;
+@synthesize failedElements = _failedElements;
+@synthesize errorText = _errorText;
+
+- (id)initWithService: (HealthVaultService *)service
+		   methodName: (NSString *)methodName
+		methodVersion: (float)methodVersion
+			 elements: (NSArray *)elements
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack {
+
+	if ((self = [super init])) {
+
+		_service = [service retain];
+		_methodName = [methodName copy];
+		_methodVersion = methodVersion;
+		_elements = [elements copy];
+		_target = [target retain];
+		_callBack = callBack;
+
+		_chunkRanges = [NSMutableArray new];
+		_responses = [NSMutableArray new];
+		_failedElements = [NSMutableArray new];
+
+		self.maxChunkLength = DEFAULT_BULK_CHUNK_LENGTH;
+		self.maxChunkElements = DEFAULT_BULK_CHUNK_ELEMENTS;
+		self.maxConcurrentChunks = DEFAULT_BULK_CONCURRENT_CHUNKS;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_service release];
+	[_methodName release];
+	[_elements release];
+	[_target release];
+	[_progressTarget release];
+	[_chunkRanges release];
+	[_responses release];
+	[_failedElements release];
+	[_errorText release];
+
+	[super dealloc];
+}
+
+- (void)setProgressTarget: (NSObject *)target callBack: (SEL)callBack {
+
+	[_progressTarget release];
+	_progressTarget = [target retain];
+	_progressCallBack = callBack;
+}
+
+- (NSUInteger)chunkCount {
+
+	return _chunkRanges.count;
+}
+
+- (BOOL)getHasError {
+
+	return _failedChunkCount > 0;
+}
+
++ (NSString *)thingIdElement: (NSString *)thingId versionStamp: (NSString *)versionStamp {
+
+	return [NSString stringWithFormat: @"<thing-id version-stamp=\"%@\">%@</thing-id>", versionStamp, thingId];
+}
+
+- (void)start {
+
+	if (_isStarted) {
+		return;
+	}
+
+	_isStarted = YES;
+
+	[self makeChunks];
+
+	for (NSUInteger i = 0; i < _chunkRanges.count; i++) {
+		[_responses addObject: [NSNull null]];
+	}
+
+	// Nothing to send, the operation is complete at once.
+	if (_chunkRanges.count == 0) {
+
+		[self chunkCompleted: nil];
+		return;
+	}
+
+	[self sendChunks];
+}
+
+- (void)makeChunks {
+
+	NSUInteger start = 0;
+	NSUInteger length = INFO_TAGS_LENGTH;
+
+	for (NSUInteger i = 0; i < _elements.count; i++) {
+
+		NSUInteger elementLength = [[_elements objectAtIndex: i] length];
+		BOOL isFull = i - start >= self.maxChunkElements || length + elementLength > self.maxChunkLength;
+
+		// A chunk gets at least one element, however long it is.
+		if (isFull && i > start) {
+
+			[_chunkRanges addObject: [NSValue valueWithRange: NSMakeRange(start, i - start)]];
+			start = i;
+			length = INFO_TAGS_LENGTH;
+		}
+
+		length += elementLength;
+	}
+
+	if (_elements.count > start) {
+		[_chunkRanges addObject: [NSValue valueWithRange: NSMakeRange(start, _elements.count - start)]];
+	}
+}
+
+- (void)sendChunks {
+
+	while (_runningChunkCount < MAX(self.maxConcurrentChunks, 1) && _nextChunk < _chunkRanges.count) {
+
+		NSRange range = [[_chunkRanges objectAtIndex: _nextChunk] rangeValue];
+
+		NSUInteger length = INFO_TAGS_LENGTH;
+		for (NSUInteger i = range.location; i < NSMaxRange(range); i++) {
+			length += [[_elements objectAtIndex: i] length];
+		}
+
+		// The chunk is built in one buffer of its final size.
+		NSMutableString *info = [[NSMutableString alloc] initWithCapacity: length];
+		[info appendString: @"<info>"];
+
+		for (NSUInteger i = range.location; i < NSMaxRange(range); i++) {
+			[info appendString: [_elements objectAtIndex: i]];
+		}
+
+		[info appendString: @"</info>"];
+
+		HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: _methodName
+																	   methodVersion: _methodVersion
+																		 infoSection: info
+																			  target: self
+																			callBack: @selector(chunkCompleted:)];
+		request.userState = [NSNumber numberWithUnsignedInteger: _nextChunk];
+
+		_nextChunk++;
+		_runningChunkCount++;
+
+		[_service sendRequest: request];
+
+		[request release];
+		[info release];
+	}
+}
+
+- (void)chunkCompleted: (HealthVaultResponse *)response {
+
+	if (response) {
+
+		NSUInteger chunk = [(NSNumber *)response.request.userState unsignedIntegerValue];
+
+		_runningChunkCount--;
+		_completedChunkCount++;
+		[_responses replaceObjectAtIndex: chunk withObject: response];
+
+		if (response.hasError) {
+
+			_failedChunkCount++;
+
+			NSRange range = [[_chunkRanges objectAtIndex: chunk] rangeValue];
+			[_failedElements addObjectsFromArray: [_elements subarrayWithRange: range]];
+
+			if (!_errorText) {
+				_errorText = [response.errorText copy];
+			}
+		}
+
+		if (_progressTarget && [_progressTarget respondsToSelector: _progressCallBack]) {
+
+			[_progressTarget performSelector: _progressCallBack
+								  withObject: response];
+		}
+
+		[self sendChunks];
+
+		if (_completedChunkCount < _chunkRanges.count) {
+			return;
+		}
+	}
+
+	// Keeps the operation alive while the callback runs, targets are released to break cycles.
+	[[self retain] autorelease];
+
+	if (_target && [_target respondsToSelector: _callBack]) {
+
+		[_target performSelector: _callBack
+					  withObject: self];
+	}
+
+	[_target release];
+	_target = nil;
+	[_progressTarget release];
+	_progressTarget = nil;
+}
+
+@end
@@ -38,4 +38,64 @@
 #define DEFAULT_LANGUAGE @"en"
 
 /// default country code identifier
-#define DEFAULT_COUNTRY @"US"
\ No newline at end of file
+#define DEFAULT_COUNTRY @"US"
+
+/// default count of HealthVault requests which can be in flight at the same time
+#define DEFAULT_MAX_CONCURRENT_REQUESTS 4
+
+/// default count of requests and responses the processing queue of the service works on at the same time
+#define DEFAULT_MAX_CONCURRENT_PROCESSING 2
+
+/// default time requests are collected for one batch, in seconds
+#define DEFAULT_BATCH_WINDOW 0.05
+
+/// default maximum count of requests merged into one batch
+#define DEFAULT_MAX_BATCH_SIZE 16
+
+/// default count of full things returned in one page of GetThings results
+#define DEFAULT_THING_PAGE_SIZE 30
+
+/// default maximum length of the info section of one bulk operation chunk, in characters
+#define DEFAULT_BULK_CHUNK_LENGTH (64 * 1024)
+
+/// default maximum count of elements in one bulk operation chunk
+#define DEFAULT_BULK_CHUNK_ELEMENTS 100
+
+/// default count of bulk operation chunks which can be in flight at the same time
+#define DEFAULT_BULK_CONCURRENT_CHUNKS 2
+
+/// default size of responses kept in memory by HealthVaultResponseCache, in bytes
+#define DEFAULT_RESPONSE_CACHE_MEMORY_SIZE (512 * 1024)
+
+/// default size of responses kept on disk by HealthVaultResponseCache, in bytes
+#define DEFAULT_RESPONSE_CACHE_DISK_SIZE (4 * 1024 * 1024)
+
+/// default delay of fsync after an append to the write journal, in seconds
+#define DEFAULT_JOURNAL_SYNC_INTERVAL 0.05
+
+/// default maximum length of the info section of coalesced journaled requests, in characters
+#define DEFAULT_JOURNAL_COALESCED_LENGTH (64 * 1024)
+
+/// default time after which journaled requests which couldn't be delivered are sent again, in seconds
+#define DEFAULT_JOURNAL_REPLAY_INTERVAL 30
+
+/// default count of times a request is sent again after a transient failure
+#define DEFAULT_MAX_RETRY_COUNT 3
+
+/// default delay before the first retry, in seconds; it doubles with every further retry
+#define DEFAULT_RETRY_BASE_DELAY 0.5
+
+/// default maximum delay before a retry, in seconds
+#define DEFAULT_RETRY_MAX_DELAY 30
+
+/// default count of retries which can be made without successful requests in between
+#define DEFAULT_RETRY_BUDGET 10
+
+/// default share of a retry every successful request adds to the retry budget
+#define DEFAULT_RETRY_BUDGET_RATIO 0.1
+
+/// default lifetime of the session token returned by CreateAuthenticatedSessionToken, in seconds
+#define DEFAULT_SESSION_TOKEN_LIFETIME (4 * 60 * 60)
+
+/// default time before the session token expires when it is renewed, in seconds
+#define DEFAULT_SESSION_TOKEN_RENEWAL_MARGIN (5 * 60)
@@ -0,0 +1,58 @@
+//
+//  HealthVaultMetricsHistogram.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "HealthVaultRequestMetrics.h"
+
+
+/// Metrics sink which keeps latency histograms of every stage, per method, in memory.
+/// Buckets grow geometrically, so percentiles are within 9% of the exact value whatever
+/// the count of requests is, and memory doesn't grow with it.
+@interface HealthVaultMetricsHistogram : NSObject <HealthVaultMetricsSink> {
+
+	/// Histograms of methods, NSMutableData holding MethodHistogram by method name.
+	NSMutableDictionary *_histograms;
+}
+
+/// Gets names of methods which have completed requests, sorted.
+@property (readonly) NSArray *methodNames;
+
+/// Returns count of completed requests of the method.
+/// @param methodName - the name of the method.
+- (NSUInteger)countForMethod: (NSString *)methodName;
+
+/// Returns count of failed requests of the method.
+/// @param methodName - the name of the method.
+- (NSUInteger)errorCountForMethod: (NSString *)methodName;
+
+/// Returns duration of the stage which the given percent of requests of the method haven't exceeded.
+/// @param percentile - the percentile, from 0 to 100, e.g. 50, 95 or 99.
+/// @param stage - the stage.
+/// @param methodName - the name of the method.
+/// @returns the duration in seconds, 0 if there are no requests of the method.
+- (NSTimeInterval)percentile: (double)percentile
+					 ofStage: (HealthVaultRequestStage)stage
+				   forMethod: (NSString *)methodName;
+
+/// Returns text with request counts, average sizes and p50/p95/p99 of every stage, per method.
+- (NSString *)report;
+
+/// Forgets all requests.
+- (void)reset;
+
+@end
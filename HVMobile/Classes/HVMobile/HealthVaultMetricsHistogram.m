@@ -0,0 +1,212 @@
+//
+//  HealthVaultMetricsHistogram.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultMetricsHistogram.h"
+
+/// Upper bound of the first bucket, in seconds; shorter durations are not told apart.
+#define HISTOGRAM_MIN_DURATION 0.00001
+
+/// Count of buckets per doubling of the duration.
+#define HISTOGRAM_BUCKETS_PER_OCTAVE 8
+
+/// Count of buckets, they cover durations up to HISTOGRAM_MIN_DURATION * 2^30, about 3 hours.
+#define HISTOGRAM_BUCKET_COUNT (1 + 30 * HISTOGRAM_BUCKETS_PER_OCTAVE)
+
+/// Counters of one method.
+typedef struct {
+
+	NSUInteger count;
+	NSUInteger errorCount;
+	NSUInteger retryCount;
+	NSUInteger refreshCount;
+	NSUInteger cachedCount;
+	unsigned long long requestBytes;
+	unsigned long long responseBytes;
+
+	NSTimeInterval maxDurations[HealthVaultRequestStageCount];
+	uint32_t buckets[HealthVaultRequestStageCount][HISTOGRAM_BUCKET_COUNT];
+} MethodHistogram;
+
+#pragma mark Helpers
+
+/// Returns index of the bucket which counts the duration.
+static NSUInteger BucketOfDuration(NSTimeInterval duration) {
+
+	if (duration < HISTOGRAM_MIN_DURATION) {
+		return 0;
+	}
+
+	NSUInteger bucket = 1 + (NSUInteger)(log2(duration / HISTOGRAM_MIN_DURATION) * HISTOGRAM_BUCKETS_PER_OCTAVE);
+
+	return MIN(bucket, HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+/// Returns upper bound of durations counted by the bucket.
+static NSTimeInterval UpperBoundOfBucket(NSUInteger bucket) {
+
+	return HISTOGRAM_MIN_DURATION * exp2((double)bucket / HISTOGRAM_BUCKETS_PER_OCTAVE);
+}
+
+#pragma mark Helpers End
+
+
+@interface HealthVaultMetricsHistogram (Private)
+
+/// Returns histogram of the method, NULL if the method has no requests.
+/// @param methodName - the name of the method.
+- (MethodHistogram *)histogramForMethod: (NSString *)methodName;
+
+@end
+
+
+@implementation HealthVaultMetricsHistogram
+
+- (id)init {
+
+	if ((self = [super init])) {
+
+		_histograms = [NSMutableDictionary new];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_histograms release];
+
+	[super dealloc];
+}
+
+- (MethodHistogram *)histogramForMethod: (NSString *)methodName {
+
+	NSMutableData *data = methodName ? [_histograms objectForKey: methodName] : nil;
+
+	return data ? (MethodHistogram *)data.mutableBytes : NULL;
+}
+
+- (void)requestCompleted: (HealthVaultRequestMetrics *)metrics {
+
+	NSString *methodName = metrics.methodName ? metrics.methodName : @"";
+	MethodHistogram *histogram = [self histogramForMethod: methodName];
+
+	if (!histogram) {
+
+		// the data is zero filled
+		NSMutableData *data = [NSMutableData dataWithLength: sizeof(MethodHistogram)];
+		[_histograms setObject: data forKey: methodName];
+
+		histogram = (MethodHistogram *)data.mutableBytes;
+	}
+
+	histogram->count++;
+	histogram->errorCount += metrics.hasError ? 1 : 0;
+	histogram->retryCount += metrics.retryCount;
+	histogram->refreshCount += metrics.refreshCount;
+	histogram->cachedCount += metrics.isCached ? 1 : 0;
+	histogram->requestBytes += metrics.requestBytes;
+	histogram->responseBytes += metrics.responseBytes;
+
+	for (NSUInteger stage = 0; stage < HealthVaultRequestStageCount; stage++) {
+
+		NSTimeInterval duration = [metrics durationOfStage: stage];
+
+		histogram->buckets[stage][BucketOfDuration(duration)]++;
+		histogram->maxDurations[stage] = MAX(histogram->maxDurations[stage], duration);
+	}
+}
+
+- (NSArray *)methodNames {
+
+	return [[_histograms allKeys] sortedArrayUsingSelector: @selector(compare:)];
+}
+
+- (NSUInteger)countForMethod: (NSString *)methodName {
+
+	MethodHistogram *histogram = [self histogramForMethod: methodName];
+
+	return histogram ? histogram->count : 0;
+}
+
+- (NSUInteger)errorCountForMethod: (NSString *)methodName {
+
+	MethodHistogram *histogram = [self histogramForMethod: methodName];
+
+	return histogram ? histogram->errorCount : 0;
+}
+
+- (NSTimeInterval)percentile: (double)percentile
+					 ofStage: (HealthVaultRequestStage)stage
+				   forMethod: (NSString *)methodName {
+
+	MethodHistogram *histogram = [self histogramForMethod: methodName];
+
+	if (!histogram || histogram->count == 0 || stage >= HealthVaultRequestStageCount) {
+		return 0;
+	}
+
+	// the smallest duration at least the given share of requests haven't exceeded
+	NSUInteger rank = (NSUInteger)ceil(MAX(MIN(percentile, 100), 0) / 100 * histogram->count);
+	rank = MAX(rank, 1);
+
+	NSUInteger counted = 0;
+
+	for (NSUInteger bucket = 0; bucket < HISTOGRAM_BUCKET_COUNT; bucket++) {
+
+		counted += histogram->buckets[stage][bucket];
+
+		if (counted >= rank) {
+			return MIN(UpperBoundOfBucket(bucket), histogram->maxDurations[stage]);
+		}
+	}
+
+	return histogram->maxDurations[stage];
+}
+
+- (NSString *)report {
+
+	NSMutableString *report = [NSMutableString string];
+
+	for (NSString *methodName in self.methodNames) {
+
+		MethodHistogram *histogram = [self histogramForMethod: methodName];
+
+		[report appendFormat: @"%@: %u requests, %u failed, %u cached, %u retries, %u token waits, %llu bytes sent, %llu bytes received on average\n",
+		 methodName, histogram->count, histogram->errorCount, histogram->cachedCount, histogram->retryCount, histogram->refreshCount,
+		 histogram->requestBytes / histogram->count, histogram->responseBytes / histogram->count];
+
+		for (NSUInteger stage = 0; stage < HealthVaultRequestStageCount; stage++) {
+
+			[report appendFormat: @"\t%@: p50 %.4f s, p95 %.4f s, p99 %.4f s, max %.4f s\n",
+			 [HealthVaultRequestMetrics nameOfStage: stage],
+			 [self percentile: 50 ofStage: stage forMethod: methodName],
+			 [self percentile: 95 ofStage: stage forMethod: methodName],
+			 [self percentile: 99 ofStage: stage forMethod: methodName],
+			 histogram->maxDurations[stage]];
+		}
+	}
+
+	return report;
+}
+
+- (void)reset {
+
+	[_histograms removeAllObjects];
+}
+
+@end
@@ -18,6 +18,9 @@
 
 #import <Foundation/Foundation.h>
 
+@class HealthVaultRequestMetrics;
+@class HealthVaultResponse;
+
 /// This class encapsulates the data that is contained in a request.
 @interface HealthVaultRequest : NSObject {
 
@@ -35,11 +38,19 @@
 	NSString *_country;
 	NSDate *_msgTime;
 	int _msgTTL;
+	NSInteger _priority;
+	NSUInteger _retryCount;
 
 	NSObject *_userState;
+	NSString *_infoHash;
+	HealthVaultRequestMetrics *_metrics;
+
+	NSObject *_resultTarget;
+	SEL _resultParser;
 
 	NSObject *_target;
 	SEL _callBack;
+	NSOperationQueue *_callBackQueue;
 }
 
 /// Gets or sets the name of the method to be called.
@@ -85,16 +96,44 @@
 /// Gets or sets request msg-ttl parameter.
 @property (assign) int msgTTL;
 
+/// Gets or sets the priority of the request in the service request queue.
+/// Requests with higher priority are sent first, the default is WEB_REQUEST_PRIORITY_NORMAL.
+@property (assign) NSInteger priority;
+
+/// Gets or sets count of times the request has been sent again after a transient failure.
+@property (assign) NSUInteger retryCount;
+
+/// Gets base64-encoded SHA 256 hash of the info section written by the last toXmlData call,
+/// nil if the request hasn't been serialized or the method isn't hashed.
+@property (readonly) NSString *infoHash;
+
+/// Gets or sets timing span of the request which is in flight, nil if metrics aren't collected.
+/// toXmlData adds serialization and signing time to it.
+@property (retain) HealthVaultRequestMetrics *metrics;
+
 /// Gets or sets the user state.
 /// User state can be used by the caller to pass state to the handler.
 @property (retain) NSObject *userState;
 
+/// Gets or sets the object which turns the response into a typed result, nil by default.
+@property (retain) NSObject *resultTarget;
+
+/// Gets or sets the method of resultTarget which takes the HealthVaultResponse and returns
+/// the result, stored as its result property. It is not invoked for failed responses.
+/// If the service has a processingQueue, the parser runs there, so it mustn't touch
+/// objects owned by the thread the service is used on.
+@property (assign) SEL resultParser;
+
 /// Gets or sets the callback handler.
 @property (retain) NSObject *target;
 
 /// Gets or sets the callback that will be called when the request has completed.
 @property (assign) SEL callBack;
 
+/// Gets or sets the queue the callBack is invoked on, nil by default.
+/// Without it, the callBack is invoked on the thread the service is used on.
+@property (retain) NSOperationQueue *callBackQueue;
+
 /// Initializes a new instance of the HealthVaultRequest class.
 /// @param name - the name of the method.
 /// @param methodVersion - the version of the method.
@@ -115,4 +154,19 @@
 /// @returns xml representation of the request.
 - (NSString *)toXml;
 
+/// Serializes the request into UTF-8 encoded xml ready to be sent as HTTP body.
+/// The envelope is written once into a single buffer; the info hash and the header HMAC
+/// are computed over the byte ranges of the buffer and written into slots reserved for them.
+/// @returns UTF-8 encoded xml representation of the request.
+- (NSData *)toXmlData;
+
+/// Invokes the result parser.
+/// @param response - the response to the request.
+/// @returns the result, nil if there is no parser or the response has failed.
+- (id)resultForResponse: (HealthVaultResponse *)response;
+
+/// Invokes the callBack with the response, on the callBackQueue if there is one.
+/// @param response - the response to the request.
+- (void)performCallBack: (HealthVaultResponse *)response;
+
 @end
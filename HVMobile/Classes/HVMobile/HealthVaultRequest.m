@@ -17,10 +17,105 @@
 // limitations under the License.
 
 #import "HealthVaultRequest.h"
+#import "HealthVaultRequestMetrics.h"
+#import "HealthVaultResponse.h"
 #import "DateTimeUtils.h"
 #import "MobilePlatform.h"
 #import "Base64.h"
 
+/// Capacity reserved for the envelope in addition to the info section.
+#define REQUEST_ENVELOPE_CAPACITY 1024
+
+/// Length of base64-encoded SHA 256 digest.
+#define SHA256_BASE64_LENGTH 44
+
+/// Appends string literal to the buffer.
+#define APPEND_LITERAL(buffer, literal) [buffer appendBytes: literal length: sizeof(literal) - 1]
+
+#pragma mark Helpers
+
+/// Appends UTF-8 representation of the string directly to the buffer.
+static void AppendString(NSMutableData *buffer, NSString *string) {
+
+	NSUInteger length = [string lengthOfBytesUsingEncoding: NSUTF8StringEncoding];
+	if (length == 0) {
+		return;
+	}
+
+	NSUInteger offset = buffer.length;
+	[buffer increaseLengthBy: length];
+
+	[string getBytes: (uint8_t *)buffer.mutableBytes + offset
+		   maxLength: length
+		  usedLength: NULL
+			encoding: NSUTF8StringEncoding
+			 options: 0
+			   range: NSMakeRange(0, string.length)
+	  remainingRange: NULL];
+}
+
+/// Appends element with text value, <name>value</name>.
+/// Missing value is written the way %@ formats nil, so signed headers stay the same as before.
+static void AppendElement(NSMutableData *buffer, const char *name, NSString *value) {
+
+	size_t nameLength = strlen(name);
+
+	APPEND_LITERAL(buffer, "<");
+	[buffer appendBytes: name length: nameLength];
+	APPEND_LITERAL(buffer, ">");
+
+	if (value) {
+		AppendString(buffer, value);
+	}
+	else {
+		APPEND_LITERAL(buffer, "(null)");
+	}
+
+	APPEND_LITERAL(buffer, "</");
+	[buffer appendBytes: name length: nameLength];
+	APPEND_LITERAL(buffer, ">");
+}
+
+/// Appends element with C string value.
+static void AppendCStringElement(NSMutableData *buffer, const char *name, const char *value) {
+
+	size_t nameLength = strlen(name);
+
+	APPEND_LITERAL(buffer, "<");
+	[buffer appendBytes: name length: nameLength];
+	APPEND_LITERAL(buffer, ">");
+
+	[buffer appendBytes: value length: strlen(value)];
+
+	APPEND_LITERAL(buffer, "</");
+	[buffer appendBytes: name length: nameLength];
+	APPEND_LITERAL(buffer, ">");
+}
+
+/// Reserves room for base64-encoded digest.
+/// @returns offset of the reserved range.
+static NSUInteger ReserveDigest(NSMutableData *buffer) {
+
+	NSUInteger offset = buffer.length;
+	[buffer increaseLengthBy: SHA256_BASE64_LENGTH];
+
+	return offset;
+}
+
+/// Writes base64-encoded digest into the reserved range.
+static void WriteDigest(NSMutableData *buffer, NSUInteger offset, NSString *digest) {
+
+	[digest getBytes: (uint8_t *)buffer.mutableBytes + offset
+		   maxLength: SHA256_BASE64_LENGTH
+		  usedLength: NULL
+			encoding: NSASCIIStringEncoding
+			 options: 0
+			   range: NSMakeRange(0, MIN(digest.length, SHA256_BASE64_LENGTH))
+	  remainingRange: NULL];
+}
+
+#pragma mark Helpers End
+
 
 @implementation HealthVaultRequest
 
@@ -38,10 +133,18 @@
 @synthesize country = _country;
 @synthesize msgTime = _msgTime;
 @synthesize msgTTL = _msgTTL;
+@synthesize priority = _priority;
+@synthesize retryCount = _retryCount;
 @synthesize userState = _userState;
+@synthesize infoHash = _infoHash;
+@synthesize metrics = _metrics;
+
+@synthesize resultTarget = _resultTarget;
+@synthesize resultParser = _resultParser;
 
 @synthesize target = _target;
 @synthesize callBack = _callBack;
+@synthesize callBackQueue = _callBackQueue;
 
 - (id)initWithMethodName: (NSString *)name
 		   methodVersion: (float)methodVersion
@@ -81,86 +184,180 @@
 	self.country = nil;
 	self.msgTime = nil;
 	self.userState = nil;
+	[_infoHash release];
+	self.metrics = nil;
+	self.resultTarget = nil;
 
 	self.target = nil;
+	self.callBackQueue = nil;
 
 	[super dealloc];
 }
 
 - (NSString *)toXml {
 
-	NSMutableString *xml = [NSMutableString new];
+	return [[[NSString alloc] initWithData: [self toXmlData] encoding: NSUTF8StringEncoding] autorelease];
+}
+
+- (NSData *)toXmlData {
+
+	NSTimeInterval startTime = _metrics ? [NSDate timeIntervalSinceReferenceDate] : 0;
+
+	BOOL isCreateAuthSessionTokenMethod = [@"CreateAuthenticatedSessionToken" compare: self.methodName] == NSOrderedSame;
+	BOOL isSigned = self.sessionSharedSecret && !isCreateAuthSessionTokenMethod;
+
+	NSMutableData *xml = [NSMutableData dataWithCapacity: REQUEST_ENVELOPE_CAPACITY + self.infoXml.length];
 
-	[xml appendString:@"<wc-request:request xmlns:wc-request=\"urn:com.microsoft.wc.request\">"];
+	APPEND_LITERAL(xml, "<wc-request:request xmlns:wc-request=\"urn:com.microsoft.wc.request\">");
 
-	NSMutableString *header = [NSMutableString new];
+	// auth precedes the header it signs, the HMAC is written when the header is complete
+	NSUInteger hmacOffset = NSNotFound;
 
-	[header appendString: @"<header>"];
+	if (isSigned) {
 
-	[header appendFormat: @"<method>%@</method>", self.methodName];
-	[header appendFormat: @"<method-version>%.0f</method-version>", self.methodVersion];
+		APPEND_LITERAL(xml, "<auth><hmac-data algName=\"HMACSHA256\">");
+		hmacOffset = ReserveDigest(xml);
+		APPEND_LITERAL(xml, "</hmac-data></auth>");
+	}
+
+	NSUInteger headerOffset = xml.length;
+	char number[32];
+
+	APPEND_LITERAL(xml, "<header>");
+
+	AppendElement(xml, "method", self.methodName);
+
+	snprintf(number, sizeof(number), "%.0f", self.methodVersion);
+	AppendCStringElement(xml, "method-version", number);
 
 	if (self.recordId) {
-		[header appendFormat: @"<record-id>%@</record-id>", self.recordId];
+		AppendElement(xml, "record-id", self.recordId);
 	}
 
 	if (self.authorizationSessionToken && self.authorizationSessionToken.length > 0) {
 
-		[header appendString: @"<auth-session>"];
-		[header appendFormat: @"<auth-token>%@</auth-token>", self.authorizationSessionToken];
+		APPEND_LITERAL(xml, "<auth-session>");
+		AppendElement(xml, "auth-token", self.authorizationSessionToken);
 
 		if (self.personId) {
 
-			[header appendString: @"<offline-person-info>"];
-			[header appendFormat: @"<offline-person-id>%@</offline-person-id>", self.personId];
-			[header appendString: @"</offline-person-info>"];
+			APPEND_LITERAL(xml, "<offline-person-info>");
+			AppendElement(xml, "offline-person-id", self.personId);
+			APPEND_LITERAL(xml, "</offline-person-info>");
 		}
 
-		[header appendString: @"</auth-session>"];
+		APPEND_LITERAL(xml, "</auth-session>");
 	}
 	else {
 
-		[header appendFormat: @"<app-id>%@</app-id>", self.appIdInstance];
+		AppendElement(xml, "app-id", self.appIdInstance);
 	}
 
-	[header appendFormat: @"<language>%@</language>", self.language];
-	[header appendFormat: @"<country>%@</country>", self.country];
+	AppendElement(xml, "language", self.language);
+	AppendElement(xml, "country", self.country);
 
+	// the timestamp is written straight from the stack buffer
+	char msgTime[DATE_TIME_UTC_STRING_LENGTH + 1];
+	NSUInteger msgTimeLength = self.msgTime ? [DateTimeUtils formatUtcTime: [self.msgTime timeIntervalSinceReferenceDate] toBuffer: msgTime] : 0;
 
-	[header appendFormat: @"<msg-time>%@</msg-time>", [DateTimeUtils dateToUtcString:self.msgTime]];
-	[header appendFormat: @"<msg-ttl>%d</msg-ttl>", self.msgTTL];
-	[header appendFormat: @"<version>%@</version>", [MobilePlatform platformAbbreviationAndVersion]];
+	if (msgTimeLength > 0) {
 
-	NSMutableString *infoString = [NSMutableString new];
-	if (self.infoXml) {
-		[infoString appendFormat: @"%@", self.infoXml];
-	} else {
-		[infoString appendFormat: @"<info />"];
+		msgTime[msgTimeLength] = 0;
+		AppendCStringElement(xml, "msg-time", msgTime);
 	}
-	
-	BOOL isCreateAuthSessionTokenMethod = [@"CreateAuthenticatedSessionToken" compare: self.methodName] == NSOrderedSame;
+	else {
+		AppendElement(xml, "msg-time", nil);
+	}
+
+	snprintf(number, sizeof(number), "%d", self.msgTTL);
+	AppendCStringElement(xml, "msg-ttl", number);
+
+	AppendElement(xml, "version", [MobilePlatform platformAbbreviationAndVersion]);
+
+	// info follows the header, the hash is written when the info is complete
+	NSUInteger hashOffset = NSNotFound;
 
 	if (!isCreateAuthSessionTokenMethod) {
-		
-		[header appendFormat: @"<info-hash>%@</info-hash>", [MobilePlatform computeSha256HashAndWrap:infoString]];
+
+		APPEND_LITERAL(xml, "<info-hash><hash-data algName=\"SHA256\">");
+		hashOffset = ReserveDigest(xml);
+		APPEND_LITERAL(xml, "</hash-data></info-hash>");
+	}
+
+	APPEND_LITERAL(xml, "</header>");
+
+	NSUInteger headerLength = xml.length - headerOffset;
+	NSUInteger infoOffset = xml.length;
+
+	if (self.infoXml) {
+		AppendString(xml, self.infoXml);
+	}
+	else {
+		APPEND_LITERAL(xml, "<info />");
 	}
 
-	[header appendString: @"</header>"];
+	NSUInteger infoLength = xml.length - infoOffset;
+
+	APPEND_LITERAL(xml, "</wc-request:request>");
+
+	NSTimeInterval signTime = _metrics ? [NSDate timeIntervalSinceReferenceDate] : 0;
+
+	if (hashOffset != NSNotFound) {
+
+		NSString *hash = [MobilePlatform computeSha256HashOfBytes: (const uint8_t *)xml.bytes + infoOffset length: infoLength];
+		WriteDigest(xml, hashOffset, hash);
+
+		[_infoHash release];
+		_infoHash = [hash retain];
+	}
+
+	// the header is signed after the info hash has been written into it
+	if (hmacOffset != NSNotFound) {
 
-	if (self.sessionSharedSecret && !isCreateAuthSessionTokenMethod) {
 		NSData *decodedKey = [Base64 decodeBase64WithString: self.sessionSharedSecret];
+		NSString *hmac = [MobilePlatform computeSha256HmacOfBytes: (const uint8_t *)xml.bytes + headerOffset
+															length: headerLength
+															   key: decodedKey];
+		WriteDigest(xml, hmacOffset, hmac);
+	}
+
+	if (_metrics) {
+
+		[_metrics addDuration: signTime - startTime toStage: HealthVaultRequestStageSerialize];
+		[_metrics addDuration: [NSDate timeIntervalSinceReferenceDate] - signTime toStage: HealthVaultRequestStageSign];
+	}
+
+	return xml;
+}
+
+- (id)resultForResponse: (HealthVaultResponse *)response {
+
+	if (response.hasError || !self.resultTarget || ![self.resultTarget respondsToSelector: self.resultParser]) {
+		return nil;
+	}
+
+	return [self.resultTarget performSelector: self.resultParser
+								   withObject: response];
+}
 
-		[xml appendFormat: @"<auth>%@</auth>", [MobilePlatform computeSha256HmacAndWrap: decodedKey : header]];
+- (void)performCallBack: (HealthVaultResponse *)response {
+
+	if (!self.target || ![self.target respondsToSelector: self.callBack]) {
+		return;
 	}
 
-	[xml appendString: header];
-	[xml appendFormat: @"%@", infoString];
+	if (self.callBackQueue && self.callBackQueue != [NSOperationQueue currentQueue]) {
 
-	[xml appendString: @"</wc-request:request>"];
+		NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget: self.target
+																				selector: self.callBack
+																				  object: response];
+		[self.callBackQueue addOperation: operation];
+		[operation release];
+		return;
+	}
 
-	[header release];
-	[infoString release];
-	return [xml autorelease];
+	[self.target performSelector: self.callBack
+					  withObject: response];
 }
 
 @end
@@ -0,0 +1,80 @@
+//
+//  HealthVaultRequestBatcher.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#import "HealthVaultRequest.h"
+#import "HealthVaultResponse.h"
+
+@class HealthVaultService;
+
+/// Packs several HealthVault calls into fewer round trips.
+/// PutThings and GetThings requests with the same method version which are sent within
+/// batchWindow seconds are merged into one request: their <thing> or <group> elements are
+/// put into one info section. The response is split back by position, so every caller gets
+/// its own HealthVaultResponse with the <thing-id> or <group> elements which belong to it,
+/// delivered to the original target and callBack. Split responses offer infoElement only.
+/// Other requests are passed to the service unchanged.
+@interface HealthVaultRequestBatcher : NSObject {
+
+	HealthVaultService *_service;
+	NSTimeInterval _batchWindow;
+	NSUInteger _maxBatchSize;
+
+	/// Requests waiting for the batch window to end, by method name and version.
+	NSMutableDictionary *_pendingRequests;
+	BOOL _isFlushScheduled;
+
+	NSUInteger _requestCount;
+	NSUInteger _sentRequestCount;
+}
+
+/// Gets the service requests are sent through.
+@property (readonly) HealthVaultService *service;
+
+/// Gets or sets how long requests are collected before a batch is sent, in seconds.
+/// The default is DEFAULT_BATCH_WINDOW.
+@property (assign) NSTimeInterval batchWindow;
+
+/// Gets or sets the maximum count of requests merged into one batch.
+/// The default is DEFAULT_MAX_BATCH_SIZE; when it is reached, the batch is sent at once.
+@property (assign) NSUInteger maxBatchSize;
+
+/// Gets count of requests passed to sendRequest:.
+@property (readonly) NSUInteger requestCount;
+
+/// Gets count of requests sent to the service, merged or not.
+@property (readonly) NSUInteger sentRequestCount;
+
+/// Initializes a new instance of the HealthVaultRequestBatcher class.
+/// @param service - the service requests are sent through.
+- (id)initWithService: (HealthVaultService *)service;
+
+/// Sends a request, possibly merged with other requests.
+/// @param request - the request to send.
+- (void)sendRequest: (HealthVaultRequest *)request;
+
+/// Sends all waiting requests without waiting for the batch window to end.
+- (void)flush;
+
+/// Checks whether a request can be merged with others.
+/// @param request - the request to check.
+/// @returns YES if the request is PutThings or GetThings with a plain info section.
++ (BOOL)canBatchRequest: (HealthVaultRequest *)request;
+
+@end
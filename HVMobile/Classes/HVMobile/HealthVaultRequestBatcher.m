@@ -0,0 +1,351 @@
+//
+//  HealthVaultRequestBatcher.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultRequestBatcher.h"
+#import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+#import "XmlDocument.h"
+
+/// Opening and closing tags of info sections which can be merged.
+#define INFO_START @"<info>"
+#define INFO_END @"</info>"
+
+
+/// Requests merged into one batch and count of elements each of them has put into the info section.
+@interface HealthVaultBatch : NSObject {
+
+	NSMutableArray *_requests;
+	NSMutableArray *_elementCounts;
+	NSString *_responseElementName;
+}
+
+/// Gets original requests.
+@property (readonly) NSMutableArray *requests;
+
+/// Gets count of elements of every request, the response has the same count of elements for it.
+@property (readonly) NSMutableArray *elementCounts;
+
+/// Gets or sets name of response info elements which are split between the requests.
+@property (retain) NSString *responseElementName;
+
+@end
+
+@implementation HealthVaultBatch
+
+@synthesize requests = _requests;
+@synthesize elementCounts = _elementCounts;
+@synthesize responseElementName = _responseElementName;
+
+- (id)init {
+
+	if ((self = [super init])) {
+
+		_requests = [NSMutableArray new];
+		_elementCounts = [NSMutableArray new];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_requests release];
+	[_elementCounts release];
+	self.responseElementName = nil;
+
+	[super dealloc];
+}
+
+@end
+
+
+@interface HealthVaultRequestBatcher (Private)
+
+/// Sends requests as one request.
+/// @param requests - requests with the same method name and version.
+- (void)sendBatch: (NSArray *)requests;
+
+/// Splits response of the batched request into responses of the original requests
+/// and runs their result parsers. It's the result parser of the batched request.
+/// @param response - response of the batched request.
+/// @returns responses of the original requests.
+- (NSArray *)splitResponse: (HealthVaultResponse *)response;
+
+/// Invokes callbacks of the original requests with parts of the response through the service,
+/// so metrics of the original requests are reported.
+/// @param response - response of the batched request.
+- (void)batchCompleted: (HealthVaultResponse *)response;
+
+/// Passes request to the service.
+/// @param request - the request to send.
+- (void)sendToService: (HealthVaultRequest *)request;
+
+@end
+
+
+#pragma mark Helpers
+
+/// Gets name of request info elements which can be merged.
+/// @param methodName - HealthVault method name.
+/// @returns element name or nil if the method can't be batched.
+static NSString *RequestElementName(NSString *methodName) {
+
+	if ([methodName isEqualToString: @"PutThings"]) {
+		return @"thing";
+	}
+
+	if ([methodName isEqualToString: @"GetThings"]) {
+		return @"group";
+	}
+
+	return nil;
+}
+
+/// Gets name of response info elements which belong to the request info elements one by one.
+/// @param methodName - HealthVault method name.
+static NSString *ResponseElementName(NSString *methodName) {
+
+	if ([methodName isEqualToString: @"PutThings"]) {
+		return @"thing-id";
+	}
+
+	return @"group";
+}
+
+#pragma mark Helpers End
+
+
+@implementation HealthVaultRequestBatcher
+
+@synthesize service = _service;
+@synthesize batchWindow = _batchWindow;
+@synthesize maxBatchSize = _maxBatchSize;
+@synthesize requestCount = _requestCount;
+@synthesize sentRequestCount = _sentRequestCount;
+
+- (id)initWithService: (HealthVaultService *)service {
+
+	if ((self = [super init])) {
+
+		_service = [service retain];
+		_pendingRequests = [NSMutableDictionary new];
+
+		self.batchWindow = DEFAULT_BATCH_WINDOW;
+		self.maxBatchSize = DEFAULT_MAX_BATCH_SIZE;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_service release];
+	[_pendingRequests release];
+
+	[super dealloc];
+}
+
++ (BOOL)canBatchRequest: (HealthVaultRequest *)request {
+
+	if (!RequestElementName(request.methodName)) {
+		return NO;
+	}
+
+	NSString *info = request.infoXml;
+
+	return info.length > INFO_START.length + INFO_END.length && [info hasPrefix: INFO_START] && [info hasSuffix: INFO_END];
+}
+
+- (void)sendRequest: (HealthVaultRequest *)request {
+
+	_requestCount++;
+
+	if (![HealthVaultRequestBatcher canBatchRequest: request]) {
+
+		[self sendToService: request];
+		return;
+	}
+
+	// The span of the request covers the batch window, the batched request is reported on its own.
+	[self.service startMetricsForRequest: request];
+
+	// Requests of different records can't share the header of one request.
+	NSString *key = [NSString stringWithFormat: @"%@ %g %@ %@", request.methodName, request.methodVersion,
+					 request.recordId ? request.recordId : @"", request.personId ? request.personId : @""];
+	NSMutableArray *requests = [_pendingRequests objectForKey: key];
+
+	if (!requests) {
+
+		requests = [NSMutableArray array];
+		[_pendingRequests setObject: requests forKey: key];
+	}
+
+	[requests addObject: request];
+
+	// A full batch doesn't wait for the window to end.
+	if (requests.count >= self.maxBatchSize) {
+
+		[self sendBatch: requests];
+		[_pendingRequests removeObjectForKey: key];
+		return;
+	}
+
+	if (!_isFlushScheduled) {
+
+		_isFlushScheduled = YES;
+		[self performSelector: @selector(flush) withObject: nil afterDelay: self.batchWindow];
+	}
+}
+
+- (void)flush {
+
+	if (_isFlushScheduled) {
+
+		[NSObject cancelPreviousPerformRequestsWithTarget: self selector: @selector(flush) object: nil];
+		_isFlushScheduled = NO;
+	}
+
+	NSArray *batches = [_pendingRequests allValues];
+	[_pendingRequests removeAllObjects];
+
+	for (NSArray *requests in batches) {
+
+		[self sendBatch: requests];
+	}
+}
+
+- (void)sendBatch: (NSArray *)requests {
+
+	HealthVaultRequest *firstRequest = [requests objectAtIndex: 0];
+
+	if (requests.count == 1) {
+
+		[self sendToService: firstRequest];
+		return;
+	}
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	NSString *elementName = RequestElementName(firstRequest.methodName);
+	NSInteger priority = firstRequest.priority;
+
+	HealthVaultBatch *batch = [HealthVaultBatch new];
+	batch.responseElementName = ResponseElementName(firstRequest.methodName);
+
+	NSMutableString *info = [NSMutableString stringWithString: INFO_START];
+
+	for (HealthVaultRequest *request in requests) {
+
+		NSString *section = request.infoXml;
+		NSRange content = NSMakeRange(INFO_START.length, section.length - INFO_START.length - INFO_END.length);
+
+		[info appendString: [section substringWithRange: content]];
+
+		// The count tells which response elements belong to the request.
+		NSUInteger elementCount = [[XmlDocument documentWithString: section].rootElement selectNodes: elementName].count;
+
+		[batch.requests addObject: request];
+		[batch.elementCounts addObject: [NSNumber numberWithUnsignedInteger: elementCount]];
+
+		priority = MAX(priority, request.priority);
+	}
+
+	[info appendString: INFO_END];
+
+	HealthVaultRequest *batchRequest = [[HealthVaultRequest alloc] initWithMethodName: firstRequest.methodName
+																		 methodVersion: firstRequest.methodVersion
+																		   infoSection: info
+																				target: self
+																			  callBack: @selector(batchCompleted:)];
+	batchRequest.priority = priority;
+	batchRequest.recordId = firstRequest.recordId;
+	batchRequest.personId = firstRequest.personId;
+	batchRequest.userState = batch;
+
+	// The response is split where it's parsed, on the processing queue of the service if it has one.
+	batchRequest.resultTarget = self;
+	batchRequest.resultParser = @selector(splitResponse:);
+
+	[self sendToService: batchRequest];
+
+	[batchRequest release];
+	[batch release];
+
+	[pool release];
+}
+
+- (NSArray *)splitResponse: (HealthVaultResponse *)response {
+
+	HealthVaultBatch *batch = (HealthVaultBatch *)response.request.userState;
+
+	// Reading the info section may turn the response into an error, so it goes first.
+	XmlElement *infoNode = response.infoElement;
+	NSArray *elements = response.hasError ? nil : [infoNode selectNodes: batch.responseElementName];
+	NSUInteger offset = 0;
+	NSMutableArray *responses = [NSMutableArray arrayWithCapacity: batch.requests.count];
+
+	for (NSUInteger i = 0; i < batch.requests.count; i++) {
+
+		HealthVaultRequest *request = [batch.requests objectAtIndex: i];
+		NSUInteger elementCount = [[batch.elementCounts objectAtIndex: i] unsignedIntegerValue];
+		XmlElement *requestInfoNode = nil;
+
+		if (!response.hasError) {
+
+			NSRange range = NSMakeRange(MIN(offset, elements.count), 0);
+			range.length = MIN(elementCount, elements.count - range.location);
+
+			requestInfoNode = [[XmlElement new] autorelease];
+			requestInfoNode.name = @"info";
+			requestInfoNode.children = [NSMutableDictionary dictionaryWithObject: [elements subarrayWithRange: range]
+																		  forKey: batch.responseElementName];
+		}
+
+		offset += elementCount;
+
+		HealthVaultResponse *requestResponse = [[HealthVaultResponse alloc] initWithResponse: response
+																					 request: request
+																				 infoElement: requestInfoNode];
+		requestResponse.result = [request resultForResponse: requestResponse];
+
+		[responses addObject: requestResponse];
+		[requestResponse release];
+	}
+
+	return responses;
+}
+
+- (void)batchCompleted: (HealthVaultResponse *)response {
+
+	// Failed responses haven't been split by the result parser.
+	NSArray *responses = response.result ? response.result : [self splitResponse: response];
+
+	for (HealthVaultResponse *requestResponse in responses) {
+
+		[self.service performAppCallBack: requestResponse.request
+								response: requestResponse];
+	}
+}
+
+- (void)sendToService: (HealthVaultRequest *)request {
+
+	_sentRequestCount++;
+	[self.service sendRequest: request];
+}
+
+@end
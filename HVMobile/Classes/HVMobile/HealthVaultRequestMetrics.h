@@ -0,0 +1,140 @@
+//
+//  HealthVaultRequestMetrics.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class WebResponse;
+@class HealthVaultRequestMetrics;
+
+
+/// Stages of a HealthVault request; durations of all attempts of the request are summed up.
+typedef enum {
+
+	/// Writing the request xml.
+	HealthVaultRequestStageSerialize,
+
+	/// Computing the info hash and the header HMAC.
+	HealthVaultRequestStageSign,
+
+	/// Waiting in the request queue for a free connection.
+	HealthVaultRequestStageQueue,
+
+	/// Opening the connection, TLS handshake and writing the request body.
+	HealthVaultRequestStageConnect,
+
+	/// Waiting for the response headers after the request has been written.
+	HealthVaultRequestStageFirstByte,
+
+	/// Receiving the response body, parsing which overlaps with it excluded.
+	HealthVaultRequestStageDownload,
+
+	/// Parsing the response xml and running the result parser of the request.
+	HealthVaultRequestStageParse,
+
+	/// Running the application callBack, or handing it over to the callBackQueue of the request.
+	HealthVaultRequestStageCallBack,
+
+	/// From sending the request till its callBack has returned, including retries and token refreshes.
+	HealthVaultRequestStageTotal,
+
+	/// Count of stages.
+	HealthVaultRequestStageCount
+} HealthVaultRequestStage;
+
+
+/// Receives metrics of completed HealthVault requests.
+@protocol HealthVaultMetricsSink <NSObject>
+
+/// Called on the thread which has created HealthVaultService after the callBack of a request
+/// has returned or has been handed over to the callBackQueue of the request.
+/// It isn't necessarily the main thread, so sinks which update UI must dispatch to it themselves.
+/// @param metrics - metrics of the request.
+- (void)requestCompleted: (HealthVaultRequestMetrics *)metrics;
+
+@end
+
+
+/// Timing span of one HealthVaultService request, from sendRequest: till the application callBack.
+/// It is collected only while the service has a metrics sink.
+@interface HealthVaultRequestMetrics : NSObject {
+
+	NSString *_methodName;
+	NSTimeInterval _startTime;
+	NSTimeInterval _durations[HealthVaultRequestStageCount];
+
+	NSUInteger _requestBytes;
+	NSUInteger _responseBytes;
+	NSUInteger _retryCount;
+	NSUInteger _refreshCount;
+	int _statusCode;
+	BOOL _hasError;
+	BOOL _isCached;
+}
+
+/// Gets the name of the method.
+@property (readonly) NSString *methodName;
+
+/// Gets the time the request has been sent, as seconds since the reference date.
+@property (readonly) NSTimeInterval startTime;
+
+/// Gets or sets count of request bytes written by all attempts.
+@property (assign) NSUInteger requestBytes;
+
+/// Gets or sets count of response bytes received by all attempts.
+@property (assign) NSUInteger responseBytes;
+
+/// Gets or sets count of times the request has been sent again after a transient failure.
+@property (assign) NSUInteger retryCount;
+
+/// Gets or sets count of times the request has waited for a new session token.
+@property (assign) NSUInteger refreshCount;
+
+/// Gets or sets status code of the response.
+@property (assign) int statusCode;
+
+/// Gets or sets whether the request has failed.
+@property (assign) BOOL hasError;
+
+/// Gets or sets whether the request has been answered from the response cache.
+@property (assign) BOOL isCached;
+
+/// Returns the name of the stage.
+/// @param stage - the stage.
++ (NSString *)nameOfStage: (HealthVaultRequestStage)stage;
+
+/// Initializes a new instance of the HealthVaultRequestMetrics class which starts now.
+/// @param methodName - the name of the method.
+- (id)initWithMethodName: (NSString *)methodName;
+
+/// Returns time spent in the stage, in seconds.
+/// @param stage - the stage.
+- (NSTimeInterval)durationOfStage: (HealthVaultRequestStage)stage;
+
+/// Adds time to the stage.
+/// @param duration - time in seconds.
+/// @param stage - the stage.
+- (void)addDuration: (NSTimeInterval)duration toStage: (HealthVaultRequestStage)stage;
+
+/// Adds transport stages and response size of one attempt.
+/// @param webResponse - response of the attempt.
+- (void)addWebResponse: (WebResponse *)webResponse;
+
+/// Sets total duration of the request, measured till now.
+- (void)finish;
+
+@end
@@ -0,0 +1,112 @@
+//
+//  HealthVaultRequestMetrics.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultRequestMetrics.h"
+#import "WebResponse.h"
+
+
+@implementation HealthVaultRequestMetrics
+
+@synthesize methodName = _methodName;
+@synthesize startTime = _startTime;
+@synthesize requestBytes = _requestBytes;
+@synthesize responseBytes = _responseBytes;
+@synthesize retryCount = _retryCount;
+@synthesize refreshCount = _refreshCount;
+@synthesize statusCode = _statusCode;
+@synthesize hasError = _hasError;
+@synthesize isCached = _isCached;
+
++ (NSString *)nameOfStage: (HealthVaultRequestStage)stage {
+
+	switch (stage) {
+
+		case HealthVaultRequestStageSerialize:
+			return @"serialize";
+		case HealthVaultRequestStageSign:
+			return @"sign";
+		case HealthVaultRequestStageQueue:
+			return @"queue";
+		case HealthVaultRequestStageConnect:
+			return @"connect";
+		case HealthVaultRequestStageFirstByte:
+			return @"first byte";
+		case HealthVaultRequestStageDownload:
+			return @"download";
+		case HealthVaultRequestStageParse:
+			return @"parse";
+		case HealthVaultRequestStageCallBack:
+			return @"callBack";
+		case HealthVaultRequestStageTotal:
+			return @"total";
+		default:
+			return nil;
+	}
+}
+
+- (id)initWithMethodName: (NSString *)methodName {
+
+	if ((self = [super init])) {
+
+		_methodName = [methodName copy];
+		_startTime = [NSDate timeIntervalSinceReferenceDate];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_methodName release];
+
+	[super dealloc];
+}
+
+- (NSTimeInterval)durationOfStage: (HealthVaultRequestStage)stage {
+
+	return stage < HealthVaultRequestStageCount ? _durations[stage] : 0;
+}
+
+- (void)addDuration: (NSTimeInterval)duration toStage: (HealthVaultRequestStage)stage {
+
+	if (stage < HealthVaultRequestStageCount && duration > 0) {
+		_durations[stage] += duration;
+	}
+}
+
+- (void)addWebResponse: (WebResponse *)webResponse {
+
+	// Transport times overlap: first byte time starts with the connection and total time
+	// includes parsing done while the body was being received, so they are split here.
+	NSTimeInterval firstByteTime = webResponse.firstByteTime ? webResponse.firstByteTime : webResponse.totalTime;
+
+	[self addDuration: webResponse.queueTime toStage: HealthVaultRequestStageQueue];
+	[self addDuration: webResponse.sendTime toStage: HealthVaultRequestStageConnect];
+	[self addDuration: firstByteTime - webResponse.sendTime toStage: HealthVaultRequestStageFirstByte];
+	[self addDuration: webResponse.totalTime - firstByteTime - webResponse.parseTime toStage: HealthVaultRequestStageDownload];
+	[self addDuration: webResponse.parseTime toStage: HealthVaultRequestStageParse];
+
+	_responseBytes += webResponse.responseBody.length;
+}
+
+- (void)finish {
+
+	_durations[HealthVaultRequestStageTotal] = [NSDate timeIntervalSinceReferenceDate] - _startTime;
+}
+
+@end
@@ -19,6 +19,7 @@
 #import <Foundation/Foundation.h>
 #import "WebResponse.h"
 #import "HealthVaultRequest.h"
+#import "XmlElement.h"
 
 /// OK status
 #define RESPONSE_OK  0;
@@ -37,12 +38,18 @@
 
 	int _statusCode;
 	NSString *_infoXml;
+	XmlElement *_infoElement;
+	BOOL _isInfoParsed;
 	NSString *_responseXml;
 	NSString *_errorText;
 	NSString *_errorContextXml;
 	NSString *_errorInfo;
+	BOOL _isJournaled;
+	BOOL _isDeliveryUncertain;
+	id _result;
 
 	HealthVaultRequest *_request;
+	WebResponse *_webResponse;
 }
 
 /// Gets or sets numeric status code of the operation.
@@ -51,7 +58,15 @@
 /// Gets or sets the informational part of the response.
 @property (retain) NSString *infoXml;
 
+/// Gets or sets the parsed info section of the response.
+/// Only the status is read when the response is created; the document is parsed
+/// the first time this property or hasError is read, so responses which are dropped unread never pay for it.
+/// If the document turns out to be invalid, errorText is set at that point.
+/// Consumers should read it instead of parsing infoXml again.
+@property (retain) XmlElement *infoElement;
+
 /// Gets or sets the raw xml that was returned from the request.
+/// When the response has been parsed while it was received, the string is created the first time it is read.
 @property (retain) NSString *responseXml;
 
 /// Gets or sets the text of the error that occurred.
@@ -65,10 +80,23 @@
 /// Gets or sets the informational part of the response.
 @property (retain) NSString *errorInfo;
 
+/// Gets or sets whether the request hasn't reached HealthVault but has been kept in the write journal.
+/// Such a response has an error; the request is sent again when the journal is replayed.
+@property (assign) BOOL isJournaled;
+
+/// Gets or sets whether a journaled write has failed after it may have reached HealthVault.
+/// It isn't replayed, since a write made twice could duplicate a thing; the application
+/// should load the things again to find out whether the write has been made.
+@property (assign) BOOL isDeliveryUncertain;
+
+/// Gets or sets the typed result made by the result parser of the request, nil if there is none.
+@property (retain) id result;
+
 /// Gets or sets the request that was sent.
 @property (retain) HealthVaultRequest *request;
 
 /// Indicates whether the operation has failed.
+/// A response which isn't a valid document is failed too, so the document is parsed if it hasn't been yet.
 @property (readonly, getter=getHasError) BOOL hasError;
 
 /// Initializes a new instance of the HealthVaultResponse class.
@@ -77,4 +105,14 @@
 - (id)initWithWebResponse: (WebResponse *)webResponse
 				  request: (HealthVaultRequest *)request;
 
+/// Initializes a new instance of the HealthVaultResponse class with a part of another response.
+/// Used to split the response of a batched request; the status and error are copied,
+/// there is no raw xml, so infoXml and responseXml are nil.
+/// @param response - the response the part is taken from.
+/// @param request - the original request.
+/// @param infoElement - the part of the info section which belongs to the request.
+- (id)initWithResponse: (HealthVaultResponse *)response
+			   request: (HealthVaultRequest *)request
+		   infoElement: (XmlElement *)infoElement;
+
 @end
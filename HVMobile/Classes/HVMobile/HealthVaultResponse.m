@@ -18,11 +18,24 @@
 
 
 #import "HealthVaultResponse.h"
-#import "XmlTextReader.h"
+#import "XmlDocument.h"
 #import "XmlElement.h"
 
 @interface HealthVaultResponse (Private)
 
+/// Initializes status fields by scanning the beginning of the xml up to the end of status element.
+/// Falls back to parseFromXml: if the xml does not look like HealthVault response.
+/// @param xml - response xml representation.
+- (BOOL)parseStatusFromXml: (NSString *)xml;
+
+/// Initializes status fields from status element.
+/// @param statusNode - status element.
+- (void)readStatus: (XmlElement *)statusNode;
+
+/// Initializes status and info fields from parsed response document.
+/// @param document - response document.
+- (BOOL)readDocument: (XmlDocument *)document;
+
 /// Initializes the fields using xml string provided.
 /// @param xml - response xml representation.
 - (BOOL)parseFromXml: (NSString *)xml;
@@ -39,10 +52,14 @@
 
 @synthesize statusCode = _statusCode;
 @synthesize infoXml = _infoXml;
+@synthesize infoElement = _infoElement;
 @synthesize responseXml = _responseXml;
 @synthesize errorText = _errorText;
 @synthesize errorContextXml = _errorContextXml;
 @synthesize errorInfo = _errorInfo;
+@synthesize isJournaled = _isJournaled;
+@synthesize isDeliveryUncertain = _isDeliveryUncertain;
+@synthesize result = _result;
 @synthesize request = _request;
 
 - (id)initWithWebResponse: (WebResponse *)webResponse
@@ -50,22 +67,30 @@
 
 	if ((self = [super init])) {
 
-		NSString *xml = webResponse.responseData;
-		
 		self.request = request;
-		self.responseXml = xml;
+		_webResponse = [webResponse retain];
 		
 		if(webResponse.hasError) {
 			
 			self.errorText = webResponse.errorText;
 		}
 		else {
-			
-			BOOL xmlReaderesult = [self parseFromXml: xml];
+
+			BOOL xmlReaderesult;
+
+			// the document has been built while the response was being received
+			if (webResponse.responseDocument) {
+
+				_isInfoParsed = YES;
+				xmlReaderesult = [self readDocument: webResponse.responseDocument];
+			}
+			else {
+				xmlReaderesult = [self parseStatusFromXml: self.responseXml];
+			}
 
 			if (!xmlReaderesult) {
 				self.errorText = [NSString stringWithFormat: NSLocalizedString(@"Response was not a valid HealthVault response key",
-																			   @"Format to display incorrect response"), xml];
+																			   @"Format to display incorrect response"), self.responseXml];
 			}
 		}
 	}
@@ -73,6 +98,27 @@
 	return self;
 }
 
+- (id)initWithResponse: (HealthVaultResponse *)response
+			   request: (HealthVaultRequest *)request
+		   infoElement: (XmlElement *)infoElement {
+
+	if ((self = [super init])) {
+
+		self.request = request;
+		self.statusCode = response.statusCode;
+		self.errorText = response.errorText;
+		self.errorContextXml = response.errorContextXml;
+		self.errorInfo = response.errorInfo;
+		self.isJournaled = response.isJournaled;
+		self.isDeliveryUncertain = response.isDeliveryUncertain;
+
+		_isInfoParsed = YES;
+		self.infoElement = infoElement;
+	}
+
+	return self;
+}
+
 - (void)dealloc {
 
 	self.errorText = nil;
@@ -80,13 +126,55 @@
 	self.errorInfo = nil;
 	self.request = nil;
 	self.infoXml = nil;
+	self.infoElement = nil;
 	self.responseXml = nil;
+	self.result = nil;
+	[_webResponse release];
 
 	[super dealloc];
 }
 
+- (NSString *)responseXml {
+
+	if (!_responseXml && _webResponse) {
+		_responseXml = [_webResponse.responseData retain];
+	}
+
+	return _responseXml;
+}
+
+- (NSString *)infoXml {
+
+	// Info section is sliced from the response only for callers which still need raw xml.
+	if (!_infoXml && self.responseXml) {
+		_infoXml = [[self getInfoFromXml: self.responseXml] retain];
+	}
+
+	return _infoXml;
+}
+
+- (XmlElement *)infoElement {
+
+	if (!_infoElement && !_isInfoParsed && self.responseXml) {
+
+		_isInfoParsed = YES;
+
+		if (![self parseFromXml: self.responseXml]) {
+			self.errorText = [NSString stringWithFormat: NSLocalizedString(@"Response was not a valid HealthVault response key",
+																		   @"Format to display incorrect response"), self.responseXml];
+		}
+	}
+
+	return _infoElement;
+}
+
 - (BOOL)getHasError {
 
+	// a body which fails to parse sets errorText, callers mustn't see success and then a nil info section
+	if (!self.errorText) {
+		[self infoElement];
+	}
+
 	return self.errorText != nil;
 }
 
@@ -96,31 +184,13 @@
 
 	@try {
 
-		XmlTextReader *xmlReader = [[XmlTextReader new] autorelease];
-		XmlElement *root = [xmlReader read: xml];
+		XmlDocument *document = [XmlDocument documentWithString: xml];
 
-		if (!root) {
+		if (!document) {
 			return NO;
 		}
 
-		// Parse status
-		XmlElement *statusNode = [root selectSingleNode: @"status"];
-		if (statusNode) {
-			self.statusCode = [[statusNode selectSingleNode: @"code"].text intValue];
-		}
-
-		// Parse message
-		XmlElement *errorNode = [statusNode selectSingleNode: @"error"];
-		if (errorNode) {
-
-			self.errorText = [NSString stringWithFormat: NSLocalizedString(@"Error in talking to HealthVault key",
-																		   @"Format to display HealthVault error message"),
-										[errorNode selectSingleNode: @"message"].text];
-			self.errorContextXml = [errorNode selectSingleNode: @"context"].text;
-			self.errorInfo = [errorNode selectSingleNode: @"error-info"].text;
-		}
-
-		self.infoXml = [self getInfoFromXml: xml];
+		[self readDocument: document];
 	}
 	@catch (id exc) {
 
@@ -134,6 +204,83 @@
 	return YES;
 }
 
+- (BOOL)readDocument: (XmlDocument *)document {
+
+	XmlElement *root = document.rootElement;
+
+	if (!root) {
+		return NO;
+	}
+
+	[self readStatus: [root selectSingleNode: @"status"]];
+
+	self.infoElement = [root selectSingleNode: @"info"];
+
+	return YES;
+}
+
+- (BOOL)parseStatusFromXml: (NSString *)xml {
+
+	// Status is the first child of the response, so the scan stops early even for large responses.
+	NSRange statusEnd = [xml rangeOfString: @"</status>"];
+	NSRange statusStart = NSMakeRange(NSNotFound, 0);
+
+	if (statusEnd.location != NSNotFound) {
+		statusStart = [xml rangeOfString: @"<status" options: 0 range: NSMakeRange(0, statusEnd.location)];
+	}
+
+	if (statusStart.location == NSNotFound) {
+
+		_isInfoParsed = YES;
+		return [self parseFromXml: xml];
+	}
+
+	NSRange statusRange = NSMakeRange(statusStart.location, NSMaxRange(statusEnd) - statusStart.location);
+
+	// Error details are rare, so they are read by the parser.
+	if ([xml rangeOfString: @"<error" options: 0 range: statusRange].location != NSNotFound) {
+
+		NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+		XmlElement *statusNode = [XmlDocument documentWithString: [xml substringWithRange: statusRange]].rootElement;
+		[self readStatus: statusNode];
+
+		[pool release];
+
+		return statusNode != nil;
+	}
+
+	NSRange codeStart = [xml rangeOfString: @"<code>" options: 0 range: statusRange];
+	NSRange codeEnd = [xml rangeOfString: @"</code>" options: 0 range: statusRange];
+
+	if (codeStart.location != NSNotFound && codeEnd.location != NSNotFound && codeEnd.location > codeStart.location) {
+
+		NSRange codeRange = NSMakeRange(NSMaxRange(codeStart), codeEnd.location - NSMaxRange(codeStart));
+		self.statusCode = [[xml substringWithRange: codeRange] intValue];
+	}
+
+	return YES;
+}
+
+- (void)readStatus: (XmlElement *)statusNode {
+
+	// Parse status
+	if (statusNode) {
+		self.statusCode = [[statusNode selectSingleNode: @"code"].text intValue];
+	}
+
+	// Parse message
+	XmlElement *errorNode = [statusNode selectSingleNode: @"error"];
+	if (errorNode) {
+
+		self.errorText = [NSString stringWithFormat: NSLocalizedString(@"Error in talking to HealthVault key",
+																	   @"Format to display HealthVault error message"),
+									[errorNode selectSingleNode: @"message"].text];
+		self.errorContextXml = [errorNode selectSingleNode: @"context"].text;
+		self.errorInfo = [errorNode selectSingleNode: @"error-info"].text;
+	}
+}
+
 - (NSString *)getInfoFromXml: (NSString *)xml {
 
 	NSRange startInfoTagPosition = [xml rangeOfString: @"<wc:info"];
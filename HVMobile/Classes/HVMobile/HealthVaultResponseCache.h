@@ -0,0 +1,129 @@
+//
+//  HealthVaultResponseCache.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#import "HealthVaultRequest.h"
+
+
+/// Keeps responses of read methods, so a request which has been answered recently
+/// is answered again without a round trip.
+/// Only methods which have been given a time to live are cached. Responses are keyed by
+/// method name, version, record id and the info hash of the request; they are kept in memory
+/// and, if the cache has a directory, on disk, each up to its size limit, and the least
+/// recently used ones are evicted first. A request of an invalidating method, PutThings
+/// and RemoveThings by default, drops the responses of its record.
+@interface HealthVaultResponseCache : NSObject {
+
+	NSString *_directory;
+	NSMutableDictionary *_timesToLive;
+	NSMutableSet *_invalidatingMethods;
+	NSUInteger _maxMemorySize;
+	NSUInteger _maxDiskSize;
+
+	/// Responses in memory by key, and their keys from the least recently used.
+	NSMutableDictionary *_memoryEntries;
+	NSMutableArray *_memoryKeys;
+	NSUInteger _memorySize;
+
+	/// Descriptions of responses on disk by key.
+	NSMutableDictionary *_diskIndex;
+	NSUInteger _diskSize;
+
+	NSUInteger _hitCount;
+	NSUInteger _missCount;
+
+	/// Count of times the responses of a record have been dropped, by record id.
+	NSMutableDictionary *_recordGenerations;
+}
+
+/// Gets or sets the maximum size of responses kept in memory, in bytes.
+/// The default is DEFAULT_RESPONSE_CACHE_MEMORY_SIZE.
+@property (assign) NSUInteger maxMemorySize;
+
+/// Gets or sets the maximum size of responses kept on disk, in bytes.
+/// The default is DEFAULT_RESPONSE_CACHE_DISK_SIZE.
+@property (assign) NSUInteger maxDiskSize;
+
+/// Gets size of responses kept in memory, in bytes.
+@property (readonly) NSUInteger memorySize;
+
+/// Gets size of responses kept on disk, in bytes.
+@property (readonly) NSUInteger diskSize;
+
+/// Gets count of requests of cached methods answered from the cache.
+@property (readonly) NSUInteger hitCount;
+
+/// Gets count of requests of cached methods which had to be sent.
+@property (readonly) NSUInteger missCount;
+
+/// Gets names of methods which drop cached responses of their record.
+@property (readonly) NSMutableSet *invalidatingMethods;
+
+/// Initializes a new instance of the HealthVaultResponseCache class.
+/// @param directory - the directory responses are kept in, nil to keep them in memory only.
+- (id)initWithDirectory: (NSString *)directory;
+
+/// Returns the directory of cached responses in the caches directory of the application.
++ (NSString *)defaultDirectory;
+
+/// Sets how long responses of the method are valid.
+/// @param timeToLive - time in seconds, zero turns caching of the method off.
+/// @param methodName - the name of the method.
+- (void)setTimeToLive: (NSTimeInterval)timeToLive forMethod: (NSString *)methodName;
+
+/// Returns how long responses of the method are valid, zero if they aren't cached.
+/// @param methodName - the name of the method.
+- (NSTimeInterval)timeToLiveForMethod: (NSString *)methodName;
+
+/// Returns body of the cached response to the request.
+/// The request must have been serialized, so its info hash is known.
+/// @param request - the request.
+/// @returns the body, or nil if there is no valid response.
+- (NSData *)responseBodyForRequest: (HealthVaultRequest *)request;
+
+/// Keeps body of the response to the request if the method is cached.
+/// @param body - the body of the response.
+/// @param request - the request.
+- (void)storeResponseBody: (NSData *)body forRequest: (HealthVaultRequest *)request;
+
+/// Keeps body of the response to the request if the method is cached and the record
+/// hasn't been invalidated since the request was sent.
+/// A read which was in flight during a write could have returned the old data.
+/// @param body - the body of the response.
+/// @param request - the request.
+/// @param generation - generation of the record when the request was sent.
+- (void)storeResponseBody: (NSData *)body forRequest: (HealthVaultRequest *)request generation: (NSUInteger)generation;
+
+/// Returns count of times the responses of the record have been dropped.
+/// It's taken when a request is sent, to tell whether its response may be stale when it arrives.
+/// @param recordId - the id of the record, nil for requests which aren't sent to a record.
+- (NSUInteger)generationOfRecord: (NSString *)recordId;
+
+/// Drops the responses of the record if the method of the request is invalidating.
+/// @param request - the request.
+- (void)invalidateForRequest: (HealthVaultRequest *)request;
+
+/// Drops the responses of the record.
+/// @param recordId - the id of the record, nil for requests which aren't sent to a record.
+- (void)invalidateRecord: (NSString *)recordId;
+
+/// Drops all responses.
+- (void)removeAllResponses;
+
+@end
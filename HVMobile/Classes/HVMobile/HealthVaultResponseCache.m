@@ -0,0 +1,472 @@
+//
+//  HealthVaultResponseCache.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultResponseCache.h"
+#import "HealthVaultConfig.h"
+#import "Base64.h"
+#import "Sha256.h"
+
+/// Name of the directory of cached responses in the caches directory.
+#define RESPONSE_CACHE_DIRECTORY @"HealthVaultResponses"
+
+/// Name of the file with descriptions of responses on disk.
+#define RESPONSE_CACHE_INDEX_FILE @"index.plist"
+
+/// Keys of the description of a response on disk.
+#define RESPONSE_CACHE_FILE_KEY @"file"
+#define RESPONSE_CACHE_RECORD_KEY @"record"
+#define RESPONSE_CACHE_EXPIRY_KEY @"expiry"
+#define RESPONSE_CACHE_SIZE_KEY @"size"
+#define RESPONSE_CACHE_LAST_USE_KEY @"lastUse"
+
+
+/// Response kept in memory.
+@interface HealthVaultCachedResponse : NSObject {
+
+	NSData *_body;
+	NSString *_recordId;
+	NSTimeInterval _expiry;
+}
+
+@property (retain) NSData *body;
+@property (retain) NSString *recordId;
+@property (assign) NSTimeInterval expiry;
+
+@end
+
+@implementation HealthVaultCachedResponse
+
+@synthesize body = _body;
+@synthesize recordId = _recordId;
+@synthesize expiry = _expiry;
+
+- (void)dealloc {
+
+	self.body = nil;
+	self.recordId = nil;
+
+	[super dealloc];
+}
+
+@end
+
+
+/// Orders keys of responses on disk from the least recently used.
+static NSInteger CompareLastUse(id firstKey, id secondKey, void *diskIndex) {
+
+	NSNumber *first = [[(NSDictionary *)diskIndex objectForKey: firstKey] objectForKey: RESPONSE_CACHE_LAST_USE_KEY];
+	NSNumber *second = [[(NSDictionary *)diskIndex objectForKey: secondKey] objectForKey: RESPONSE_CACHE_LAST_USE_KEY];
+
+	return [first compare: second];
+}
+
+
+@interface HealthVaultResponseCache (Private)
+
+/// Makes key of the response to the request.
+/// @param request - the request.
+/// @returns the key.
++ (NSString *)keyForRequest: (HealthVaultRequest *)request;
+
+/// Makes name of the file of the response.
+/// @param key - the key of the response.
+/// @returns the file name.
++ (NSString *)fileNameForKey: (NSString *)key;
+
+/// Keeps response in memory and evicts the least recently used ones over the size limit.
+- (void)storeInMemory: (NSData *)body key: (NSString *)key recordId: (NSString *)recordId expiry: (NSTimeInterval)expiry;
+
+/// Drops response from memory.
+/// @param key - the key of the response.
+- (void)removeFromMemory: (NSString *)key;
+
+/// Writes response to disk and evicts the least recently used ones over the size limit.
+- (void)storeOnDisk: (NSData *)body key: (NSString *)key recordId: (NSString *)recordId expiry: (NSTimeInterval)expiry;
+
+/// Drops response from disk, the index isn't saved.
+/// @param key - the key of the response.
+- (void)removeFromDisk: (NSString *)key;
+
+/// Writes descriptions of responses on disk.
+- (void)saveDiskIndex;
+
+@end
+
+
+@implementation HealthVaultResponseCache
+
+@synthesize maxMemorySize = _maxMemorySize;
+@synthesize maxDiskSize = _maxDiskSize;
+@synthesize memorySize = _memorySize;
+@synthesize diskSize = _diskSize;
+@synthesize hitCount = _hitCount;
+@synthesize missCount = _missCount;
+@synthesize invalidatingMethods = _invalidatingMethods;
+
+- (id)initWithDirectory: (NSString *)directory {
+
+	if ((self = [super init])) {
+
+		_directory = [directory copy];
+		_timesToLive = [NSMutableDictionary new];
+		_invalidatingMethods = [[NSMutableSet alloc] initWithObjects: @"PutThings", @"RemoveThings", nil];
+		_memoryEntries = [NSMutableDictionary new];
+		_memoryKeys = [NSMutableArray new];
+		_recordGenerations = [NSMutableDictionary new];
+
+		self.maxMemorySize = DEFAULT_RESPONSE_CACHE_MEMORY_SIZE;
+		self.maxDiskSize = DEFAULT_RESPONSE_CACHE_DISK_SIZE;
+
+		if (_directory) {
+
+			[[NSFileManager defaultManager] createDirectoryAtPath: _directory
+									  withIntermediateDirectories: YES
+													   attributes: nil
+															error: NULL];
+
+			// Responses cached by the previous launch are still valid until they expire.
+			NSDictionary *index = [NSDictionary dictionaryWithContentsOfFile: [_directory stringByAppendingPathComponent: RESPONSE_CACHE_INDEX_FILE]];
+			_diskIndex = [NSMutableDictionary new];
+
+			for (NSString *key in index) {
+
+				NSMutableDictionary *description = [[index objectForKey: key] mutableCopy];
+				[_diskIndex setObject: description forKey: key];
+				_diskSize += [[description objectForKey: RESPONSE_CACHE_SIZE_KEY] unsignedIntegerValue];
+				[description release];
+			}
+		}
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_directory release];
+	[_timesToLive release];
+	[_invalidatingMethods release];
+	[_memoryEntries release];
+	[_memoryKeys release];
+	[_diskIndex release];
+	[_recordGenerations release];
+
+	[super dealloc];
+}
+
++ (NSString *)defaultDirectory {
+
+	NSArray *directories = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+
+	return [[directories objectAtIndex: 0] stringByAppendingPathComponent: RESPONSE_CACHE_DIRECTORY];
+}
+
+- (void)setTimeToLive: (NSTimeInterval)timeToLive forMethod: (NSString *)methodName {
+
+	if (timeToLive > 0) {
+		[_timesToLive setObject: [NSNumber numberWithDouble: timeToLive] forKey: methodName];
+	}
+	else {
+		[_timesToLive removeObjectForKey: methodName];
+	}
+}
+
+- (NSTimeInterval)timeToLiveForMethod: (NSString *)methodName {
+
+	return [[_timesToLive objectForKey: methodName] doubleValue];
+}
+
+- (NSData *)responseBodyForRequest: (HealthVaultRequest *)request {
+
+	if ([self timeToLiveForMethod: request.methodName] <= 0 || !request.infoHash) {
+		return nil;
+	}
+
+	NSString *key = [HealthVaultResponseCache keyForRequest: request];
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+	HealthVaultCachedResponse *entry = [_memoryEntries objectForKey: key];
+
+	if (entry && entry.expiry > now) {
+
+		// The key moves to the most recently used end.
+		[_memoryKeys removeObject: key];
+		[_memoryKeys addObject: key];
+
+		_hitCount++;
+		return [[entry.body retain] autorelease];
+	}
+
+	if (entry) {
+		[self removeFromMemory: key];
+	}
+
+	NSMutableDictionary *description = [_diskIndex objectForKey: key];
+
+	if (description) {
+
+		NSTimeInterval expiry = [[description objectForKey: RESPONSE_CACHE_EXPIRY_KEY] doubleValue];
+		NSString *path = [_directory stringByAppendingPathComponent: [description objectForKey: RESPONSE_CACHE_FILE_KEY]];
+		NSData *body = expiry > now ? [NSData dataWithContentsOfFile: path] : nil;
+
+		if (body) {
+
+			[description setObject: [NSNumber numberWithDouble: now] forKey: RESPONSE_CACHE_LAST_USE_KEY];
+
+			NSString *recordId = [description objectForKey: RESPONSE_CACHE_RECORD_KEY];
+			[self storeInMemory: body key: key recordId: recordId expiry: expiry];
+
+			_hitCount++;
+			return body;
+		}
+
+		[self removeFromDisk: key];
+		[self saveDiskIndex];
+	}
+
+	_missCount++;
+	return nil;
+}
+
+- (void)storeResponseBody: (NSData *)body forRequest: (HealthVaultRequest *)request {
+
+	NSTimeInterval timeToLive = [self timeToLiveForMethod: request.methodName];
+
+	if (timeToLive <= 0 || !request.infoHash || !body) {
+		return;
+	}
+
+	NSString *key = [HealthVaultResponseCache keyForRequest: request];
+	NSString *recordId = request.recordId ? request.recordId : @"";
+	NSTimeInterval expiry = [NSDate timeIntervalSinceReferenceDate] + timeToLive;
+
+	// The body may be a buffer of the transport.
+	body = [[body copy] autorelease];
+
+	[self storeInMemory: body key: key recordId: recordId expiry: expiry];
+
+	if (_directory) {
+		[self storeOnDisk: body key: key recordId: recordId expiry: expiry];
+	}
+}
+
+- (void)storeResponseBody: (NSData *)body forRequest: (HealthVaultRequest *)request generation: (NSUInteger)generation {
+
+	if (generation != [self generationOfRecord: request.recordId]) {
+		return;
+	}
+
+	[self storeResponseBody: body forRequest: request];
+}
+
+- (NSUInteger)generationOfRecord: (NSString *)recordId {
+
+	return [[_recordGenerations objectForKey: recordId ? recordId : @""] unsignedIntegerValue];
+}
+
+- (void)invalidateForRequest: (HealthVaultRequest *)request {
+
+	if ([_invalidatingMethods containsObject: request.methodName]) {
+		[self invalidateRecord: request.recordId];
+	}
+}
+
+- (void)invalidateRecord: (NSString *)recordId {
+
+	if (!recordId) {
+		recordId = @"";
+	}
+
+	[_recordGenerations setObject: [NSNumber numberWithUnsignedInteger: [self generationOfRecord: recordId] + 1] forKey: recordId];
+
+	for (NSString *key in [_memoryEntries allKeys]) {
+
+		HealthVaultCachedResponse *entry = [_memoryEntries objectForKey: key];
+
+		if ([entry.recordId isEqualToString: recordId]) {
+			[self removeFromMemory: key];
+		}
+	}
+
+	BOOL isDiskChanged = NO;
+
+	for (NSString *key in [_diskIndex allKeys]) {
+
+		if ([[[_diskIndex objectForKey: key] objectForKey: RESPONSE_CACHE_RECORD_KEY] isEqualToString: recordId]) {
+
+			[self removeFromDisk: key];
+			isDiskChanged = YES;
+		}
+	}
+
+	if (isDiskChanged) {
+		[self saveDiskIndex];
+	}
+}
+
+- (void)removeAllResponses {
+
+	[_memoryEntries removeAllObjects];
+	[_memoryKeys removeAllObjects];
+	_memorySize = 0;
+
+	for (NSString *key in [_diskIndex allKeys]) {
+		[self removeFromDisk: key];
+	}
+
+	if (_directory) {
+		[self saveDiskIndex];
+	}
+}
+
+#pragma mark Helpers
+
++ (NSString *)keyForRequest: (HealthVaultRequest *)request {
+
+	return [NSString stringWithFormat: @"%@|%.0f|%@|%@", request.methodName, request.methodVersion,
+			request.recordId ? request.recordId : @"", request.infoHash];
+}
+
++ (NSString *)fileNameForKey: (NSString *)key {
+
+	NSData *keyData = [key dataUsingEncoding: NSUTF8StringEncoding];
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	Sha256Context context;
+	Sha256Init(&context);
+	Sha256Update(&context, keyData.bytes, keyData.length);
+	Sha256Final(&context, digest);
+
+	// The url safe alphabet has no path separator.
+	return [Base64 encodeBase64WithBytes: digest
+								  length: SHA256_DIGEST_SIZE
+								 options: Base64EncodingUrlSafe | Base64EncodingNoPadding];
+}
+
+- (void)storeInMemory: (NSData *)body key: (NSString *)key recordId: (NSString *)recordId expiry: (NSTimeInterval)expiry {
+
+	[self removeFromMemory: key];
+
+	if (body.length > self.maxMemorySize) {
+		return;
+	}
+
+	HealthVaultCachedResponse *entry = [HealthVaultCachedResponse new];
+	entry.body = body;
+	entry.recordId = recordId;
+	entry.expiry = expiry;
+
+	[_memoryEntries setObject: entry forKey: key];
+	[_memoryKeys addObject: key];
+	_memorySize += body.length;
+
+	[entry release];
+
+	while (_memorySize > self.maxMemorySize && _memoryKeys.count > 0) {
+		[self removeFromMemory: [_memoryKeys objectAtIndex: 0]];
+	}
+}
+
+- (void)removeFromMemory: (NSString *)key {
+
+	HealthVaultCachedResponse *entry = [_memoryEntries objectForKey: key];
+
+	if (!entry) {
+		return;
+	}
+
+	_memorySize -= entry.body.length;
+
+	// The key may be the one passed in.
+	[[key retain] autorelease];
+
+	[_memoryKeys removeObject: key];
+	[_memoryEntries removeObjectForKey: key];
+}
+
+- (void)storeOnDisk: (NSData *)body key: (NSString *)key recordId: (NSString *)recordId expiry: (NSTimeInterval)expiry {
+
+	[self removeFromDisk: key];
+
+	if (body.length > self.maxDiskSize) {
+
+		[self saveDiskIndex];
+		return;
+	}
+
+	NSString *fileName = [HealthVaultResponseCache fileNameForKey: key];
+
+	if (![body writeToFile: [_directory stringByAppendingPathComponent: fileName] atomically: YES]) {
+
+		[self saveDiskIndex];
+		return;
+	}
+
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	NSMutableDictionary *description = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+										fileName, RESPONSE_CACHE_FILE_KEY,
+										recordId, RESPONSE_CACHE_RECORD_KEY,
+										[NSNumber numberWithDouble: expiry], RESPONSE_CACHE_EXPIRY_KEY,
+										[NSNumber numberWithUnsignedInteger: body.length], RESPONSE_CACHE_SIZE_KEY,
+										[NSNumber numberWithDouble: now], RESPONSE_CACHE_LAST_USE_KEY,
+										nil];
+	[_diskIndex setObject: description forKey: key];
+	_diskSize += body.length;
+
+	if (_diskSize > self.maxDiskSize) {
+
+		NSArray *keys = [[_diskIndex allKeys] sortedArrayUsingFunction: CompareLastUse context: _diskIndex];
+
+		for (NSString *leastRecentKey in keys) {
+
+			if (_diskSize <= self.maxDiskSize) {
+				break;
+			}
+
+			[self removeFromDisk: leastRecentKey];
+		}
+	}
+
+	[self saveDiskIndex];
+}
+
+- (void)removeFromDisk: (NSString *)key {
+
+	NSDictionary *description = [_diskIndex objectForKey: key];
+
+	if (!description) {
+		return;
+	}
+
+	_diskSize -= [[description objectForKey: RESPONSE_CACHE_SIZE_KEY] unsignedIntegerValue];
+
+	NSString *path = [_directory stringByAppendingPathComponent: [description objectForKey: RESPONSE_CACHE_FILE_KEY]];
+	[[NSFileManager defaultManager] removeItemAtPath: path error: NULL];
+
+	[[key retain] autorelease];
+	[_diskIndex removeObjectForKey: key];
+}
+
+- (void)saveDiskIndex {
+
+	[_diskIndex writeToFile: [_directory stringByAppendingPathComponent: RESPONSE_CACHE_INDEX_FILE] atomically: YES];
+}
+
+#pragma mark Helpers End
+
+@end
@@ -0,0 +1,120 @@
+//
+//  HealthVaultRetryPolicy.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class HealthVaultRequest;
+@class HealthVaultResponse;
+@class WebResponse;
+
+
+/// Kinds of failures of a HealthVault request.
+typedef enum {
+
+	/// The request has succeeded or failed for good, retrying it wouldn't help.
+	HealthVaultFailurePermanent,
+
+	/// The connection couldn't be opened, the request hasn't reached HealthVault.
+	HealthVaultFailureNotSent,
+
+	/// HealthVault is busy and hasn't processed the request.
+	HealthVaultFailureBusy,
+
+	/// The connection has been lost or timed out, the request may have been processed.
+	HealthVaultFailureUncertain
+} HealthVaultFailureKind;
+
+
+/// Decides which failed requests HealthVaultService sends again and when.
+/// Requests which haven't been processed are retried whatever the method is; requests which may
+/// have been processed are retried only if their method is idempotent.
+/// The delay grows exponentially from baseDelay up to maxDelay, half of it is random, so clients
+/// which have failed at the same moment don't come back at the same moment.
+/// All retries draw from one budget: every retry takes one from it and every successful request
+/// adds retryBudgetRatio back, so retries can't multiply load while HealthVault is degraded.
+@interface HealthVaultRetryPolicy : NSObject {
+
+	NSMutableSet *_idempotentMethods;
+	NSMutableSet *_retryableStatusCodes;
+	NSUInteger _maxRetryCount;
+	NSTimeInterval _baseDelay;
+	NSTimeInterval _maxDelay;
+	double _retryBudget;
+	double _retryBudgetRatio;
+
+	/// Retries which can be made now.
+	double _availableRetries;
+
+	NSUInteger _retryCount;
+	NSUInteger _refusedRetryCount;
+}
+
+/// Gets names of methods which can be sent again even if they may have been processed.
+@property (readonly) NSMutableSet *idempotentMethods;
+
+/// Gets NSNumber status codes of HealthVault responses which mean the request hasn't been
+/// processed and can be sent again; empty by default. HTTP 503 is always treated so.
+@property (readonly) NSMutableSet *retryableStatusCodes;
+
+/// Gets or sets the maximum count of retries of one request, the default is DEFAULT_MAX_RETRY_COUNT.
+@property (assign) NSUInteger maxRetryCount;
+
+/// Gets or sets delay before the first retry, in seconds, the default is DEFAULT_RETRY_BASE_DELAY.
+@property (assign) NSTimeInterval baseDelay;
+
+/// Gets or sets the maximum delay before a retry, in seconds, the default is DEFAULT_RETRY_MAX_DELAY.
+/// A request isn't retried if the server asks to wait longer.
+@property (assign) NSTimeInterval maxDelay;
+
+/// Gets or sets the maximum count of retries made without successful requests in between,
+/// the default is DEFAULT_RETRY_BUDGET. Setting it fills the budget.
+@property (assign) double retryBudget;
+
+/// Gets or sets share of a retry every successful request adds to the budget,
+/// the default is DEFAULT_RETRY_BUDGET_RATIO.
+@property (assign) double retryBudgetRatio;
+
+/// Gets count of retries made.
+@property (readonly) NSUInteger retryCount;
+
+/// Gets count of retries refused because the budget has been used up.
+@property (readonly) NSUInteger refusedRetryCount;
+
+/// Classifies failure of a request.
+/// @param webResponse - the transport response.
+/// @param response - HealthVault response created from it.
+/// @returns the kind of the failure.
+- (HealthVaultFailureKind)failureKindOfResponse: (WebResponse *)webResponse
+									   response: (HealthVaultResponse *)response;
+
+/// Decides whether the request is sent again and takes the retry from the budget.
+/// Successful responses refill the budget.
+/// @param request - the request, its retryCount is the count of retries made so far.
+/// @param webResponse - the transport response.
+/// @param response - HealthVault response created from it.
+/// @returns delay before the retry in seconds, or a negative value if the request isn't retried.
+- (NSTimeInterval)retryDelayForRequest: (HealthVaultRequest *)request
+						   webResponse: (WebResponse *)webResponse
+							  response: (HealthVaultResponse *)response;
+
+/// Computes delay before a retry.
+/// @param retryIndex - count of retries made so far.
+/// @returns random delay between half and all of the exponential delay.
+- (NSTimeInterval)backoffDelay: (NSUInteger)retryIndex;
+
+@end
@@ -0,0 +1,161 @@
+//
+//  HealthVaultRetryPolicy.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultRetryPolicy.h"
+#import "HealthVaultRequest.h"
+#import "HealthVaultResponse.h"
+#import "WebResponse.h"
+#import "HealthVaultConfig.h"
+
+/// HTTP status of a server which is overloaded or throttles the client.
+#define HTTP_SERVICE_UNAVAILABLE 503
+
+/// HTTP statuses of a gateway which has failed to get the response.
+#define HTTP_BAD_GATEWAY 502
+#define HTTP_GATEWAY_TIMEOUT 504
+
+
+@implementation HealthVaultRetryPolicy
+
+@synthesize idempotentMethods = _idempotentMethods;
+@synthesize retryableStatusCodes = _retryableStatusCodes;
+@synthesize maxRetryCount = _maxRetryCount;
+@synthesize baseDelay = _baseDelay;
+@synthesize maxDelay = _maxDelay;
+@synthesize retryBudget = _retryBudget;
+@synthesize retryBudgetRatio = _retryBudgetRatio;
+@synthesize retryCount = _retryCount;
+@synthesize refusedRetryCount = _refusedRetryCount;
+
+- (id)init {
+
+	if ((self = [super init])) {
+
+		_idempotentMethods = [[NSMutableSet alloc] initWithObjects: @"GetThings", @"GetAuthorizedPeople",
+							  @"GetAuthorizedRecords", @"GetPersonInfo", @"GetServiceDefinition", @"GetThingType",
+							  @"GetVocabulary", @"SearchVocabulary", @"GetApplicationInfo", nil];
+		_retryableStatusCodes = [NSMutableSet new];
+
+		self.maxRetryCount = DEFAULT_MAX_RETRY_COUNT;
+		self.baseDelay = DEFAULT_RETRY_BASE_DELAY;
+		self.maxDelay = DEFAULT_RETRY_MAX_DELAY;
+		self.retryBudget = DEFAULT_RETRY_BUDGET;
+		self.retryBudgetRatio = DEFAULT_RETRY_BUDGET_RATIO;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_idempotentMethods release];
+	[_retryableStatusCodes release];
+
+	[super dealloc];
+}
+
+- (void)setRetryBudget: (double)retryBudget {
+
+	_retryBudget = retryBudget;
+	_availableRetries = retryBudget;
+}
+
+- (HealthVaultFailureKind)failureKindOfResponse: (WebResponse *)webResponse
+									   response: (HealthVaultResponse *)response {
+
+	if (webResponse.hasError) {
+
+		switch (webResponse.errorCode) {
+
+			case NSURLErrorCancelled:
+				return HealthVaultFailurePermanent;
+
+			case NSURLErrorCannotFindHost:
+			case NSURLErrorCannotConnectToHost:
+			case NSURLErrorDNSLookupFailed:
+			case NSURLErrorNotConnectedToInternet:
+				return HealthVaultFailureNotSent;
+
+			default:
+				return HealthVaultFailureUncertain;
+		}
+	}
+
+	if (webResponse.httpStatusCode == HTTP_SERVICE_UNAVAILABLE) {
+		return HealthVaultFailureBusy;
+	}
+
+	if (webResponse.httpStatusCode == HTTP_BAD_GATEWAY || webResponse.httpStatusCode == HTTP_GATEWAY_TIMEOUT) {
+		return HealthVaultFailureUncertain;
+	}
+
+	if (response.hasError && [_retryableStatusCodes containsObject: [NSNumber numberWithInt: response.statusCode]]) {
+		return HealthVaultFailureBusy;
+	}
+
+	return HealthVaultFailurePermanent;
+}
+
+- (NSTimeInterval)retryDelayForRequest: (HealthVaultRequest *)request
+						   webResponse: (WebResponse *)webResponse
+							  response: (HealthVaultResponse *)response {
+
+	if (!response.hasError) {
+
+		_availableRetries = MIN(_availableRetries + self.retryBudgetRatio, self.retryBudget);
+		return -1;
+	}
+
+	HealthVaultFailureKind kind = [self failureKindOfResponse: webResponse response: response];
+
+	if (kind == HealthVaultFailurePermanent || request.retryCount >= self.maxRetryCount) {
+		return -1;
+	}
+
+	// A write which may have been processed would be made twice.
+	if (kind == HealthVaultFailureUncertain && ![_idempotentMethods containsObject: request.methodName]) {
+		return -1;
+	}
+
+	NSTimeInterval delay = MAX([self backoffDelay: request.retryCount], webResponse.retryAfter);
+
+	if (delay > self.maxDelay) {
+		return -1;
+	}
+
+	if (_availableRetries < 1) {
+
+		_refusedRetryCount++;
+		return -1;
+	}
+
+	_availableRetries -= 1;
+	_retryCount++;
+
+	return delay;
+}
+
+- (NSTimeInterval)backoffDelay: (NSUInteger)retryIndex {
+
+	NSTimeInterval delay = self.baseDelay * pow(2, MIN(retryIndex, 30));
+	delay = MIN(delay, self.maxDelay);
+
+	return delay / 2 + delay / 2 * (arc4random() / (double)UINT32_MAX);
+}
+
+@end
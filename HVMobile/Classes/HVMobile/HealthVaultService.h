@@ -24,6 +24,11 @@
 #import "MobilePlatform.h"
 #import "WebResponse.h"
 #import "WebTransport.h"
+#import "WebRequestQueue.h"
+#import "HealthVaultResponseCache.h"
+#import "HealthVaultWriteJournal.h"
+#import "HealthVaultRetryPolicy.h"
+#import "HealthVaultRequestMetrics.h"
 
 /// A class used to communicate with the HealthVault web service.
 @interface HealthVaultService : NSObject {
@@ -31,6 +36,9 @@
 	NSString *_healthServiceUrl;
 	NSString *_shellUrl;
 	NSString *_authorizationSessionToken;
+	NSDate *_sessionTokenTime;
+	NSTimeInterval _sessionTokenLifetime;
+	NSTimeInterval _sessionTokenRenewalMargin;
 	NSString *_sharedSecret;
 	NSString *_sessionSharedSecret;
 	NSString *_masterAppId;
@@ -41,6 +49,46 @@
 
 	NSMutableArray *_records;
 	HealthVaultRecord *_currentRecord;
+
+	WebRequestQueue *_requestQueue;
+	HealthVaultResponseCache *_responseCache;
+	HealthVaultRetryPolicy *_retryPolicy;
+	NSObject<HealthVaultMetricsSink> *_metricsSink;
+
+	NSOperationQueue *_processingQueue;
+	/// The thread the service has been created on, where it queues requests and invokes callBacks.
+	NSThread *_serviceThread;
+	/// Count of requests handed over to the processing queue for serialization.
+	NSUInteger _serializedRequestCount;
+	/// Count of serialized requests which have been queued, in the order they were sent.
+	NSUInteger _queuedRequestCount;
+	/// Serialized requests waiting for earlier ones, by sequence number.
+	NSMutableDictionary *_serializedRequests;
+
+	HealthVaultWriteJournal *_writeJournal;
+	/// Sequence numbers of journaled requests in flight, by request.
+	NSMutableDictionary *_journalSequences;
+	NSObject *_journalTarget;
+	SEL _journalCallBack;
+	BOOL _isJournalReplayScheduled;
+	NSUInteger _replayedRequestCount;
+
+	/// Generations of response cache records taken when cached reads were sent, by request.
+	NSMutableDictionary *_cacheGenerations;
+
+	/// CreateAuthenticatedSessionToken request which is in flight, if any.
+	HealthVaultRequest *_refreshTokenRequest;
+
+	/// Requests which wait for the session token to be refreshed.
+	NSMutableArray *_requestsAwaitingToken;
+
+	/// Is YES if the token in flight is renewed ahead of expiry, the old one is still valid.
+	BOOL _isRenewingSessionToken;
+	NSTimer *_renewalTimer;
+
+	NSUInteger _sessionTokenRenewalCount;
+	NSUInteger _sessionTokenRefreshCount;
+	NSUInteger _avoidedExpiredRequestCount;
 }
 
 /// Gets or sets the URL that is used to talk to the HealthVault Web Service.
@@ -52,6 +100,27 @@
 /// Gets or sets the authorization token that is required to talk to the HealthVault
 @property (retain) NSString *authorizationSessionToken;
 
+/// Gets or sets the time the session token has been received, nil if it is unknown.
+@property (retain) NSDate *sessionTokenTime;
+
+/// Gets or sets how long the session token is valid, in seconds.
+/// The default is DEFAULT_SESSION_TOKEN_LIFETIME.
+@property (assign) NSTimeInterval sessionTokenLifetime;
+
+/// Gets or sets how long before the expiry the session token is renewed, in seconds.
+/// The default is DEFAULT_SESSION_TOKEN_RENEWAL_MARGIN, zero turns renewal off,
+/// so the token is only refreshed after a request has failed with it.
+@property (assign) NSTimeInterval sessionTokenRenewalMargin;
+
+/// Gets count of session tokens renewed ahead of expiry.
+@property (readonly) NSUInteger sessionTokenRenewalCount;
+
+/// Gets count of session tokens refreshed after a request has failed with an expired token.
+@property (readonly) NSUInteger sessionTokenRefreshCount;
+
+/// Gets count of requests which waited for a renewed token instead of being sent with the expiring one.
+@property (readonly) NSUInteger avoidedExpiredRequestCount;
+
 /// Gets or sets the application shared secret.
 @property (retain) NSString *sharedSecret;
 
@@ -83,6 +152,45 @@
 /// Gets or sets the person and record that will be used.
 @property (retain) HealthVaultRecord *currentRecord;
 
+/// Gets or sets the queue all requests are sent through.
+/// It limits the count of requests in flight and keeps connections to healthServiceUrl alive.
+@property (retain) WebRequestQueue *requestQueue;
+
+/// Gets or sets the cache of responses to read methods, nil by default.
+/// Requests answered from the cache complete on the next run loop pass without a round trip;
+/// requests of invalidating methods drop cached responses of their record.
+@property (retain) HealthVaultResponseCache *responseCache;
+
+/// Gets or sets the policy which decides which failed requests are sent again, nil by default.
+/// A retried request gets new msg-time and signature; the application is called back once,
+/// with the response of the last attempt.
+@property (retain) HealthVaultRetryPolicy *retryPolicy;
+
+/// Gets or sets the sink which receives timing span of every request, nil by default.
+/// Spans are collected only while there is a sink, which is called on the thread that has created the service.
+@property (retain) NSObject<HealthVaultMetricsSink> *metricsSink;
+
+/// Gets or sets the queue which serializes and signs requests and parses responses, nil by default.
+/// Without it, the work is done on the thread the service is used on. With it, that thread only
+/// queues requests and completes them: the info section and result of the response are ready
+/// before the callBack is invoked, and requests are still queued in the order they are sent.
+/// The service must be used on the thread it has been created on, which needs a running run loop.
+/// Setting the queue turns incremental parsing of the requestQueue off, as it would happen on that thread.
+@property (retain) NSOperationQueue *processingQueue;
+
+/// Gets or sets the journal which keeps write requests until they are delivered, nil by default.
+/// With the journal, a journaled request which can't reach HealthVault is completed with
+/// isJournaled response and sent again, re-signed, when the journal is replayed.
+/// While such requests wait, new ones wait behind them, so writes are delivered in order.
+@property (retain) HealthVaultWriteJournal *writeJournal;
+
+/// Gets count of requests sent by journal replays.
+@property (readonly) NSUInteger replayedRequestCount;
+
+/// Is YES while the session token is being refreshed.
+/// Requests sent meanwhile are held back and sent once the new token is saved.
+@property (readonly) BOOL isRefreshingSessionToken;
+
 /// Is YES if current application instance has already been created, otherwise FALSE.
 @property (readonly, getter = getIsApplicationCreated) BOOL isApplicationCreated;
 
@@ -118,6 +226,34 @@
 /// @param responseXml - the response xml.
 - (void)saveCastCallResults: (NSString *)responseXml;
 
+/// Saves the results of a cast call into the session.
+/// @param infoNode - the info section of the response, already parsed.
+- (void)saveCastCallResultsFromInfo: (XmlElement *)infoNode;
+
+/// Renews the session token if it isn't being refreshed already.
+/// It happens on its own sessionTokenRenewalMargin seconds before the token expires;
+/// requests sent meanwhile wait for the new token.
+- (void)renewSessionToken;
+
+/// Cancels scheduled renewal of the session token.
+/// The scheduled renewal retains the service until it happens.
+- (void)cancelSessionTokenRenewal;
+
+/// Sets method which is called with the HealthVaultResponse of every replayed journal request.
+/// Responses of coalesced requests are not split. The target is not retained.
+/// @param target - callBack method owner.
+/// @param callBack - the method to call.
+- (void)setWriteJournalTarget: (NSObject *)target callBack: (SEL)callBack;
+
+/// Sends waiting journal requests; several of them are in flight at the same time.
+/// The journal is replayed on its own when a response proves that HealthVault is reachable,
+/// and DEFAULT_JOURNAL_REPLAY_INTERVAL seconds after a request has failed to reach it.
+- (void)replayWriteJournal;
+
+/// Cancels scheduled replay of the journal.
+/// The scheduled replay retains the service until it happens.
+- (void)cancelWriteJournalReplay;
+
 /// Sends a request to the HealthVault web service.
 /// This method returns immediately; the results and any error information will be passed to the
 /// completion method stored in the request.
@@ -125,6 +261,18 @@
 /// @param request - the request to send.
 - (void)sendRequest:(HealthVaultRequest *)request;
 
+/// Starts timing span of the request if there is a metrics sink and the request doesn't have one.
+/// Used by senders which hold a request before it reaches sendRequest:, so the wait is measured too.
+/// @param request - the request.
+- (void)startMetricsForRequest: (HealthVaultRequest *)request;
+
+/// Invokes the calling application's callback and reports metrics of the request to the sink.
+/// Used by senders which answer a request with a response of another one, e.g. a part of a batch.
+/// @param request - the request object.
+/// @param response - the response object.
+- (void)performAppCallBack: (HealthVaultRequest *)request
+				  response: (HealthVaultResponse *)response;
+
 /// Authorizes more records.
 /// @param target - callback handler.
 /// @param authCompleted - method that is called when the authentication process is complete.
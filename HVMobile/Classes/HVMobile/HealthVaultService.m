@@ -25,7 +25,7 @@
 #import "Base64.h"
 #import "DateTimeUtils.h"
 #import "Provisioner.h"
-#import "XmlTextReader.h"
+#import "XmlDocument.h"
 #import "HealthVaultSettings.h"
 #import "HealthVaultConfig.h"
 
@@ -38,14 +38,111 @@
 /// Refreshes the session token.
 /// Makes a CAST call to get a new session token, 
 /// and then re-issues the original request.
+/// Only one CAST call is made at a time, requests which fail meanwhile wait for it.
 /// @param request - the original request.
 - (void)refreshSessionToken: (HealthVaultRequest *)request;
 
-/// Invokes the calling application's callback.
-/// @param request - the request object.
-/// @param response - the response object.
-- (void)performAppCallBack: (HealthVaultRequest *)request
-				  response: (HealthVaultResponse *)response;
+/// Starts CAST call which gets a new session token.
+- (void)startSessionTokenRefresh;
+
+/// Schedules renewal of the session token ahead of its expiry.
+- (void)scheduleSessionTokenRenewal;
+
+/// Checks whether the renewal time of the session token has passed.
+/// @returns YES if the token should be renewed before the next request.
+- (BOOL)isSessionTokenDueForRenewal;
+
+/// Sends request without checking whether the session token is being refreshed.
+/// @param request - the request to send.
+- (void)sendRequestNow: (HealthVaultRequest *)request;
+
+/// Serializes and signs the request on the processing queue.
+/// @param arguments - the request and its sequence number.
+- (void)serializeRequest: (NSArray *)arguments;
+
+/// Queues serialized requests in the order they have been sent; runs on the service thread.
+/// @param arguments - the request, its sequence number and the serialized request.
+- (void)requestSerialized: (NSArray *)arguments;
+
+/// Answers the request from the response cache or puts it into the request queue.
+/// @param request - the request.
+/// @param requestXml - the serialized request.
+- (void)queueRequest: (HealthVaultRequest *)request withBody: (NSData *)requestXml;
+
+/// Creates the response and runs the result parser of the request.
+/// @param webResponse - the web response.
+/// @param request - the request.
+/// @param parsesInfo - YES if the info section is parsed now rather than when it's first read.
+/// @returns the response.
+- (HealthVaultResponse *)responseForWebResponse: (WebResponse *)webResponse
+										request: (HealthVaultRequest *)request
+									 parsesInfo: (BOOL)parsesInfo;
+
+/// Hands the web response over to the processing queue.
+/// @param webResponse - the web response.
+/// @param request - the request.
+/// @param completion - method invoked on the service thread with the web response and the response.
+- (void)parseResponseInBackground: (WebResponse *)webResponse
+						  request: (HealthVaultRequest *)request
+					   completion: (SEL)completion;
+
+/// Parses the response on the processing queue.
+/// @param arguments - the web response, the request and name of the completion method.
+- (void)parseResponse: (NSArray *)arguments;
+
+/// Hands results of the processing queue over to the service thread.
+/// Must be called after the autorelease pool of the work has been drained.
+/// @param selector - method invoked on the service thread.
+/// @param arguments - argument of the method.
+- (void)performOnServiceThread: (SEL)selector withArguments: (NSArray *)arguments;
+
+/// Completes request whose response has been parsed on the processing queue.
+/// @param arguments - the web response and the response.
+- (void)responseParsed: (NSArray *)arguments;
+
+/// Completes request answered from the cache whose response has been parsed on the processing queue.
+/// @param arguments - the web response with the cached body and the response.
+- (void)cachedResponseParsed: (NSArray *)arguments;
+
+/// Handles token expiry and retries, updates the journal and the cache and invokes the callBack.
+/// @param response - the response.
+/// @param webResponse - the web response.
+- (void)completeRequest: (HealthVaultResponse *)response
+			webResponse: (WebResponse *)webResponse;
+
+/// Completes request with the cached response.
+/// @param arguments - the WebResponse with the cached body and the request.
+- (void)sendCachedResponse: (NSArray *)arguments;
+
+/// Appends journaled request to the write journal.
+/// @param request - the request.
+/// @returns YES if the request waits for earlier journaled requests and mustn't be sent now.
+- (BOOL)journalRequest: (HealthVaultRequest *)request;
+
+/// Completes journaled request which waits for replay with isJournaled response.
+/// @param request - the request.
+- (void)sendJournaledResponse: (HealthVaultRequest *)request;
+
+/// Takes journaled request out of flight.
+/// @param request - the request.
+/// @param isDelivered - YES if HealthVault has received the request, NO if it has to be sent again.
+/// @returns YES if the request is journaled.
+- (BOOL)finishJournaledRequest: (HealthVaultRequest *)request isDelivered: (BOOL)isDelivered;
+
+/// Classifies failure of a journaled write, with the retry policy of the service or the default one.
+/// @param response - the response.
+/// @param webResponse - the transport response.
+/// @returns HealthVaultFailureNotSent or HealthVaultFailureBusy if the write can be replayed,
+/// HealthVaultFailureUncertain if it may have been made.
+- (HealthVaultFailureKind)journalFailureKindOfResponse: (HealthVaultResponse *)response
+										   webResponse: (WebResponse *)webResponse;
+
+/// Schedules replay of the journal after DEFAULT_JOURNAL_REPLAY_INTERVAL.
+- (void)scheduleJournalReplay;
+
+/// Passes response of a replayed request to the journal target.
+/// @param response - the response.
+- (void)journalReplayCompleted: (HealthVaultResponse *)response;
 
 @end
 
@@ -55,6 +152,12 @@
 @synthesize healthServiceUrl = _healthServiceUrl;
 @synthesize shellUrl = _shellUrl;
 @synthesize authorizationSessionToken = _authorizationSessionToken;
+@synthesize sessionTokenTime = _sessionTokenTime;
+@synthesize sessionTokenLifetime = _sessionTokenLifetime;
+@synthesize sessionTokenRenewalMargin = _sessionTokenRenewalMargin;
+@synthesize sessionTokenRenewalCount = _sessionTokenRenewalCount;
+@synthesize sessionTokenRefreshCount = _sessionTokenRefreshCount;
+@synthesize avoidedExpiredRequestCount = _avoidedExpiredRequestCount;
 @synthesize sharedSecret = _sharedSecret;
 @synthesize sessionSharedSecret = _sessionSharedSecret;
 @synthesize masterAppId = _masterAppId;
@@ -64,6 +167,13 @@
 @synthesize applicationCreationToken = _applicationCreationToken;
 @synthesize records = _records;
 @synthesize currentRecord = _currentRecord;
+@synthesize requestQueue = _requestQueue;
+@synthesize responseCache = _responseCache;
+@synthesize retryPolicy = _retryPolicy;
+@synthesize metricsSink = _metricsSink;
+@synthesize processingQueue = _processingQueue;
+@synthesize writeJournal = _writeJournal;
+@synthesize replayedRequestCount = _replayedRequestCount;
 
 - (id)init {
 
@@ -92,7 +202,19 @@
 		self.language = DEFAULT_LANGUAGE;
 		self.country = DEFAULT_COUNTRY;
 
+		self.sessionTokenLifetime = DEFAULT_SESSION_TOKEN_LIFETIME;
+		self.sessionTokenRenewalMargin = DEFAULT_SESSION_TOKEN_RENEWAL_MARGIN;
+
 		_records = [NSMutableArray new];
+		_requestQueue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: DEFAULT_MAX_CONCURRENT_REQUESTS];
+		_requestQueue.parsesResponsesIncrementally = YES;
+
+		_requestsAwaitingToken = [NSMutableArray new];
+		_journalSequences = [NSMutableDictionary new];
+		_cacheGenerations = [NSMutableDictionary new];
+
+		_serviceThread = [[NSThread currentThread] retain];
+		_serializedRequests = [NSMutableDictionary new];
 	}
 	return self;
 }
@@ -103,6 +225,7 @@
 	self.healthServiceUrl = nil;
 	self.shellUrl = nil;
 	self.authorizationSessionToken = nil;
+	self.sessionTokenTime = nil;
 	self.sharedSecret = nil;
 	self.sessionSharedSecret = nil;
 	self.masterAppId = nil;
@@ -112,10 +235,33 @@
 	self.applicationCreationToken = nil;
 	self.records = nil;
 	self.currentRecord = nil;
+	[_processingQueue release];
+	self.requestQueue = nil;
+	self.responseCache = nil;
+	self.retryPolicy = nil;
+	self.metricsSink = nil;
+	self.writeJournal = nil;
+
+	[_refreshTokenRequest release];
+	[_requestsAwaitingToken release];
+	[_journalSequences release];
+	[_cacheGenerations release];
+	[_renewalTimer release];
+	[_serviceThread release];
+	[_serializedRequests release];
 
 	[super dealloc];
 }
 
+- (void)setProcessingQueue: (NSOperationQueue *)processingQueue {
+
+	[_processingQueue autorelease];
+	_processingQueue = [processingQueue retain];
+
+	// The document would be built on the service thread while the response is being received.
+	self.requestQueue.parsesResponsesIncrementally = (processingQueue == nil);
+}
+
 #pragma mark Url Generating Logic
 
 - (NSString *)getApplicationCreationUrl {
@@ -175,6 +321,50 @@
 
 - (void)sendRequest: (HealthVaultRequest *)request {
 
+	[self startMetricsForRequest: request];
+
+	if ([self journalRequest: request]) {
+		return;
+	}
+
+	// The renewal timer doesn't fire while the application is suspended,
+	// so the token may have to be renewed before the request is sent.
+	if (!_refreshTokenRequest && [self isSessionTokenDueForRenewal]) {
+		[self renewSessionToken];
+	}
+
+	// The request would be signed with the token which is being replaced,
+	// so it waits and is sent with the new one.
+	if (_refreshTokenRequest && request != _refreshTokenRequest) {
+
+		if (_isRenewingSessionToken) {
+			_avoidedExpiredRequestCount++;
+		}
+
+		request.metrics.refreshCount++;
+		[_requestsAwaitingToken addObject: request];
+		return;
+	}
+
+	[self sendRequestNow: request];
+}
+
+- (void)startMetricsForRequest: (HealthVaultRequest *)request {
+
+	if (!_metricsSink || request.metrics) {
+		return;
+	}
+
+	HealthVaultRequestMetrics *metrics = [[HealthVaultRequestMetrics alloc] initWithMethodName: request.methodName];
+	request.metrics = metrics;
+	[metrics release];
+}
+
+- (void)sendRequestNow: (HealthVaultRequest *)request {
+
+	// CreateAuthenticatedSessionToken is sent without going through sendRequest:.
+	[self startMetricsForRequest: request];
+
 	request.msgTime = [NSDate date];
 	
 	if (self.appIdInstance && self.appIdInstance.length > 0) {
@@ -185,43 +375,459 @@
 
 		request.appIdInstance = self.masterAppId;
 	}
-	if(self.currentRecord != nil) {
+	// Replayed journal requests keep the record they have been sent to.
+	if(self.currentRecord != nil && !request.recordId) {
 		
 		request.personId = self.currentRecord.personId;
 		request.recordId = self.currentRecord.recordId;
 	}
-	request.authorizationSessionToken = self.authorizationSessionToken;
-	request.sessionSharedSecret = self.sessionSharedSecret;
+	// CreateAuthenticatedSessionToken is authenticated by app-id, even when the current token is being renewed.
+	if (request != _refreshTokenRequest) {
+
+		request.authorizationSessionToken = self.authorizationSessionToken;
+		request.sessionSharedSecret = self.sessionSharedSecret;
+	}
+
+	if (self.processingQueue) {
+
+		NSNumber *sequence = [NSNumber numberWithUnsignedInteger: _serializedRequestCount++];
+		NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget: self
+																				selector: @selector(serializeRequest:)
+																				  object: [NSArray arrayWithObjects: request, sequence, nil]];
+		[self.processingQueue addOperation: operation];
+		[operation release];
+		return;
+	}
+
+	[self queueRequest: request withBody: [request toXmlData]];
+}
+
+- (void)serializeRequest: (NSArray *)arguments {
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	HealthVaultRequest *request = [arguments objectAtIndex: 0];
+	NSData *requestXml = [request toXmlData];
+	NSArray *serializedRequest = [[arguments arrayByAddingObject: requestXml] retain];
+
+	[pool release];
+
+	[self performOnServiceThread: @selector(requestSerialized:) withArguments: serializedRequest];
+	[serializedRequest release];
+}
+
+- (void)performOnServiceThread: (SEL)selector withArguments: (NSArray *)arguments {
+
+	// Temporary elements are released with the pool drained before this call.
+	// Their dealloc clears slots of the document's element cache, which isn't locked,
+	// so it must not run while the service thread already reads the document.
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	[self performSelector: selector
+				 onThread: _serviceThread
+			   withObject: arguments
+			waitUntilDone: NO];
+
+	[pool release];
+}
+
+- (void)requestSerialized: (NSArray *)arguments {
+
+	[_serializedRequests setObject: arguments forKey: [arguments objectAtIndex: 1]];
+
+	// A small request can be serialized before a large one sent earlier, but it's queued after it.
+	NSNumber *sequence = [NSNumber numberWithUnsignedInteger: _queuedRequestCount];
+	NSArray *serializedRequest;
+
+	while ((serializedRequest = [[_serializedRequests objectForKey: sequence] retain])) {
+
+		[_serializedRequests removeObjectForKey: sequence];
+		_queuedRequestCount++;
+
+		[self queueRequest: [serializedRequest objectAtIndex: 0] withBody: [serializedRequest objectAtIndex: 2]];
+		[serializedRequest release];
+
+		sequence = [NSNumber numberWithUnsignedInteger: _queuedRequestCount];
+	}
+}
+
+- (void)queueRequest: (HealthVaultRequest *)request withBody: (NSData *)requestXml {
+
+	request.metrics.requestBytes += requestXml.length;
+
+	if (self.responseCache) {
+
+		// Writes make cached responses of the record stale.
+		[self.responseCache invalidateForRequest: request];
+
+		// The info hash is known once the request has been serialized.
+		NSData *cachedBody = [self.responseCache responseBodyForRequest: request];
+
+		if (cachedBody) {
+
+			WebResponse *webResponse = [[WebResponse new] autorelease];
+			webResponse.responseBody = cachedBody;
+			request.metrics.isCached = YES;
+
+			if (self.processingQueue) {
+
+				[self parseResponseInBackground: webResponse
+										request: request
+									 completion: @selector(cachedResponseParsed:)];
+				return;
+			}
 
-	NSString *requestXml = [request toXml];
+			[self performSelector: @selector(sendCachedResponse:)
+					   withObject: [NSArray arrayWithObjects: webResponse, request, nil]
+					   afterDelay: 0];
+			return;
+		}
 
-	[WebTransport sendRequestForURL: self.healthServiceUrl
-						   withData: requestXml
-							context: request
-							 target: self
-						   callBack: @selector(sendRequestCallback: context:)];
+		// A write to the record which completes before the response arrives makes the response stale.
+		if ([self.responseCache timeToLiveForMethod: request.methodName] > 0) {
+
+			[_cacheGenerations setObject: [NSNumber numberWithUnsignedInteger: [self.responseCache generationOfRecord: request.recordId]]
+								  forKey: [NSValue valueWithNonretainedObject: request]];
+		}
+	}
+
+	[self.requestQueue sendRequestForURL: self.healthServiceUrl
+								withBody: requestXml
+								priority: request.priority
+								 context: request
+								  target: self
+								callBack: @selector(sendRequestCallback: context:)];
 }
 
 - (void)sendRequestCallback: (WebResponse *)response
 					context: (HealthVaultRequest *)healthVaultRequest {
 
-	HealthVaultResponse *healthVaultResponse = [[[HealthVaultResponse alloc] initWithWebResponse: response
-																						 request: healthVaultRequest] autorelease];
+	if (self.processingQueue) {
+
+		[self parseResponseInBackground: response
+								request: healthVaultRequest
+							 completion: @selector(responseParsed:)];
+		return;
+	}
+
+	[self completeRequest: [self responseForWebResponse: response request: healthVaultRequest parsesInfo: NO]
+			  webResponse: response];
+}
+
+- (HealthVaultResponse *)responseForWebResponse: (WebResponse *)webResponse
+										request: (HealthVaultRequest *)request
+									 parsesInfo: (BOOL)parsesInfo {
+
+	HealthVaultRequestMetrics *metrics = request.metrics;
+	NSTimeInterval parseStartTime = metrics ? [NSDate timeIntervalSinceReferenceDate] : 0;
+
+	HealthVaultResponse *response = [[[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			  request: request] autorelease];
+
+	// Checking for error parses the info section, which may turn the response into an error, so it goes before the result.
+	if (parsesInfo) {
+		[response hasError];
+	}
+
+	response.result = [request resultForResponse: response];
+
+	if (metrics) {
+
+		[metrics addWebResponse: webResponse];
+		[metrics addDuration: [NSDate timeIntervalSinceReferenceDate] - parseStartTime toStage: HealthVaultRequestStageParse];
+	}
+
+	return response;
+}
+
+- (void)parseResponseInBackground: (WebResponse *)webResponse
+						  request: (HealthVaultRequest *)request
+					   completion: (SEL)completion {
+
+	NSArray *arguments = [NSArray arrayWithObjects: webResponse, request, NSStringFromSelector(completion), nil];
+	NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget: self
+																			selector: @selector(parseResponse:)
+																			  object: arguments];
+	[self.processingQueue addOperation: operation];
+	[operation release];
+}
+
+- (void)parseResponse: (NSArray *)arguments {
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	WebResponse *webResponse = [arguments objectAtIndex: 0];
+	HealthVaultRequest *request = [arguments objectAtIndex: 1];
+	SEL completion = NSSelectorFromString([arguments objectAtIndex: 2]);
+
+	// The whole document is parsed here, so the callBack doesn't do it on the service thread.
+	HealthVaultResponse *response = [self responseForWebResponse: webResponse request: request parsesInfo: YES];
+	NSArray *parsedResponse = [[NSArray alloc] initWithObjects: webResponse, response, nil];
+
+	[pool release];
+
+	[self performOnServiceThread: completion withArguments: parsedResponse];
+	[parsedResponse release];
+}
+
+- (void)responseParsed: (NSArray *)arguments {
+
+	[self completeRequest: [arguments objectAtIndex: 1]
+			  webResponse: [arguments objectAtIndex: 0]];
+}
+
+- (void)cachedResponseParsed: (NSArray *)arguments {
+
+	HealthVaultResponse *response = [arguments objectAtIndex: 1];
+
+	[self performAppCallBack: response.request
+					response: response];
+}
+
+- (void)completeRequest: (HealthVaultResponse *)healthVaultResponse
+			webResponse: (WebResponse *)response {
+
+	HealthVaultRequest *healthVaultRequest = healthVaultResponse.request;
 
 	// The token that is returned from GetAuthenticatedSessionToken has a limited lifetime. When it expires,
 	// we will get an error here. We detect that situation, get a new token, and then re-issue the call.
-	if (healthVaultResponse.statusCode == RESPONSE_AUTH_SESSION_TOKEN_EXPIRED) {
+	if (healthVaultResponse.statusCode == RESPONSE_AUTH_SESSION_TOKEN_EXPIRED && healthVaultRequest != _refreshTokenRequest) {
+
+		// The request could have been sent before the token was refreshed by another one.
+		if (self.authorizationSessionToken && ![self.authorizationSessionToken isEqualToString: healthVaultRequest.authorizationSessionToken]) {
+
+			[self sendRequest: healthVaultRequest];
+			return;
+		}
+
 		[self refreshSessionToken: healthVaultRequest];
 		return;
 	}
 	
+	// Transient failures are retried, every attempt is stamped and signed anew when it is sent.
+	NSTimeInterval retryDelay = self.retryPolicy ? [self.retryPolicy retryDelayForRequest: healthVaultRequest
+																			  webResponse: response
+																				 response: healthVaultResponse] : -1;
+	if (retryDelay >= 0) {
+
+		healthVaultRequest.retryCount++;
+		[self performSelector: @selector(sendRequest:) withObject: healthVaultRequest afterDelay: retryDelay];
+		return;
+	}
+
+	// A response of any kind means the request has reached HealthVault; if it has been rejected,
+	// sending it again wouldn't help, so it leaves the journal as well.
+	// Only writes which haven't been processed are replayed: a lost connection or a timeout doesn't tell
+	// whether HealthVault has made the write, and a new thing put twice would be duplicated.
+	HealthVaultFailureKind failureKind = [self journalFailureKindOfResponse: healthVaultResponse webResponse: response];
+	BOOL mustReplay = failureKind == HealthVaultFailureNotSent || failureKind == HealthVaultFailureBusy;
+
+	if ([self finishJournaledRequest: healthVaultRequest isDelivered: !mustReplay]) {
+
+		healthVaultResponse.isJournaled = mustReplay;
+		healthVaultResponse.isDeliveryUncertain = failureKind == HealthVaultFailureUncertain;
+	}
+
+	if (self.responseCache) {
+
+		// A write drops the responses of its record again, as reads may have been sent while it was in flight.
+		[self.responseCache invalidateForRequest: healthVaultRequest];
+
+		// A read which was in flight during a write could have returned the old data, it isn't stored then.
+		NSValue *requestKey = [NSValue valueWithNonretainedObject: healthVaultRequest];
+		NSNumber *generation = [_cacheGenerations objectForKey: requestKey];
+
+		if (generation && !healthVaultResponse.hasError) {
+
+			[self.responseCache storeResponseBody: response.responseBody
+									   forRequest: healthVaultRequest
+									   generation: [generation unsignedIntegerValue]];
+		}
+
+		[_cacheGenerations removeObjectForKey: requestKey];
+	}
+
+	// HealthVault is reachable again, so the writes which have failed to reach it are sent.
+	if (!response.hasError && self.writeJournal.waitingCount > 0) {
+		[self replayWriteJournal];
+	}
+
 	// Returns source request and response to app.
 	[self performAppCallBack: healthVaultRequest
 					response: healthVaultResponse];
 }
 
+- (void)sendCachedResponse: (NSArray *)arguments {
+
+	WebResponse *webResponse = [arguments objectAtIndex: 0];
+	HealthVaultRequest *request = [arguments objectAtIndex: 1];
+
+	[self performAppCallBack: request
+					response: [self responseForWebResponse: webResponse request: request parsesInfo: NO]];
+}
+
 #pragma mark Send Request Logic End
 
+#pragma mark Write Journal Logic
+
+- (void)setWriteJournalTarget: (NSObject *)target callBack: (SEL)callBack {
+
+	_journalTarget = target;
+	_journalCallBack = callBack;
+}
+
+- (BOOL)journalRequest: (HealthVaultRequest *)request {
+
+	NSValue *requestKey = [NSValue valueWithNonretainedObject: request];
+
+	// Requests resent after a token refresh and replayed ones are in the journal already.
+	if (!self.writeJournal || ![self.writeJournal isJournaledRequest: request] || [_journalSequences objectForKey: requestKey]) {
+		return NO;
+	}
+
+	// The record is written to the journal, so the request is replayed to it even if another record is chosen.
+	if (self.currentRecord != nil && !request.recordId) {
+
+		request.personId = self.currentRecord.personId;
+		request.recordId = self.currentRecord.recordId;
+	}
+
+	// Earlier writes which haven't been delivered go first.
+	BOOL mustWait = self.writeJournal.waitingCount > 0;
+	uint32_t sequence = [self.writeJournal appendRequest: request isSending: !mustWait];
+
+	if (sequence == 0) {
+		return NO;
+	}
+
+	if (!mustWait) {
+
+		[_journalSequences setObject: [NSArray arrayWithObject: [NSNumber numberWithUnsignedInt: sequence]]
+							  forKey: requestKey];
+		return NO;
+	}
+
+	[self performSelector: @selector(sendJournaledResponse:) withObject: request afterDelay: 0];
+
+	// The request may be the first one made after connectivity has returned.
+	[self replayWriteJournal];
+
+	return YES;
+}
+
+- (void)sendJournaledResponse: (HealthVaultRequest *)request {
+
+	WebResponse *webResponse = [[WebResponse new] autorelease];
+	webResponse.errorText = NSLocalizedString(@"Request has been journaled key", @"Error of a write which waits in the journal");
+
+	HealthVaultResponse *response = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			 request: request];
+	response.isJournaled = YES;
+
+	[self performAppCallBack: request
+					response: response];
+	[response release];
+}
+
+- (HealthVaultFailureKind)journalFailureKindOfResponse: (HealthVaultResponse *)response
+										   webResponse: (WebResponse *)webResponse {
+
+	if (!response.hasError) {
+		return HealthVaultFailurePermanent;
+	}
+
+	HealthVaultRetryPolicy *policy = self.retryPolicy ? [self.retryPolicy retain] : [HealthVaultRetryPolicy new];
+	HealthVaultFailureKind failureKind = [policy failureKindOfResponse: webResponse response: response];
+	[policy release];
+
+	// A cancelled request may have been sent as well.
+	if (failureKind == HealthVaultFailurePermanent && webResponse.hasError) {
+		return HealthVaultFailureUncertain;
+	}
+
+	return failureKind;
+}
+
+- (BOOL)finishJournaledRequest: (HealthVaultRequest *)request isDelivered: (BOOL)isDelivered {
+
+	NSValue *requestKey = [NSValue valueWithNonretainedObject: request];
+	NSArray *sequences = [_journalSequences objectForKey: requestKey];
+
+	if (!sequences) {
+		return NO;
+	}
+
+	if (isDelivered) {
+
+		[self.writeJournal removeSequences: sequences];
+	}
+	else {
+
+		[self.writeJournal resetSequences: sequences];
+		[self scheduleJournalReplay];
+	}
+
+	[_journalSequences removeObjectForKey: requestKey];
+
+	return YES;
+}
+
+- (void)replayWriteJournal {
+
+	[self cancelWriteJournalReplay];
+
+	// Without a session token nothing can be sent; during a refresh requests wait for the new one.
+	if (!self.writeJournal || (!self.authorizationSessionToken && !_refreshTokenRequest)) {
+		return;
+	}
+
+	NSArray *sequences = nil;
+	HealthVaultRequest *request;
+
+	// All requests which can be sent are queued at once, the queue keeps several of them in flight.
+	// Each one gets new msg-time and signature when it is sent.
+	while ((request = [self.writeJournal nextReplayRequest: &sequences])) {
+
+		request.target = self;
+		request.callBack = @selector(journalReplayCompleted:);
+
+		[_journalSequences setObject: sequences forKey: [NSValue valueWithNonretainedObject: request]];
+		_replayedRequestCount++;
+
+		[self sendRequest: request];
+	}
+}
+
+- (void)scheduleJournalReplay {
+
+	if (_isJournalReplayScheduled) {
+		return;
+	}
+
+	_isJournalReplayScheduled = YES;
+	[self performSelector: @selector(replayWriteJournal) withObject: nil afterDelay: DEFAULT_JOURNAL_REPLAY_INTERVAL];
+}
+
+- (void)cancelWriteJournalReplay {
+
+	if (_isJournalReplayScheduled) {
+
+		[NSObject cancelPreviousPerformRequestsWithTarget: self selector: @selector(replayWriteJournal) object: nil];
+		_isJournalReplayScheduled = NO;
+	}
+}
+
+- (void)journalReplayCompleted: (HealthVaultResponse *)response {
+
+	if (_journalTarget && [_journalTarget respondsToSelector: _journalCallBack]) {
+
+		[_journalTarget performSelector: _journalCallBack
+							 withObject: response];
+	}
+}
+
+#pragma mark Write Journal Logic End
+
 #pragma mark Auth Logic
 
 - (void)performAuthenticationCheck: (NSObject *)target
@@ -253,46 +859,157 @@
 
 #pragma mark Token Refreshing Logic
 
+- (BOOL)isRefreshingSessionToken {
+
+	return _refreshTokenRequest != nil;
+}
+
 - (void)refreshSessionToken: (HealthVaultRequest *)request {
 
+	// Saves source request, it will be resent after token updating.
+	request.metrics.refreshCount++;
+	[_requestsAwaitingToken addObject: request];
+
+	if (_refreshTokenRequest) {
+		return;
+	}
+
+	_sessionTokenRefreshCount++;
+
 	self.authorizationSessionToken = nil;
+	[self startSessionTokenRefresh];
+}
+
+- (void)renewSessionToken {
+
+	if (_refreshTokenRequest) {
+		return;
+	}
+
+	_sessionTokenRenewalCount++;
+
+	// The current token stays valid, it is used again if the renewal fails.
+	_isRenewingSessionToken = YES;
+	[self startSessionTokenRefresh];
+}
+
+- (void)startSessionTokenRefresh {
+
+	[self cancelSessionTokenRenewal];
+
 	NSString *infoSection = [self getCastCallInfoSection];
 
-	HealthVaultRequest *refreshTokenRequest =
+	_refreshTokenRequest =
 			[[HealthVaultRequest alloc] initWithMethodName: @"CreateAuthenticatedSessionToken"
 											 methodVersion: 2
 											   infoSection: infoSection
 													target: self
 												  callBack: @selector(refreshSessionTokenCompleted:)];
 
-	// Saves source response to userState property, it will be resent
-	// after token updating.
-	refreshTokenRequest.userState = request;
+	// Other requests can't succeed until the token is refreshed.
+	_refreshTokenRequest.priority = WEB_REQUEST_PRIORITY_HIGH;
+
+	[self sendRequestNow: _refreshTokenRequest];
+}
+
+- (void)scheduleSessionTokenRenewal {
+
+	[self cancelSessionTokenRenewal];
+
+	if (self.sessionTokenRenewalMargin <= 0 || !self.authorizationSessionToken || !self.sessionTokenTime) {
+		return;
+	}
+
+	NSTimeInterval delay = [self.sessionTokenTime timeIntervalSinceNow] + self.sessionTokenLifetime - self.sessionTokenRenewalMargin;
+
+	_renewalTimer = [[NSTimer scheduledTimerWithTimeInterval: MAX(delay, 0)
+													  target: self
+													selector: @selector(renewalTimerFired:)
+													userInfo: nil
+													 repeats: NO] retain];
+}
+
+- (void)renewalTimerFired: (NSTimer *)timer {
+
+	[_renewalTimer release];
+	_renewalTimer = nil;
+
+	[self renewSessionToken];
+}
+
+- (void)cancelSessionTokenRenewal {
 
-	[self sendRequest: refreshTokenRequest];
-	[refreshTokenRequest release];
+	[_renewalTimer invalidate];
+	[_renewalTimer release];
+	_renewalTimer = nil;
+}
+
+- (BOOL)isSessionTokenDueForRenewal {
+
+	if (self.sessionTokenRenewalMargin <= 0 || !self.authorizationSessionToken || !self.sessionTokenTime) {
+		return NO;
+	}
+
+	return -[self.sessionTokenTime timeIntervalSinceNow] >= self.sessionTokenLifetime - self.sessionTokenRenewalMargin;
 }
 
 - (void)refreshSessionTokenCompleted: (HealthVaultResponse *)response {
 
-	// Retrieves source request, which was failed.
-	HealthVaultRequest *originalRequest = (HealthVaultRequest *)response.request.userState;
-	
+	// Takes the requests which were failed or sent during the refresh.
+	NSArray *waitingRequests = [_requestsAwaitingToken copy];
+	[_requestsAwaitingToken removeAllObjects];
+
+	[_refreshTokenRequest autorelease];
+	_refreshTokenRequest = nil;
+
+	BOOL wasRenewing = _isRenewingSessionToken;
+	_isRenewingSessionToken = NO;
+
+	// The old token hasn't expired yet, so the requests are sent with it;
+	// if it expires meanwhile, they get a new one through the usual refresh.
+	// Its age is forgotten, so the failed renewal isn't retried before every request.
+	if (response.hasError && wasRenewing) {
+
+		self.sessionTokenTime = nil;
+
+		for (HealthVaultRequest *request in waitingRequests) {
+
+			[self sendRequest: request];
+		}
+	}
 	// Any error just gets returned to the application.
-	if (response.hasError) {
+	else if (response.hasError) {
 
-		[self performAppCallBack: originalRequest
-						response: response];
-		return;
+		for (HealthVaultRequest *request in waitingRequests) {
+
+			HealthVaultResponse *requestResponse = response;
+
+			// The write hasn't been sent, so it stays in the journal.
+			if ([self finishJournaledRequest: request isDelivered: NO]) {
+
+				requestResponse = [[[HealthVaultResponse alloc] initWithResponse: response
+																		 request: request
+																	 infoElement: nil] autorelease];
+				requestResponse.isJournaled = YES;
+			}
+
+			[self performAppCallBack: request
+							response: requestResponse];
+		}
 	}
+	else {
 
+		// If the CAST was successful the results were saved and
+		// the original requests are restarted, all signed with the new secret.
+		[self saveCastCallResultsFromInfo: response.infoElement];
 
-	// If the CAST was successful the results were saved and
-	// the original request is restarted.
-	[self saveCastCallResults: response.infoXml];
+		for (HealthVaultRequest *request in waitingRequests) {
 
-	// Resend original request.
-	[self sendRequest: originalRequest];
+			[self sendRequest: request];
+		}
+	}
+
+	[waitingRequests release];
 }
 
 #pragma mark Token Refreshing Logic End
@@ -303,15 +1020,18 @@
 
 	NSAutoreleasePool *pool = [NSAutoreleasePool new];
 
-	XmlTextReader *xmlReader = [XmlTextReader new];
-	XmlElement *responseRootNode = [xmlReader read: responseXml];
+	[self saveCastCallResultsFromInfo: [XmlDocument documentWithString: responseXml].rootElement];
 
-	self.authorizationSessionToken = [responseRootNode selectSingleNode: @"token"].text;
-	self.sessionSharedSecret = [responseRootNode selectSingleNode: @"shared-secret"].text;
+	[pool release];
+}
 
-	[xmlReader release];
+- (void)saveCastCallResultsFromInfo: (XmlElement *)infoNode {
 
-	[pool release];
+	self.authorizationSessionToken = [infoNode selectSingleNode: @"token"].text;
+	self.sessionSharedSecret = [infoNode selectSingleNode: @"shared-secret"].text;
+	self.sessionTokenTime = [NSDate date];
+
+	[self scheduleSessionTokenRenewal];
 }
 
 - (NSString *)getCastCallInfoSection {
@@ -359,6 +1079,7 @@
 
 	settings.applicationId = self.appIdInstance;
 	settings.authorizationSessionToken = self.authorizationSessionToken;
+	settings.sessionTokenTime = self.sessionTokenTime;
 	settings.sharedSecret = self.sharedSecret;
 	settings.country = self.country;
 	settings.language = self.language;
@@ -383,6 +1104,7 @@
 
 	self.appIdInstance = settings.applicationId;
 	self.authorizationSessionToken = settings.authorizationSessionToken;
+	self.sessionTokenTime = settings.sessionTokenTime;
 	self.sharedSecret = settings.sharedSecret;
 	self.country = settings.country;
 	self.language = settings.language;
@@ -400,6 +1122,8 @@
 		self.currentRecord = nil;
 	}
 
+	[self scheduleSessionTokenRenewal];
+
 	[pool release];
 }
 
@@ -408,10 +1132,29 @@
 - (void)performAppCallBack: (HealthVaultRequest *)request
 				  response: (HealthVaultResponse *)response {
 
-	if (request && request.target && [request.target respondsToSelector:request.callBack]) {
+	// The span is taken off the request, so the callBack can send it again with a new one.
+	HealthVaultRequestMetrics *metrics = [request.metrics retain];
+	NSTimeInterval callBackStartTime = 0;
 
-		[request.target performSelector: request.callBack
-							 withObject: response];
+	if (metrics) {
+
+		request.metrics = nil;
+		callBackStartTime = [NSDate timeIntervalSinceReferenceDate];
+	}
+
+	[request performCallBack: response];
+
+	if (metrics) {
+
+		[metrics addDuration: [NSDate timeIntervalSinceReferenceDate] - callBackStartTime toStage: HealthVaultRequestStageCallBack];
+
+		metrics.retryCount = request.retryCount;
+		metrics.statusCode = response.statusCode;
+		metrics.hasError = response.hasError;
+		[metrics finish];
+
+		[self.metricsSink requestCompleted: metrics];
+		[metrics release];
 	}
 }
 
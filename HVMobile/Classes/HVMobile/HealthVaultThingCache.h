@@ -0,0 +1,110 @@
+//
+//  HealthVaultThingCache.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/// Size of the thing id and version stamp fields of a cache index entry, including the terminating zero.
+#define THING_CACHE_KEY_LENGTH 48
+
+
+/// Keeps things of one type of one record on the device, so they can be shown
+/// before HealthVault answers and only changed things have to be downloaded.
+/// Things are stored in the order of GetThings results in one file: a header,
+/// an index of fixed-size entries (thing id, version stamp, position of the xml)
+/// and the xml of things in index order. A range of things is read with one seek
+/// into the index and one into the xml, so it takes time proportional to the length
+/// of the range, not to the size of the cache.
+/// Thing ids and version stamps are GUIDs; a key longer than THING_CACHE_KEY_LENGTH - 1
+/// characters can't be stored.
+@interface HealthVaultThingCache : NSObject {
+
+	NSString *_path;
+	NSString *_recordId;
+	NSString *_typeId;
+}
+
+/// Gets the path of the cache file.
+@property (readonly) NSString *path;
+
+/// Gets the id of the record.
+@property (readonly) NSString *recordId;
+
+/// Gets the id of the thing type.
+@property (readonly) NSString *typeId;
+
+/// Gets count of cached things, only the header of the file is read.
+@property (readonly) NSUInteger count;
+
+/// Initializes a new instance of the HealthVaultThingCache class.
+/// @param directory - the directory of cache files, it is created if it doesn't exist.
+/// @param recordId - the id of the record.
+/// @param typeId - the id of the thing type.
+- (id)initWithDirectory: (NSString *)directory
+			   recordId: (NSString *)recordId
+				 typeId: (NSString *)typeId;
+
+/// Returns the directory of cache files in the caches directory of the application.
++ (NSString *)defaultDirectory;
+
+/// Reads xml of cached things.
+/// @param range - positions of the things, it is clipped to the count of things.
+/// @returns array of NSString with xml of <thing> elements.
+- (NSArray *)thingsInRange: (NSRange)range;
+
+/// Reads cached things as info section of a GetThings response,
+/// so they can be parsed the same way as things from HealthVault.
+/// @param range - positions of the things, it is clipped to the count of things.
+/// @returns <info><group>...</group></info> xml.
+- (NSString *)infoXmlWithThingsInRange: (NSRange)range;
+
+/// Reads version stamps of all cached things.
+/// @returns dictionary of version stamps by thing id.
+- (NSDictionary *)versionStamps;
+
+/// Replaces the content of the cache.
+/// Things which aren't in the things dictionary are copied from the current content,
+/// so only changed things have to be passed.
+/// @param thingIds - ids of things in the order they are returned by GetThings.
+/// @param versionStamps - version stamps of the things.
+/// @param things - xml of new and changed things by thing id.
+/// @returns NO if a thing is neither in things nor in the cache, or the file can't be written.
+- (BOOL)writeThingIds: (NSArray *)thingIds
+		versionStamps: (NSArray *)versionStamps
+			   things: (NSDictionary *)things;
+
+/// Inserts a thing which has been written to HealthVault, so it can be shown without reading the things again.
+/// The index and the xml are copied around the new thing, nothing is parsed.
+/// @param thing - xml of the <thing> element.
+/// @param thingId - the thing id.
+/// @param versionStamp - the version stamp.
+/// @param index - position of the thing, at most the count of things.
+/// @returns NO if the position is beyond the end, or the file can't be written.
+- (BOOL)insertThing: (NSString *)thing
+			thingId: (NSString *)thingId
+	   versionStamp: (NSString *)versionStamp
+			atIndex: (NSUInteger)index;
+
+/// Removes things which have been removed from HealthVault, the rest keep their order.
+/// @param thingIds - ids of things to remove, ids which aren't cached are ignored.
+/// @returns NO if the file can't be written.
+- (BOOL)removeThingIds: (NSSet *)thingIds;
+
+/// Removes all cached things.
+- (void)clear;
+
+@end
@@ -0,0 +1,567 @@
+//
+//  HealthVaultThingCache.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingCache.h"
+
+/// Identifies cache files.
+#define THING_CACHE_MAGIC "HVTC"
+
+/// Version of the file format, files of other versions are ignored.
+#define THING_CACHE_VERSION 1
+
+/// Name of the directory of cache files in the caches directory.
+#define THING_CACHE_DIRECTORY @"HealthVaultThings"
+
+
+/// Header of the cache file.
+typedef struct {
+
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+} ThingCacheHeader;
+
+/// Index entry of one thing, the offset is counted from the end of the index.
+typedef struct {
+
+	char thingId[THING_CACHE_KEY_LENGTH];
+	char versionStamp[THING_CACHE_KEY_LENGTH];
+	uint64_t offset;
+	uint32_t length;
+	uint32_t reserved;
+} ThingCacheEntry;
+
+
+@interface HealthVaultThingCache (Private)
+
+/// Opens the cache file and reads its header.
+/// @param header - receives the header.
+/// @returns the file positioned after the header, or nil if there is no valid cache file.
+- (NSFileHandle *)openWithHeader: (ThingCacheHeader *)header;
+
+/// Reads index entries.
+/// @param range - positions of the entries, it must be within the count of things.
+/// @param file - the file positioned anywhere.
+/// @returns data with ThingCacheEntry array or nil if the file is truncated.
++ (NSData *)readEntriesInRange: (NSRange)range file: (NSFileHandle *)file;
+
+/// Maps the cache file and checks that every index entry points into its xml.
+/// @param count - receives count of things.
+/// @returns the mapped file, or nil if there is no valid cache file.
+- (NSData *)mapWithCount: (NSUInteger *)count;
+
+/// Creates string from a zero terminated key field.
+/// @param key - the field.
+/// @returns the string, or nil if the field isn't valid UTF-8.
++ (NSString *)stringWithKey: (const char *)key;
+
+/// Copies string to a key field.
+/// @param string - the string.
+/// @param key - the field, THING_CACHE_KEY_LENGTH characters long.
+/// @returns NO if the string doesn't fit into the field.
++ (BOOL)copyString: (NSString *)string toKey: (char *)key;
+
+@end
+
+
+@implementation HealthVaultThingCache
+
+@synthesize path = _path;
+@synthesize recordId = _recordId;
+@synthesize typeId = _typeId;
+
+- (id)initWithDirectory: (NSString *)directory
+			   recordId: (NSString *)recordId
+				 typeId: (NSString *)typeId {
+
+	if ((self = [super init])) {
+
+		_recordId = [recordId copy];
+		_typeId = [typeId copy];
+
+		[[NSFileManager defaultManager] createDirectoryAtPath: directory
+								  withIntermediateDirectories: YES
+												   attributes: nil
+														error: NULL];
+
+		NSString *fileName = [NSString stringWithFormat: @"%@_%@.things", recordId, typeId];
+		_path = [[directory stringByAppendingPathComponent: fileName] retain];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_path release];
+	[_recordId release];
+	[_typeId release];
+
+	[super dealloc];
+}
+
++ (NSString *)defaultDirectory {
+
+	NSArray *directories = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+
+	return [[directories objectAtIndex: 0] stringByAppendingPathComponent: THING_CACHE_DIRECTORY];
+}
+
+- (NSUInteger)count {
+
+	ThingCacheHeader header;
+	NSFileHandle *file = [self openWithHeader: &header];
+
+	if (!file) {
+		return 0;
+	}
+
+	[file closeFile];
+
+	return header.count;
+}
+
+- (NSArray *)thingsInRange: (NSRange)range {
+
+	ThingCacheHeader header;
+	NSFileHandle *file = [self openWithHeader: &header];
+
+	if (!file) {
+		return [NSArray array];
+	}
+
+	// Clips the range to the count of things.
+	if (range.location >= header.count) {
+		range.length = 0;
+	}
+	else {
+		range.length = MIN(range.length, header.count - range.location);
+	}
+
+	NSData *entryData = range.length > 0 ? [HealthVaultThingCache readEntriesInRange: range file: file] : nil;
+
+	if (!entryData) {
+
+		[file closeFile];
+		return [NSArray array];
+	}
+
+	const ThingCacheEntry *entries = (const ThingCacheEntry *)entryData.bytes;
+
+	// Xml of the range is contiguous, so it is read at once.
+	uint64_t dataStart = sizeof(ThingCacheHeader) + (uint64_t)header.count * sizeof(ThingCacheEntry);
+	uint64_t firstOffset = entries[0].offset;
+	uint64_t endOffset = entries[range.length - 1].offset + entries[range.length - 1].length;
+
+	if (endOffset < firstOffset) {
+
+		[file closeFile];
+		return [NSArray array];
+	}
+
+	[file seekToFileOffset: dataStart + firstOffset];
+	NSData *xmlData = [file readDataOfLength: (NSUInteger)(endOffset - firstOffset)];
+	[file closeFile];
+
+	if (xmlData.length < endOffset - firstOffset) {
+		return [NSArray array];
+	}
+
+	NSMutableArray *things = [NSMutableArray arrayWithCapacity: range.length];
+
+	for (NSUInteger i = 0; i < range.length; i++) {
+
+		// An entry of a corrupt index may point outside of the xml which has been read.
+		if (entries[i].offset < firstOffset || entries[i].length > endOffset - entries[i].offset) {
+			return [NSArray array];
+		}
+
+		NSString *thing = [[NSString alloc] initWithBytes: (const char *)xmlData.bytes + (entries[i].offset - firstOffset)
+												   length: entries[i].length
+												 encoding: NSUTF8StringEncoding];
+		if (thing) {
+			[things addObject: thing];
+		}
+
+		[thing release];
+	}
+
+	return things;
+}
+
+- (NSString *)infoXmlWithThingsInRange: (NSRange)range {
+
+	NSArray *things = [self thingsInRange: range];
+
+	NSUInteger length = 0;
+	for (NSString *thing in things) {
+		length += thing.length;
+	}
+
+	NSMutableString *xml = [NSMutableString stringWithCapacity: length + 26];
+
+	[xml appendString: @"<info><group>"];
+
+	for (NSString *thing in things) {
+		[xml appendString: thing];
+	}
+
+	[xml appendString: @"</group></info>"];
+
+	return xml;
+}
+
+- (NSDictionary *)versionStamps {
+
+	ThingCacheHeader header;
+	NSFileHandle *file = [self openWithHeader: &header];
+
+	if (!file) {
+		return [NSDictionary dictionary];
+	}
+
+	NSData *entryData = [HealthVaultThingCache readEntriesInRange: NSMakeRange(0, header.count) file: file];
+	[file closeFile];
+
+	NSMutableDictionary *versionStamps = [NSMutableDictionary dictionaryWithCapacity: header.count];
+	const ThingCacheEntry *entries = (const ThingCacheEntry *)entryData.bytes;
+
+	for (NSUInteger i = 0; entryData && i < header.count; i++) {
+
+		NSString *thingId = [HealthVaultThingCache stringWithKey: entries[i].thingId];
+		NSString *versionStamp = [HealthVaultThingCache stringWithKey: entries[i].versionStamp];
+
+		// A key which isn't valid UTF-8 is skipped, the thing is loaded again by the next sync.
+		if (thingId && versionStamp) {
+			[versionStamps setObject: versionStamp forKey: thingId];
+		}
+	}
+
+	return versionStamps;
+}
+
+- (BOOL)writeThingIds: (NSArray *)thingIds
+		versionStamps: (NSArray *)versionStamps
+			   things: (NSDictionary *)things {
+
+	if (thingIds.count != versionStamps.count) {
+		return NO;
+	}
+
+	// Unchanged things are copied from the current file, it is mapped rather than read.
+	NSData *current = [NSData dataWithContentsOfFile: _path options: NSDataReadingMapped error: NULL];
+	const ThingCacheHeader *currentHeader = (const ThingCacheHeader *)current.bytes;
+	const ThingCacheEntry *currentEntries = NULL;
+	uint64_t currentDataStart = 0;
+	NSMutableDictionary *currentPositions = nil;
+
+	if (current.length >= sizeof(ThingCacheHeader)
+		&& memcmp(currentHeader->magic, THING_CACHE_MAGIC, sizeof(currentHeader->magic)) == 0
+		&& currentHeader->version == THING_CACHE_VERSION) {
+
+		currentDataStart = sizeof(ThingCacheHeader) + (uint64_t)currentHeader->count * sizeof(ThingCacheEntry);
+
+		if (current.length >= currentDataStart) {
+
+			currentEntries = (const ThingCacheEntry *)(currentHeader + 1);
+			currentPositions = [NSMutableDictionary dictionaryWithCapacity: currentHeader->count];
+
+			for (NSUInteger i = 0; i < currentHeader->count; i++) {
+
+				NSString *thingId = [HealthVaultThingCache stringWithKey: currentEntries[i].thingId];
+
+				if (thingId) {
+					[currentPositions setObject: [NSNumber numberWithUnsignedInteger: i] forKey: thingId];
+				}
+			}
+		}
+	}
+
+	NSUInteger count = thingIds.count;
+	NSUInteger indexLength = sizeof(ThingCacheHeader) + count * sizeof(ThingCacheEntry);
+
+	NSMutableData *file = [NSMutableData dataWithCapacity: MAX(indexLength, current.length)];
+	[file setLength: indexLength];
+
+	ThingCacheHeader *header = (ThingCacheHeader *)file.mutableBytes;
+	memcpy(header->magic, THING_CACHE_MAGIC, sizeof(header->magic));
+	header->version = THING_CACHE_VERSION;
+	header->count = (uint32_t)count;
+
+	uint64_t offset = 0;
+
+	for (NSUInteger i = 0; i < count; i++) {
+
+		// The buffer may move as xml is appended.
+		ThingCacheEntry *entry = (ThingCacheEntry *)((char *)file.mutableBytes + sizeof(ThingCacheHeader)) + i;
+
+		NSString *thingId = [thingIds objectAtIndex: i];
+
+		if (![HealthVaultThingCache copyString: thingId toKey: entry->thingId]
+			|| ![HealthVaultThingCache copyString: [versionStamps objectAtIndex: i] toKey: entry->versionStamp]) {
+
+			return NO;
+		}
+
+		NSString *thing = [things objectForKey: thingId];
+		NSUInteger length;
+
+		if (thing) {
+
+			NSData *xml = [thing dataUsingEncoding: NSUTF8StringEncoding];
+			length = xml.length;
+
+			[file appendData: xml];
+		}
+		else {
+
+			NSNumber *position = [currentPositions objectForKey: thingId];
+
+			if (!position) {
+				return NO;
+			}
+
+			const ThingCacheEntry *currentEntry = currentEntries + [position unsignedIntegerValue];
+			length = currentEntry->length;
+
+			if (currentEntry->offset > current.length - currentDataStart
+				|| length > current.length - currentDataStart - currentEntry->offset) {
+				return NO;
+			}
+
+			[file appendBytes: (const char *)current.bytes + currentDataStart + currentEntry->offset
+					   length: length];
+		}
+
+		entry = (ThingCacheEntry *)((char *)file.mutableBytes + sizeof(ThingCacheHeader)) + i;
+		entry->offset = offset;
+		entry->length = (uint32_t)length;
+
+		offset += length;
+	}
+
+	return [file writeToFile: _path atomically: YES];
+}
+
+- (BOOL)insertThing: (NSString *)thing
+			thingId: (NSString *)thingId
+	   versionStamp: (NSString *)versionStamp
+			atIndex: (NSUInteger)index {
+
+	NSUInteger count = 0;
+	NSData *current = [self mapWithCount: &count];
+
+	if (index > count) {
+		return NO;
+	}
+
+	const ThingCacheEntry *currentEntries = current ? (const ThingCacheEntry *)((const ThingCacheHeader *)current.bytes + 1) : NULL;
+	const char *currentXml = current ? (const char *)(currentEntries + count) : NULL;
+	uint64_t xmlLength = count > 0 ? currentEntries[count - 1].offset + currentEntries[count - 1].length : 0;
+	uint64_t splitOffset = index < count ? currentEntries[index].offset : xmlLength;
+
+	NSData *xml = [thing dataUsingEncoding: NSUTF8StringEncoding];
+	NSUInteger indexLength = sizeof(ThingCacheHeader) + (count + 1) * sizeof(ThingCacheEntry);
+
+	NSMutableData *file = [NSMutableData dataWithLength: indexLength];
+
+	ThingCacheHeader *header = (ThingCacheHeader *)file.mutableBytes;
+	memcpy(header->magic, THING_CACHE_MAGIC, sizeof(header->magic));
+	header->version = THING_CACHE_VERSION;
+	header->count = (uint32_t)(count + 1);
+
+	// Entries before the new one are copied as is, the xml of the ones after it moves by its length.
+	ThingCacheEntry *entries = (ThingCacheEntry *)(header + 1);
+
+	if (count > 0) {
+
+		memcpy(entries, currentEntries, index * sizeof(ThingCacheEntry));
+		memcpy(entries + index + 1, currentEntries + index, (count - index) * sizeof(ThingCacheEntry));
+	}
+
+	for (NSUInteger i = index + 1; i <= count; i++) {
+		entries[i].offset += xml.length;
+	}
+
+	ThingCacheEntry *entry = entries + index;
+	memset(entry, 0, sizeof(ThingCacheEntry));
+
+	if (![HealthVaultThingCache copyString: thingId toKey: entry->thingId]
+		|| ![HealthVaultThingCache copyString: versionStamp toKey: entry->versionStamp]) {
+
+		return NO;
+	}
+
+	entry->offset = splitOffset;
+	entry->length = (uint32_t)xml.length;
+
+	[file appendBytes: currentXml length: (NSUInteger)splitOffset];
+	[file appendData: xml];
+	[file appendBytes: currentXml + splitOffset length: (NSUInteger)(xmlLength - splitOffset)];
+
+	return [file writeToFile: _path atomically: YES];
+}
+
+- (BOOL)removeThingIds: (NSSet *)thingIds {
+
+	NSUInteger count = 0;
+	NSData *current = [self mapWithCount: &count];
+
+	if (!current) {
+		return YES;
+	}
+
+	const ThingCacheEntry *currentEntries = (const ThingCacheEntry *)((const ThingCacheHeader *)current.bytes + 1);
+	const char *currentXml = (const char *)(currentEntries + count);
+
+	NSMutableData *entryData = [NSMutableData dataWithCapacity: count * sizeof(ThingCacheEntry)];
+	NSMutableData *xmlData = [NSMutableData dataWithCapacity: current.length];
+
+	for (NSUInteger i = 0; i < count; i++) {
+
+		if ([thingIds containsObject: [HealthVaultThingCache stringWithKey: currentEntries[i].thingId]]) {
+			continue;
+		}
+
+		ThingCacheEntry entry = currentEntries[i];
+		entry.offset = xmlData.length;
+
+		[xmlData appendBytes: currentXml + currentEntries[i].offset length: currentEntries[i].length];
+		[entryData appendBytes: &entry length: sizeof(ThingCacheEntry)];
+	}
+
+	NSUInteger remainingCount = entryData.length / sizeof(ThingCacheEntry);
+
+	if (remainingCount == count) {
+		return YES;
+	}
+
+	ThingCacheHeader header;
+	memcpy(header.magic, THING_CACHE_MAGIC, sizeof(header.magic));
+	header.version = THING_CACHE_VERSION;
+	header.count = (uint32_t)remainingCount;
+	header.reserved = 0;
+
+	NSMutableData *file = [NSMutableData dataWithCapacity: sizeof(ThingCacheHeader) + entryData.length + xmlData.length];
+	[file appendBytes: &header length: sizeof(ThingCacheHeader)];
+	[file appendData: entryData];
+	[file appendData: xmlData];
+
+	return [file writeToFile: _path atomically: YES];
+}
+
+- (void)clear {
+
+	[[NSFileManager defaultManager] removeItemAtPath: _path error: NULL];
+}
+
+#pragma mark Helpers
+
+- (NSFileHandle *)openWithHeader: (ThingCacheHeader *)header {
+
+	NSFileHandle *file = [NSFileHandle fileHandleForReadingAtPath: _path];
+
+	if (!file) {
+		return nil;
+	}
+
+	NSData *headerData = [file readDataOfLength: sizeof(ThingCacheHeader)];
+
+	if (headerData.length < sizeof(ThingCacheHeader)) {
+
+		[file closeFile];
+		return nil;
+	}
+
+	memcpy(header, headerData.bytes, sizeof(ThingCacheHeader));
+
+	if (memcmp(header->magic, THING_CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != THING_CACHE_VERSION) {
+
+		[file closeFile];
+		return nil;
+	}
+
+	return file;
+}
+
+- (NSData *)mapWithCount: (NSUInteger *)count {
+
+	*count = 0;
+
+	NSData *data = [NSData dataWithContentsOfFile: _path options: NSDataReadingMapped error: NULL];
+	const ThingCacheHeader *header = (const ThingCacheHeader *)data.bytes;
+
+	if (data.length < sizeof(ThingCacheHeader)
+		|| memcmp(header->magic, THING_CACHE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != THING_CACHE_VERSION) {
+
+		return nil;
+	}
+
+	uint64_t dataStart = sizeof(ThingCacheHeader) + (uint64_t)header->count * sizeof(ThingCacheEntry);
+
+	if (data.length < dataStart) {
+		return nil;
+	}
+
+	// The xml of things is stored contiguously in index order, so every entry starts where the previous one ends.
+	const ThingCacheEntry *entries = (const ThingCacheEntry *)(header + 1);
+	uint64_t xmlLength = data.length - dataStart;
+	uint64_t end = 0;
+
+	for (NSUInteger i = 0; i < header->count; i++) {
+
+		if (entries[i].offset != end || entries[i].length > xmlLength - end) {
+			return nil;
+		}
+
+		end += entries[i].length;
+	}
+
+	*count = header->count;
+
+	return data;
+}
+
++ (NSData *)readEntriesInRange: (NSRange)range file: (NSFileHandle *)file {
+
+	[file seekToFileOffset: sizeof(ThingCacheHeader) + (uint64_t)range.location * sizeof(ThingCacheEntry)];
+
+	NSData *entryData = [file readDataOfLength: range.length * sizeof(ThingCacheEntry)];
+
+	return entryData.length == range.length * sizeof(ThingCacheEntry) ? entryData : nil;
+}
+
++ (NSString *)stringWithKey: (const char *)key {
+
+	return [[[NSString alloc] initWithBytes: key
+									 length: strnlen(key, THING_CACHE_KEY_LENGTH)
+								   encoding: NSUTF8StringEncoding] autorelease];
+}
+
++ (BOOL)copyString: (NSString *)string toKey: (char *)key {
+
+	memset(key, 0, THING_CACHE_KEY_LENGTH);
+
+	return [string getCString: key maxLength: THING_CACHE_KEY_LENGTH encoding: NSUTF8StringEncoding];
+}
+
+#pragma mark Helpers End
+
+@end
@@ -0,0 +1,132 @@
+//
+//  HealthVaultThingMapper.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class XmlWriter;
+@class Base64Decoder;
+
+/// State of the parser before the root element.
+#define THING_MAPPER_STATE_DOCUMENT 0
+
+/// State returned for elements which aren't mapped, their subtrees are skipped.
+#define THING_MAPPER_STATE_NONE -1
+
+/// The first state which subclasses may use.
+#define THING_MAPPER_STATE_FIRST 1
+
+/// Count of components of HealthVault structured date and time:
+/// year, month, day, hour, minute, second and millisecond.
+#define THING_MAPPER_WHEN_COMPONENTS 7
+
+/// Base class of the thing mappers generated by Tools/ThingMapperGenerator.py from thing type descriptions.
+/// Things are read from GetThings info, <info><group><thing/>...</group></info>, while the document is
+/// being parsed: the subclass maps every element it knows to a state and sets values of the thing
+/// when their elements end, elements of other states are skipped, so no tree is built.
+/// Things are written by the subclass into XmlWriter.
+@interface HealthVaultThingMapper : NSObject <NSXMLParserDelegate> {
+
+	/// States of the open elements.
+	NSInteger *_states;
+	NSUInteger _depth;
+	NSUInteger _stateCapacity;
+
+	/// Depth of the open elements within the skipped subtree.
+	NSUInteger _skippedDepth;
+
+	/// Text of the element being collected.
+	NSMutableString *_text;
+	BOOL _collectsText;
+
+	/// Decoder of the base64 text of the element being collected.
+	Base64Decoder *_base64Decoder;
+
+	NSMutableArray *_things;
+}
+
+/// Returns type id of the things.
++ (NSString *)typeId;
+
+/// Parses things from GetThings info section.
+/// @param xml - the info section.
+/// @returns array of things or nil if the xml isn't valid.
++ (NSArray *)parseThingsFromXml: (NSString *)xml;
+
+/// Parses things from GetThings info section.
+/// @param data - UTF-8 xml of the info section.
+/// @returns array of things or nil if the xml isn't valid.
++ (NSArray *)parseThingsFromData: (NSData *)data;
+
+/// Writes <thing> element of the thing.
+/// @param thing - the thing.
+/// @param writer - the writer to write to.
++ (void)appendThing: (id)thing toWriter: (XmlWriter *)writer;
+
+/// Returns <thing> xml of the thing.
+/// @param thing - the thing.
++ (NSString *)xmlOfThing: (id)thing;
+
+/// Parses things, an instance parses one document.
+/// @param data - UTF-8 xml of the info section.
+/// @returns array of things or nil if the xml isn't valid.
+- (NSArray *)parseThingsFromData: (NSData *)data;
+
+/// Returns state of the element, implemented by subclass.
+/// @param name - local name of the element.
+/// @param state - state of the parent element.
+/// @returns the state or THING_MAPPER_STATE_NONE if the element isn't mapped.
+- (NSInteger)stateForElement: (NSString *)name inState: (NSInteger)state;
+
+/// Called when element of the state starts, implemented by subclass.
+/// @param state - state of the element.
+/// @param attributes - attributes of the element.
+- (void)enterState: (NSInteger)state attributes: (NSDictionary *)attributes;
+
+/// Called when element of the state ends, implemented by subclass.
+/// @param state - state of the element.
+- (void)leaveState: (NSInteger)state;
+
+/// Starts collecting text of the element which has just started, the text is available until it ends.
+- (void)collectText;
+
+/// Starts decoding base64 text of the element which has just started.
+- (void)collectBase64;
+
+/// Returns collected text of the element which is ending.
+/// @returns the text or nil if the element has no text.
+- (NSString *)text;
+
+/// Returns decoded base64 text of the element which is ending.
+/// @returns the data or nil if the element is empty or its text isn't valid base64.
+- (NSData *)base64Data;
+
+/// Adds parsed thing to the results.
+/// @param thing - the thing.
+- (void)addThing: (id)thing;
+
+/// Returns date of HealthVault structured date and time.
+/// @param components - THING_MAPPER_WHEN_COMPONENTS components, time ones are 0 if there is no time.
+/// @returns the date or nil if the components aren't a valid date.
++ (NSDate *)dateWithWhenComponents: (const NSInteger *)components;
+
+/// Writes content of HealthVault structured date and time, <date> and <time> elements, in UTC.
+/// @param date - the date.
+/// @param writer - the writer to write to.
++ (void)appendWhenOfDate: (NSDate *)date toWriter: (XmlWriter *)writer;
+
+@end
@@ -0,0 +1,317 @@
+//
+//  HealthVaultThingMapper.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingMapper.h"
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+#import "Base64.h"
+#import "Logger.h"
+
+/// Initial depth of the state stack.
+#define STATE_STACK_INITIAL_CAPACITY 16
+
+/// Initial capacity of the collected text.
+#define COLLECTED_TEXT_INITIAL_CAPACITY 64
+
+
+@interface HealthVaultThingMapper (Private)
+
+/// Stops collecting text of the element which has ended.
+- (void)stopCollecting;
+
+@end
+
+
+@implementation HealthVaultThingMapper
+
++ (NSString *)typeId {
+
+	return nil;
+}
+
++ (NSArray *)parseThingsFromXml: (NSString *)xml {
+
+	return [self parseThingsFromData: [xml dataUsingEncoding: NSUTF8StringEncoding]];
+}
+
++ (NSArray *)parseThingsFromData: (NSData *)data {
+
+	HealthVaultThingMapper *mapper = [self new];
+	NSArray *things = [mapper parseThingsFromData: data];
+	[mapper release];
+
+	return things;
+}
+
++ (void)appendThing: (id)thing toWriter: (XmlWriter *)writer {
+
+}
+
++ (NSString *)xmlOfThing: (id)thing {
+
+	XmlWriter *writer = [XmlWriter new];
+	[self appendThing: thing toWriter: writer];
+
+	NSString *xml = writer.string;
+	[writer release];
+
+	return xml;
+}
+
+- (id)init {
+
+	if ((self = [super init])) {
+
+		_stateCapacity = STATE_STACK_INITIAL_CAPACITY;
+		_states = malloc(_stateCapacity * sizeof(NSInteger));
+		_text = [[NSMutableString alloc] initWithCapacity: COLLECTED_TEXT_INITIAL_CAPACITY];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	free(_states);
+	[_text release];
+	[_base64Decoder release];
+	[_things release];
+
+	[super dealloc];
+}
+
+- (NSArray *)parseThingsFromData: (NSData *)data {
+
+	if (!data) {
+		return nil;
+	}
+
+	[_things release];
+	_things = [NSMutableArray new];
+	_depth = 0;
+	_skippedDepth = 0;
+
+	NSXMLParser *parser = [[NSXMLParser alloc] initWithData: data];
+	[parser setShouldProcessNamespaces: YES];
+	parser.delegate = self;
+
+	BOOL isParsed = [parser parse];
+	[parser release];
+
+	[self stopCollecting];
+
+	if (!isParsed) {
+
+		TraceComponentError(@"HealthVaultThingMapper", @"Things couldn't be parsed, %@", NSStringFromClass([self class]));
+
+		[_things release];
+		_things = nil;
+		return nil;
+	}
+
+	NSArray *things = [_things autorelease];
+	_things = nil;
+
+	return things;
+}
+
+- (NSInteger)stateForElement: (NSString *)name inState: (NSInteger)state {
+
+	return THING_MAPPER_STATE_NONE;
+}
+
+- (void)enterState: (NSInteger)state attributes: (NSDictionary *)attributes {
+
+}
+
+- (void)leaveState: (NSInteger)state {
+
+}
+
+- (void)collectText {
+
+	[_text setString: @""];
+	_collectsText = YES;
+}
+
+- (void)collectBase64 {
+
+	[_base64Decoder release];
+	_base64Decoder = [[Base64Decoder alloc] initWithCapacity: 0];
+}
+
+- (NSString *)text {
+
+	return _collectsText && _text.length > 0 ? [NSString stringWithString: _text] : nil;
+}
+
+- (NSData *)base64Data {
+
+	// the data belongs to the decoder, which is released when the element ends
+	NSData *data = [_base64Decoder finish];
+
+	return data.length > 0 ? [[data retain] autorelease] : nil;
+}
+
+- (void)addThing: (id)thing {
+
+	if (thing) {
+		[_things addObject: thing];
+	}
+}
+
++ (NSDate *)dateWithWhenComponents: (const NSInteger *)components {
+
+	char buffer[64];
+
+	// an encoding error is negative, as size_t it fails the bounds check below
+	size_t length = (size_t)snprintf(buffer, sizeof(buffer), "%04ld-%02ld-%02ldT%02ld:%02ld:%02ld.%03ldZ",
+						  (long)components[0], (long)components[1], (long)components[2],
+						  (long)components[3], (long)components[4], (long)components[5], (long)components[6]);
+
+	NSTimeInterval time;
+
+	if (length == 0 || length >= sizeof(buffer) || ![DateTimeUtils parseUtcBytes: buffer length: length time: &time]) {
+		return nil;
+	}
+
+	return [NSDate dateWithTimeIntervalSinceReferenceDate: time];
+}
+
++ (void)appendWhenOfDate: (NSDate *)date toWriter: (XmlWriter *)writer {
+
+	char timestamp[DATE_TIME_UTC_STRING_LENGTH];
+
+	if (!date || [DateTimeUtils formatUtcTime: [date timeIntervalSinceReferenceDate] toBuffer: timestamp] == 0) {
+		return;
+	}
+
+	// components are taken from the fixed positions of yyyy-MM-ddTHH:mm:ss.SSSZ
+	static const struct { int offset; int length; const char *start; const char *end; } components[] = {
+		{ 0, 4, "<date><y>", "</y>" },
+		{ 5, 2, "<m>", "</m>" },
+		{ 8, 2, "<d>", "</d></date>" },
+		{ 11, 2, "<time><h>", "</h>" },
+		{ 14, 2, "<m>", "</m>" },
+		{ 17, 2, "<s>", "</s>" },
+		{ 20, 3, "<f>", "</f></time>" }
+	};
+
+	for (NSUInteger i = 0; i < THING_MAPPER_WHEN_COMPONENTS; i++) {
+
+		NSInteger value = 0;
+
+		for (int j = 0; j < components[i].length; j++) {
+			value = value * 10 + (timestamp[components[i].offset + j] - '0');
+		}
+
+		[writer appendBytes: components[i].start length: strlen(components[i].start)];
+		[writer appendInteger: value];
+		[writer appendBytes: components[i].end length: strlen(components[i].end)];
+	}
+}
+
+#pragma mark NSXMLParserDelegate
+
+- (void)parser: (NSXMLParser *)parser didStartElement: (NSString *)elementName namespaceURI: (NSString *)namespaceURI
+	qualifiedName: (NSString *)qualifiedName attributes: (NSDictionary *)attributeDict {
+
+	if (_skippedDepth > 0) {
+
+		_skippedDepth++;
+		return;
+	}
+
+	NSInteger parentState = _depth > 0 ? _states[_depth - 1] : THING_MAPPER_STATE_DOCUMENT;
+	NSInteger state = [self stateForElement: elementName inState: parentState];
+
+	if (state == THING_MAPPER_STATE_NONE) {
+
+		_skippedDepth = 1;
+		return;
+	}
+
+	if (_depth == _stateCapacity) {
+
+		_stateCapacity *= 2;
+		_states = realloc(_states, _stateCapacity * sizeof(NSInteger));
+	}
+
+	_states[_depth++] = state;
+
+	[self enterState: state attributes: attributeDict];
+}
+
+- (void)parser: (NSXMLParser *)parser didEndElement: (NSString *)elementName
+	namespaceURI: (NSString *)namespaceURI qualifiedName: (NSString *)qName {
+
+	if (_skippedDepth > 0) {
+
+		_skippedDepth--;
+		return;
+	}
+
+	if (_depth == 0) {
+		return;
+	}
+
+	[self leaveState: _states[--_depth]];
+	[self stopCollecting];
+}
+
+- (void)parser: (NSXMLParser *)parser foundCharacters: (NSString *)string {
+
+	// text of skipped children isn't a part of the value
+	if (_skippedDepth > 0) {
+		return;
+	}
+
+	if (_collectsText) {
+		[_text appendString: string];
+	}
+	else if (_base64Decoder) {
+		[_base64Decoder decodeString: string];
+	}
+}
+
+- (void)parser: (NSXMLParser *)parser foundCDATA: (NSData *)CDATABlock {
+
+	if (_skippedDepth > 0 || (!_collectsText && !_base64Decoder)) {
+		return;
+	}
+
+	NSString *string = [[NSString alloc] initWithData: CDATABlock encoding: NSUTF8StringEncoding];
+	[self parser: parser foundCharacters: string];
+	[string release];
+}
+
+#pragma mark NSXMLParserDelegate End
+
+#pragma mark Private
+
+- (void)stopCollecting {
+
+	_collectsText = NO;
+
+	[_base64Decoder release];
+	_base64Decoder = nil;
+}
+
+#pragma mark Private End
+
+@end
@@ -0,0 +1,106 @@
+//
+//  HealthVaultThingPager.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#import "HealthVaultRequest.h"
+#import "HealthVaultResponse.h"
+
+@class HealthVaultService;
+@class HealthVaultRequestBatcher;
+
+/// Loads things matching a GetThings filter page by page.
+/// The first request asks for pageSize full things; HealthVault returns the keys of the rest
+/// as <unprocessed-thing-key-info> elements, and they are requested by id in chunks of pageSize.
+/// So the first page arrives after one small round trip whatever the count of things is.
+/// Every page is delivered as a HealthVaultResponse whose info section has one <group>
+/// with the things of the page. The next page is requested by loadNextPage; if prefetchesNextPage
+/// is set, it is requested as soon as the previous page arrives and is delivered when asked for.
+@interface HealthVaultThingPager : NSObject {
+
+	HealthVaultService *_service;
+	HealthVaultRequestBatcher *_requestBatcher;
+	NSString *_filterXml;
+	NSString *_formatXml;
+	NSUInteger _pageSize;
+	BOOL _prefetchesNextPage;
+
+	NSObject *_target;
+	SEL _callBack;
+
+	/// Keys of things which haven't been requested yet.
+	NSMutableArray *_remainingThingIds;
+
+	/// Request in flight and the page which has arrived but hasn't been asked for.
+	HealthVaultRequest *_pageRequest;
+	HealthVaultResponse *_prefetchedPage;
+	BOOL _isPageWanted;
+
+	NSUInteger _loadedPageCount;
+	NSUInteger _loadedThingCount;
+	BOOL _isStarted;
+	BOOL _isFinished;
+}
+
+/// Gets or sets batcher page requests are sent through, so they can share
+/// a round trip with other requests; if it is nil, they are sent to the service.
+@property (retain) HealthVaultRequestBatcher *requestBatcher;
+
+/// Gets or sets count of things in one page.
+/// The default is DEFAULT_THING_PAGE_SIZE.
+@property (assign) NSUInteger pageSize;
+
+/// Gets or sets whether the next page is requested while the current one is consumed.
+@property (assign) BOOL prefetchesNextPage;
+
+/// Gets count of pages delivered.
+@property (readonly) NSUInteger loadedPageCount;
+
+/// Gets count of things delivered.
+@property (readonly) NSUInteger loadedThingCount;
+
+/// Gets count of things which haven't been delivered yet.
+/// Known after the first page has arrived.
+@property (readonly) NSUInteger remainingThingCount;
+
+/// Is YES if there are pages which haven't been delivered.
+@property (readonly) BOOL hasMorePages;
+
+/// Initializes a new instance of the HealthVaultThingPager class.
+/// @param service - the service requests are sent through.
+/// @param filterXml - <filter> elements of the group.
+/// @param formatXml - <format> element of the group.
+/// @param target - callback method owner, it isn't retained; call cancel before it is released.
+/// @param callBack - method invoked with HealthVaultResponse for every page.
+- (id)initWithService: (HealthVaultService *)service
+			filterXml: (NSString *)filterXml
+			formatXml: (NSString *)formatXml
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack;
+
+/// Requests the first page.
+- (void)start;
+
+/// Requests the next page, or delivers it at once if it has been prefetched.
+/// Does nothing if there are no more pages or a page is already being loaded.
+- (void)loadNextPage;
+
+/// Stops delivering pages.
+- (void)cancel;
+
+@end
@@ -0,0 +1,251 @@
+//
+//  HealthVaultThingPager.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingPager.h"
+#import "HealthVaultService.h"
+#import "HealthVaultRequestBatcher.h"
+#import "HealthVaultConfig.h"
+
+
+@interface HealthVaultThingPager (Private)
+
+/// Sends GetThings request for one page.
+/// @param groupXml - content of the <group> element.
+/// @param maxFull - count of full things to return, zero if it isn't limited.
+- (void)sendPageRequest: (NSString *)groupXml maxFull: (NSUInteger)maxFull;
+
+/// Requests the next chunk of things by their ids.
+- (void)requestNextChunk;
+
+/// Delivers page to the caller.
+/// @param response - the response with the page.
+- (void)deliverPage: (HealthVaultResponse *)response;
+
+@end
+
+
+@implementation HealthVaultThingPager
+
+@synthesize requestBatcher = _requestBatcher;
+@synthesize pageSize = _pageSize;
+@synthesize prefetchesNextPage = _prefetchesNextPage;
+@synthesize loadedPageCount = _loadedPageCount;
+@synthesize loadedThingCount = _loadedThingCount;
+
+- (id)initWithService: (HealthVaultService *)service
+			filterXml: (NSString *)filterXml
+			formatXml: (NSString *)formatXml
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack {
+
+	if ((self = [super init])) {
+
+		_service = [service retain];
+		_filterXml = [filterXml copy];
+		_formatXml = [formatXml copy];
+		_target = target;
+		_callBack = callBack;
+
+		_remainingThingIds = [NSMutableArray new];
+
+		self.pageSize = DEFAULT_THING_PAGE_SIZE;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_service release];
+	self.requestBatcher = nil;
+	[_filterXml release];
+	[_formatXml release];
+	[_remainingThingIds release];
+	[_pageRequest release];
+	[_prefetchedPage release];
+
+	[super dealloc];
+}
+
+- (NSUInteger)remainingThingCount {
+
+	NSUInteger prefetchedCount = [[_prefetchedPage.infoElement selectSingleNode: @"group"] selectNodes: @"thing"].count;
+
+	return _remainingThingIds.count + prefetchedCount;
+}
+
+- (BOOL)hasMorePages {
+
+	if (_prefetchedPage) {
+		return YES;
+	}
+
+	return !_isFinished && (!_isStarted || _pageRequest || _remainingThingIds.count > 0);
+}
+
+- (void)start {
+
+	if (_isStarted) {
+		return;
+	}
+
+	_isStarted = YES;
+	_isPageWanted = YES;
+
+	// Things beyond the first page come back as keys only.
+	[self sendPageRequest: [NSString stringWithFormat: @"%@%@", _filterXml ? _filterXml : @"", _formatXml]
+				  maxFull: self.pageSize];
+}
+
+- (void)loadNextPage {
+
+	if (!_isStarted) {
+
+		[self start];
+		return;
+	}
+
+	if (_isPageWanted) {
+		return;
+	}
+
+	if (_prefetchedPage) {
+
+		HealthVaultResponse *page = [_prefetchedPage autorelease];
+		_prefetchedPage = nil;
+
+		[self deliverPage: page];
+		return;
+	}
+
+	if (!self.hasMorePages) {
+		return;
+	}
+
+	_isPageWanted = YES;
+	[self requestNextChunk];
+}
+
+- (void)cancel {
+
+	_isFinished = YES;
+	_isPageWanted = NO;
+	_target = nil;
+
+	[_remainingThingIds removeAllObjects];
+	[_prefetchedPage release];
+	_prefetchedPage = nil;
+}
+
+- (void)requestNextChunk {
+
+	if (_pageRequest || _isFinished || _remainingThingIds.count == 0) {
+		return;
+	}
+
+	NSRange chunk = NSMakeRange(0, MIN(self.pageSize, _remainingThingIds.count));
+	NSMutableString *groupXml = [NSMutableString string];
+
+	for (NSString *thingId in [_remainingThingIds subarrayWithRange: chunk]) {
+		[groupXml appendFormat: @"<id>%@</id>", thingId];
+	}
+
+	[_remainingThingIds removeObjectsInRange: chunk];
+	[groupXml appendString: _formatXml];
+
+	[self sendPageRequest: groupXml maxFull: 0];
+}
+
+- (void)sendPageRequest: (NSString *)groupXml maxFull: (NSUInteger)maxFull {
+
+	NSString *info = maxFull > 0
+			? [NSString stringWithFormat: @"<info><group max-full=\"%u\">%@</group></info>", maxFull, groupXml]
+			: [NSString stringWithFormat: @"<info><group>%@</group></info>", groupXml];
+
+	_pageRequest = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+													methodVersion: 3
+													  infoSection: info
+														   target: self
+														 callBack: @selector(pageCompleted:)];
+
+	if (self.requestBatcher) {
+		[self.requestBatcher sendRequest: _pageRequest];
+	}
+	else {
+		[_service sendRequest: _pageRequest];
+	}
+}
+
+- (void)pageCompleted: (HealthVaultResponse *)response {
+
+	[_pageRequest release];
+	_pageRequest = nil;
+
+	if (_isFinished) {
+		return;
+	}
+
+	if (response.hasError) {
+
+		// The error is delivered as the last page.
+		_isFinished = YES;
+		[_remainingThingIds removeAllObjects];
+	}
+	else {
+
+		// The first page lists keys of the things which didn't fit into it.
+		for (XmlElement *keyNode in [[response.infoElement selectSingleNode: @"group"] selectNodes: @"unprocessed-thing-key-info"]) {
+
+			NSString *thingId = [keyNode selectSingleNode: @"thing-id"].text;
+
+			if (thingId) {
+				[_remainingThingIds addObject: thingId];
+			}
+		}
+	}
+
+	if (_isPageWanted) {
+
+		[self deliverPage: response];
+	}
+	else {
+
+		_prefetchedPage = [response retain];
+	}
+}
+
+- (void)deliverPage: (HealthVaultResponse *)response {
+
+	_isPageWanted = NO;
+
+	_loadedPageCount++;
+	_loadedThingCount += [[response.infoElement selectSingleNode: @"group"] selectNodes: @"thing"].count;
+
+	// The next page is loaded while the caller consumes this one.
+	if (self.prefetchesNextPage) {
+		[self requestNextChunk];
+	}
+
+	if (_target && [_target respondsToSelector: _callBack]) {
+
+		[_target performSelector: _callBack
+					  withObject: response];
+	}
+}
+
+@end
@@ -0,0 +1,106 @@
+//
+//  HealthVaultThingSync.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+#import "HealthVaultRequest.h"
+#import "HealthVaultResponse.h"
+#import "HealthVaultThingCache.h"
+
+@class HealthVaultService;
+
+/// Brings HealthVaultThingCache up to date with the things matching a GetThings filter.
+/// The first request asks only for keys of the things: the core section without data-xml,
+/// and HealthVault returns keys of things beyond its limit as <unprocessed-thing-key-info>.
+/// Things which are new or whose version stamp differs from the cached one are then
+/// requested by id in chunks of pageSize, things which are gone are dropped,
+/// and the cache is written in the order of the results.
+/// Cached things can be shown while the sync is running; the callBack is invoked
+/// with the sync once the cache has been written or an error has occurred.
+@interface HealthVaultThingSync : NSObject {
+
+	HealthVaultService *_service;
+	HealthVaultThingCache *_cache;
+	NSString *_filterXml;
+	NSString *_formatXml;
+	NSUInteger _pageSize;
+
+	NSObject *_target;
+	SEL _callBack;
+
+	/// Keys of things matching the filter, in the order of the results.
+	NSMutableArray *_thingIds;
+	NSMutableArray *_versionStamps;
+
+	/// Positions of things in _thingIds by thing id.
+	NSMutableDictionary *_thingPositions;
+
+	/// Version stamps of cached things by thing id, read when the keys arrive.
+	NSDictionary *_cachedVersionStamps;
+
+	/// Xml of new and changed things by thing id.
+	NSMutableDictionary *_things;
+
+	NSUInteger _runningRequestCount;
+	NSUInteger _changedThingCount;
+	NSUInteger _removedThingCount;
+	NSString *_errorText;
+	BOOL _isStarted;
+	BOOL _isFinished;
+}
+
+/// Gets the cache which is synchronized.
+@property (readonly) HealthVaultThingCache *cache;
+
+/// Gets or sets count of things requested by id in one request.
+/// The default is DEFAULT_THING_PAGE_SIZE.
+@property (assign) NSUInteger pageSize;
+
+/// Gets count of things which have been downloaded because they are new or changed.
+@property (readonly) NSUInteger changedThingCount;
+
+/// Gets count of cached things which have been dropped because they are gone.
+@property (readonly) NSUInteger removedThingCount;
+
+/// Gets text of the error, nil if the sync has succeeded.
+@property (readonly) NSString *errorText;
+
+/// Indicates whether the sync has failed; the cache keeps its previous content then.
+@property (readonly, getter=getHasError) BOOL hasError;
+
+/// Initializes a new instance of the HealthVaultThingSync class.
+/// @param service - the service requests are sent through.
+/// @param cache - the cache to bring up to date.
+/// @param filterXml - <filter> elements of the group.
+/// @param formatXml - <format> element used to download things, it should contain the core section.
+/// @param target - callback method owner, it isn't retained; call cancel before it is released.
+/// @param callBack - method invoked with the sync when it is completed.
+- (id)initWithService: (HealthVaultService *)service
+				cache: (HealthVaultThingCache *)cache
+			filterXml: (NSString *)filterXml
+			formatXml: (NSString *)formatXml
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack;
+
+/// Requests keys of the things.
+- (void)start;
+
+/// Stops the sync, the cache isn't changed and the callBack isn't invoked.
+- (void)cancel;
+
+@end
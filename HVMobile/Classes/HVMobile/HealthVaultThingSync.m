@@ -0,0 +1,320 @@
+//
+//  HealthVaultThingSync.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingSync.h"
+#import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+
+/// Asks for keys of things only.
+#define THING_KEYS_FORMAT_XML @"<format><section>core</section></format>"
+
+
+@interface HealthVaultThingSync (Private)
+
+/// Sends GetThings request.
+/// @param groupXml - content of the <group> element.
+/// @param callBack - method invoked with the response.
+- (void)sendRequest: (NSString *)groupXml callBack: (SEL)callBack;
+
+/// Requests things by id in chunks of pageSize.
+/// @param thingIds - ids of the things.
+- (void)requestThings: (NSArray *)thingIds;
+
+/// Handles response with keys of things.
+/// @param response - the response.
+- (void)keysCompleted: (HealthVaultResponse *)response;
+
+/// Handles response with things requested by id.
+/// @param response - the response.
+- (void)thingsCompleted: (HealthVaultResponse *)response;
+
+/// Writes the cache if there is no error and invokes the callBack.
+- (void)finish;
+
+/// Stops the sync with error.
+/// @param errorText - the text of the error.
+- (void)failWithError: (NSString *)errorText;
+
+@end
+
+
+@implementation HealthVaultThingSync
+
+@synthesize cache = _cache;
+@synthesize pageSize = _pageSize;
+@synthesize changedThingCount = _changedThingCount;
+@synthesize removedThingCount = _removedThingCount;
+@synthesize errorText = _errorText;
+
+- (id)initWithService: (HealthVaultService *)service
+				cache: (HealthVaultThingCache *)cache
+			filterXml: (NSString *)filterXml
+			formatXml: (NSString *)formatXml
+			   target: (NSObject *)target
+			 callBack: (SEL)callBack {
+
+	if ((self = [super init])) {
+
+		_service = [service retain];
+		_cache = [cache retain];
+		_filterXml = [filterXml copy];
+		_formatXml = [formatXml copy];
+		_target = target;
+		_callBack = callBack;
+
+		_thingIds = [NSMutableArray new];
+		_versionStamps = [NSMutableArray new];
+		_thingPositions = [NSMutableDictionary new];
+		_things = [NSMutableDictionary new];
+
+		self.pageSize = DEFAULT_THING_PAGE_SIZE;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_service release];
+	[_cache release];
+	[_filterXml release];
+	[_formatXml release];
+	[_thingIds release];
+	[_versionStamps release];
+	[_thingPositions release];
+	[_cachedVersionStamps release];
+	[_things release];
+	[_errorText release];
+
+	[super dealloc];
+}
+
+- (BOOL)getHasError {
+
+	return _errorText != nil;
+}
+
+- (void)start {
+
+	if (_isStarted) {
+		return;
+	}
+
+	_isStarted = YES;
+
+	[self sendRequest: [NSString stringWithFormat: @"%@%@", _filterXml ? _filterXml : @"", THING_KEYS_FORMAT_XML]
+			 callBack: @selector(keysCompleted:)];
+}
+
+- (void)cancel {
+
+	_isFinished = YES;
+	_target = nil;
+}
+
+- (void)sendRequest: (NSString *)groupXml callBack: (SEL)callBack {
+
+	NSString *info = [NSString stringWithFormat: @"<info><group>%@</group></info>", groupXml];
+
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																   methodVersion: 3
+																	 infoSection: info
+																		  target: self
+																		callBack: callBack];
+	_runningRequestCount++;
+
+	[_service sendRequest: request];
+	[request release];
+}
+
+- (void)requestThings: (NSArray *)thingIds {
+
+	NSUInteger pageSize = MAX(self.pageSize, 1);
+
+	for (NSUInteger start = 0; start < thingIds.count; start += pageSize) {
+
+		NSMutableString *groupXml = [NSMutableString string];
+
+		for (NSUInteger i = start; i < MIN(start + pageSize, thingIds.count); i++) {
+			[groupXml appendFormat: @"<id>%@</id>", [thingIds objectAtIndex: i]];
+		}
+
+		[groupXml appendString: _formatXml];
+
+		[self sendRequest: groupXml callBack: @selector(thingsCompleted:)];
+	}
+}
+
+- (void)keysCompleted: (HealthVaultResponse *)response {
+
+	_runningRequestCount--;
+
+	if (_isFinished) {
+		return;
+	}
+
+	if (response.hasError) {
+
+		[self failWithError: response.errorText];
+		return;
+	}
+
+	_cachedVersionStamps = [[_cache versionStamps] retain];
+	NSMutableArray *changedThingIds = [NSMutableArray array];
+
+	// Full things come first, keys of the rest follow, both in the order of the results.
+	XmlElement *group = [response.infoElement selectSingleNode: @"group"];
+	NSMutableArray *keyNodes = [NSMutableArray arrayWithArray: [group selectNodes: @"thing"]];
+	[keyNodes addObjectsFromArray: [group selectNodes: @"unprocessed-thing-key-info"]];
+
+	for (XmlElement *keyNode in keyNodes) {
+
+		XmlElement *thingIdNode = [keyNode selectSingleNode: @"thing-id"];
+		NSString *thingId = thingIdNode.text;
+		NSString *versionStamp = [thingIdNode attrValue: @"version-stamp"];
+
+		if (!thingId || !versionStamp) {
+			continue;
+		}
+
+		[_thingPositions setObject: [NSNumber numberWithUnsignedInteger: _thingIds.count] forKey: thingId];
+		[_thingIds addObject: thingId];
+		[_versionStamps addObject: versionStamp];
+
+		if (![[_cachedVersionStamps objectForKey: thingId] isEqualToString: versionStamp]) {
+			[changedThingIds addObject: thingId];
+		}
+	}
+
+	for (NSString *cachedThingId in _cachedVersionStamps) {
+
+		if (![_thingPositions objectForKey: cachedThingId]) {
+			_removedThingCount++;
+		}
+	}
+
+	[self requestThings: changedThingIds];
+
+	if (_runningRequestCount == 0) {
+		[self finish];
+	}
+}
+
+- (void)thingsCompleted: (HealthVaultResponse *)response {
+
+	_runningRequestCount--;
+
+	if (_isFinished) {
+		return;
+	}
+
+	if (response.hasError) {
+
+		[self failWithError: response.errorText];
+		return;
+	}
+
+	XmlElement *group = [response.infoElement selectSingleNode: @"group"];
+
+	for (XmlElement *thingNode in [group selectNodes: @"thing"]) {
+
+		XmlElement *thingIdNode = [thingNode selectSingleNode: @"thing-id"];
+		NSString *thingId = thingIdNode.text;
+
+		if (!thingId) {
+			continue;
+		}
+
+		// The thing may have changed again since its key was listed.
+		NSNumber *position = [_thingPositions objectForKey: thingId];
+		NSString *versionStamp = [thingIdNode attrValue: @"version-stamp"];
+
+		if (position && versionStamp) {
+			[_versionStamps replaceObjectAtIndex: [position unsignedIntegerValue] withObject: versionStamp];
+		}
+
+		// The thing is kept as it has been received, so its elements stay in schema order.
+		[_things setObject: [thingNode xml] forKey: thingId];
+		_changedThingCount++;
+	}
+
+	// Things over the limit of the response come back as keys again.
+	NSMutableArray *unprocessedThingIds = [NSMutableArray array];
+
+	for (XmlElement *keyNode in [group selectNodes: @"unprocessed-thing-key-info"]) {
+
+		NSString *thingId = [keyNode selectSingleNode: @"thing-id"].text;
+
+		if (thingId) {
+			[unprocessedThingIds addObject: thingId];
+		}
+	}
+
+	[self requestThings: unprocessedThingIds];
+
+	if (_runningRequestCount == 0) {
+		[self finish];
+	}
+}
+
+- (void)finish {
+
+	// Things which have been removed after their keys were listed aren't returned.
+	for (NSUInteger i = _thingIds.count; i > 0; i--) {
+
+		NSString *thingId = [_thingIds objectAtIndex: i - 1];
+		NSString *cachedVersionStamp = [_cachedVersionStamps objectForKey: thingId];
+
+		if (![_things objectForKey: thingId] && ![cachedVersionStamp isEqualToString: [_versionStamps objectAtIndex: i - 1]]) {
+
+			[_thingIds removeObjectAtIndex: i - 1];
+			[_versionStamps removeObjectAtIndex: i - 1];
+		}
+	}
+
+	if (![_cache writeThingIds: _thingIds versionStamps: _versionStamps things: _things]) {
+
+		[self failWithError: NSLocalizedString(@"Thing cache write error key",
+											   @"Message to display when things can't be cached")];
+		return;
+	}
+
+	_isFinished = YES;
+
+	if (_target && [_target respondsToSelector: _callBack]) {
+
+		[_target performSelector: _callBack
+					  withObject: self];
+	}
+}
+
+- (void)failWithError: (NSString *)errorText {
+
+	_isFinished = YES;
+
+	[_errorText release];
+	_errorText = [errorText copy];
+
+	if (_target && [_target respondsToSelector: _callBack]) {
+
+		[_target performSelector: _callBack
+					  withObject: self];
+	}
+}
+
+@end
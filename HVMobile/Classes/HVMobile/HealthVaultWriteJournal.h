@@ -0,0 +1,115 @@
+//
+//  HealthVaultWriteJournal.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class HealthVaultRequest;
+
+
+/// Durable log of write requests which haven't been delivered to HealthVault yet.
+/// Every request is appended to one file with its method, version, record, person and info section;
+/// the header (token, msg-time, hashes) isn't kept, it is written anew when the request is replayed.
+/// Appends are written at once, but the file is synchronized syncInterval seconds later,
+/// so requests appended meanwhile share one fsync.
+/// Delivered requests are logged as removals; the file is truncated when nothing is left
+/// and rewritten without removed requests when it is opened.
+/// Consecutive waiting PutThings or RemoveThings requests of the same record are coalesced on replay.
+@interface HealthVaultWriteJournal : NSObject {
+
+	NSString *_path;
+	NSFileHandle *_file;
+
+	/// Requests in the order they have been appended.
+	NSMutableArray *_entries;
+	/// The same requests by sequence number.
+	NSMutableDictionary *_entriesBySequence;
+	uint32_t _nextSequence;
+
+	NSMutableSet *_journaledMethods;
+	NSTimeInterval _syncInterval;
+	NSUInteger _maxCoalescedLength;
+
+	BOOL _isSyncScheduled;
+	BOOL _hasUnsyncedWrites;
+	NSUInteger _syncCount;
+}
+
+/// Gets path of the journal file.
+@property (readonly) NSString *path;
+
+/// Gets names of methods which are journaled, PutThings and RemoveThings by default.
+@property (readonly) NSMutableSet *journaledMethods;
+
+/// Gets or sets delay of fsync after an append, in seconds.
+/// The default is DEFAULT_JOURNAL_SYNC_INTERVAL; zero synchronizes every append.
+@property (assign) NSTimeInterval syncInterval;
+
+/// Gets or sets the maximum length of the info section of coalesced requests, in characters.
+/// The default is DEFAULT_JOURNAL_COALESCED_LENGTH.
+@property (assign) NSUInteger maxCoalescedLength;
+
+/// Gets count of fsync calls.
+@property (readonly) NSUInteger syncCount;
+
+/// Gets count of requests which haven't been delivered.
+@property (readonly) NSUInteger pendingCount;
+
+/// Gets count of requests which haven't been delivered and aren't being sent.
+@property (readonly) NSUInteger waitingCount;
+
+/// Initializes a new instance of the HealthVaultWriteJournal class.
+/// Requests left in the file by the previous launch are loaded as waiting.
+/// @param path - path of the journal file, it is created if it doesn't exist.
+- (id)initWithPath: (NSString *)path;
+
+/// Gets default path of the journal file in the library directory.
++ (NSString *)defaultPath;
+
+/// Checks whether a request is journaled.
+/// @param request - the request to check.
+/// @returns YES if the method of the request is one of journaledMethods.
+- (BOOL)isJournaledRequest: (HealthVaultRequest *)request;
+
+/// Appends request to the journal.
+/// @param request - the request, its record and person ids should be set.
+/// @param isSending - YES if the request is sent at once, NO if it waits for replay.
+/// @returns sequence number of the request, or 0 if the journal couldn't be written.
+- (uint32_t)appendRequest: (HealthVaultRequest *)request isSending: (BOOL)isSending;
+
+/// Removes requests which have been delivered or rejected by HealthVault.
+/// @param sequences - NSNumber sequence numbers of the requests.
+- (void)removeSequences: (NSArray *)sequences;
+
+/// Returns requests which haven't reached HealthVault to waiting ones.
+/// @param sequences - NSNumber sequence numbers of the requests.
+- (void)resetSequences: (NSArray *)sequences;
+
+/// Creates request for the first waiting requests and marks them as being sent.
+/// Requests of a record are sent in order of methods: a waiting request isn't returned
+/// while an earlier request of its record with another method is being sent.
+/// @param sequences - receives NSNumber sequence numbers of the coalesced requests.
+/// @returns new request without target, or nil if nothing can be sent now.
+- (HealthVaultRequest *)nextReplayRequest: (NSArray **)sequences;
+
+/// Synchronizes appended data with the disk at once.
+- (void)synchronize;
+
+/// Removes all requests.
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,644 @@
+//
+//  HealthVaultWriteJournal.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultWriteJournal.h"
+#import "HealthVaultRequest.h"
+#import "HealthVaultConfig.h"
+
+/// Identifies journal files.
+#define WRITE_JOURNAL_MAGIC "HVWJ"
+
+/// Version of the file format, files of other versions are discarded.
+#define WRITE_JOURNAL_VERSION 1
+
+/// Name of the journal file in the library directory.
+#define WRITE_JOURNAL_FILE @"HealthVaultWriteJournal.log"
+
+/// Record types.
+#define WRITE_JOURNAL_APPEND 1
+#define WRITE_JOURNAL_REMOVE 2
+
+/// Opening and closing tags of info sections which can be coalesced.
+#define INFO_START @"<info>"
+#define INFO_END @"</info>"
+
+
+/// Header of the journal file.
+typedef struct {
+
+	char magic[4];
+	uint32_t version;
+} WriteJournalHeader;
+
+/// Header of one record, the payload follows.
+/// Payload of an append is made of method name, version, record id, person id and info section,
+/// UTF-8 encoded and separated by zero bytes; a removal has no payload.
+typedef struct {
+
+	uint32_t length;
+	uint32_t type;
+	uint32_t sequence;
+	uint32_t checksum;
+} WriteJournalRecordHeader;
+
+
+/// Journaled request.
+@interface HealthVaultJournalEntry : NSObject {
+
+	uint32_t _sequence;
+	NSString *_methodName;
+	float _methodVersion;
+	NSString *_recordId;
+	NSString *_personId;
+	NSString *_infoXml;
+	BOOL _isSending;
+}
+
+@property (assign) uint32_t sequence;
+@property (retain) NSString *methodName;
+@property (assign) float methodVersion;
+
+/// Gets or sets record id, empty if the request isn't sent to a record.
+@property (retain) NSString *recordId;
+
+/// Gets or sets person id, empty if there is none.
+@property (retain) NSString *personId;
+
+@property (retain) NSString *infoXml;
+
+/// Gets or sets whether the request is being sent.
+@property (assign) BOOL isSending;
+
+@end
+
+@implementation HealthVaultJournalEntry
+
+@synthesize sequence = _sequence;
+@synthesize methodName = _methodName;
+@synthesize methodVersion = _methodVersion;
+@synthesize recordId = _recordId;
+@synthesize personId = _personId;
+@synthesize infoXml = _infoXml;
+@synthesize isSending = _isSending;
+
+- (void)dealloc {
+
+	self.methodName = nil;
+	self.recordId = nil;
+	self.personId = nil;
+	self.infoXml = nil;
+
+	[super dealloc];
+}
+
+@end
+
+
+@interface HealthVaultWriteJournal (Private)
+
+/// Reads the journal file and rewrites it if it has removed requests or a torn end.
+- (void)load;
+
+/// Writes records at the end of the file and schedules synchronization.
+/// @param data - the records.
+/// @returns NO if the file couldn't be written.
+- (BOOL)writeRecords: (NSData *)data;
+
+/// Writes the file header followed by records of the given requests, replacing the file.
+/// @param entries - the requests.
+- (void)rewriteWithEntries: (NSArray *)entries;
+
+/// Opens the file for appending.
+- (void)openFile;
+
+/// Creates append record of the request.
+/// @param entry - the request.
+/// @returns the record.
++ (NSData *)appendRecord: (HealthVaultJournalEntry *)entry;
+
+/// Reads request from payload of an append record.
+/// @param bytes - the payload.
+/// @param length - length of the payload.
+/// @returns the request without sequence number, or nil if the payload isn't valid.
++ (HealthVaultJournalEntry *)entryWithPayload: (const char *)bytes length: (NSUInteger)length;
+
+@end
+
+
+#pragma mark Helpers
+
+/// Computes FNV-1a hash of a record.
+/// @param header - the record header, its checksum field isn't hashed.
+/// @param payload - the record payload.
+static uint32_t RecordChecksum(const WriteJournalRecordHeader *header, const void *payload) {
+
+	uint32_t hash = 2166136261u;
+	uint32_t fields[3] = { header->length, header->type, header->sequence };
+	const uint8_t *bytes = (const uint8_t *)fields;
+
+	for (NSUInteger i = 0; i < sizeof(fields); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	bytes = (const uint8_t *)payload;
+
+	for (NSUInteger i = 0; i < header->length; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/// Appends a record to the data.
+static void AppendRecord(NSMutableData *data, uint32_t type, uint32_t sequence, NSData *payload) {
+
+	WriteJournalRecordHeader header;
+	header.length = (uint32_t)payload.length;
+	header.type = type;
+	header.sequence = sequence;
+	header.checksum = RecordChecksum(&header, payload.bytes);
+
+	[data appendBytes: &header length: sizeof(header)];
+	[data appendData: payload];
+}
+
+/// Checks whether the info sections of two requests can be merged.
+static BOOL CanCoalesce(HealthVaultJournalEntry *entry, HealthVaultJournalEntry *nextEntry) {
+
+	if (![nextEntry.methodName isEqualToString: entry.methodName]
+		|| nextEntry.methodVersion != entry.methodVersion
+		|| ![nextEntry.recordId isEqualToString: entry.recordId]
+		|| ![nextEntry.personId isEqualToString: entry.personId]) {
+
+		return NO;
+	}
+
+	if (![entry.methodName isEqualToString: @"PutThings"] && ![entry.methodName isEqualToString: @"RemoveThings"]) {
+		return NO;
+	}
+
+	return [nextEntry.infoXml hasPrefix: INFO_START] && [nextEntry.infoXml hasSuffix: INFO_END]
+		&& [entry.infoXml hasPrefix: INFO_START] && [entry.infoXml hasSuffix: INFO_END];
+}
+
+#pragma mark Helpers End
+
+
+@implementation HealthVaultWriteJournal
+
+@synthesize path = _path;
+@synthesize journaledMethods = _journaledMethods;
+@synthesize syncInterval = _syncInterval;
+@synthesize maxCoalescedLength = _maxCoalescedLength;
+@synthesize syncCount = _syncCount;
+
+- (id)initWithPath: (NSString *)path {
+
+	if ((self = [super init])) {
+
+		_path = [path copy];
+		_entries = [NSMutableArray new];
+		_entriesBySequence = [NSMutableDictionary new];
+		_journaledMethods = [[NSMutableSet alloc] initWithObjects: @"PutThings", @"RemoveThings", nil];
+		_nextSequence = 1;
+
+		self.syncInterval = DEFAULT_JOURNAL_SYNC_INTERVAL;
+		self.maxCoalescedLength = DEFAULT_JOURNAL_COALESCED_LENGTH;
+
+		[[NSFileManager defaultManager] createDirectoryAtPath: [_path stringByDeletingLastPathComponent]
+								  withIntermediateDirectories: YES
+												   attributes: nil
+														error: NULL];
+		[self load];
+		[self openFile];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[self synchronize];
+	[_file closeFile];
+
+	[_file release];
+	[_path release];
+	[_entries release];
+	[_entriesBySequence release];
+	[_journaledMethods release];
+
+	[super dealloc];
+}
+
++ (NSString *)defaultPath {
+
+	// Caches may be purged by the system, so the journal is kept in the library.
+	NSArray *directories = NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES);
+
+	return [[directories objectAtIndex: 0] stringByAppendingPathComponent: WRITE_JOURNAL_FILE];
+}
+
+- (NSUInteger)pendingCount {
+
+	return _entries.count;
+}
+
+- (NSUInteger)waitingCount {
+
+	NSUInteger count = 0;
+
+	for (HealthVaultJournalEntry *entry in _entries) {
+
+		if (!entry.isSending) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+- (BOOL)isJournaledRequest: (HealthVaultRequest *)request {
+
+	return [_journaledMethods containsObject: request.methodName];
+}
+
+- (uint32_t)appendRequest: (HealthVaultRequest *)request isSending: (BOOL)isSending {
+
+	HealthVaultJournalEntry *entry = [[HealthVaultJournalEntry new] autorelease];
+	entry.sequence = _nextSequence;
+	entry.methodName = request.methodName;
+	entry.methodVersion = request.methodVersion;
+	entry.recordId = request.recordId ? request.recordId : @"";
+	entry.personId = request.personId ? request.personId : @"";
+	entry.infoXml = request.infoXml ? request.infoXml : @"";
+	entry.isSending = isSending;
+
+	if (![self writeRecords: [HealthVaultWriteJournal appendRecord: entry]]) {
+		return 0;
+	}
+
+	_nextSequence++;
+
+	[_entries addObject: entry];
+	[_entriesBySequence setObject: entry forKey: [NSNumber numberWithUnsignedInt: entry.sequence]];
+
+	return entry.sequence;
+}
+
+- (void)removeSequences: (NSArray *)sequences {
+
+	NSMutableData *records = [NSMutableData data];
+
+	for (NSNumber *sequence in sequences) {
+
+		HealthVaultJournalEntry *entry = [_entriesBySequence objectForKey: sequence];
+
+		if (entry) {
+
+			AppendRecord(records, WRITE_JOURNAL_REMOVE, entry.sequence, nil);
+
+			[_entries removeObjectIdenticalTo: entry];
+			[_entriesBySequence removeObjectForKey: sequence];
+		}
+	}
+
+	if (records.length == 0) {
+		return;
+	}
+
+	// Nothing is pending, so the log starts over.
+	if (_entries.count == 0) {
+
+		[_file truncateFileAtOffset: sizeof(WriteJournalHeader)];
+		_hasUnsyncedWrites = YES;
+		[self synchronize];
+		return;
+	}
+
+	[self writeRecords: records];
+}
+
+- (void)resetSequences: (NSArray *)sequences {
+
+	for (NSNumber *sequence in sequences) {
+
+		HealthVaultJournalEntry *entry = [_entriesBySequence objectForKey: sequence];
+		entry.isSending = NO;
+	}
+}
+
+- (HealthVaultRequest *)nextReplayRequest: (NSArray **)sequences {
+
+	NSUInteger firstIndex = NSNotFound;
+
+	for (NSUInteger i = 0; i < _entries.count; i++) {
+
+		if (![[_entries objectAtIndex: i] isSending]) {
+
+			firstIndex = i;
+			break;
+		}
+	}
+
+	if (firstIndex == NSNotFound) {
+		return nil;
+	}
+
+	HealthVaultJournalEntry *firstEntry = [_entries objectAtIndex: firstIndex];
+
+	// A removal mustn't overtake puts of the same record which are in flight, nor the other way round.
+	for (NSUInteger i = 0; i < firstIndex; i++) {
+
+		HealthVaultJournalEntry *entry = [_entries objectAtIndex: i];
+
+		if (entry.isSending && [entry.recordId isEqualToString: firstEntry.recordId]
+			&& ![entry.methodName isEqualToString: firstEntry.methodName]) {
+
+			return nil;
+		}
+	}
+
+	NSMutableArray *entries = [NSMutableArray arrayWithObject: firstEntry];
+	NSUInteger length = firstEntry.infoXml.length;
+
+	for (NSUInteger i = firstIndex + 1; i < _entries.count; i++) {
+
+		HealthVaultJournalEntry *entry = [_entries objectAtIndex: i];
+		NSUInteger contentLength = entry.infoXml.length - INFO_START.length - INFO_END.length;
+
+		if (entry.isSending || !CanCoalesce(firstEntry, entry) || length + contentLength > self.maxCoalescedLength) {
+			break;
+		}
+
+		[entries addObject: entry];
+		length += contentLength;
+	}
+
+	NSString *info = firstEntry.infoXml;
+
+	if (entries.count > 1) {
+
+		NSMutableString *mergedInfo = [NSMutableString stringWithCapacity: length];
+		[mergedInfo appendString: INFO_START];
+
+		for (HealthVaultJournalEntry *entry in entries) {
+
+			NSString *section = entry.infoXml;
+			[mergedInfo appendString: [section substringWithRange: NSMakeRange(INFO_START.length, section.length - INFO_START.length - INFO_END.length)]];
+		}
+
+		[mergedInfo appendString: INFO_END];
+		info = mergedInfo;
+	}
+
+	NSMutableArray *entrySequences = [NSMutableArray arrayWithCapacity: entries.count];
+
+	for (HealthVaultJournalEntry *entry in entries) {
+
+		entry.isSending = YES;
+		[entrySequences addObject: [NSNumber numberWithUnsignedInt: entry.sequence]];
+	}
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: firstEntry.methodName
+																	 methodVersion: firstEntry.methodVersion
+																	   infoSection: info
+																			target: nil
+																		  callBack: nil] autorelease];
+	request.recordId = firstEntry.recordId.length > 0 ? firstEntry.recordId : nil;
+	request.personId = firstEntry.personId.length > 0 ? firstEntry.personId : nil;
+
+	if (sequences) {
+		*sequences = entrySequences;
+	}
+
+	return request;
+}
+
+- (void)synchronize {
+
+	if (_isSyncScheduled) {
+
+		[NSObject cancelPreviousPerformRequestsWithTarget: self selector: @selector(synchronize) object: nil];
+		_isSyncScheduled = NO;
+	}
+
+	if (!_hasUnsyncedWrites) {
+		return;
+	}
+
+	@try {
+
+		[_file synchronizeFile];
+		_syncCount++;
+	}
+	@catch (id exc) {
+	}
+
+	_hasUnsyncedWrites = NO;
+}
+
+- (void)removeAllEntries {
+
+	[_entries removeAllObjects];
+	[_entriesBySequence removeAllObjects];
+
+	[_file truncateFileAtOffset: sizeof(WriteJournalHeader)];
+	_hasUnsyncedWrites = YES;
+	[self synchronize];
+}
+
+#pragma mark Private
+
+- (void)load {
+
+	NSData *data = [NSData dataWithContentsOfFile: _path options: NSDataReadingMapped error: NULL];
+	const char *bytes = data.bytes;
+	const WriteJournalHeader *header = (const WriteJournalHeader *)bytes;
+
+	if (data.length < sizeof(WriteJournalHeader) || memcmp(header->magic, WRITE_JOURNAL_MAGIC, 4) != 0
+		|| header->version != WRITE_JOURNAL_VERSION) {
+
+		[self rewriteWithEntries: nil];
+		return;
+	}
+
+	NSUInteger offset = sizeof(WriteJournalHeader);
+	BOOL needsRewrite = NO;
+
+	while (offset + sizeof(WriteJournalRecordHeader) <= data.length) {
+
+		WriteJournalRecordHeader record;
+		memcpy(&record, bytes + offset, sizeof(record));
+
+		const char *payload = bytes + offset + sizeof(record);
+
+		// The app could have been killed in the middle of an append.
+		if (record.length > data.length - offset - sizeof(record) || RecordChecksum(&record, payload) != record.checksum) {
+			break;
+		}
+
+		offset += sizeof(record) + record.length;
+		_nextSequence = MAX(_nextSequence, record.sequence + 1);
+
+		NSNumber *sequence = [NSNumber numberWithUnsignedInt: record.sequence];
+
+		if (record.type == WRITE_JOURNAL_APPEND) {
+
+			HealthVaultJournalEntry *entry = [HealthVaultWriteJournal entryWithPayload: payload length: record.length];
+
+			if (entry) {
+
+				entry.sequence = record.sequence;
+				[_entries addObject: entry];
+				[_entriesBySequence setObject: entry forKey: sequence];
+			}
+		}
+		else {
+
+			[_entries removeObjectIdenticalTo: [_entriesBySequence objectForKey: sequence]];
+			[_entriesBySequence removeObjectForKey: sequence];
+			needsRewrite = YES;
+		}
+	}
+
+	if (needsRewrite || offset != data.length) {
+		[self rewriteWithEntries: _entries];
+	}
+}
+
+- (void)rewriteWithEntries: (NSArray *)entries {
+
+	NSMutableData *data = [NSMutableData data];
+
+	WriteJournalHeader header;
+	memcpy(header.magic, WRITE_JOURNAL_MAGIC, 4);
+	header.version = WRITE_JOURNAL_VERSION;
+	[data appendBytes: &header length: sizeof(header)];
+
+	for (HealthVaultJournalEntry *entry in entries) {
+
+		[data appendData: [HealthVaultWriteJournal appendRecord: entry]];
+	}
+
+	[data writeToFile: _path atomically: YES];
+}
+
+- (void)openFile {
+
+	if (![[NSFileManager defaultManager] fileExistsAtPath: _path]) {
+		[self rewriteWithEntries: nil];
+	}
+
+	_file = [[NSFileHandle fileHandleForUpdatingAtPath: _path] retain];
+	[_file seekToEndOfFile];
+}
+
+- (BOOL)writeRecords: (NSData *)data {
+
+	if (!_file) {
+		return NO;
+	}
+
+	@try {
+
+		[_file seekToEndOfFile];
+		[_file writeData: data];
+	}
+	@catch (id exc) {
+
+		return NO;
+	}
+
+	_hasUnsyncedWrites = YES;
+
+	if (self.syncInterval <= 0) {
+
+		[self synchronize];
+	}
+	else if (!_isSyncScheduled) {
+
+		// Appends made meanwhile are synchronized together.
+		_isSyncScheduled = YES;
+		[self performSelector: @selector(synchronize) withObject: nil afterDelay: self.syncInterval];
+	}
+
+	return YES;
+}
+
++ (NSData *)appendRecord: (HealthVaultJournalEntry *)entry {
+
+	NSString *version = [NSString stringWithFormat: @"%g", entry.methodVersion];
+	NSArray *fields = [NSArray arrayWithObjects: entry.methodName, version, entry.recordId, entry.personId, entry.infoXml, nil];
+
+	NSMutableData *payload = [NSMutableData dataWithCapacity: entry.infoXml.length + 128];
+
+	for (NSUInteger i = 0; i < fields.count; i++) {
+
+		if (i > 0) {
+			[payload appendBytes: "" length: 1];
+		}
+
+		[payload appendData: [[fields objectAtIndex: i] dataUsingEncoding: NSUTF8StringEncoding]];
+	}
+
+	NSMutableData *record = [NSMutableData dataWithCapacity: payload.length + sizeof(WriteJournalRecordHeader)];
+	AppendRecord(record, WRITE_JOURNAL_APPEND, entry.sequence, payload);
+
+	return record;
+}
+
++ (HealthVaultJournalEntry *)entryWithPayload: (const char *)bytes length: (NSUInteger)length {
+
+	NSMutableArray *fields = [NSMutableArray arrayWithCapacity: 5];
+	NSUInteger start = 0;
+
+	for (NSUInteger i = 0; i <= length; i++) {
+
+		if (i == length || bytes[i] == 0) {
+
+			NSString *field = [[NSString alloc] initWithBytes: bytes + start
+													   length: i - start
+													 encoding: NSUTF8StringEncoding];
+			if (!field) {
+				return nil;
+			}
+
+			[fields addObject: field];
+			[field release];
+
+			start = i + 1;
+		}
+	}
+
+	if (fields.count != 5) {
+		return nil;
+	}
+
+	HealthVaultJournalEntry *entry = [[HealthVaultJournalEntry new] autorelease];
+	entry.methodName = [fields objectAtIndex: 0];
+	entry.methodVersion = [[fields objectAtIndex: 1] floatValue];
+	entry.recordId = [fields objectAtIndex: 2];
+	entry.personId = [fields objectAtIndex: 3];
+	entry.infoXml = [fields objectAtIndex: 4];
+
+	return entry;
+}
+
+#pragma mark Private End
+
+@end
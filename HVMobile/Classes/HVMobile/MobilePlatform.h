@@ -17,6 +17,7 @@
 // limitations under the License.
 
 #import <Foundation/Foundation.h>
+#import "Sha256.h"
 
 /// Implements the platform-specific methods used by the HealthVaultService class.
 @interface MobilePlatform : NSObject {
@@ -39,12 +40,37 @@
 /// @returns the wrapped hash.</returns>
 + (NSString *)computeSha256HashAndWrap: (NSString *)data;
 
+/// Computes a SHA 256 hash of a byte range.
+/// @param bytes - the data to hash.
+/// @param length - count of bytes to hash.
+/// @returns the hash as a base64-encoded string.
++ (NSString *)computeSha256HashOfBytes: (const void *)bytes length: (NSUInteger)length;
+
+/// Completes hashing context and encodes the hash.
+/// Use Sha256Init and Sha256Update to feed the data chunk by chunk.
+/// @param context - initialized hashing context.
+/// @returns the hash as a base64-encoded string.
++ (NSString *)finishSha256Hash: (Sha256Context *)context;
+
 /// Computes a SHA 256 HMAC.
 /// @param key - the key to use.</param>
 /// @param data - the input data.</param>
 /// @returns a base-64 encoded HMAC.</returns>
 + (NSString *)computeSha256Hmac:(NSData *)key: (NSString *)data;
 
+/// Computes a SHA 256 HMAC of a byte range.
+/// @param bytes - the input data.
+/// @param length - count of bytes to sign.
+/// @param key - the key to use.
+/// @returns a base-64 encoded HMAC.
++ (NSString *)computeSha256HmacOfBytes: (const void *)bytes length: (NSUInteger)length key: (NSData *)key;
+
+/// Completes HMAC context and encodes the result.
+/// Use HmacSha256Init and HmacSha256Update to feed the data chunk by chunk.
+/// @param context - initialized HMAC context.
+/// @returns a base-64 encoded HMAC.
++ (NSString *)finishSha256Hmac: (HmacSha256Context *)context;
+
 /// Computes a SHA 256 HMAC and wraps the result in XML.
 /// @param key - the key to use.</param>
 /// @param data - the input data.</param>
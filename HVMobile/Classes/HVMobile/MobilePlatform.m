@@ -18,7 +18,6 @@
 
 
 #import "MobilePlatform.h"
-#import <CommonCrypto/CommonHMAC.h>
 #import "Base64.h"
 
 
@@ -37,15 +36,26 @@
 
 + (NSString *)computeSha256Hash: (NSString *)data {
 
-	const char *chars = [data cStringUsingEncoding: NSUTF8StringEncoding];
-	NSData *keyData = [NSData dataWithBytes: chars length: strlen(chars)];
+	NSData *bytes = [data dataUsingEncoding: NSUTF8StringEncoding];
 
-	uint8_t digest[CC_SHA256_DIGEST_LENGTH] = {0};
-	CC_SHA256(keyData.bytes, keyData.length, digest);
+	return [self computeSha256HashOfBytes: bytes.bytes length: bytes.length];
+}
+
++ (NSString *)computeSha256HashOfBytes: (const void *)bytes length: (NSUInteger)length {
 
-	NSString *base64String = [Base64 encodeBase64WithData: [NSData dataWithBytes:digest length:CC_SHA256_DIGEST_LENGTH]];
+	Sha256Context context;
+	Sha256Init(&context);
+	Sha256Update(&context, bytes, length);
 
-	return base64String;
+	return [self finishSha256Hash: &context];
+}
+
++ (NSString *)finishSha256Hash: (Sha256Context *)context {
+
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	Sha256Final(context, digest);
+
+	return [Base64 encodeBase64WithBytes: digest length: SHA256_DIGEST_SIZE options: 0];
 }
 
 + (NSString *)computeSha256HashAndWrap: (NSString *)data {
@@ -57,21 +67,26 @@
 
 + (NSString *)computeSha256Hmac: (NSData *)key: (NSString *)data {
 
-	NSUInteger len = [key length];
-	char *cKey = (char *)[key bytes];
+	NSData *bytes = [data dataUsingEncoding: NSUTF8StringEncoding];
+
+	return [self computeSha256HmacOfBytes: bytes.bytes length: bytes.length key: key];
+}
 
-	const char *cData = [data cStringUsingEncoding: NSUTF8StringEncoding];
++ (NSString *)computeSha256HmacOfBytes: (const void *)bytes length: (NSUInteger)length key: (NSData *)key {
 
-	unsigned char cHMAC[CC_SHA256_DIGEST_LENGTH];
+	HmacSha256Context context;
+	HmacSha256Init(&context, key.bytes, key.length);
+	HmacSha256Update(&context, bytes, length);
 
-	CCHmac(kCCHmacAlgSHA256, cKey, len, cData, strlen(cData), cHMAC);
+	return [self finishSha256Hmac: &context];
+}
 
-	NSData *hmac = [[NSData alloc] initWithBytes: cHMAC length: sizeof(cHMAC)];
++ (NSString *)finishSha256Hmac: (HmacSha256Context *)context {
 
-	NSString *base64String = [Base64 encodeBase64WithData: hmac];
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	HmacSha256Final(context, digest);
 
-	[hmac release];
-	return base64String;
+	return [Base64 encodeBase64WithBytes: digest length: SHA256_DIGEST_SIZE options: 0];
 }
 
 + (NSString *)computeSha256HmacAndWrap: (NSData *)key: (NSString *)data {
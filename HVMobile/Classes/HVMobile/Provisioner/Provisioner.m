@@ -19,7 +19,7 @@
 #import "Provisioner.h"
 #import "HealthVaultService.h"
 #import "AuthenticationCheckState.h"
-#import "XmlTextReader.h"
+#import "XmlElement.h"
 
 
 @interface Provisioner (Private)
@@ -131,7 +131,7 @@
     }
     else {
 
-        [state.service saveCastCallResults: response.infoXml];
+        [state.service saveCastCallResultsFromInfo: response.infoElement];
     }
 
     [Provisioner performAuthenticationCheck: state];
@@ -171,8 +171,7 @@
 
     NSAutoreleasePool *pool = [NSAutoreleasePool new];
 
-    XmlTextReader *xmlReader = [XmlTextReader new];
-    XmlElement *infoNode = [xmlReader read: response.infoXml];
+    XmlElement *infoNode = response.infoElement;
 
     XmlElement *responseResults = [infoNode selectSingleNode: @"response-results"];
     XmlElement *personInfo = [responseResults selectSingleNode: @"person-info"];
@@ -218,7 +217,6 @@
         }
     }
 
-    [xmlReader release];
     [pool release];
 
     if (state.service.records.count > 0) {
@@ -272,14 +270,12 @@
 
     NSAutoreleasePool *pool = [NSAutoreleasePool new];
 
-    XmlTextReader *xmlReader = [XmlTextReader new];
-    XmlElement *infoNode = [xmlReader read: response.infoXml];
+    XmlElement *infoNode = response.infoElement;
 
     state.service.appIdInstance = [infoNode selectSingleNode: @"app-id"].text;
     state.service.sharedSecret = [infoNode selectSingleNode: @"shared-secret"].text;
     state.service.applicationCreationToken = [infoNode selectSingleNode: @"app-token"].text;
 
-    [xmlReader release];
     [pool release];
 
     [state.target performSelector: state.shellAuthRequiredCallBack
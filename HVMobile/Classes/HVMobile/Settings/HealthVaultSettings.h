@@ -25,6 +25,7 @@
 	NSString *_applicationId;
 	NSString *_applicationCreationToken;
 	NSString *_authorizationSessionToken;
+	NSDate *_sessionTokenTime;
 	NSString *_sharedSecret;
 	NSString *_country;
 	NSString *_language;
@@ -49,6 +50,9 @@
 /// Gets or sets the authorization session token.
 @property (retain) NSString *authorizationSessionToken;
 
+/// Gets or sets the time the authorization session token has been received.
+@property (retain) NSDate *sessionTokenTime;
+
 /// Gets or sets the shared secret.
 @property (retain) NSString *sharedSecret;
 
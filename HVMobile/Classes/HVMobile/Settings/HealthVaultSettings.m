@@ -40,6 +40,7 @@
 @synthesize applicationId = _applicationId;
 @synthesize applicationCreationToken = _applicationCreationToken;
 @synthesize authorizationSessionToken = _authorizationSessionToken;
+@synthesize sessionTokenTime = _sessionTokenTime;
 @synthesize sharedSecret = _sharedSecret;
 @synthesize country = _country;
 @synthesize language = _language;
@@ -64,6 +65,7 @@
 	self.applicationId = nil;
 	self.applicationCreationToken = nil;
 	self.authorizationSessionToken = nil;
+	self.sessionTokenTime = nil;
 	self.sharedSecret = nil;
 	self.applicationCreationToken = nil;
 	self.country = nil;
@@ -92,6 +94,9 @@
 	[perfs setObject: self.authorizationSessionToken
 			  forKey: [NSString stringWithFormat: @"%@authorizationSessionToken", prefix]];
 
+	[perfs setObject: self.sessionTokenTime
+			  forKey: [NSString stringWithFormat: @"%@sessionTokenTime", prefix]];
+
 	[perfs setObject: self.sharedSecret
 			  forKey: [NSString stringWithFormat: @"%@sharedSecret", prefix]];
 
@@ -128,6 +133,8 @@
 
 	settings.authorizationSessionToken = [perfs objectForKey: [NSString stringWithFormat: @"%@authorizationSessionToken", prefix]];
 
+	settings.sessionTokenTime = [perfs objectForKey: [NSString stringWithFormat: @"%@sessionTokenTime", prefix]];
+
 	settings.sharedSecret = [perfs objectForKey: [NSString stringWithFormat: @"%@sharedSecret", prefix]];
 
 	settings.country = [perfs objectForKey: [NSString stringWithFormat: @"%@country", prefix]];
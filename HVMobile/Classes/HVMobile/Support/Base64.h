@@ -18,6 +18,30 @@
 
 #import <Foundation/Foundation.h>
 
+/// State of the streaming base64 decoder.
+typedef struct {
+
+	/// Bits of the incomplete group and count of characters in it.
+	uint32_t group;
+	NSUInteger count;
+
+	/// Count of padding characters met, nothing but white space may follow them.
+	NSUInteger padding;
+
+	BOOL isFailed;
+
+} Base64DecoderState;
+
+/// Options of base64 encoding.
+enum {
+
+	/// Uses '-' and '_' instead of '+' and '/', so the text can be put into URLs and file names.
+	Base64EncodingUrlSafe = 1 << 0,
+
+	/// Omits trailing '=' characters.
+	Base64EncodingNoPadding = 1 << 1
+};
+typedef NSUInteger Base64EncodingOptions;
 
 /// Provides Base64 encoding/decoding functionality.
 @interface Base64 : NSObject {
@@ -25,12 +49,78 @@
 
 /// Encodes incoming data to base64 string.
 /// @param dataToEncode - data for encoding.
-/// @returns encoded base64 string.
+/// @returns encoded base64 string or nil if there is no data.
 + (NSString *)encodeBase64WithData:(NSData *)dataToEncode;
 
+/// Encodes incoming data to base64 string.
+/// @param dataToEncode - data for encoding.
+/// @param options - encoding options.
+/// @returns encoded base64 string or nil if there is no data.
++ (NSString *)encodeBase64WithData:(NSData *)dataToEncode options:(Base64EncodingOptions)options;
+
+/// Encodes bytes to base64 string.
+/// @param bytes - bytes for encoding.
+/// @param length - count of bytes.
+/// @param options - encoding options.
+/// @returns encoded base64 string or nil if there are no bytes.
++ (NSString *)encodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length options:(Base64EncodingOptions)options;
+
+/// Encodes bytes into caller-supplied buffer, no terminating zero is written.
+/// @param bytes - bytes for encoding.
+/// @param length - count of bytes.
+/// @param buffer - buffer of at least encodedLengthOfLength:options: characters.
+/// @param options - encoding options.
+/// @returns count of characters written.
++ (NSUInteger)encodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length toBuffer:(char *)buffer options:(Base64EncodingOptions)options;
+
+/// Gets count of characters base64 text takes.
+/// @param length - count of bytes for encoding.
+/// @param options - encoding options.
++ (NSUInteger)encodedLengthOfLength:(NSUInteger)length options:(Base64EncodingOptions)options;
+
 /// Decodes base64 string.
+/// White space is skipped, both standard and URL-safe alphabets are accepted.
 /// @param stringToDecode - string for decoding.
-/// @returns decoded data.
+/// @returns decoded data or nil if the string is not valid base64.
 + (NSData *)decodeBase64WithString:(NSString *)stringToDecode;
 
+/// Decodes base64 text.
+/// @param bytes - ASCII characters for decoding.
+/// @param length - count of characters.
+/// @returns decoded data or nil if the text is not valid base64.
++ (NSData *)decodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length;
+
+@end
+
+
+/// Decodes base64 text delivered in chunks, for example by xml parser.
+/// Chunks may be split at any character, the decoded bytes are appended to one buffer.
+@interface Base64Decoder : NSObject {
+
+	Base64DecoderState _state;
+	NSMutableData *_data;
+}
+
+/// Gets the data decoded so far.
+@property (readonly) NSMutableData *data;
+
+/// Initializes decoder.
+/// @param capacity - expected count of decoded bytes.
+- (id)initWithCapacity: (NSUInteger)capacity;
+
+/// Decodes chunk of base64 text.
+/// @param bytes - ASCII characters for decoding.
+/// @param length - count of characters.
+/// @returns NO if the text is not valid base64.
+- (BOOL)decodeBytes: (const void *)bytes length: (NSUInteger)length;
+
+/// Decodes chunk of base64 text.
+/// @param string - string for decoding.
+/// @returns NO if the text is not valid base64.
+- (BOOL)decodeString: (NSString *)string;
+
+/// Decodes the rest of the last group.
+/// @returns decoded data or nil if the text is not valid base64.
+- (NSData *)finish;
+
 @end
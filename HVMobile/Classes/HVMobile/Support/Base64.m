@@ -18,96 +18,391 @@
 
 #import "Base64.h"
 
-@implementation Base64
+/// Decoding table value of white space characters.
+#define BASE64_SPACE 0xFE
+
+/// Decoding table value of padding character.
+#define BASE64_PADDING 0xFD
+
+/// Decoding table value of characters which are not allowed.
+#define BASE64_INVALID 0xFF
+
+/// Size of the buffer strings are converted through while they are decoded.
+#define BASE64_STRING_CHUNK_SIZE 1024
+
+/// Maps characters to 6-bit values; special values have two high bits set,
+/// so a group of four alphabet characters is detected by a single test.
+/// Both standard and URL-safe alphabets are accepted.
+static const uint8_t _decodingTable[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE, 0xFE, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFD, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
 
-// Encoding charset
+/// Maps 6-bit values to characters of standard alphabet.
 static const char _encodingTable[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+/// Maps 6-bit values to characters of URL-safe alphabet.
+static const char _urlSafeEncodingTable[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+#pragma mark Helpers
+
+/// Encodes bytes to base64 text.
+/// @param out - buffer of at least encodedLengthOfLength:options: characters.
+/// @returns count of characters written to out.
+static NSUInteger Base64Encode(const uint8_t *p, NSUInteger length, char *out, Base64EncodingOptions options) {
+
+	const char *table = (options & Base64EncodingUrlSafe) ? _urlSafeEncodingTable : _encodingTable;
+	const uint8_t *end = p + length / 3 * 3;
+	char *o = out;
+
+	// four groups per iteration, each group of three bytes becomes four characters
+	while (end - p >= 12) {
+
+		for (int i = 0; i < 4; i++) {
+
+			uint32_t group = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+			o[0] = table[group >> 18];
+			o[1] = table[(group >> 12) & 0x3F];
+			o[2] = table[(group >> 6) & 0x3F];
+			o[3] = table[group & 0x3F];
+
+			p += 3;
+			o += 4;
+		}
+	}
+
+	while (p < end) {
+
+		uint32_t group = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+		o[0] = table[group >> 18];
+		o[1] = table[(group >> 12) & 0x3F];
+		o[2] = table[(group >> 6) & 0x3F];
+		o[3] = table[group & 0x3F];
+
+		p += 3;
+		o += 4;
+	}
+
+	BOOL isPadded = !(options & Base64EncodingNoPadding);
+
+	switch (length % 3) {
+
+		case 1:
+			o[0] = table[p[0] >> 2];
+			o[1] = table[(p[0] << 4) & 0x30];
+			o += 2;
+
+			if (isPadded) {
+				o[0] = '=';
+				o[1] = '=';
+				o += 2;
+			}
+			break;
+
+		case 2:
+			o[0] = table[p[0] >> 2];
+			o[1] = table[((p[0] << 4) & 0x30) | (p[1] >> 4)];
+			o[2] = table[(p[1] << 2) & 0x3C];
+			o += 3;
+
+			if (isPadded) {
+				*o++ = '=';
+			}
+			break;
+	}
+
+	return o - out;
+}
+
+/// Decodes chunk of base64 text.
+/// @param out - buffer of at least (state->count + state->padding + length) / 4 * 3 bytes.
+/// @returns count of bytes written to out.
+static NSUInteger Base64DecodeChunk(Base64DecoderState *state, const uint8_t *p, NSUInteger length, uint8_t *out) {
+
+	const uint8_t *end = p + length;
+	uint8_t *o = out;
+
+	while (p < end && !state->isFailed) {
+
+		// whole groups of alphabet characters are decoded without touching the state
+		if (state->count == 0 && state->padding == 0) {
+
+			while (end - p >= 4) {
+
+				uint32_t a = _decodingTable[p[0]];
+				uint32_t b = _decodingTable[p[1]];
+				uint32_t c = _decodingTable[p[2]];
+				uint32_t d = _decodingTable[p[3]];
+
+				if ((a | b | c | d) & 0xC0) {
+					break;
+				}
+
+				uint32_t group = (a << 18) | (b << 12) | (c << 6) | d;
+				o[0] = (uint8_t)(group >> 16);
+				o[1] = (uint8_t)(group >> 8);
+				o[2] = (uint8_t)group;
+
+				o += 3;
+				p += 4;
+			}
+
+			if (p >= end) {
+				break;
+			}
+		}
+
+		uint8_t value = _decodingTable[*p++];
+
+		if (value == BASE64_SPACE) {
+			continue;
+		}
+
+		if (value == BASE64_PADDING) {
+
+			// padding completes the last group of two or three characters
+			if (state->count < 2) {
+				state->isFailed = YES;
+				break;
+			}
+
+			state->padding++;
+
+			if (state->count + state->padding == 4) {
+
+				if (state->count == 2) {
+					*o++ = (uint8_t)(state->group >> 4);
+				}
+				else {
+					*o++ = (uint8_t)(state->group >> 10);
+					*o++ = (uint8_t)(state->group >> 2);
+				}
+
+				state->count = 0;
+				state->group = 0;
+			}
+			continue;
+		}
+
+		if (value == BASE64_INVALID || state->padding > 0) {
+			state->isFailed = YES;
+			break;
+		}
+
+		state->group = (state->group << 6) | value;
+
+		if (++state->count == 4) {
+
+			o[0] = (uint8_t)(state->group >> 16);
+			o[1] = (uint8_t)(state->group >> 8);
+			o[2] = (uint8_t)state->group;
+			o += 3;
+
+			state->count = 0;
+			state->group = 0;
+		}
+	}
+
+	return o - out;
+}
+
+/// Decodes the rest of the last group, missing padding is tolerated.
+/// @param out - buffer of at least 2 bytes.
+/// @returns count of bytes written to out.
+static NSUInteger Base64DecodeFinish(Base64DecoderState *state, uint8_t *out) {
+
+	switch (state->count) {
+
+		case 0:
+			return 0;
+
+		case 2:
+			out[0] = (uint8_t)(state->group >> 4);
+			return 1;
+
+		case 3:
+			out[0] = (uint8_t)(state->group >> 10);
+			out[1] = (uint8_t)(state->group >> 2);
+			return 2;
+
+		default:
+			state->isFailed = YES;
+			return 0;
+	}
+}
+
+#pragma mark Helpers End
+
+@implementation Base64
+
 + (NSString *)encodeBase64WithData:(NSData *)dataToEncode {
-	
+
+	return [self encodeBase64WithBytes: dataToEncode.bytes length: dataToEncode.length options: 0];
+}
+
++ (NSString *)encodeBase64WithData:(NSData *)dataToEncode options:(Base64EncodingOptions)options {
+
+	return [self encodeBase64WithBytes: dataToEncode.bytes length: dataToEncode.length options: options];
+}
+
++ (NSString *)encodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length options:(Base64EncodingOptions)options {
+
 	// args checking
-	if (dataToEncode == nil || [dataToEncode length] == 0) {
-		
+	if (bytes == NULL || length == 0) {
+
 		return nil;
 	}
-	
-	int lenght = [dataToEncode length];
-	
-	// initializing output buffer
-	const unsigned char * input = [dataToEncode bytes];
-	
-	char *output = (char *)calloc(((lenght + 2) / 3) * 4, sizeof(char));	
-	char *outputPtr = output;
-	
-	// encoding
-	int currChar, prevChar; // current and previous characters
-
-	for (int idxInput = 0; idxInput < lenght; idxInput++) {
-		
-	    currChar = input[idxInput];		
-
-	    switch (idxInput % 3) {
-			
-			case 0:
-				*outputPtr++ = _encodingTable[(currChar >> 2) & 0x3F];
-				break;
-				
-			case 1:
-				*outputPtr++ = _encodingTable[((prevChar << 4) & 0x30) | ((currChar >> 4) & 0xF)];
-				break;
-				
-			case 2:
-				*outputPtr++ = _encodingTable[((prevChar << 2) & 0x3C) | ((currChar >> 6) & 0x3)];
-				*outputPtr++ = _encodingTable[currChar & 0x3F];
-				break;
-	    }
-		
-	    prevChar = currChar;
+
+	NSUInteger encodedLength = [self encodedLengthOfLength: length options: options];
+	char *output = malloc(encodedLength);
+
+	if (output == NULL) {
+		return nil;
 	}
-	
-	
-	// padding characters		
-	switch (lenght % 3) {
-			
-		case 1: 
-			*outputPtr++ = _encodingTable[(prevChar << 4) & 0x30];
-			*outputPtr++ = '=';
-			*outputPtr++ = '=';			
-			break;
-			
-		case 2:			
-			*outputPtr++ = _encodingTable[(prevChar << 2) & 0x3C];
-			*outputPtr++ = '=';
-			break;
+
+	Base64Encode(bytes, length, output, options);
+
+	// the string takes ownership of the buffer instead of copying it
+	return [[[NSString alloc] initWithBytesNoCopy: output
+										   length: encodedLength
+										 encoding: NSASCIIStringEncoding
+									 freeWhenDone: YES] autorelease];
+}
+
++ (NSUInteger)encodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length toBuffer:(char *)buffer options:(Base64EncodingOptions)options {
+
+	return Base64Encode(bytes, length, buffer, options);
+}
+
++ (NSUInteger)encodedLengthOfLength:(NSUInteger)length options:(Base64EncodingOptions)options {
+
+	if (options & Base64EncodingNoPadding) {
+		return length / 3 * 4 + (length % 3 == 0 ? 0 : length % 3 + 1);
 	}
-	
-	*outputPtr = '\0';
-	
-	NSString *encodedInput = [NSString stringWithCString: output encoding: NSUTF8StringEncoding];
-	
-	free(output);
-	
-	return encodedInput;
+
+	return (length + 2) / 3 * 4;
 }
 
 + (NSData *)decodeBase64WithString:(NSString *)stringToDecode {
-	NSMutableData* data = [[[NSMutableData alloc] init] autorelease];
-	data = [[[NSPropertyListSerialization dataFromPropertyList: data
-														format: NSPropertyListXMLFormat_v1_0 errorDescription: nil] mutableCopy] autorelease];
-	char endByte = 0;
-	[data appendBytes: &endByte length: 1];
-	NSMutableString* plist = [NSMutableString stringWithUTF8String: ([data bytes])];
-	[plist replaceOccurrencesOfString: @"<data>"
-						   withString: [@"<data>" stringByAppendingString: stringToDecode]
-							  options: 0
-								range: NSMakeRange(0, [plist length])];
-	
-	data = [[[NSPropertyListSerialization propertyListFromData: [NSData dataWithBytes: [plist UTF8String]
-																			   length: [plist length]]
-											  mutabilityOption: NSPropertyListImmutable
-														format: nil
-											  errorDescription: nil] mutableCopy] autorelease];
-	return data;
+
+	Base64Decoder *decoder = [[Base64Decoder alloc] initWithCapacity: stringToDecode.length / 4 * 3];
+
+	[decoder decodeString: stringToDecode];
+	NSData *data = [[decoder finish] retain];
+
+	[decoder release];
+	return [data autorelease];
+}
+
++ (NSData *)decodeBase64WithBytes:(const void *)bytes length:(NSUInteger)length {
+
+	Base64Decoder *decoder = [[Base64Decoder alloc] initWithCapacity: length / 4 * 3];
+
+	[decoder decodeBytes: bytes length: length];
+	NSData *data = [[decoder finish] retain];
+
+	[decoder release];
+	return [data autorelease];
+}
+
+@end
+
+
+@implementation Base64Decoder
+
+@synthesize data = _data;
+
+- (id)init {
+
+	return [self initWithCapacity: 0];
+}
+
+- (id)initWithCapacity: (NSUInteger)capacity {
+
+	if ((self = [super init])) {
+
+		_data = [[NSMutableData alloc] initWithCapacity: capacity];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_data release];
+
+	[super dealloc];
+}
+
+- (BOOL)decodeBytes: (const void *)bytes length: (NSUInteger)length {
+
+	if (_state.isFailed) {
+		return NO;
+	}
+
+	NSUInteger offset = _data.length;
+	[_data increaseLengthBy: (_state.count + _state.padding + length) / 4 * 3];
+
+	NSUInteger decoded = Base64DecodeChunk(&_state, bytes, length, (uint8_t *)_data.mutableBytes + offset);
+	[_data setLength: offset + decoded];
+
+	return !_state.isFailed;
+}
+
+- (BOOL)decodeString: (NSString *)string {
+
+	uint8_t chunk[BASE64_STRING_CHUNK_SIZE];
+	NSRange range = NSMakeRange(0, string.length);
+
+	// the string is converted through a small buffer, so the text is not copied as a whole
+	while (range.length > 0 && !_state.isFailed) {
+
+		NSUInteger used = 0;
+
+		if (![string getBytes: chunk
+					maxLength: sizeof(chunk)
+				   usedLength: &used
+					 encoding: NSUTF8StringEncoding
+					  options: 0
+						range: range
+			   remainingRange: &range]) {
+
+			_state.isFailed = YES;
+			break;
+		}
+
+		[self decodeBytes: chunk length: used];
+	}
+
+	return !_state.isFailed;
+}
+
+- (NSData *)finish {
+
+	uint8_t rest[2];
+	NSUInteger count = Base64DecodeFinish(&_state, rest);
+
+	if (_state.isFailed) {
+		return nil;
+	}
+
+	[_data appendBytes: rest length: count];
+
+	return _data;
 }
 
 @end
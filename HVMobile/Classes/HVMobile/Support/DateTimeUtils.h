@@ -18,17 +18,43 @@
 
 #import <Foundation/Foundation.h>
 
+/// Length of UTC timestamp written by DateTimeUtils, yyyy-MM-ddTHH:mm:ss.SSSZ.
+#define DATE_TIME_UTC_STRING_LENGTH 24
+
 /// Provides date conversion utilities.
+/// Timestamps are formatted and parsed by hand rather than by NSDateFormatter,
+/// so the methods don't allocate formatters and can be called from any thread.
 @interface DateTimeUtils : NSObject
 
-/// Converts date to UTC formatted string.
+/// Converts date to UTC formatted string, yyyy-MM-ddTHH:mm:ss.SSSZ.
 /// @param date - date to be converted.
-/// @returns UTC formatted string.
+/// @returns UTC formatted string, nil if there is no date.
 + (NSString *)dateToUtcString: (NSDate *)date;
 
+/// Writes UTC timestamp of the time into caller-supplied buffer, no terminating zero is written.
+/// @param time - seconds since the reference date, 1 January 2001 GMT.
+/// @param buffer - buffer of at least DATE_TIME_UTC_STRING_LENGTH characters.
+/// @returns count of characters written, 0 if the year is out of 1...9999 range.
++ (NSUInteger)formatUtcTime: (NSTimeInterval)time toBuffer: (char *)buffer;
+
 /// Converts string with date in UTC format to date object.
+/// The fraction of seconds and the time zone, Z or +hh:mm, are optional;
+/// timestamps without a time zone are taken as UTC.
 /// @param string - string to be converted.
-/// @returns date in UTC format.
+/// @returns date in UTC format, nil if the string isn't a valid timestamp.
 + (NSDate *)UtcStringToDate: (NSString *)string;
 
+/// Parses UTC timestamp.
+/// @param bytes - ASCII characters of the timestamp.
+/// @param length - count of characters.
+/// @param time - receives seconds since the reference date.
+/// @returns NO if the text isn't a valid timestamp.
++ (BOOL)parseUtcBytes: (const char *)bytes length: (NSUInteger)length time: (NSTimeInterval *)time;
+
+/// Parses array of UTC timestamps.
+/// @param strings - strings to be converted.
+/// @param times - receives seconds since the reference date for every string, NAN for invalid ones.
+/// @returns count of valid timestamps.
++ (NSUInteger)parseUtcStrings: (NSArray *)strings times: (NSTimeInterval *)times;
+
 @end
@@ -18,37 +18,291 @@
 
 #import "DateTimeUtils.h"
 
+/// Days from 1 January 1970 to 1 January 2001, the reference date of NSDate.
+#define DAYS_TO_REFERENCE_DATE 11323
+
+#define SECONDS_PER_DAY 86400
+#define MILLISECONDS_PER_DAY (SECONDS_PER_DAY * 1000LL)
+
+/// Length of the timestamp without fraction and time zone, yyyy-MM-ddTHH:mm:ss.
+#define DATE_TIME_LENGTH 19
+
+/// Longest timestamp string which is parsed without copying it to the heap.
+#define MAX_UTC_STRING_LENGTH 64
+
+/// Count of fraction digits which are read, the rest is below the precision of NSTimeInterval.
+#define MAX_FRACTION_DIGITS 9
+
+#pragma mark Helpers
+
+/// Returns count of days from 1 January 1970 to the date of proleptic Gregorian calendar.
+static int64_t DaysFromCivil(int64_t year, int month, int day) {
+
+	year -= (month <= 2);
+
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + dayOfEra - 719468;
+}
+
+/// Converts count of days from 1 January 1970 to the date of proleptic Gregorian calendar.
+static void CivilFromDays(int64_t days, int64_t *year, int *month, int *day) {
+
+	days += 719468;
+
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int64_t dayOfEra = days - era * 146097;
+	int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+	*day = (int)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+	*month = (int)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+	*year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static int DaysInMonth(int year, int month) {
+
+	static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) {
+		return 29;
+	}
+
+	return days[month - 1];
+}
+
+/// Reads number of the given count of digits.
+static BOOL ReadDigits(const char *p, int count, int *value) {
+
+	int result = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		if (p[i] < '0' || p[i] > '9') {
+			return NO;
+		}
+
+		result = result * 10 + (p[i] - '0');
+	}
+
+	*value = result;
+	return YES;
+}
+
+/// Writes number padded with zeros to the given count of digits.
+static void WriteDigits(char *p, int count, int value) {
+
+	for (int i = count - 1; i >= 0; i--) {
+
+		p[i] = '0' + value % 10;
+		value /= 10;
+	}
+}
+
+static NSUInteger FormatUtcTime(NSTimeInterval time, char *buffer) {
+
+	// Years 1...9999 are within +/-320 billion seconds of the reference date.
+	if (!isfinite(time) || fabs(time) > 4e11) {
+		return 0;
+	}
+
+	// Milliseconds are rounded, so the time of a parsed timestamp is written back unchanged.
+	int64_t milliseconds = (int64_t)floor(time * 1000 + 0.5);
+	int64_t days = milliseconds / MILLISECONDS_PER_DAY;
+	int64_t millisecondOfDay = milliseconds % MILLISECONDS_PER_DAY;
+
+	if (millisecondOfDay < 0) {
+
+		days--;
+		millisecondOfDay += MILLISECONDS_PER_DAY;
+	}
+
+	int64_t year;
+	int month, day;
+	CivilFromDays(days + DAYS_TO_REFERENCE_DATE, &year, &month, &day);
+
+	if (year < 1 || year > 9999) {
+		return 0;
+	}
+
+	int secondOfDay = (int)(millisecondOfDay / 1000);
+
+	WriteDigits(buffer, 4, (int)year);
+	buffer[4] = '-';
+	WriteDigits(buffer + 5, 2, month);
+	buffer[7] = '-';
+	WriteDigits(buffer + 8, 2, day);
+	buffer[10] = 'T';
+	WriteDigits(buffer + 11, 2, secondOfDay / 3600);
+	buffer[13] = ':';
+	WriteDigits(buffer + 14, 2, secondOfDay / 60 % 60);
+	buffer[16] = ':';
+	WriteDigits(buffer + 17, 2, secondOfDay % 60);
+	buffer[19] = '.';
+	WriteDigits(buffer + 20, 3, (int)(millisecondOfDay % 1000));
+	buffer[23] = 'Z';
+
+	return DATE_TIME_UTC_STRING_LENGTH;
+}
+
+static BOOL ParseUtcBytes(const char *p, NSUInteger length, NSTimeInterval *time) {
+
+	int year, month, day, hour, minute, second;
+
+	if (length < DATE_TIME_LENGTH || p[4] != '-' || p[7] != '-' || p[10] != 'T' || p[13] != ':' || p[16] != ':') {
+		return NO;
+	}
+
+	if (!ReadDigits(p, 4, &year) || !ReadDigits(p + 5, 2, &month) || !ReadDigits(p + 8, 2, &day)
+		|| !ReadDigits(p + 11, 2, &hour) || !ReadDigits(p + 14, 2, &minute) || !ReadDigits(p + 17, 2, &second)) {
+		return NO;
+	}
+
+	if (year < 1 || month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month)
+		|| hour > 23 || minute > 59 || second > 59) {
+		return NO;
+	}
+
+	const char *c = p + DATE_TIME_LENGTH;
+	const char *end = p + length;
+
+	// Fraction of seconds, HealthVault writes up to seven digits.
+	int64_t fraction = 0;
+	int64_t fractionScale = 1;
+
+	if (c < end && *c == '.') {
+
+		const char *digits = ++c;
+
+		for (; c < end && *c >= '0' && *c <= '9'; c++) {
+
+			if (c - digits < MAX_FRACTION_DIGITS) {
+
+				fraction = fraction * 10 + (*c - '0');
+				fractionScale *= 10;
+			}
+		}
+
+		if (c == digits) {
+			return NO;
+		}
+	}
+
+	// Time zone, timestamps without it are taken as UTC.
+	int offset = 0;
+
+	if (c < end && *c == 'Z') {
+
+		c++;
+	}
+	else if (c < end && (*c == '+' || *c == '-')) {
+
+		int offsetHours, offsetMinutes;
+
+		if (end - c < 6 || c[3] != ':' || !ReadDigits(c + 1, 2, &offsetHours) || !ReadDigits(c + 4, 2, &offsetMinutes)
+			|| offsetHours > 23 || offsetMinutes > 59) {
+			return NO;
+		}
+
+		offset = (offsetHours * 60 + offsetMinutes) * 60 * (*c == '-' ? -1 : 1);
+		c += 6;
+	}
+
+	if (c != end) {
+		return NO;
+	}
+
+	int64_t days = DaysFromCivil(year, month, day) - DAYS_TO_REFERENCE_DATE;
+	int64_t seconds = days * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second - offset;
+
+	*time = (double)seconds + (double)fraction / fractionScale;
+	return YES;
+}
+
+/// Parses timestamp string, its characters are copied to the stack if the string doesn't expose them.
+static BOOL ParseUtcString(NSString *string, NSTimeInterval *time) {
+
+	if (!string) {
+		return NO;
+	}
+
+	char buffer[MAX_UTC_STRING_LENGTH];
+	const char *bytes = CFStringGetCStringPtr((CFStringRef)string, kCFStringEncodingASCII);
+
+	if (!bytes) {
+
+		if (![string getCString: buffer maxLength: sizeof(buffer) encoding: NSASCIIStringEncoding]) {
+			return NO;
+		}
+
+		bytes = buffer;
+	}
+
+	return ParseUtcBytes(bytes, strlen(bytes), time);
+}
+
+#pragma mark Helpers End
+
 
 @implementation DateTimeUtils
 
 + (NSString *)dateToUtcString: (NSDate *)date {
 
-	NSDateFormatter *formatter = [NSDateFormatter new];
-	[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'"];
-	[formatter setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
-	NSString *utcDateString = [formatter stringFromDate: date];
-	[formatter release];
+	if (!date) {
+		return nil;
+	}
+
+	char buffer[DATE_TIME_UTC_STRING_LENGTH];
+	NSUInteger length = FormatUtcTime([date timeIntervalSinceReferenceDate], buffer);
 
-	return utcDateString;
+	return [[[NSString alloc] initWithBytes: buffer
+									 length: length
+								   encoding: NSASCIIStringEncoding] autorelease];
+}
+
++ (NSUInteger)formatUtcTime: (NSTimeInterval)time toBuffer: (char *)buffer {
+
+	return FormatUtcTime(time, buffer);
 }
 
 + (NSDate *)UtcStringToDate: (NSString *)string {
-	
-	NSDateFormatter *formatter = [NSDateFormatter new];
-	[formatter setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
-	
-	[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss.SSS"];
-	NSDate *utcDate = [formatter dateFromString: string];
-	
-	if (utcDate == nil) {
-		
-		[formatter setDateFormat: @"yyyy-MM-dd'T'HH:mm:ss"];
-		utcDate = [formatter dateFromString: string];
-	}
-	
-	[formatter release];
-	
-	return utcDate;
+
+	NSTimeInterval time;
+
+	if (!ParseUtcString(string, &time)) {
+		return nil;
+	}
+
+	return [NSDate dateWithTimeIntervalSinceReferenceDate: time];
+}
+
++ (BOOL)parseUtcBytes: (const char *)bytes length: (NSUInteger)length time: (NSTimeInterval *)time {
+
+	return ParseUtcBytes(bytes, length, time);
+}
+
++ (NSUInteger)parseUtcStrings: (NSArray *)strings times: (NSTimeInterval *)times {
+
+	NSUInteger validCount = 0;
+	NSUInteger i = 0;
+
+	for (NSString *string in strings) {
+
+		if (ParseUtcString(string, &times[i])) {
+			validCount++;
+		}
+		else {
+			times[i] = NAN;
+		}
+
+		i++;
+	}
+
+	return validCount;
 }
 
 @end
@@ -0,0 +1,254 @@
+//
+//  Sha256.c
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Sha256.h"
+#include <string.h>
+
+#if SHA256_USE_COMMON_CRYPTO
+
+void Sha256Init(Sha256Context *context) {
+
+	CC_SHA256_Init(context);
+}
+
+void Sha256Update(Sha256Context *context, const void *data, size_t length) {
+
+	// CommonCrypto takes 32-bit lengths
+	const uint8_t *bytes = data;
+
+	while (length > 0) {
+
+		CC_LONG chunk = length > 0x40000000 ? 0x40000000 : (CC_LONG)length;
+		CC_SHA256_Update(context, bytes, chunk);
+
+		bytes += chunk;
+		length -= chunk;
+	}
+}
+
+void Sha256Final(Sha256Context *context, uint8_t *digest) {
+
+	CC_SHA256_Final(digest, context);
+}
+
+void HmacSha256Init(HmacSha256Context *context, const void *key, size_t keyLength) {
+
+	CCHmacInit(context, kCCHmacAlgSHA256, key, keyLength);
+}
+
+void HmacSha256Update(HmacSha256Context *context, const void *data, size_t length) {
+
+	CCHmacUpdate(context, data, length);
+}
+
+void HmacSha256Final(HmacSha256Context *context, uint8_t *digest) {
+
+	CCHmacFinal(context, digest);
+}
+
+#else
+
+// Portable implementation, FIPS 180-4.
+
+/// Round constants, FIPS 180-4 section 4.2.2.
+static const uint32_t _roundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/// Processes one 64-byte block.
+static void Sha256Transform(uint32_t *state, const uint8_t *block) {
+
+	uint32_t w[64];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+			   ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+	}
+
+	for (int i = 16; i < 64; i++) {
+		uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0; i < 64; i++) {
+
+		uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + _roundConstants[i] + w[i];
+		uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void Sha256Init(Sha256Context *context) {
+
+	static const uint32_t initialState[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(context->state, initialState, sizeof(initialState));
+	context->length = 0;
+}
+
+void Sha256Update(Sha256Context *context, const void *data, size_t length) {
+
+	const uint8_t *bytes = data;
+	size_t buffered = (size_t)(context->length % SHA256_BLOCK_SIZE);
+
+	context->length += length;
+
+	// complete the buffered block first
+	if (buffered > 0) {
+
+		size_t count = SHA256_BLOCK_SIZE - buffered;
+		if (count > length) {
+			count = length;
+		}
+
+		memcpy(context->buffer + buffered, bytes, count);
+		bytes += count;
+		length -= count;
+
+		if (buffered + count < SHA256_BLOCK_SIZE) {
+			return;
+		}
+
+		Sha256Transform(context->state, context->buffer);
+	}
+
+	// whole blocks are hashed in place
+	for (; length >= SHA256_BLOCK_SIZE; length -= SHA256_BLOCK_SIZE, bytes += SHA256_BLOCK_SIZE) {
+		Sha256Transform(context->state, bytes);
+	}
+
+	memcpy(context->buffer, bytes, length);
+}
+
+void Sha256Final(Sha256Context *context, uint8_t *digest) {
+
+	uint64_t bitLength = context->length * 8;
+	size_t buffered = (size_t)(context->length % SHA256_BLOCK_SIZE);
+
+	context->buffer[buffered++] = 0x80;
+
+	if (buffered > SHA256_BLOCK_SIZE - 8) {
+
+		memset(context->buffer + buffered, 0, SHA256_BLOCK_SIZE - buffered);
+		Sha256Transform(context->state, context->buffer);
+		buffered = 0;
+	}
+
+	memset(context->buffer + buffered, 0, SHA256_BLOCK_SIZE - 8 - buffered);
+
+	for (int i = 0; i < 8; i++) {
+		context->buffer[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bitLength >> (i * 8));
+	}
+
+	Sha256Transform(context->state, context->buffer);
+
+	for (int i = 0; i < 8; i++) {
+		digest[i * 4] = (uint8_t)(context->state[i] >> 24);
+		digest[i * 4 + 1] = (uint8_t)(context->state[i] >> 16);
+		digest[i * 4 + 2] = (uint8_t)(context->state[i] >> 8);
+		digest[i * 4 + 3] = (uint8_t)context->state[i];
+	}
+
+	memset(context, 0, sizeof(*context));
+}
+
+void HmacSha256Init(HmacSha256Context *context, const void *key, size_t keyLength) {
+
+	uint8_t block[SHA256_BLOCK_SIZE];
+	memset(block, 0, sizeof(block));
+
+	// keys longer than a block are hashed first, RFC 2104
+	if (keyLength > SHA256_BLOCK_SIZE) {
+
+		Sha256Init(&context->inner);
+		Sha256Update(&context->inner, key, keyLength);
+		Sha256Final(&context->inner, block);
+	}
+	else if (keyLength > 0) {
+
+		memcpy(block, key, keyLength);
+	}
+
+	for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+		block[i] ^= 0x36;
+	}
+
+	Sha256Init(&context->inner);
+	Sha256Update(&context->inner, block, SHA256_BLOCK_SIZE);
+
+	// 0x36 ^ 0x5c turns inner padding into outer padding
+	for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+		block[i] ^= 0x36 ^ 0x5c;
+	}
+
+	Sha256Init(&context->outer);
+	Sha256Update(&context->outer, block, SHA256_BLOCK_SIZE);
+
+	memset(block, 0, sizeof(block));
+}
+
+void HmacSha256Update(HmacSha256Context *context, const void *data, size_t length) {
+
+	Sha256Update(&context->inner, data, length);
+}
+
+void HmacSha256Final(HmacSha256Context *context, uint8_t *digest) {
+
+	uint8_t innerDigest[SHA256_DIGEST_SIZE];
+
+	Sha256Final(&context->inner, innerDigest);
+
+	Sha256Update(&context->outer, innerDigest, SHA256_DIGEST_SIZE);
+	Sha256Final(&context->outer, digest);
+
+	memset(innerDigest, 0, sizeof(innerDigest));
+}
+
+#endif
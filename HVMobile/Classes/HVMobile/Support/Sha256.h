@@ -0,0 +1,114 @@
+//
+//  Sha256.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HV_SHA256_H
+#define HV_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Incremental SHA 256 and HMAC SHA 256.
+/// Data can be fed chunk by chunk, so large request bodies are signed without being copied.
+/// CommonCrypto is used on Apple platforms; the portable implementation is used elsewhere
+/// or when SHA256_PORTABLE is defined, so the signing code builds and runs without CommonCrypto.
+
+#if defined(__APPLE__) && !defined(SHA256_PORTABLE)
+#	define SHA256_USE_COMMON_CRYPTO 1
+#else
+#	define SHA256_USE_COMMON_CRYPTO 0
+#endif
+
+/// Length of SHA 256 digest in bytes.
+#define SHA256_DIGEST_SIZE 32
+
+/// Length of SHA 256 block in bytes.
+#define SHA256_BLOCK_SIZE 64
+
+#if SHA256_USE_COMMON_CRYPTO
+
+#include <CommonCrypto/CommonDigest.h>
+#include <CommonCrypto/CommonHMAC.h>
+
+typedef CC_SHA256_CTX Sha256Context;
+typedef CCHmacContext HmacSha256Context;
+
+#else
+
+/// SHA 256 hashing state.
+typedef struct {
+
+	uint32_t state[8];
+
+	/// Count of bytes hashed so far.
+	uint64_t length;
+
+	/// Bytes of incomplete block.
+	uint8_t buffer[SHA256_BLOCK_SIZE];
+
+} Sha256Context;
+
+/// HMAC SHA 256 state, the outer context is keyed and waits for the inner digest.
+typedef struct {
+
+	Sha256Context inner;
+	Sha256Context outer;
+
+} HmacSha256Context;
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Initializes hashing context.
+void Sha256Init(Sha256Context *context);
+
+/// Adds data to the hash.
+/// @param context - hashing context.
+/// @param data - data to hash.
+/// @param length - count of bytes to hash.
+void Sha256Update(Sha256Context *context, const void *data, size_t length);
+
+/// Completes hashing, the context must be initialized again to be reused.
+/// @param context - hashing context.
+/// @param digest - buffer of SHA256_DIGEST_SIZE bytes which receives the hash.
+void Sha256Final(Sha256Context *context, uint8_t *digest);
+
+/// Initializes HMAC context with the key.
+/// @param context - HMAC context.
+/// @param key - the key to use.
+/// @param keyLength - length of the key in bytes.
+void HmacSha256Init(HmacSha256Context *context, const void *key, size_t keyLength);
+
+/// Adds data to the HMAC.
+/// @param context - HMAC context.
+/// @param data - data to sign.
+/// @param length - count of bytes to sign.
+void HmacSha256Update(HmacSha256Context *context, const void *data, size_t length);
+
+/// Completes HMAC computation.
+/// @param context - HMAC context.
+/// @param digest - buffer of SHA256_DIGEST_SIZE bytes which receives the HMAC.
+void HmacSha256Final(HmacSha256Context *context, uint8_t *digest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
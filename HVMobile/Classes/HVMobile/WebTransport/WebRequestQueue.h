@@ -0,0 +1,103 @@
+//
+//  WebRequestQueue.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class WebTransport;
+
+/// Priority of regular requests.
+#define WEB_REQUEST_PRIORITY_NORMAL 0
+
+/// Priority of requests which other requests are waiting for, e.g. session token refresh.
+#define WEB_REQUEST_PRIORITY_HIGH 10
+
+/// Runs web requests with a bounded count of requests in flight.
+/// Pending requests are started in order of priority, requests with equal priority
+/// are started in the order they have been submitted.
+/// Requests to the same host share persistent (keep-alive) connections, so the count
+/// of open connections does not exceed the concurrency limit.
+@interface WebRequestQueue : NSObject {
+
+	NSInteger _maxConcurrentRequests;
+	BOOL _usesPersistentConnections;
+	BOOL _parsesResponsesIncrementally;
+
+	/// Transports waiting to be started, sorted by priority.
+	NSMutableArray *_pendingTransports;
+
+	/// Transports which are in flight.
+	NSMutableArray *_runningTransports;
+}
+
+/// Gets or sets the maximum count of requests in flight.
+@property (assign) NSInteger maxConcurrentRequests;
+
+/// Gets or sets whether connections are kept alive and reused for subsequent requests.
+@property (assign) BOOL usesPersistentConnections;
+
+/// Gets or sets whether responses are parsed as xml while they are being received.
+/// See WebTransport parsesResponseIncrementally.
+@property (assign) BOOL parsesResponsesIncrementally;
+
+/// Gets count of requests waiting to be started.
+@property (readonly) NSUInteger pendingCount;
+
+/// Gets count of requests in flight.
+@property (readonly) NSUInteger runningCount;
+
+/// Initializes a new instance of the WebRequestQueue class.
+/// @param maxConcurrentRequests - the maximum count of requests in flight.
+- (id)initWithMaxConcurrentRequests: (NSInteger)maxConcurrentRequests;
+
+/// Submits a post request to a specific URL.
+/// @param url - string which contains server address.
+/// @param data - string will be sent in POST header.
+/// @param priority - request priority, requests with higher priority are started first.
+/// @param context - any object will be passed to callBack with response.
+/// @param target - callback method owner.
+/// @param callBack - the method to call when the request has completed.
+- (void)sendRequestForURL: (NSString *)url
+				 withData: (NSString *)data
+				 priority: (NSInteger)priority
+				  context: (NSObject *)context
+				   target: (NSObject *)target
+				 callBack: (SEL)callBack;
+
+/// Submits a post request with encoded body to a specific URL.
+/// @param url - string which contains server address.
+/// @param body - UTF-8 encoded data will be sent in POST body.
+/// @param priority - request priority, requests with higher priority are started first.
+/// @param context - any object will be passed to callBack with response.
+/// @param target - callback method owner.
+/// @param callBack - the method to call when the request has completed.
+- (void)sendRequestForURL: (NSString *)url
+				 withBody: (NSData *)body
+				 priority: (NSInteger)priority
+				  context: (NSObject *)context
+				   target: (NSObject *)target
+				 callBack: (SEL)callBack;
+
+/// Submits a transport which has been created, but not started yet.
+/// @param transport - transport to run.
+- (void)addTransport: (WebTransport *)transport;
+
+/// Called by transport when its request has completed.
+/// @param transport - completed transport.
+- (void)transportCompleted: (WebTransport *)transport;
+
+@end
@@ -0,0 +1,165 @@
+//
+//  WebRequestQueue.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "WebRequestQueue.h"
+#import "WebTransport.h"
+#import "HealthVaultConfig.h"
+
+@interface WebRequestQueue (Private)
+
+/// Starts pending transports while there are free slots.
+- (void)startPendingTransports;
+
+@end
+
+@implementation WebRequestQueue
+
+@synthesize maxConcurrentRequests = _maxConcurrentRequests;
+@synthesize usesPersistentConnections = _usesPersistentConnections;
+@synthesize parsesResponsesIncrementally = _parsesResponsesIncrementally;
+
+- (id)init {
+
+	return [self initWithMaxConcurrentRequests: DEFAULT_MAX_CONCURRENT_REQUESTS];
+}
+
+- (id)initWithMaxConcurrentRequests: (NSInteger)maxConcurrentRequests {
+
+	if ((self = [super init])) {
+
+		_maxConcurrentRequests = maxConcurrentRequests;
+		_usesPersistentConnections = YES;
+		_pendingTransports = [NSMutableArray new];
+		_runningTransports = [NSMutableArray new];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	// transports don't retain the queue, so they must not call back once it is gone
+	for (WebTransport *transport in _pendingTransports) {
+		[transport cancel];
+	}
+
+	for (WebTransport *transport in _runningTransports) {
+		[transport cancel];
+	}
+
+	[_pendingTransports release];
+	[_runningTransports release];
+
+	[super dealloc];
+}
+
+- (NSUInteger)pendingCount {
+
+	return _pendingTransports.count;
+}
+
+- (NSUInteger)runningCount {
+
+	return _runningTransports.count;
+}
+
+- (void)setMaxConcurrentRequests: (NSInteger)maxConcurrentRequests {
+
+	_maxConcurrentRequests = maxConcurrentRequests;
+
+	// raising the limit lets waiting requests go immediately
+	[self startPendingTransports];
+}
+
+- (void)sendRequestForURL: (NSString *)url
+				 withData: (NSString *)data
+				 priority: (NSInteger)priority
+				  context: (NSObject *)context
+				   target: (NSObject *)target
+				 callBack: (SEL)callBack {
+
+	WebTransport *transport = [[WebTransport alloc] initWithURL: url
+														   data: data
+														context: context
+														 target: target
+													   callBack: callBack];
+	transport.priority = priority;
+
+	[self addTransport: transport];
+	[transport release];
+}
+
+- (void)sendRequestForURL: (NSString *)url
+				 withBody: (NSData *)body
+				 priority: (NSInteger)priority
+				  context: (NSObject *)context
+				   target: (NSObject *)target
+				 callBack: (SEL)callBack {
+
+	WebTransport *transport = [[WebTransport alloc] initWithURL: url
+														   body: body
+														context: context
+														 target: target
+													   callBack: callBack];
+	transport.priority = priority;
+
+	[self addTransport: transport];
+	[transport release];
+}
+
+- (void)addTransport: (WebTransport *)transport {
+
+	transport.queue = self;
+	transport.parsesResponseIncrementally = transport.parsesResponseIncrementally || _parsesResponsesIncrementally;
+	[transport setValue: (_usesPersistentConnections ? @"keep-alive" : @"close") forHTTPHeaderField: @"Connection"];
+	[transport markEnqueued];
+
+	// insert after the last transport with the same or higher priority, so equal priorities stay FIFO
+	NSUInteger index = _pendingTransports.count;
+	while (index > 0 && ((WebTransport *)[_pendingTransports objectAtIndex: index - 1]).priority < transport.priority) {
+		index--;
+	}
+
+	[_pendingTransports insertObject: transport atIndex: index];
+
+	[self startPendingTransports];
+}
+
+- (void)transportCompleted: (WebTransport *)transport {
+
+	transport.queue = nil;
+	[_runningTransports removeObjectIdenticalTo: transport];
+
+	[self startPendingTransports];
+}
+
+- (void)startPendingTransports {
+
+	while (_pendingTransports.count > 0 &&
+		   (_maxConcurrentRequests <= 0 || _runningTransports.count < (NSUInteger)_maxConcurrentRequests)) {
+
+		WebTransport *transport = [_pendingTransports objectAtIndex: 0];
+
+		[_runningTransports addObject: transport];
+		[_pendingTransports removeObjectAtIndex: 0];
+
+		[transport start];
+	}
+}
+
+@end
@@ -18,21 +18,67 @@
 
 #import <Foundation/Foundation.h>
 
+@class XmlDocument;
+
 
 /// Represents xml response from HealthVault server.
 /// The data related to a request.
 @interface WebResponse : NSObject {
 
 	NSString *_responseData;
+	NSData *_responseBody;
+	XmlDocument *_responseDocument;
 	NSString *_errorText;
+	NSInteger _errorCode;
+	NSInteger _httpStatusCode;
+	NSTimeInterval _retryAfter;
+
+	NSTimeInterval _queueTime;
+	NSTimeInterval _sendTime;
+	NSTimeInterval _firstByteTime;
+	NSTimeInterval _parseTime;
+	NSTimeInterval _totalTime;
 }
 
 /// Gets or sets the response data.
+/// If the response has been received as responseBody, the string is decoded the first time it is read.
 @property (retain) NSString *responseData;
 
+/// Gets or sets the raw UTF-8 response body.
+@property (retain) NSData *responseBody;
+
+/// Gets or sets the document parsed while the response was being received, nil if the response
+/// has not been parsed incrementally or is not valid xml.
+@property (retain) XmlDocument *responseDocument;
+
 /// Gets or sets the error text.
 @property (retain) NSString *errorText;
 
+/// Gets or sets code of the connection error, one of NSURLError codes, 0 if there is no error.
+@property (assign) NSInteger errorCode;
+
+/// Gets or sets HTTP status code of the response, 0 if no response has been received.
+@property (assign) NSInteger httpStatusCode;
+
+/// Gets or sets the delay the server has asked for in Retry-After header, in seconds, 0 if there is none.
+@property (assign) NSTimeInterval retryAfter;
+
+/// Gets or sets the time the request has been waiting in the queue before it was sent, in seconds.
+@property (assign) NSTimeInterval queueTime;
+
+/// Gets or sets the time from sending the request till its body was written, in seconds.
+/// It covers opening the connection and TLS handshake, 0 if the body hasn't been written.
+@property (assign) NSTimeInterval sendTime;
+
+/// Gets or sets the time from sending the request till the response headers were received, in seconds.
+@property (assign) NSTimeInterval firstByteTime;
+
+/// Gets or sets the time from sending the request till the response was completed, in seconds.
+@property (assign) NSTimeInterval totalTime;
+
+/// Gets or sets the time spent parsing the response while it was being received, in seconds.
+@property (assign) NSTimeInterval parseTime;
+
 /// Gets error status for response. Returns YES if request has been failed.
 @property (readonly, getter = getHasError) BOOL hasError;
 
@@ -17,21 +17,43 @@
 // limitations under the License.
 
 #import "WebResponse.h"
+#import "XmlDocument.h"
 
 
 @implementation WebResponse
 
 @synthesize responseData = _responseData;
+@synthesize responseBody = _responseBody;
+@synthesize responseDocument = _responseDocument;
 @synthesize errorText = _errorText;
+@synthesize errorCode = _errorCode;
+@synthesize httpStatusCode = _httpStatusCode;
+@synthesize retryAfter = _retryAfter;
+@synthesize queueTime = _queueTime;
+@synthesize sendTime = _sendTime;
+@synthesize firstByteTime = _firstByteTime;
+@synthesize totalTime = _totalTime;
+@synthesize parseTime = _parseTime;
 
 - (void)dealloc {
 
 	self.responseData = nil;
+	self.responseBody = nil;
+	self.responseDocument = nil;
 	self.errorText = nil;
 
 	[super dealloc];
 }
 
+- (NSString *)responseData {
+
+	if (!_responseData && _responseBody) {
+		_responseData = [[NSString alloc] initWithData: _responseBody encoding: NSUTF8StringEncoding];
+	}
+
+	return _responseData;
+}
+
 - (BOOL)getHasError {
 
     return self.errorText != nil;
@@ -18,16 +18,51 @@
 
 #import <Foundation/Foundation.h>
 
+@class WebRequestQueue;
+@class XmlDocument;
 
 /// Class to simplify making POSTs and obtaining the responses.
+/// A transport can be started immediately or submitted to WebRequestQueue,
+/// which limits the count of requests in flight.
 @interface WebTransport : NSObject {
 
     NSMutableData *_responseBody;
+    XmlDocument *_responseDocument;
+    BOOL _parsesResponseIncrementally;
     NSObject *_context;
     NSObject *_target;
     SEL _callBack;
+
+    NSMutableURLRequest *_request;
+    NSURLConnection *_connection;
+    WebRequestQueue *_queue;
+    NSInteger _priority;
+
+    /// Timestamps used to measure queue wait, time to first byte and total time.
+    NSTimeInterval _enqueueTime;
+    NSTimeInterval _startTime;
+    NSTimeInterval _bodySentTime;
+    NSTimeInterval _firstByteTime;
+
+    /// Time spent parsing the response while it is being received.
+    NSTimeInterval _parseTime;
+
+    /// Status and Retry-After header of the HTTP response.
+    NSInteger _httpStatusCode;
+    NSTimeInterval _retryAfter;
 }
 
+/// Gets or sets priority of the request, requests with higher priority are started first.
+@property (assign) NSInteger priority;
+
+/// Gets or sets whether the response body is parsed as xml while it is being received.
+/// Received chunks are fed into XmlDocument sharing the response buffer, so parsing overlaps
+/// with the transfer and the response is not copied into a string.
+@property (assign) BOOL parsesResponseIncrementally;
+
+/// Gets or sets the queue which runs the transport, the queue is not retained.
+@property (assign) WebRequestQueue *queue;
+
 /// Returns whether all requests and responses should be logged.
 + (BOOL)isRequestResponseLogEnabled;
 
@@ -47,4 +82,43 @@
                    target: (NSObject *)target
                  callBack: (SEL)callBack;
 
+/// Initializes a new instance of the WebTransport class without sending the request.
+/// @param url - string which contains server address.
+/// @param data - string will be sent in POST header.
+/// @param context - any object will be passed to callBack with response.
+/// @param target - callback method owner.
+/// @param callBack - the method to call when the request has completed.
+- (id)initWithURL: (NSString *)url
+             data: (NSString *)data
+          context: (NSObject *)context
+           target: (NSObject *)target
+         callBack: (SEL)callBack;
+
+/// Initializes a new instance of the WebTransport class with encoded body without sending the request.
+/// The body is sent as is, without further conversion.
+/// @param url - string which contains server address.
+/// @param body - UTF-8 encoded data will be sent in POST body.
+/// @param context - any object will be passed to callBack with response.
+/// @param target - callback method owner.
+/// @param callBack - the method to call when the request has completed.
+- (id)initWithURL: (NSString *)url
+             body: (NSData *)body
+          context: (NSObject *)context
+           target: (NSObject *)target
+         callBack: (SEL)callBack;
+
+/// Sets value of HTTP header field of the request.
+/// @param value - header value.
+/// @param field - header name.
+- (void)setValue: (NSString *)value forHTTPHeaderField: (NSString *)field;
+
+/// Marks the moment the transport has been put into a queue.
+- (void)markEnqueued;
+
+/// Sends the request.
+- (void)start;
+
+/// Cancels the request and detaches the transport from its queue, callBack is not called.
+- (void)cancel;
+
 @end
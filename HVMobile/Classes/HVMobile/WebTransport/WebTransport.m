@@ -18,6 +18,8 @@
 
 #import "WebTransport.h"
 #import "WebResponse.h"
+#import "WebRequestQueue.h"
+#import "XmlDocument.h"
 #import "Logger.h"
 #import "HealthVaultConfig.h"
 
@@ -35,18 +37,6 @@
 /// @param message - message to be written.
 + (void)addMessageToRequestResponseLog: (NSString *)message;
 
-/// Sends a post request to a specific URL.
-/// @param url - string which contains server address.
-/// @param data - string will be sent in POST header.
-/// @param context - any object will be passed to callBack with response.
-/// @param target - callback method owner.
-/// @param callBack - the method to call when the request has completed.
-- (void)sendRequestForURL: (NSString *)url
-                 withData: (NSString *)data
-                  context: (NSObject *)context
-                   target: (NSObject *)target
-                 callBack: (SEL)callBack;
-
 /// Performs callBack on target when response is received.
 /// @param response - response to send.
 - (void)performCallBack: (WebResponse *)response;
@@ -56,6 +46,10 @@
 
 @implementation WebTransport
 
+@synthesize priority = _priority;
+@synthesize parsesResponseIncrementally = _parsesResponseIncrementally;
+@synthesize queue = _queue;
+
 /// Represents logging status (enabled/disabled).
 static BOOL _isRequestResponseLogEnabled = HEALTH_VAULT_TRACE_ENABLED;
 
@@ -64,6 +58,9 @@ static BOOL _isRequestResponseLogEnabled = HEALTH_VAULT_TRACE_ENABLED;
     [_target release];
     [_context release];
     [_responseBody release];
+    [_responseDocument release];
+    [_request release];
+    [_connection release];
 
     [super dealloc];
 }
@@ -101,64 +98,167 @@ static BOOL _isRequestResponseLogEnabled = HEALTH_VAULT_TRACE_ENABLED;
                    target: (NSObject *)target
                  callBack: (SEL)callBack {
 
-    WebTransport *transport = [[WebTransport new] autorelease];
-    [transport sendRequestForURL: url
-            withData: data
-            context: context
-            target: target
-            callBack: callBack];
+    WebTransport *transport = [[WebTransport alloc] initWithURL: url
+                                                           data: data
+                                                        context: context
+                                                         target: target
+                                                       callBack: callBack];
+    [transport start];
+    [transport release];
 }
 
-- (void)sendRequestForURL: (NSString *)url
-                 withData: (NSString *)data
-                  context: (NSObject *)context
-                   target: (NSObject *)target
-                 callBack: (SEL)callBack {
+- (id)initWithURL: (NSString *)url
+             data: (NSString *)data
+          context: (NSObject *)context
+           target: (NSObject *)target
+         callBack: (SEL)callBack {
+
+    return [self initWithURL: url
+                        body: [data dataUsingEncoding: NSUTF8StringEncoding]
+                     context: context
+                      target: target
+                    callBack: callBack];
+}
+
+- (id)initWithURL: (NSString *)url
+             body: (NSData *)body
+          context: (NSObject *)context
+           target: (NSObject *)target
+         callBack: (SEL)callBack {
+
+    if ((self = [super init])) {
+
+        _target = [target retain];
+        _callBack = callBack;
+        _context = [context retain];
+        _responseBody = [[NSMutableData data] retain];
 
-    _target = [target retain];
-    _callBack = callBack;
-    _context = [context retain];
-    _responseBody = [[NSMutableData data] retain];
+        _request = [[NSMutableURLRequest alloc] initWithURL: [NSURL URLWithString: url]];
 
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL: [NSURL URLWithString: url]];
-	
 #ifdef CONNECTION_ALLOW_ANY_HTTPS_CERTIFICATE
-	// required for unit tests, see http://www.openradar.me/8385355
-    [NSURLRequest setAllowsAnyHTTPSCertificate:YES forHost:[[NSURL URLWithString: url] host]];
-	// alternative way is handling canAuthenticateAgainstProtectionSpace challannge
-	// http://stackoverflow.com/questions/933331/
+        // required for unit tests, see http://www.openradar.me/8385355
+        [NSURLRequest setAllowsAnyHTTPSCertificate:YES forHost:[[NSURL URLWithString: url] host]];
+        // alternative way is handling canAuthenticateAgainstProtectionSpace challannge
+        // http://stackoverflow.com/questions/933331/
 #endif
-	
-    [request setTimeoutInterval: DEFAULT_REQUEST_TIMEOUT];
 
-    if (data) {
-        [WebTransport addMessageToRequestResponseLog: data];
+        [_request setTimeoutInterval: DEFAULT_REQUEST_TIMEOUT];
 
-        NSData *xmlData = [data dataUsingEncoding: NSUTF8StringEncoding];
+        if (body) {
 
-        [request setHTTPMethod: DEFAULT_HTTP_METHOD];
-        [request addValue: [NSString stringWithFormat: @"%d", xmlData.length] forHTTPHeaderField: @"Content-Length"];
-        [request setHTTPBody: xmlData];
+            // the string is decoded only when it is going to be logged
+            if (_isRequestResponseLogEnabled) {
+
+                NSString *data = [[NSString alloc] initWithData: body encoding: NSUTF8StringEncoding];
+                [WebTransport addMessageToRequestResponseLog: data];
+                [data release];
+            }
+
+            [_request setHTTPMethod: DEFAULT_HTTP_METHOD];
+            [_request addValue: [NSString stringWithFormat: @"%d", body.length] forHTTPHeaderField: @"Content-Length"];
+            [_request setHTTPBody: body];
+        }
     }
 
-    NSURLConnection *connection = [[NSURLConnection alloc] initWithRequest: request delegate: self];
-    [connection start];
+    return self;
+}
+
+- (void)setValue: (NSString *)value forHTTPHeaderField: (NSString *)field {
+
+    [_request setValue: value forHTTPHeaderField: field];
+}
+
+- (void)markEnqueued {
+
+    _enqueueTime = [NSDate timeIntervalSinceReferenceDate];
+}
+
+- (void)start {
+
+    _startTime = [NSDate timeIntervalSinceReferenceDate];
+
+    if (!_enqueueTime) {
+        _enqueueTime = _startTime;
+    }
+
+    // the connection retains its delegate until it finishes, fails or is cancelled
+    _connection = [[NSURLConnection alloc] initWithRequest: _request delegate: self];
+    [_connection start];
+}
+
+- (void)cancel {
+
+    _queue = nil;
+
+    [_connection cancel];
+    [_connection release];
+    _connection = nil;
 }
 
 #pragma mark Connection Events
 
+- (void)connection: (NSURLConnection *)connection
+   didSendBodyData: (NSInteger)bytesWritten
+ totalBytesWritten: (NSInteger)totalBytesWritten
+totalBytesExpectedToWrite: (NSInteger)totalBytesExpectedToWrite {
+
+    // the last call marks the moment the connection is open and the whole body is written
+    _bodySentTime = [NSDate timeIntervalSinceReferenceDate];
+}
+
 - (void)connection: (NSURLConnection *)connection didReceiveResponse: (NSURLResponse *)response {
 
-    if (_responseBody) {
-        [_responseBody setLength: 0];
+    _firstByteTime = [NSDate timeIntervalSinceReferenceDate];
+
+    if ([response isKindOfClass: [NSHTTPURLResponse class]]) {
+
+        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+        _httpStatusCode = httpResponse.statusCode;
+
+        // only the delay form is used, HTTP date is ignored
+        _retryAfter = MAX([[[httpResponse allHeaderFields] objectForKey: @"Retry-After"] doubleValue], 0);
+    }
+
+    // the whole response is kept in one buffer, reserve it up front when the length is known
+    long long expectedLength = response.expectedContentLength;
+    NSUInteger capacity = (expectedLength > 0 && expectedLength < NSUIntegerMax) ? (NSUInteger)expectedLength : 0;
+
+    [_responseBody release];
+    _responseBody = [[NSMutableData alloc] initWithCapacity: capacity];
+
+    [_responseDocument release];
+    _responseDocument = nil;
+    _parseTime = 0;
+
+    if (_parsesResponseIncrementally) {
+        _responseDocument = [[XmlDocument alloc] initWithGrowingData: _responseBody];
     }
 }
 
 - (void)connection: (NSURLConnection *)conn didReceiveData: (NSData *)data {
 
-    if (_responseBody && data) {
-        [_responseBody appendData: data];
+    if (!_responseBody || !data) {
+        return;
+    }
+
+    [_responseBody appendData: data];
+
+    if (!_responseDocument) {
+        return;
+    }
+
+    NSTimeInterval parseStartTime = [NSDate timeIntervalSinceReferenceDate];
+
+    if (![_responseDocument parseAppendedData]) {
+
+        // the body is still delivered as is, the consumer reports invalid response
+        TraceComponentError(@"WebTransport", @"%@", @"Response is not valid xml, incremental parsing has been stopped");
+
+        [_responseDocument release];
+        _responseDocument = nil;
     }
+
+    _parseTime += [NSDate timeIntervalSinceReferenceDate] - parseStartTime;
 }
 
 - (void)connectionDidFinishLoading: (NSURLConnection *)conn {
@@ -166,17 +266,35 @@ static BOOL _isRequestResponseLogEnabled = HEALTH_VAULT_TRACE_ENABLED;
 	TraceComponentMessage(@"WebTransport", NSLocalizedString(@"Received bytes key",
 															 @"Format to display amount of received bytes"), _responseBody.length);
 
-    NSString *responseString = [[NSString alloc] initWithData: _responseBody encoding: NSUTF8StringEncoding];
+    if (_responseDocument) {
+
+        NSTimeInterval parseStartTime = [NSDate timeIntervalSinceReferenceDate];
+
+        if (![_responseDocument finishParsing]) {
+
+            [_responseDocument release];
+            _responseDocument = nil;
+        }
 
-    [WebTransport addMessageToRequestResponseLog: responseString];
+        _parseTime += [NSDate timeIntervalSinceReferenceDate] - parseStartTime;
+    }
 
     WebResponse *response = [WebResponse new];
-    response.responseData = responseString;
+    response.responseBody = _responseBody;
+    response.responseDocument = _responseDocument;
+    response.httpStatusCode = _httpStatusCode;
+    response.retryAfter = _retryAfter;
+
+    // the string is decoded only when it is going to be logged
+    if (_isRequestResponseLogEnabled) {
+        [WebTransport addMessageToRequestResponseLog: response.responseData];
+    }
+
     [self performCallBack: response];
     [response release];
-    [responseString release];
 
-    [conn release];
+    [_connection release];
+    _connection = nil;
 }
 
 - (void)connection: (NSURLConnection *)conn didFailWithError: (NSError *)error {
@@ -190,20 +308,38 @@ static BOOL _isRequestResponseLogEnabled = HEALTH_VAULT_TRACE_ENABLED;
 
     WebResponse *response = [WebResponse new];
     response.errorText = errorString;
+    response.errorCode = error.code;
     [self performCallBack: response];
     [response release];
 
-    [conn release];
+    [_connection release];
+    _connection = nil;
 }
 
 #pragma mark Connection Events End
 
 - (void)performCallBack: (WebResponse *)response {
 
+    NSTimeInterval finishTime = [NSDate timeIntervalSinceReferenceDate];
+
+    response.queueTime = _startTime - _enqueueTime;
+    response.sendTime = _bodySentTime ? _bodySentTime - _startTime : 0;
+    response.firstByteTime = _firstByteTime ? _firstByteTime - _startTime : 0;
+    response.totalTime = finishTime - _startTime;
+    response.parseTime = _parseTime;
+
+    TraceComponentMessage(@"WebTransport", @"Request timing: queued %.3f s, first byte %.3f s, total %.3f s",
+                          response.queueTime, response.firstByteTime, response.totalTime);
+
+    // the queue may release the transport once it is notified
+    [[self retain] autorelease];
+
     if (_target && [_target respondsToSelector: _callBack]) {
 
         [_target performSelector: _callBack withObject: response withObject: _context];
     }
+
+    [_queue transportCompleted: self];
 }
 
 @end
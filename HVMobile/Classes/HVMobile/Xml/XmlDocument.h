@@ -0,0 +1,220 @@
+//
+//  XmlDocument.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "XmlElement.h"
+
+/// Index value which denotes a missing node.
+#define XML_NODE_NONE -1
+
+/// Node table entry.
+typedef struct {
+
+	/// Interned local name index.
+	int32_t name;
+
+	/// Parent, first child and next sibling node indexes.
+	int32_t parent;
+	int32_t firstChild;
+	int32_t nextSibling;
+
+	/// First entry in the attribute table and count of attributes.
+	int32_t firstAttribute;
+	int32_t attributeCount;
+
+	/// First text segment, text of the node may consist of several segments.
+	int32_t firstText;
+
+	/// Range of the element in the document buffer, from its start tag till the end of its end tag.
+	uint32_t offset;
+	uint32_t length;
+
+} XmlNodeRecord;
+
+/// Attribute table entry, value is a range in the document buffer.
+typedef struct {
+
+	int32_t name;
+	uint32_t offset;
+	uint32_t length;
+	BOOL escaped;
+
+} XmlAttributeRecord;
+
+/// Text table entry, text is a range in the document buffer.
+typedef struct {
+
+	uint32_t offset;
+	uint32_t length;
+	int32_t next;
+	BOOL escaped;
+
+} XmlTextRecord;
+
+/// Represents compact read-only xml document.
+/// All nodes live in one contiguous node table linked by parent, first child and next sibling indexes.
+/// Element and attribute names are interned once per document; text and attribute values are
+/// ranges into the original UTF-8 buffer, they are converted to strings only when requested.
+/// Nodes are exposed through XmlElement interface, so selectNodes:, selectSingleNode: and attrValue:
+/// work the same way as for the tree built by XmlTextReader.
+@interface XmlDocument : NSObject {
+
+	/// Original UTF-8 buffer.
+	NSData *_data;
+
+	XmlNodeRecord *_nodes;
+	NSUInteger _nodeCount;
+	NSUInteger _nodeCapacity;
+
+	XmlAttributeRecord *_attributes;
+	NSUInteger _attributeCount;
+	NSUInteger _attributeCapacity;
+
+	XmlTextRecord *_texts;
+	NSUInteger _textCount;
+	NSUInteger _textCapacity;
+
+	/// Interned names, the position in array is the name index.
+	NSMutableArray *_names;
+
+	/// Maps name to its index.
+	NSMutableDictionary *_nameIndexes;
+
+	/// Hash table used for interning names directly from the buffer.
+	struct XmlNameSlot *_nameSlots;
+	NSUInteger _nameSlotCapacity;
+
+	/// Elements which have been requested for nodes, they are not retained.
+	XmlElement **_elements;
+
+	/// Incremental parsing state: position of the first byte not parsed yet and open elements.
+	NSUInteger _parseOffset;
+	struct XmlOpenElement *_openElements;
+	NSUInteger _depth;
+	NSUInteger _openElementCapacity;
+	BOOL _isInvalid;
+}
+
+/// Gets the original UTF-8 buffer.
+@property (readonly) NSData *data;
+
+/// Gets the count of nodes in the document.
+@property (readonly) NSUInteger nodeCount;
+
+/// Gets root element of the document.
+@property (readonly) XmlElement *rootElement;
+
+/// Returns count of documents parsed by the application so far.
+/// Used to check that every response is tokenized exactly once.
++ (NSUInteger)parseCount;
+
+/// Parses xml text and creates document.
+/// @param xml - xml text to parse.
+/// @returns document or nil if xml is not valid.
++ (XmlDocument *)documentWithString: (NSString *)xml;
+
+/// Parses UTF-8 encoded xml and creates document.
+/// The buffer is retained by the document and must not be modified.
+/// @param data - xml to parse.
+/// @returns document or nil if xml is not valid.
++ (XmlDocument *)documentWithData: (NSData *)data;
+
+/// Initializes document with UTF-8 encoded xml.
+/// @param data - xml to parse.
+/// @returns document or nil if xml is not valid.
+- (id)initWithData: (NSData *)data;
+
+/// Initializes document which is parsed while the buffer grows.
+/// The buffer is shared with the caller: the caller appends received bytes to it and calls
+/// parseAppendedData, so the response is kept in memory only once and is tokenized while it arrives.
+/// Nodes are not accessible until finishParsing has succeeded.
+/// @param data - buffer the caller appends UTF-8 encoded xml to.
+- (id)initWithGrowingData: (NSMutableData *)data;
+
+/// Parses all complete tokens appended to the buffer since the previous call.
+/// A token split between two chunks is parsed when the rest of it arrives.
+/// @returns NO if the xml is not valid.
+- (BOOL)parseAppendedData;
+
+/// Parses the rest of the buffer and checks that the document is complete.
+/// @returns NO if the xml is not valid.
+- (BOOL)finishParsing;
+
+/// Returns element for node.
+/// @param index - node index.
+- (XmlElement *)elementAtIndex: (NSInteger)index;
+
+/// Returns node table entry.
+/// @param index - node index.
+- (const XmlNodeRecord *)nodeAtIndex: (NSInteger)index;
+
+/// Returns interned name for name index.
+/// @param index - name index.
+- (NSString *)nameAtIndex: (NSInteger)index;
+
+/// Returns name index or XML_NODE_NONE if the document does not contain the name.
+/// @param name - element or attribute name.
+- (NSInteger)indexOfName: (NSString *)name;
+
+/// Returns text of node or nil if node does not have text.
+/// @param index - node index.
+- (NSMutableString *)textOfNode: (NSInteger)index;
+
+/// Decodes text of node as base64 directly from the document buffer.
+/// @param index - node index.
+/// @returns decoded data or nil if the text is not valid base64.
+- (NSData *)base64DataOfNode: (NSInteger)index;
+
+/// Returns attribute value of node or nil if node does not have such attribute.
+/// @param name - attribute name.
+/// @param index - node index.
+- (NSString *)attribute: (NSString *)name ofNode: (NSInteger)index;
+
+/// Returns attribute value of node or nil if node does not have such attribute.
+/// @param nameIndex - index of the attribute name, as returned by indexOfName:.
+/// @param index - node index.
+- (NSString *)attributeWithNameIndex: (NSInteger)nameIndex ofNode: (NSInteger)index;
+
+/// Returns all attributes of node.
+/// @param index - node index.
+- (NSMutableDictionary *)attributesOfNode: (NSInteger)index;
+
+/// Returns xml of node as it is in the document buffer, in document order and without re-serialization.
+/// Namespace declarations of ancestors are not included.
+/// @param index - node index.
+- (NSString *)xmlOfNode: (NSInteger)index;
+
+/// Returns the nth child of node with the given name.
+/// @param name - child name.
+/// @param position - position index (starting from zero).
+/// @param index - node index.
+/// @returns child node index or XML_NODE_NONE.
+- (NSInteger)child: (NSString *)name at: (NSInteger)position ofNode: (NSInteger)index;
+
+/// Returns the next child of node with the given name.
+/// @param nameIndex - index of the child name, as returned by indexOfName:.
+/// @param previous - child node the search starts after, XML_NODE_NONE to start with the first child.
+/// @param index - node index.
+/// @returns child node index or XML_NODE_NONE.
+- (NSInteger)childWithNameIndex: (NSInteger)nameIndex after: (NSInteger)previous ofNode: (NSInteger)index;
+
+/// Removes element from the cache, called when element is deallocated.
+/// @param index - node index.
+- (void)elementReleased: (NSInteger)index;
+
+@end
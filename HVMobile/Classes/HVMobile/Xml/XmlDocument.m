@@ -0,0 +1,910 @@
+//
+//  XmlDocument.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlDocument.h"
+#import "XmlDocumentElement.h"
+#import "Base64.h"
+#import "Logger.h"
+#import <libkern/OSAtomic.h>
+
+/// Initial capacity of the node table.
+#define NODE_TABLE_INITIAL_CAPACITY 64
+
+/// Initial capacity of the name hash table, must be a power of two.
+#define NAME_TABLE_INITIAL_CAPACITY 64
+
+/// Initial depth of the stack used while building node table.
+#define BUILD_STACK_INITIAL_CAPACITY 16
+
+/// Hash table entry used for interning names.
+struct XmlNameSlot {
+
+	int32_t name;
+	uint32_t hash;
+	uint32_t offset;
+	uint32_t length;
+};
+
+/// Open element while building node table.
+typedef struct XmlOpenElement {
+
+	int32_t node;
+	int32_t lastChild;
+	int32_t lastText;
+
+	/// Qualified name range, used to match the end tag.
+	uint32_t nameOffset;
+	uint32_t nameLength;
+
+} XmlOpenElement;
+
+/// Count of parsed documents.
+static volatile int32_t _parseCount = 0;
+
+#pragma mark Helpers
+
+/// Grows array if it has no room for one more item.
+static void *XmlEnsureCapacity(void *items, NSUInteger count, NSUInteger *capacity, size_t itemSize) {
+
+	if (count < *capacity) {
+		return items;
+	}
+
+	*capacity = *capacity ? *capacity * 2 : NODE_TABLE_INITIAL_CAPACITY;
+	return realloc(items, *capacity * itemSize);
+}
+
+static inline BOOL XmlIsSpace(uint8_t c) {
+
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline BOOL XmlIsNameEnd(uint8_t c) {
+
+	return XmlIsSpace(c) || c == '>' || c == '/' || c == '=';
+}
+
+/// Finds pattern in buffer.
+/// @returns pointer to the first pattern occurrence or NULL.
+static const uint8_t *XmlFind(const uint8_t *p, const uint8_t *end, const char *pattern, size_t patternLength) {
+
+	for (; p + patternLength <= end; p++) {
+
+		if (*p == (uint8_t)pattern[0] && memcmp(p, pattern, patternLength) == 0) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/// Finds the end of start tag, '>' characters inside attribute values are skipped.
+/// @returns pointer to the closing '>' or NULL if the tag is not complete.
+static const uint8_t *XmlFindTagEnd(const uint8_t *p, const uint8_t *end) {
+
+	for (; p < end; p++) {
+
+		if (*p == '>') {
+			return p;
+		}
+
+		if (*p == '"' || *p == '\'') {
+
+			p = memchr(p + 1, *p, end - p - 1);
+			if (!p) {
+				return NULL;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/// Writes unicode code point as UTF-8.
+/// @returns count of bytes written.
+static NSUInteger XmlWriteUtf8(uint32_t c, uint8_t *out) {
+
+	if (c < 0x80) {
+		out[0] = c;
+		return 1;
+	}
+	if (c < 0x800) {
+		out[0] = 0xC0 | (c >> 6);
+		out[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+	if (c < 0x10000) {
+		out[0] = 0xE0 | (c >> 12);
+		out[1] = 0x80 | ((c >> 6) & 0x3F);
+		out[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (c >> 18);
+	out[1] = 0x80 | ((c >> 12) & 0x3F);
+	out[2] = 0x80 | ((c >> 6) & 0x3F);
+	out[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+/// Replaces entity and character references.
+/// Decoded text is never longer than the source one.
+/// @returns length of decoded text.
+static NSUInteger XmlDecode(const uint8_t *p, NSUInteger length, uint8_t *out) {
+
+	const uint8_t *end = p + length;
+	uint8_t *start = out;
+
+	while (p < end) {
+
+		if (*p != '&') {
+			*out++ = *p++;
+			continue;
+		}
+
+		const uint8_t *semicolon = memchr(p, ';', end - p);
+		NSUInteger entityLength = semicolon ? semicolon - p + 1 : 0;
+
+		if (entityLength == 4 && memcmp(p, "&lt;", 4) == 0) {
+			*out++ = '<';
+		}
+		else if (entityLength == 4 && memcmp(p, "&gt;", 4) == 0) {
+			*out++ = '>';
+		}
+		else if (entityLength == 5 && memcmp(p, "&amp;", 5) == 0) {
+			*out++ = '&';
+		}
+		else if (entityLength == 6 && memcmp(p, "&quot;", 6) == 0) {
+			*out++ = '"';
+		}
+		else if (entityLength == 6 && memcmp(p, "&apos;", 6) == 0) {
+			*out++ = '\'';
+		}
+		else if (entityLength > 3 && p[1] == '#') {
+
+			BOOL hex = (p[2] == 'x' || p[2] == 'X');
+			uint32_t c = (uint32_t)strtoul((const char *)p + (hex ? 3 : 2), NULL, hex ? 16 : 10);
+			out += XmlWriteUtf8(c, out);
+		}
+		else {
+
+			// unknown entity, keep it as is
+			*out++ = *p++;
+			continue;
+		}
+
+		p += entityLength;
+	}
+
+	return out - start;
+}
+
+/// Creates string from UTF-8 bytes.
+/// Bytes which are not valid UTF-8 are decoded as Latin-1, so malformed input yields a lossy string instead of nil.
+/// @returns new string, caller is responsible for releasing it.
+static NSMutableString *XmlCreateStringWithBytes(const uint8_t *p, NSUInteger length) {
+
+	NSMutableString *result = [[NSMutableString alloc] initWithBytes: p length: length encoding: NSUTF8StringEncoding];
+
+	if (!result) {
+		result = [[NSMutableString alloc] initWithBytes: p length: length encoding: NSISOLatin1StringEncoding];
+	}
+
+	return result;
+}
+
+/// Creates string from the buffer range.
+/// @param escaped - YES if the range contains entity references.
+/// @returns new string, caller is responsible for releasing it.
+static NSMutableString *XmlCreateString(const uint8_t *p, NSUInteger length, BOOL escaped) {
+
+	if (!escaped) {
+		return XmlCreateStringWithBytes(p, length);
+	}
+
+	uint8_t *decoded = malloc(length);
+	NSUInteger decodedLength = XmlDecode(p, length, decoded);
+	NSMutableString *result = XmlCreateStringWithBytes(decoded, decodedLength);
+	free(decoded);
+
+	return result;
+}
+
+#pragma mark Helpers End
+
+@interface XmlDocument (Private)
+
+/// Allocates tables used while building node table.
+- (void)prepareParsing;
+
+/// Builds node table from the part of the buffer which has not been parsed yet.
+/// @param isFinal - YES if no more data will be appended, incomplete tokens are reported as errors then.
+/// @returns NO if the xml is not valid.
+- (BOOL)parse: (BOOL)isFinal;
+
+/// Returns index of the name, adds the name to the table if it is met for the first time.
+/// @param offset - name offset in the buffer.
+/// @param length - name length.
+- (int32_t)internName: (uint32_t)offset length: (uint32_t)length;
+
+/// Adds text segment to the open element.
+- (void)addText: (uint32_t)offset
+		 length: (uint32_t)length
+		escaped: (BOOL)escaped
+		   into: (XmlOpenElement *)element;
+
+@end
+
+@implementation XmlDocument
+
+@synthesize data = _data;
+@synthesize nodeCount = _nodeCount;
+
++ (NSUInteger)parseCount {
+
+	return _parseCount;
+}
+
++ (XmlDocument *)documentWithString: (NSString *)xml {
+
+	return [self documentWithData: [xml dataUsingEncoding: NSUTF8StringEncoding]];
+}
+
++ (XmlDocument *)documentWithData: (NSData *)data {
+
+	return [[[XmlDocument alloc] initWithData: data] autorelease];
+}
+
+- (id)initWithData: (NSData *)data {
+
+	if ((self = [super init])) {
+
+		_data = [data retain];
+		[self prepareParsing];
+
+		if (!data || ![self finishParsing]) {
+
+			TraceComponentError(@"XmlDocument", @"%@", @"Document parsing has failed");
+			[self release];
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+- (id)initWithGrowingData: (NSMutableData *)data {
+
+	if ((self = [super init])) {
+
+		_data = [data retain];
+		[self prepareParsing];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	free(_nodes);
+	free(_attributes);
+	free(_texts);
+	free(_nameSlots);
+	free(_elements);
+	free(_openElements);
+
+	[_names release];
+	[_nameIndexes release];
+	[_data release];
+
+	[super dealloc];
+}
+
+- (void)prepareParsing {
+
+	_names = [NSMutableArray new];
+	_nameIndexes = [NSMutableDictionary new];
+
+	_nameSlotCapacity = NAME_TABLE_INITIAL_CAPACITY;
+	_nameSlots = malloc(_nameSlotCapacity * sizeof(struct XmlNameSlot));
+	memset(_nameSlots, 0xFF, _nameSlotCapacity * sizeof(struct XmlNameSlot));
+
+	_openElementCapacity = BUILD_STACK_INITIAL_CAPACITY;
+	_openElements = malloc(_openElementCapacity * sizeof(XmlOpenElement));
+
+	OSAtomicIncrement32(&_parseCount);
+}
+
+- (BOOL)parseAppendedData {
+
+	if (_isInvalid) {
+		return NO;
+	}
+
+	return [self parse: NO];
+}
+
+- (BOOL)finishParsing {
+
+	if (_isInvalid || _elements) {
+		return !_isInvalid;
+	}
+
+	if (![self parse: YES]) {
+		return NO;
+	}
+
+	free(_openElements);
+	_openElements = NULL;
+
+	_elements = calloc(_nodeCount, sizeof(XmlElement *));
+
+	return YES;
+}
+
+- (BOOL)parse: (BOOL)isFinal {
+
+	const uint8_t *bytes = _data.bytes;
+	const uint8_t *end = bytes + _data.length;
+	const uint8_t *p = bytes + _parseOffset;
+
+	// beginning of the current token, parsing resumes from here if the token is not complete yet
+	const uint8_t *token = p;
+
+	while (p < end) {
+
+		token = p;
+
+		if (*p != '<') {
+
+			// character data, text which is not terminated yet is added as is and
+			// merged with its continuation when the next chunk arrives
+			const uint8_t *textEnd = memchr(p, '<', end - p);
+			if (!textEnd) {
+				textEnd = end;
+			}
+
+			if (_depth > 0) {
+
+				BOOL escaped = memchr(p, '&', textEnd - p) != NULL;
+				[self addText: p - bytes length: textEnd - p escaped: escaped into: &_openElements[_depth - 1]];
+			}
+			else {
+
+				// only white space is allowed outside of the root element
+				for (; p < textEnd; p++) {
+					if (!XmlIsSpace(*p)) goto fail;
+				}
+			}
+
+			p = textEnd;
+			continue;
+		}
+
+		if (p + 1 >= end) goto more;
+
+		if (p[1] == '?') {
+
+			// processing instruction or xml declaration
+			const uint8_t *close = XmlFind(p + 2, end, "?>", 2);
+			if (!close) goto more;
+			p = close + 2;
+			continue;
+		}
+
+		if (p[1] == '!') {
+
+			if (end - p < 4) goto more;
+
+			if (memcmp(p, "<!--", 4) == 0) {
+
+				const uint8_t *close = XmlFind(p + 4, end, "-->", 3);
+				if (!close) goto more;
+				p = close + 3;
+			}
+			else if (p[2] == '[') {
+
+				if (end - p < 9) goto more;
+				if (memcmp(p, "<![CDATA[", 9) != 0 || _depth == 0) goto fail;
+
+				const uint8_t *cdataEnd = XmlFind(p + 9, end, "]]>", 3);
+				if (!cdataEnd) goto more;
+
+				[self addText: p + 9 - bytes length: cdataEnd - p - 9 escaped: NO into: &_openElements[_depth - 1]];
+				p = cdataEnd + 3;
+			}
+			else {
+
+				// document type declaration, internal subset is skipped as a whole
+				const uint8_t *subset = memchr(p, '[', end - p);
+				const uint8_t *close = memchr(p, '>', end - p);
+				if (!close) goto more;
+
+				if (subset && subset < close) {
+					close = XmlFind(subset, end, "]>", 2);
+					if (!close) goto more;
+					close++;
+				}
+				p = close + 1;
+			}
+			continue;
+		}
+
+		if (p[1] == '/') {
+
+			// end tag
+			const uint8_t *nameStart = p + 2;
+			const uint8_t *nameEnd = nameStart;
+			while (nameEnd < end && !XmlIsNameEnd(*nameEnd)) nameEnd++;
+
+			const uint8_t *close = memchr(nameEnd, '>', end - nameEnd);
+			if (!close) goto more;
+			if (_depth == 0) goto fail;
+
+			XmlOpenElement *open = &_openElements[_depth - 1];
+			if (open->nameLength != nameEnd - nameStart ||
+				memcmp(bytes + open->nameOffset, nameStart, open->nameLength) != 0) {
+				goto fail;
+			}
+
+			_depth--;
+			p = close + 1;
+
+			XmlNodeRecord *closed = &_nodes[open->node];
+			closed->length = (p - bytes) - closed->offset;
+			continue;
+		}
+
+		// start tag, it is parsed only when it has been received completely
+		const uint8_t *tagEnd = XmlFindTagEnd(p + 1, end);
+		if (!tagEnd) goto more;
+		tagEnd++;
+
+		const uint8_t *nameStart = p + 1;
+		const uint8_t *nameEnd = nameStart;
+		while (nameEnd < tagEnd && !XmlIsNameEnd(*nameEnd)) nameEnd++;
+
+		if (nameEnd == nameStart) goto fail;
+
+		// only one root element is allowed
+		if (_depth == 0 && _nodeCount > 0) goto fail;
+
+		// local name is used as element name
+		const uint8_t *localName = nameStart;
+		for (const uint8_t *c = nameStart; c < nameEnd; c++) {
+			if (*c == ':') localName = c + 1;
+		}
+
+		_nodes = XmlEnsureCapacity(_nodes, _nodeCount, &_nodeCapacity, sizeof(XmlNodeRecord));
+
+		int32_t nodeIndex = (int32_t)_nodeCount++;
+		XmlNodeRecord *node = &_nodes[nodeIndex];
+		node->name = [self internName: localName - bytes length: nameEnd - localName];
+		node->parent = XML_NODE_NONE;
+		node->firstChild = XML_NODE_NONE;
+		node->nextSibling = XML_NODE_NONE;
+		node->firstAttribute = (int32_t)_attributeCount;
+		node->attributeCount = 0;
+		node->firstText = XML_NODE_NONE;
+		node->offset = p - bytes;
+		node->length = 0;
+
+		if (_depth > 0) {
+
+			XmlOpenElement *parent = &_openElements[_depth - 1];
+			node->parent = parent->node;
+
+			if (parent->lastChild == XML_NODE_NONE) {
+				_nodes[parent->node].firstChild = nodeIndex;
+			}
+			else {
+				_nodes[parent->lastChild].nextSibling = nodeIndex;
+			}
+			parent->lastChild = nodeIndex;
+		}
+
+		// attributes
+		p = nameEnd;
+		BOOL isEmpty = NO;
+
+		while (YES) {
+
+			while (p < tagEnd && XmlIsSpace(*p)) p++;
+			if (p >= tagEnd) goto fail;
+
+			if (*p == '>') {
+				p++;
+				break;
+			}
+
+			if (*p == '/') {
+				if (p + 1 >= tagEnd || p[1] != '>') goto fail;
+				isEmpty = YES;
+				p += 2;
+				break;
+			}
+
+			const uint8_t *attributeName = p;
+			while (p < tagEnd && !XmlIsNameEnd(*p)) p++;
+			const uint8_t *attributeNameEnd = p;
+
+			while (p < tagEnd && XmlIsSpace(*p)) p++;
+			if (p >= tagEnd || *p != '=' || attributeNameEnd == attributeName) goto fail;
+			p++;
+			while (p < tagEnd && XmlIsSpace(*p)) p++;
+			if (p >= tagEnd || (*p != '"' && *p != '\'')) goto fail;
+
+			const uint8_t *valueStart = p + 1;
+			const uint8_t *valueEnd = memchr(valueStart, *p, tagEnd - valueStart);
+			if (!valueEnd) goto fail;
+			p = valueEnd + 1;
+
+			// namespace declarations are not reported as attributes
+			NSUInteger attributeNameLength = attributeNameEnd - attributeName;
+			if ((attributeNameLength == 5 && memcmp(attributeName, "xmlns", 5) == 0) ||
+				(attributeNameLength > 5 && memcmp(attributeName, "xmlns:", 6) == 0)) {
+				continue;
+			}
+
+			_attributes = XmlEnsureCapacity(_attributes, _attributeCount, &_attributeCapacity, sizeof(XmlAttributeRecord));
+
+			XmlAttributeRecord *attribute = &_attributes[_attributeCount++];
+			attribute->name = [self internName: attributeName - bytes length: attributeNameLength];
+			attribute->offset = valueStart - bytes;
+			attribute->length = valueEnd - valueStart;
+			attribute->escaped = memchr(valueStart, '&', valueEnd - valueStart) != NULL;
+
+			// node pointer could be moved by realloc of node table only, so it is still valid here
+			node->attributeCount++;
+		}
+
+		if (isEmpty) {
+			node->length = (p - bytes) - node->offset;
+		}
+		else {
+
+			if (_depth == _openElementCapacity) {
+				_openElementCapacity *= 2;
+				_openElements = realloc(_openElements, _openElementCapacity * sizeof(XmlOpenElement));
+			}
+
+			XmlOpenElement *open = &_openElements[_depth++];
+			open->node = nodeIndex;
+			open->lastChild = XML_NODE_NONE;
+			open->lastText = XML_NODE_NONE;
+			open->nameOffset = nameStart - bytes;
+			open->nameLength = nameEnd - nameStart;
+		}
+	}
+
+	_parseOffset = p - bytes;
+
+	if (isFinal && (_depth > 0 || _nodeCount == 0)) goto fail;
+
+	return YES;
+
+more:
+	// the token is completed by the next chunk
+	if (isFinal) goto fail;
+
+	_parseOffset = token - bytes;
+
+	return YES;
+
+fail:
+	_isInvalid = YES;
+
+	return NO;
+}
+
+- (int32_t)internName: (uint32_t)offset length: (uint32_t)length {
+
+	const uint8_t *bytes = (const uint8_t *)_data.bytes + offset;
+
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < length; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	NSUInteger mask = _nameSlotCapacity - 1;
+	NSUInteger slot = hash & mask;
+
+	while (_nameSlots[slot].name != XML_NODE_NONE) {
+
+		struct XmlNameSlot *entry = &_nameSlots[slot];
+		if (entry->hash == hash && entry->length == length &&
+			memcmp((const uint8_t *)_data.bytes + entry->offset, bytes, length) == 0) {
+
+			return entry->name;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	// new name
+	int32_t nameIndex = (int32_t)_names.count;
+
+	NSString *name = [[NSString alloc] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding];
+	[_names addObject: name];
+	[_nameIndexes setObject: [NSNumber numberWithInt: nameIndex] forKey: name];
+	[name release];
+
+	struct XmlNameSlot *entry = &_nameSlots[slot];
+	entry->name = nameIndex;
+	entry->hash = hash;
+	entry->offset = offset;
+	entry->length = length;
+
+	// keep load factor below one half
+	if (_names.count * 2 > _nameSlotCapacity) {
+
+		NSUInteger oldCapacity = _nameSlotCapacity;
+		struct XmlNameSlot *oldSlots = _nameSlots;
+
+		_nameSlotCapacity *= 2;
+		_nameSlots = malloc(_nameSlotCapacity * sizeof(struct XmlNameSlot));
+		memset(_nameSlots, 0xFF, _nameSlotCapacity * sizeof(struct XmlNameSlot));
+		mask = _nameSlotCapacity - 1;
+
+		for (NSUInteger i = 0; i < oldCapacity; i++) {
+
+			if (oldSlots[i].name == XML_NODE_NONE) continue;
+
+			slot = oldSlots[i].hash & mask;
+			while (_nameSlots[slot].name != XML_NODE_NONE) {
+				slot = (slot + 1) & mask;
+			}
+			_nameSlots[slot] = oldSlots[i];
+		}
+
+		free(oldSlots);
+	}
+
+	return nameIndex;
+}
+
+- (void)addText: (uint32_t)offset
+		 length: (uint32_t)length
+		escaped: (BOOL)escaped
+		   into: (XmlOpenElement *)element {
+
+	// text split between two received chunks continues the previous segment
+	if (element->lastText != XML_NODE_NONE) {
+
+		XmlTextRecord *last = &_texts[element->lastText];
+		if (last->offset + last->length == offset) {
+
+			last->length += length;
+			last->escaped = last->escaped || escaped;
+			return;
+		}
+	}
+
+	_texts = XmlEnsureCapacity(_texts, _textCount, &_textCapacity, sizeof(XmlTextRecord));
+
+	int32_t textIndex = (int32_t)_textCount++;
+	XmlTextRecord *text = &_texts[textIndex];
+	text->offset = offset;
+	text->length = length;
+	text->escaped = escaped;
+	text->next = XML_NODE_NONE;
+
+	if (element->lastText == XML_NODE_NONE) {
+		_nodes[element->node].firstText = textIndex;
+	}
+	else {
+		_texts[element->lastText].next = textIndex;
+	}
+	element->lastText = textIndex;
+}
+
+#pragma mark Node Access
+
+- (XmlElement *)rootElement {
+
+	return [self elementAtIndex: 0];
+}
+
+- (XmlElement *)elementAtIndex: (NSInteger)index {
+
+	if (index < 0 || (NSUInteger)index >= _nodeCount) {
+		return nil;
+	}
+
+	XmlElement *element = _elements[index];
+
+	if (element) {
+		return [[element retain] autorelease];
+	}
+
+	element = [[XmlDocumentElement alloc] initWithDocument: self index: index];
+	_elements[index] = element;
+
+	return [element autorelease];
+}
+
+- (void)elementReleased: (NSInteger)index {
+
+	_elements[index] = nil;
+}
+
+- (const XmlNodeRecord *)nodeAtIndex: (NSInteger)index {
+
+	return &_nodes[index];
+}
+
+- (NSString *)nameAtIndex: (NSInteger)index {
+
+	return [_names objectAtIndex: index];
+}
+
+- (NSInteger)indexOfName: (NSString *)name {
+
+	NSNumber *index = name ? [_nameIndexes objectForKey: name] : nil;
+
+	return index ? [index intValue] : XML_NODE_NONE;
+}
+
+- (NSMutableString *)textOfNode: (NSInteger)index {
+
+	int32_t textIndex = _nodes[index].firstText;
+
+	if (textIndex == XML_NODE_NONE) {
+		return nil;
+	}
+
+	const uint8_t *bytes = _data.bytes;
+	XmlTextRecord *text = &_texts[textIndex];
+	NSMutableString *result = XmlCreateString(bytes + text->offset, text->length, text->escaped);
+
+	// text interrupted by child elements, comments or CDATA sections
+	for (textIndex = text->next; textIndex != XML_NODE_NONE; textIndex = text->next) {
+
+		text = &_texts[textIndex];
+		NSString *segment = XmlCreateString(bytes + text->offset, text->length, text->escaped);
+		[result appendString: segment];
+		[segment release];
+	}
+
+	return [result autorelease];
+}
+
+- (NSData *)base64DataOfNode: (NSInteger)index {
+
+	const uint8_t *bytes = _data.bytes;
+	NSUInteger length = 0;
+
+	for (int32_t textIndex = _nodes[index].firstText; textIndex != XML_NODE_NONE; textIndex = _texts[textIndex].next) {
+		length += _texts[textIndex].length;
+	}
+
+	Base64Decoder *decoder = [[Base64Decoder alloc] initWithCapacity: length / 4 * 3];
+
+	for (int32_t textIndex = _nodes[index].firstText; textIndex != XML_NODE_NONE; textIndex = _texts[textIndex].next) {
+
+		XmlTextRecord *text = &_texts[textIndex];
+
+		if (text->escaped) {
+
+			// character references are unusual in base64 text, such segments are decoded through a string
+			NSString *segment = XmlCreateString(bytes + text->offset, text->length, YES);
+			[decoder decodeString: segment];
+			[segment release];
+		}
+		else {
+
+			[decoder decodeBytes: bytes + text->offset length: text->length];
+		}
+	}
+
+	NSData *data = [[decoder finish] retain];
+	[decoder release];
+
+	return [data autorelease];
+}
+
+- (NSString *)attribute: (NSString *)name ofNode: (NSInteger)index {
+
+	return [self attributeWithNameIndex: [self indexOfName: name] ofNode: index];
+}
+
+- (NSString *)attributeWithNameIndex: (NSInteger)nameIndex ofNode: (NSInteger)index {
+
+	if (nameIndex == XML_NODE_NONE) {
+		return nil;
+	}
+
+	XmlNodeRecord *node = &_nodes[index];
+
+	for (int32_t i = 0; i < node->attributeCount; i++) {
+
+		XmlAttributeRecord *attribute = &_attributes[node->firstAttribute + i];
+
+		if (attribute->name == nameIndex) {
+
+			NSString *value = XmlCreateString((const uint8_t *)_data.bytes + attribute->offset, attribute->length, attribute->escaped);
+			return [value autorelease];
+		}
+	}
+
+	return nil;
+}
+
+- (NSMutableDictionary *)attributesOfNode: (NSInteger)index {
+
+	XmlNodeRecord *node = &_nodes[index];
+	NSMutableDictionary *attributes = [NSMutableDictionary dictionaryWithCapacity: node->attributeCount];
+
+	for (int32_t i = 0; i < node->attributeCount; i++) {
+
+		XmlAttributeRecord *attribute = &_attributes[node->firstAttribute + i];
+		NSString *value = XmlCreateString((const uint8_t *)_data.bytes + attribute->offset, attribute->length, attribute->escaped);
+
+		[attributes setObject: value forKey: [_names objectAtIndex: attribute->name]];
+		[value release];
+	}
+
+	return attributes;
+}
+
+- (NSString *)xmlOfNode: (NSInteger)index {
+
+	XmlNodeRecord *node = &_nodes[index];
+	NSString *xml = XmlCreateStringWithBytes((const uint8_t *)_data.bytes + node->offset, node->length);
+
+	return [xml autorelease];
+}
+
+- (NSInteger)child: (NSString *)name at: (NSInteger)position ofNode: (NSInteger)index {
+
+	NSInteger nameIndex = [self indexOfName: name];
+
+	if (nameIndex == XML_NODE_NONE) {
+		return XML_NODE_NONE;
+	}
+
+	for (int32_t child = _nodes[index].firstChild; child != XML_NODE_NONE; child = _nodes[child].nextSibling) {
+
+		if (_nodes[child].name == nameIndex && position-- == 0) {
+			return child;
+		}
+	}
+
+	return XML_NODE_NONE;
+}
+
+- (NSInteger)childWithNameIndex: (NSInteger)nameIndex after: (NSInteger)previous ofNode: (NSInteger)index {
+
+	if (nameIndex == XML_NODE_NONE) {
+		return XML_NODE_NONE;
+	}
+
+	int32_t child = previous == XML_NODE_NONE ? _nodes[index].firstChild : _nodes[previous].nextSibling;
+
+	for (; child != XML_NODE_NONE; child = _nodes[child].nextSibling) {
+
+		if (_nodes[child].name == nameIndex) {
+			return child;
+		}
+	}
+
+	return XML_NODE_NONE;
+}
+
+#pragma mark Node Access End
+
+@end
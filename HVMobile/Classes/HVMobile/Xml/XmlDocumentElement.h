@@ -0,0 +1,48 @@
+//
+//  XmlDocumentElement.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "XmlElement.h"
+
+@class XmlDocument;
+
+/// Represents a node of XmlDocument through XmlElement interface.
+/// Name, text, attributes and children are read from the document node table on demand;
+/// xml is the range of the element in the document buffer, so it keeps document order.
+@interface XmlDocumentElement : XmlElement {
+
+	/// Owner document.
+	XmlDocument *_document;
+
+	/// Node index in the document.
+	NSInteger _index;
+}
+
+/// Gets owner document.
+@property (readonly) XmlDocument *document;
+
+/// Gets node index in the document.
+@property (readonly) NSInteger index;
+
+/// Initializes a new instance of the XmlDocumentElement class.
+/// @param document - owner document.
+/// @param index - node index.
+- (id)initWithDocument: (XmlDocument *)document
+				 index: (NSInteger)index;
+
+@end
@@ -0,0 +1,260 @@
+//
+//  XmlDocumentElement.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlDocumentElement.h"
+#import "XmlDocument.h"
+#import "XmlPath.h"
+
+@interface XmlDocumentElement (Private)
+
+/// Returns index of the first node at the path, without creating elements for the steps.
+/// @param path - the path.
+/// @returns node index or XML_NODE_NONE.
+- (NSInteger)nodeAtPath: (XmlPath *)path;
+
+/// Adds elements at the steps of the path, starting with the given step, to the array.
+/// @param nameIndexes - name indexes of the steps.
+/// @param count - count of steps.
+/// @param node - index of the node the first step is matched against.
+/// @param nodes - the array to add to.
+- (void)collectNodesWithNameIndexes: (const NSInteger *)nameIndexes
+							  count: (NSUInteger)count
+							 ofNode: (NSInteger)node
+							   into: (NSMutableArray *)nodes;
+
+@end
+
+@implementation XmlDocumentElement
+
+@synthesize document = _document;
+@synthesize index = _index;
+
+- (id)initWithDocument: (XmlDocument *)document
+				 index: (NSInteger)index {
+
+	if ((self = [super init])) {
+
+		_document = [document retain];
+		_index = index;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_document elementReleased: _index];
+	[_document release];
+
+	[super dealloc];
+}
+
+- (NSString *)name {
+
+	if (!_name) {
+		_name = [[_document nameAtIndex: [_document nodeAtIndex: _index]->name] retain];
+	}
+
+	return _name;
+}
+
+- (NSMutableString *)text {
+
+	if (!_text) {
+		_text = [[_document textOfNode: _index] retain];
+	}
+
+	return _text;
+}
+
+- (NSMutableDictionary *)attributes {
+
+	if (!_attributes) {
+		_attributes = [[_document attributesOfNode: _index] retain];
+	}
+
+	return _attributes;
+}
+
+- (NSMutableDictionary *)children {
+
+	if (!_children) {
+
+		_children = [NSMutableDictionary new];
+
+		for (NSInteger child = [_document nodeAtIndex: _index]->firstChild; child != XML_NODE_NONE;
+			 child = [_document nodeAtIndex: child]->nextSibling) {
+
+			XmlElement *element = [_document elementAtIndex: child];
+			NSMutableArray *children = [_children objectForKey: element.name];
+
+			if (children == nil) {
+
+				children = [NSMutableArray new];
+				[_children setObject: children forKey: element.name];
+				[children release];
+			}
+
+			[children addObject: element];
+		}
+	}
+
+	return _children;
+}
+
+- (NSString *)xml {
+
+	return [_document xmlOfNode: _index];
+}
+
+- (NSArray *)selectNodes: (NSString *)elementname {
+
+	NSInteger nameIndex = [_document indexOfName: elementname];
+
+	if (nameIndex == XML_NODE_NONE) {
+		return nil;
+	}
+
+	NSMutableArray *nodes = nil;
+
+	for (NSInteger child = [_document nodeAtIndex: _index]->firstChild; child != XML_NODE_NONE;
+		 child = [_document nodeAtIndex: child]->nextSibling) {
+
+		if ([_document nodeAtIndex: child]->name == nameIndex) {
+
+			if (!nodes) {
+				nodes = [NSMutableArray array];
+			}
+			[nodes addObject: [_document elementAtIndex: child]];
+		}
+	}
+
+	return nodes;
+}
+
+- (XmlElement *)selectSingleNode: (NSString *)elementname at: (NSInteger)position {
+
+	NSInteger child = [_document child: elementname at: position ofNode: _index];
+
+	return [_document elementAtIndex: child];
+}
+
+- (XmlElement *)selectSingleNodeAtPath: (XmlPath *)path {
+
+	return [_document elementAtIndex: [self nodeAtPath: path]];
+}
+
+- (NSArray *)selectNodesAtPath: (XmlPath *)path {
+
+	NSUInteger count = path.steps.count;
+
+	if (count == 0) {
+		return [NSArray arrayWithObject: self];
+	}
+
+	NSInteger *nameIndexes = malloc(count * sizeof(NSInteger));
+
+	for (NSUInteger i = 0; i < count; i++) {
+
+		nameIndexes[i] = [_document indexOfName: [path.steps objectAtIndex: i]];
+
+		if (nameIndexes[i] == XML_NODE_NONE) {
+
+			free(nameIndexes);
+			return nil;
+		}
+	}
+
+	NSMutableArray *nodes = [NSMutableArray array];
+	[self collectNodesWithNameIndexes: nameIndexes count: count ofNode: _index into: nodes];
+	free(nameIndexes);
+
+	return nodes.count > 0 ? nodes : nil;
+}
+
+- (NSString *)valueAtPath: (XmlPath *)path {
+
+	NSInteger node = [self nodeAtPath: path];
+
+	if (node == XML_NODE_NONE) {
+		return nil;
+	}
+
+	if (path.attributeName) {
+		return [_document attribute: path.attributeName ofNode: node];
+	}
+
+	return [_document textOfNode: node];
+}
+
+- (NSString *)attrValue: (NSString *)attributename {
+
+	if (_attributes) {
+		return [_attributes objectForKey: attributename];
+	}
+
+	return [_document attribute: attributename ofNode: _index];
+}
+
+- (NSData *)base64Value {
+
+	// decoded straight from the document buffer unless text has already been requested
+	if (_text) {
+		return [super base64Value];
+	}
+
+	return [_document base64DataOfNode: _index];
+}
+
+#pragma mark Private
+
+- (NSInteger)nodeAtPath: (XmlPath *)path {
+
+	NSInteger node = _index;
+
+	for (NSString *step in path.steps) {
+
+		node = [_document childWithNameIndex: [_document indexOfName: step] after: XML_NODE_NONE ofNode: node];
+
+		if (node == XML_NODE_NONE) break;
+	}
+
+	return node;
+}
+
+- (void)collectNodesWithNameIndexes: (const NSInteger *)nameIndexes
+							  count: (NSUInteger)count
+							 ofNode: (NSInteger)node
+							   into: (NSMutableArray *)nodes {
+
+	for (NSInteger child = [_document childWithNameIndex: nameIndexes[0] after: XML_NODE_NONE ofNode: node];
+		 child != XML_NODE_NONE;
+		 child = [_document childWithNameIndex: nameIndexes[0] after: child ofNode: node]) {
+
+		if (count == 1) {
+			[nodes addObject: [_document elementAtIndex: child]];
+		}
+		else {
+			[self collectNodesWithNameIndexes: nameIndexes + 1 count: count - 1 ofNode: child into: nodes];
+		}
+	}
+}
+
+#pragma mark Private End
+
+@end
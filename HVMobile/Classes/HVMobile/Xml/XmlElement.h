@@ -18,6 +18,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class XmlPath;
+
 /// Represents xml tree node.
 @interface XmlElement : NSObject {
 
@@ -52,6 +54,8 @@
 - (NSArray *)selectNodes: (NSString *)name;
 
 /// Returns the child node with the given name 
+/// The name may be a path of names separated by '/', it is split on every call,
+/// so paths which are read repeatedly should be compiled into XmlPath.
 /// @param name - child name.
 /// @returns the first occurrence if there is more than one.
 - (XmlElement *)selectSingleNode: (NSString *)name;
@@ -62,9 +66,33 @@
 /// @returns the nth child with the given name.
 - (XmlElement *)selectSingleNode: (NSString *)name at: (NSInteger)position;
 
+/// Returns the first element at the path; an attribute the path ends with is ignored.
+/// @param path - compiled path.
+/// @returns the element or nil if there is none.
+- (XmlElement *)selectSingleNodeAtPath: (XmlPath *)path;
+
+/// Returns all elements at the path, in document order.
+/// @param path - compiled path; an attribute it ends with is ignored.
+/// @returns array of elements or nil if there are none.
+- (NSArray *)selectNodesAtPath: (XmlPath *)path;
+
+/// Returns text of the first element at the path or value of the attribute the path ends with.
+/// @param path - compiled path.
+/// @returns the value or nil if there is no such node.
+- (NSString *)valueAtPath: (XmlPath *)path;
+
 /// Returns attribute value.
 /// @param name - attribute name.
 /// @returns attribute value.
 - (NSString *)attrValue: (NSString *)name;
 
+/// Decodes element inner text as base64.
+/// @returns decoded data or nil if the text is not valid base64.
+- (NSData *)base64Value;
+
+/// Writes the element with its attributes and children as xml.
+/// Children with the same name keep their order, groups of children with different names don't.
+/// @returns xml text of the element.
+- (NSString *)xml;
+
 @end
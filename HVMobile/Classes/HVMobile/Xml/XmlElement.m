@@ -17,6 +17,29 @@
 // limitations under the License.
 
 #import "XmlElement.h"
+#import "XmlPath.h"
+#import "Base64.h"
+
+
+@interface XmlElement (Private)
+
+/// Appends xml text of the element.
+/// @param xml - the string to append to.
+- (void)appendXml: (NSMutableString *)xml;
+
+/// Adds elements at the steps of the path, starting with the given step, to the array.
+/// @param path - the path.
+/// @param step - index of the step the children of the element are matched against.
+/// @param nodes - the array to add to.
+- (void)collectNodesAtPath: (XmlPath *)path step: (NSUInteger)step into: (NSMutableArray *)nodes;
+
+/// Appends text with xml special characters escaped.
+/// @param text - the text.
+/// @param xml - the string to append to.
++ (void)appendEscapedText: (NSString *)text toXml: (NSMutableString *)xml;
+
+@end
+
 
 @implementation XmlElement
 
@@ -40,7 +63,7 @@
 
 - (NSArray *)selectNodes: (NSString *)elementname {
 
-	return [self.children valueForKey: elementname];
+	return [self.children objectForKey: elementname];
 }
 
 - (XmlElement *)selectSingleNode: (NSString *)elementname at: (NSInteger)position {
@@ -56,7 +79,11 @@
 }
 
 - (XmlElement *)selectSingleNode: (NSString *)elementname {
-	
+
+	if ([elementname rangeOfString: @"/"].location == NSNotFound) {
+		return [self selectSingleNode: elementname at: 0];
+	}
+
 	NSArray *parts = [elementname componentsSeparatedByString: @"/"];
 	XmlElement *current = self;
 	
@@ -70,9 +97,129 @@
 	return current;
 }
 
+- (XmlElement *)selectSingleNodeAtPath: (XmlPath *)path {
+
+	XmlElement *current = self;
+
+	for (NSString *step in path.steps) {
+
+		current = [current selectSingleNode: step at: 0];
+
+		if (!current) return nil;
+	}
+
+	return current;
+}
+
+- (NSArray *)selectNodesAtPath: (XmlPath *)path {
+
+	if (path.steps.count == 0) {
+		return [NSArray arrayWithObject: self];
+	}
+
+	NSMutableArray *nodes = [NSMutableArray array];
+	[self collectNodesAtPath: path step: 0 into: nodes];
+
+	return nodes.count > 0 ? nodes : nil;
+}
+
+- (void)collectNodesAtPath: (XmlPath *)path step: (NSUInteger)step into: (NSMutableArray *)nodes {
+
+	NSArray *children = [self selectNodes: [path.steps objectAtIndex: step]];
+
+	if (step + 1 == path.steps.count) {
+
+		[nodes addObjectsFromArray: children];
+		return;
+	}
+
+	for (XmlElement *child in children) {
+		[child collectNodesAtPath: path step: step + 1 into: nodes];
+	}
+}
+
+- (NSString *)valueAtPath: (XmlPath *)path {
+
+	XmlElement *element = [self selectSingleNodeAtPath: path];
+
+	return path.attributeName ? [element attrValue: path.attributeName] : element.text;
+}
+
 - (NSString *)attrValue: (NSString *)attributename {
 
-	return [self.attributes valueForKey: attributename];
+	return [self.attributes objectForKey: attributename];
+}
+
+- (NSData *)base64Value {
+
+	return [Base64 decodeBase64WithString: self.text];
+}
+
+- (NSString *)xml {
+
+	NSMutableString *xml = [NSMutableString string];
+	[self appendXml: xml];
+
+	return xml;
+}
+
+- (void)appendXml: (NSMutableString *)xml {
+
+	[xml appendFormat: @"<%@", self.name];
+
+	NSDictionary *attributes = self.attributes;
+	for (NSString *attributeName in attributes) {
+
+		[xml appendFormat: @" %@=\"", attributeName];
+		[XmlElement appendEscapedText: [attributes objectForKey: attributeName] toXml: xml];
+		[xml appendString: @"\""];
+	}
+
+	NSDictionary *children = self.children;
+	NSString *text = self.text;
+
+	if (children.count == 0 && text.length == 0) {
+
+		[xml appendString: @"/>"];
+		return;
+	}
+
+	[xml appendString: @">"];
+
+	// Text between child elements is whitespace only, so it is dropped.
+	if (children.count == 0) {
+
+		[XmlElement appendEscapedText: text toXml: xml];
+	}
+
+	for (NSString *childName in children) {
+		for (XmlElement *child in [children objectForKey: childName]) {
+			[child appendXml: xml];
+		}
+	}
+
+	[xml appendFormat: @"</%@>", self.name];
+}
+
++ (void)appendEscapedText: (NSString *)text toXml: (NSMutableString *)xml {
+
+	NSCharacterSet *specialCharacters = [NSCharacterSet characterSetWithCharactersInString: @"&<>\""];
+
+	if ([text rangeOfCharacterFromSet: specialCharacters].location == NSNotFound) {
+
+		[xml appendString: text];
+		return;
+	}
+
+	NSMutableString *escaped = [text mutableCopy];
+
+	[escaped replaceOccurrencesOfString: @"&" withString: @"&amp;" options: 0 range: NSMakeRange(0, escaped.length)];
+	[escaped replaceOccurrencesOfString: @"<" withString: @"&lt;" options: 0 range: NSMakeRange(0, escaped.length)];
+	[escaped replaceOccurrencesOfString: @">" withString: @"&gt;" options: 0 range: NSMakeRange(0, escaped.length)];
+	[escaped replaceOccurrencesOfString: @"\"" withString: @"&quot;" options: 0 range: NSMakeRange(0, escaped.length)];
+
+	[xml appendString: escaped];
+	[escaped release];
 }
 
 @end
@@ -0,0 +1,95 @@
+//
+//  XmlPath.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class XmlElement;
+
+/// Represents compiled path of child elements, optionally ending with an attribute,
+/// e.g. data-xml/weight/value/display or thing-id/@version-stamp.
+/// The path is split once when it is created; it is immutable, so one instance can be
+/// kept in a static variable and used from any thread.
+@interface XmlPath : NSObject {
+
+	NSString *_string;
+	NSArray *_steps;
+	NSString *_attributeName;
+}
+
+/// Gets the path text.
+@property (readonly) NSString *string;
+
+/// Gets names of the child elements, in order.
+@property (readonly) NSArray *steps;
+
+/// Gets name of the attribute the path ends with, nil if it ends with an element.
+@property (readonly) NSString *attributeName;
+
+/// Creates path.
+/// @param string - element names separated by '/', the last one may be an attribute name prefixed with '@'.
+/// @returns path or nil if the text isn't a valid path.
++ (XmlPath *)pathWithString: (NSString *)string;
+
+/// Initializes a new instance of the XmlPath class.
+/// @param string - element names separated by '/', the last one may be an attribute name prefixed with '@'.
+/// @returns path or nil if the text isn't a valid path.
+- (id)initWithString: (NSString *)string;
+
+@end
+
+
+/// Extracts values of a declared set of paths from elements, typically from every one
+/// of repeating elements such as things of a GetThings response.
+/// The paths are merged into a tree, so steps they share are walked once per element;
+/// for elements of XmlDocument the walk goes over the node table without creating
+/// intermediate elements. Extractor is immutable and can be used from any thread.
+@interface XmlPathExtractor : NSObject {
+
+	/// Tree of steps, the first one stands for the element values are extracted from.
+	struct XmlExtractorStep *_steps;
+	NSUInteger _stepCount;
+
+	NSUInteger _pathCount;
+
+	/// Paths which repeat an earlier one, they get a copy of its value.
+	NSUInteger *_duplicatePaths;
+	NSUInteger *_originalPaths;
+	NSUInteger _duplicateCount;
+}
+
+/// Gets count of paths, that is count of values extracted from every element.
+@property (readonly) NSUInteger count;
+
+/// Initializes a new instance of the XmlPathExtractor class.
+/// @param paths - paths relative to the elements, XmlPath objects or strings.
+/// @returns extractor or nil if a path isn't valid.
+- (id)initWithPaths: (NSArray *)paths;
+
+/// Extracts values of all paths from the element.
+/// The value of a path is text of its element or value of its attribute, nil if there is no such node.
+/// @param element - the element.
+/// @param values - buffer of count strings, filled in the order of paths; strings are autoreleased.
+- (void)extractValuesFrom: (XmlElement *)element values: (NSString **)values;
+
+/// Extracts values of all paths from every element.
+/// Names are looked up in the document once for all elements which belong to the same one.
+/// @param elements - the elements.
+/// @param values - buffer of elements.count * count strings, filled element after element.
+- (void)extractValuesFromElements: (NSArray *)elements values: (NSString **)values;
+
+@end
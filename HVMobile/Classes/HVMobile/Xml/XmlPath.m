@@ -0,0 +1,388 @@
+//
+//  XmlPath.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlPath.h"
+#import "XmlElement.h"
+#import "XmlDocument.h"
+#import "XmlDocumentElement.h"
+
+/// Step of the extractor tree.
+struct XmlExtractorStep {
+
+	/// Element or attribute name.
+	NSString *name;
+	BOOL isAttribute;
+
+	/// First child and next sibling step indexes, XML_NODE_NONE if there are none.
+	NSInteger firstChild;
+	NSInteger nextSibling;
+
+	/// Index of the path which ends with the step, XML_NODE_NONE if no path ends here.
+	NSInteger valueIndex;
+};
+
+@implementation XmlPath
+
+@synthesize string = _string;
+@synthesize steps = _steps;
+@synthesize attributeName = _attributeName;
+
++ (XmlPath *)pathWithString: (NSString *)string {
+
+	return [[[XmlPath alloc] initWithString: string] autorelease];
+}
+
+- (id)initWithString: (NSString *)string {
+
+	if ((self = [super init])) {
+
+		if (string.length == 0) {
+
+			[self release];
+			return nil;
+		}
+
+		NSArray *parts = [string componentsSeparatedByString: @"/"];
+		NSMutableArray *steps = [NSMutableArray arrayWithCapacity: parts.count];
+
+		for (NSUInteger i = 0; i < parts.count; i++) {
+
+			NSString *part = [parts objectAtIndex: i];
+			BOOL isLast = (i + 1 == parts.count);
+
+			if ([part hasPrefix: @"@"] && isLast && part.length > 1) {
+
+				part = [part substringFromIndex: 1];
+
+				if ([part rangeOfString: @"@"].location == NSNotFound) {
+
+					_attributeName = [part copy];
+					break;
+				}
+			}
+
+			if (part.length == 0 || [part rangeOfString: @"@"].location != NSNotFound) {
+
+				[self release];
+				return nil;
+			}
+
+			[steps addObject: part];
+		}
+
+		_string = [string copy];
+		_steps = [steps copy];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[_string release];
+	[_steps release];
+	[_attributeName release];
+
+	[super dealloc];
+}
+
+- (NSString *)description {
+
+	return _string;
+}
+
+@end
+
+
+@interface XmlPathExtractor (Private)
+
+/// Adds steps of the path to the tree.
+/// @param path - the path.
+/// @param pathIndex - index of the path, that is index of its value.
+- (void)addPath: (XmlPath *)path index: (NSUInteger)pathIndex;
+
+/// Returns child step with the given name, adding it if there is no such step.
+/// @param name - element or attribute name.
+/// @param isAttribute - whether the step selects an attribute.
+/// @param parent - parent step index.
+- (NSInteger)stepNamed: (NSString *)name isAttribute: (BOOL)isAttribute parent: (NSInteger)parent;
+
+/// Clears the values of element and fills them in.
+/// @param element - the element.
+/// @param nameIndexes - name indexes of the steps resolved for the document of the element, 
+/// or NULL if element is not a document element.
+/// @param values - buffer of count strings.
+- (void)extractValuesFrom: (XmlElement *)element nameIndexes: (NSInteger *)nameIndexes values: (NSString **)values;
+
+@end
+
+
+#pragma mark Helpers
+
+/// Extracts values of the child steps from the element of a tree built by XmlTextReader.
+static void ExtractFromElement(const struct XmlExtractorStep *steps, NSInteger step, XmlElement *element, NSString **values) {
+
+	for (NSInteger child = steps[step].firstChild; child != XML_NODE_NONE; child = steps[child].nextSibling) {
+
+		const struct XmlExtractorStep *current = &steps[child];
+
+		if (current->isAttribute) {
+
+			values[current->valueIndex] = [element attrValue: current->name];
+			continue;
+		}
+
+		XmlElement *childElement = [element selectSingleNode: current->name at: 0];
+
+		if (!childElement) continue;
+
+		if (current->valueIndex != XML_NODE_NONE) {
+			values[current->valueIndex] = childElement.text;
+		}
+
+		ExtractFromElement(steps, child, childElement, values);
+	}
+}
+
+/// Extracts values of the child steps from the node of document, without creating elements.
+static void ExtractFromNode(const struct XmlExtractorStep *steps, const NSInteger *nameIndexes, NSInteger step,
+							XmlDocument *document, NSInteger node, NSString **values) {
+
+	for (NSInteger child = steps[step].firstChild; child != XML_NODE_NONE; child = steps[child].nextSibling) {
+
+		const struct XmlExtractorStep *current = &steps[child];
+
+		if (current->isAttribute) {
+
+			values[current->valueIndex] = [document attributeWithNameIndex: nameIndexes[child] ofNode: node];
+			continue;
+		}
+
+		NSInteger childNode = [document childWithNameIndex: nameIndexes[child] after: XML_NODE_NONE ofNode: node];
+
+		if (childNode == XML_NODE_NONE) continue;
+
+		if (current->valueIndex != XML_NODE_NONE) {
+			values[current->valueIndex] = [document textOfNode: childNode];
+		}
+
+		ExtractFromNode(steps, nameIndexes, child, document, childNode, values);
+	}
+}
+
+/// Looks up names of the steps in the document.
+static void ResolveNames(const struct XmlExtractorStep *steps, NSUInteger stepCount, XmlDocument *document, NSInteger *nameIndexes) {
+
+	nameIndexes[0] = XML_NODE_NONE;
+
+	for (NSUInteger i = 1; i < stepCount; i++) {
+		nameIndexes[i] = [document indexOfName: steps[i].name];
+	}
+}
+
+#pragma mark Helpers End
+
+
+@implementation XmlPathExtractor
+
+@synthesize count = _pathCount;
+
+- (id)initWithPaths: (NSArray *)paths {
+
+	if ((self = [super init])) {
+
+		// every step of every path plus the root at most
+		NSUInteger capacity = 1;
+		NSMutableArray *compiledPaths = [NSMutableArray arrayWithCapacity: paths.count];
+
+		for (id path in paths) {
+
+			XmlPath *compiledPath = [path isKindOfClass: [XmlPath class]] ? path : [XmlPath pathWithString: path];
+
+			if (!compiledPath) {
+
+				[self release];
+				return nil;
+			}
+
+			[compiledPaths addObject: compiledPath];
+			capacity += compiledPath.steps.count + 1;
+		}
+
+		_steps = calloc(capacity, sizeof(struct XmlExtractorStep));
+		_duplicatePaths = calloc(paths.count + 1, sizeof(NSUInteger));
+		_originalPaths = calloc(paths.count + 1, sizeof(NSUInteger));
+
+		_steps[0].firstChild = XML_NODE_NONE;
+		_steps[0].nextSibling = XML_NODE_NONE;
+		_steps[0].valueIndex = XML_NODE_NONE;
+		_stepCount = 1;
+
+		for (NSUInteger i = 0; i < compiledPaths.count; i++) {
+			[self addPath: [compiledPaths objectAtIndex: i] index: i];
+		}
+
+		_pathCount = compiledPaths.count;
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	if (_steps) {
+
+		for (NSUInteger i = 0; i < _stepCount; i++) {
+			[_steps[i].name release];
+		}
+		free(_steps);
+	}
+
+	free(_duplicatePaths);
+	free(_originalPaths);
+
+	[super dealloc];
+}
+
+- (void)extractValuesFrom: (XmlElement *)element values: (NSString **)values {
+
+	if (![element isKindOfClass: [XmlDocumentElement class]]) {
+
+		[self extractValuesFrom: element nameIndexes: NULL values: values];
+		return;
+	}
+
+	NSInteger *nameIndexes = malloc(_stepCount * sizeof(NSInteger));
+	ResolveNames(_steps, _stepCount, ((XmlDocumentElement *)element).document, nameIndexes);
+
+	[self extractValuesFrom: element nameIndexes: nameIndexes values: values];
+
+	free(nameIndexes);
+}
+
+- (void)extractValuesFromElements: (NSArray *)elements values: (NSString **)values {
+
+	NSInteger *nameIndexes = malloc(_stepCount * sizeof(NSInteger));
+	XmlDocument *resolvedDocument = nil;
+
+	for (XmlElement *element in elements) {
+
+		if ([element isKindOfClass: [XmlDocumentElement class]]) {
+
+			XmlDocument *document = ((XmlDocumentElement *)element).document;
+
+			if (document != resolvedDocument) {
+
+				ResolveNames(_steps, _stepCount, document, nameIndexes);
+				resolvedDocument = document;
+			}
+
+			[self extractValuesFrom: element nameIndexes: nameIndexes values: values];
+		}
+		else {
+			[self extractValuesFrom: element nameIndexes: NULL values: values];
+		}
+
+		values += _pathCount;
+	}
+
+	free(nameIndexes);
+}
+
+#pragma mark Private
+
+- (void)addPath: (XmlPath *)path index: (NSUInteger)pathIndex {
+
+	NSInteger step = 0;
+
+	for (NSString *name in path.steps) {
+		step = [self stepNamed: name isAttribute: NO parent: step];
+	}
+
+	if (path.attributeName) {
+		step = [self stepNamed: path.attributeName isAttribute: YES parent: step];
+	}
+
+	if (_steps[step].valueIndex == XML_NODE_NONE) {
+
+		_steps[step].valueIndex = pathIndex;
+		return;
+	}
+
+	_duplicatePaths[_duplicateCount] = pathIndex;
+	_originalPaths[_duplicateCount] = _steps[step].valueIndex;
+	_duplicateCount++;
+}
+
+- (NSInteger)stepNamed: (NSString *)name isAttribute: (BOOL)isAttribute parent: (NSInteger)parent {
+
+	NSInteger last = XML_NODE_NONE;
+
+	for (NSInteger child = _steps[parent].firstChild; child != XML_NODE_NONE; child = _steps[child].nextSibling) {
+
+		if (_steps[child].isAttribute == isAttribute && [_steps[child].name isEqualToString: name]) {
+			return child;
+		}
+
+		last = child;
+	}
+
+	NSInteger step = _stepCount++;
+
+	_steps[step].name = [name copy];
+	_steps[step].isAttribute = isAttribute;
+	_steps[step].firstChild = XML_NODE_NONE;
+	_steps[step].nextSibling = XML_NODE_NONE;
+	_steps[step].valueIndex = XML_NODE_NONE;
+
+	// children are kept in the order they were declared
+	if (last == XML_NODE_NONE) {
+		_steps[parent].firstChild = step;
+	}
+	else {
+		_steps[last].nextSibling = step;
+	}
+
+	return step;
+}
+
+- (void)extractValuesFrom: (XmlElement *)element nameIndexes: (NSInteger *)nameIndexes values: (NSString **)values {
+
+	for (NSUInteger i = 0; i < _pathCount; i++) {
+		values[i] = nil;
+	}
+
+	if (!element) return;
+
+	if (nameIndexes) {
+
+		XmlDocumentElement *documentElement = (XmlDocumentElement *)element;
+		ExtractFromNode(_steps, nameIndexes, 0, documentElement.document, documentElement.index, values);
+	}
+	else {
+		ExtractFromElement(_steps, 0, element, values);
+	}
+
+	for (NSUInteger i = 0; i < _duplicateCount; i++) {
+		values[_duplicatePaths[i]] = values[_originalPaths[i]];
+	}
+}
+
+#pragma mark Private End
+
+@end
@@ -20,6 +20,8 @@
 #import "XmlElement.h"
 
 /// Reads xml data and creates xml tree.
+/// In streaming mode only the subtrees located at the requested path are built;
+/// each of them is passed to the caller as soon as it is completed and released afterwards.
 @interface XmlTextReader : NSObject <NSXMLParserDelegate> {
 
 	/// Xml tree root element.
@@ -27,11 +29,42 @@
 
 	/// Stack used for creating xml tree.
 	NSMutableArray *_elements;
+
+	/// Path (split into element names) of the nodes which are reported in streaming mode.
+	NSArray *_streamPath;
+
+	/// Names of the open elements which are not a part of the subtree being built.
+	NSMutableArray *_openElementNames;
+
+	/// Streaming mode callback parameters.
+	NSObject *_streamContext;
+	NSObject *_streamTarget;
+	SEL _streamCallBack;
 }
 
+/// Returns count of documents read by all XmlTextReader instances so far.
+/// Used to check that every response is tokenized exactly once.
++ (NSUInteger)parseCount;
+
 /// Reads xml data, creates xml tree.
 /// @param xml - xml text to parse.
 /// @returns reference to tree root element.
 - (XmlElement *)read: (NSString *)xml;
 
+/// Reads xml data in streaming mode.
+/// Only the elements located at the given path are built, each of them is passed 
+/// to the callBack as soon as its end tag is read and released afterwards,
+/// so memory usage is bounded by the largest single node instead of the whole document.
+/// @param xml - xml text to parse.
+/// @param path - path to the nodes relative to the root element, e.g. @"group/thing".
+/// @param context - any object will be passed to callBack with each node.
+/// @param target - callback method owner.
+/// @param callBack - the method to call for each node, e.g. - (void)nodeRead: (XmlElement *)node context: (id)context.
+/// @returns YES if the document has been parsed successfully.
+- (BOOL)read: (NSString *)xml
+ nodesAtPath: (NSString *)path
+	 context: (NSObject *)context
+	  target: (NSObject *)target
+	callBack: (SEL)callBack;
+
 @end
@@ -19,6 +19,7 @@
 #import <Foundation/NSXMLParser.h>
 #import "XmlTextReader.h"
 #import "Logger.h"
+#import <libkern/OSAtomic.h>
 
 // Specifies the initial capacity for the array which stores child nodes for the element.
 #define ELEMENT_CHILD_STORE_INITIAL_CAPACITY 3
@@ -26,8 +27,31 @@
 // Specifies the initial length (capacity) of the string to store element text.
 #define ELEMENT_CONTENT_INITIAL_CAPACITY 50
 
+/// Count of read documents.
+static volatile int32_t _parseCount = 0;
+
+@interface XmlTextReader (Private)
+
+/// Parses xml text, calling delegate methods for each node.
+/// @param xml - xml text to parse.
+/// @returns YES if the document has been parsed successfully.
+- (BOOL)parseXml: (NSString *)xml;
+
+/// Checks whether the currently open element is located at the streaming path.
+- (BOOL)isAtStreamPath;
+
+/// Passes completed streaming node to the callBack and releases it.
+- (void)completeStreamNode;
+
+@end
+
 @implementation XmlTextReader
 
++ (NSUInteger)parseCount {
+
+	return _parseCount;
+}
+
 - (id)init {
 
 	if (self = [super init]) {
@@ -43,12 +67,56 @@
 
 	[_rootElement release];
 	[_elements release];
+	[_streamPath release];
+	[_openElementNames release];
+	[_streamContext release];
+	[_streamTarget release];
 
 	[super dealloc];
 }
 
 - (XmlElement *)read: (NSString *)xml {
-	
+
+	if (![self parseXml: xml]) {
+		return nil;
+	}
+
+	return _rootElement;
+}
+
+- (BOOL)read: (NSString *)xml
+ nodesAtPath: (NSString *)path
+	 context: (NSObject *)context
+	  target: (NSObject *)target
+	callBack: (SEL)callBack {
+
+	[_rootElement release];
+	_rootElement = nil;
+
+	_streamPath = [(path.length > 0 ? [path componentsSeparatedByString: @"/"] : [NSArray array]) retain];
+	_openElementNames = [NSMutableArray new];
+	_streamContext = [context retain];
+	_streamTarget = [target retain];
+	_streamCallBack = callBack;
+
+	BOOL result = [self parseXml: xml];
+
+	[_streamPath release];
+	_streamPath = nil;
+	[_openElementNames release];
+	_openElementNames = nil;
+	[_streamContext release];
+	_streamContext = nil;
+	[_streamTarget release];
+	_streamTarget = nil;
+
+	return result;
+}
+
+- (BOOL)parseXml: (NSString *)xml {
+
+	OSAtomicIncrement32(&_parseCount);
+
 	NSData *xmlData = [xml dataUsingEncoding: NSUTF8StringEncoding];
 	
 	// set up internal SAX xmlReader instance (NSXMLParser)
@@ -67,7 +135,7 @@
 		else { // xml is not valid, trace this event
 		
 			TraceComponentError(@"XMLxmlReader", @"%@ %@", @"Document parsing has failed; xml = ", xml);
-			return nil;
+			return NO;
 		}
 	}
 	@finally {
@@ -76,7 +144,40 @@
 		[xmlReader release];
 	}
 
-	return _rootElement;
+	return YES;
+}
+
+- (BOOL)isAtStreamPath {
+
+	// The first open element is the document root, the path is relative to it.
+	if (_openElementNames.count != _streamPath.count + 1) {
+		return NO;
+	}
+
+	for (NSUInteger i = 0; i < _streamPath.count; i++) {
+
+		if (![[_streamPath objectAtIndex: i] isEqualToString: [_openElementNames objectAtIndex: i + 1]]) {
+			return NO;
+		}
+	}
+
+	return YES;
+}
+
+- (void)completeStreamNode {
+
+	NSAutoreleasePool *pool = [NSAutoreleasePool new];
+
+	if (_streamTarget && [_streamTarget respondsToSelector: _streamCallBack]) {
+
+		[_streamTarget performSelector: _streamCallBack withObject: _rootElement withObject: _streamContext];
+	}
+
+	[pool release];
+
+	// the node has been consumed, so drop it before reading the next one
+	[_rootElement release];
+	_rootElement = nil;
 }
 
 // Called when the start of an element is encountered in the document, this provides the name of the element, 
@@ -85,6 +186,16 @@
 - (void)parser: (NSXMLParser *)xmlReader didStartElement: (NSString *)elementName namespaceURI: (NSString *)namespaceURI
 	qualifiedName: (NSString *)qualifiedName attributes: (NSDictionary *)attributeDict {
 
+	// in streaming mode, elements outside of the requested nodes are tracked by name only
+	if (_streamPath && _elements.count == 0) {
+
+		[_openElementNames addObject: elementName];
+
+		if (![self isAtStreamPath]) {
+			return;
+		}
+	}
+
 	XmlElement *current = [XmlElement new];
 	current.name = elementName;
 	
@@ -127,7 +238,18 @@
 - (void)parser: (NSXMLParser *)xmlReader didEndElement: (NSString *)elementName
 		namespaceURI: (NSString *)namespaceURI qualifiedName: (NSString *)qName {
 
-	[_elements removeLastObject];
+	if (_elements.count > 0) {
+
+		[_elements removeLastObject];
+
+		if (!_streamPath || _elements.count > 0) {
+			return;
+		}
+
+		[self completeStreamNode];
+	}
+
+	[_openElementNames removeLastObject];
 }
 // Called when the xmlReader found characters for the element.
 // This can be called multiple times for the same element.
@@ -0,0 +1,75 @@
+//
+//  XmlWriter.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+/// Appends string literal to the writer without measuring it.
+#define XML_WRITER_APPEND_LITERAL(writer, literal) [writer appendBytes: literal length: sizeof(literal) - 1]
+
+/// Writes xml as UTF-8 bytes into a growing buffer.
+/// Markup is appended as is, text values are escaped on the way into the buffer,
+/// so no intermediate strings are created.
+@interface XmlWriter : NSObject {
+
+	uint8_t *_bytes;
+	NSUInteger _length;
+	NSUInteger _capacity;
+}
+
+/// Gets count of bytes written.
+@property (readonly) NSUInteger length;
+
+/// Gets the bytes written, valid until the next append.
+@property (readonly) const uint8_t *bytes;
+
+/// Initializes a new instance of the XmlWriter class.
+/// @param capacity - expected count of bytes.
+- (id)initWithCapacity: (NSUInteger)capacity;
+
+/// Returns copy of the bytes written.
+- (NSData *)data;
+
+/// Returns the xml written as a string.
+- (NSString *)string;
+
+/// Appends bytes as is.
+/// @param bytes - UTF-8 markup.
+/// @param length - count of bytes.
+- (void)appendBytes: (const void *)bytes length: (NSUInteger)length;
+
+/// Appends text with &, <, > and " escaped, so it can be used both as element text and as attribute value.
+/// @param text - the text, nothing is written if it is nil.
+- (void)appendEscapedString: (NSString *)text;
+
+/// Appends integer in decimal notation.
+/// @param value - the value.
+- (void)appendInteger: (NSInteger)value;
+
+/// Appends xsd:double representation of the value.
+/// @param value - the value.
+- (void)appendDouble: (double)value;
+
+/// Appends UTC timestamp, yyyy-MM-ddTHH:mm:ss.SSSZ.
+/// @param date - the date, nothing is written if it is nil.
+- (void)appendUtcDate: (NSDate *)date;
+
+/// Appends base64 text of the data.
+/// @param data - the data, nothing is written if it is nil.
+- (void)appendBase64: (NSData *)data;
+
+@end
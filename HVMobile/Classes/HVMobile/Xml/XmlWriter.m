@@ -0,0 +1,240 @@
+//
+//  XmlWriter.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+#import "Base64.h"
+
+/// Capacity of the buffer when none is specified.
+#define XML_WRITER_DEFAULT_CAPACITY 256
+
+@interface XmlWriter (Private)
+
+/// Makes room for the given count of bytes after the ones written.
+/// @param length - count of bytes to be written.
+/// @returns pointer to the free space.
+- (uint8_t *)reserve: (NSUInteger)length;
+
+@end
+
+#pragma mark Helpers
+
+/// Returns length of the escaped character, 1 for characters which aren't escaped.
+static inline NSUInteger EscapedLength(uint8_t c) {
+
+	switch (c) {
+
+		case '&': return 5;
+		case '<': return 4;
+		case '>': return 4;
+		case '"': return 6;
+	}
+
+	return 1;
+}
+
+/// Escapes bytes in place, moving them towards the end of the buffer.
+/// @param bytes - the text, the buffer must have room for extra bytes after it.
+/// @param length - count of bytes of the text.
+/// @param extra - count of bytes escaping adds.
+static void EscapeInPlace(uint8_t *bytes, NSUInteger length, NSUInteger extra) {
+
+	uint8_t *source = bytes + length;
+	uint8_t *target = source + extra;
+
+	// the text is walked from the end, so nothing is overwritten before it has been moved
+	while (source > bytes && target > source) {
+
+		uint8_t c = *--source;
+		const char *entity = NULL;
+
+		switch (c) {
+
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '"': entity = "&quot;"; break;
+		}
+
+		if (entity) {
+
+			size_t entityLength = strlen(entity);
+			target -= entityLength;
+			memcpy(target, entity, entityLength);
+		}
+		else {
+			*--target = c;
+		}
+	}
+}
+
+#pragma mark Helpers End
+
+
+@implementation XmlWriter
+
+@synthesize length = _length;
+
+- (id)init {
+
+	return [self initWithCapacity: XML_WRITER_DEFAULT_CAPACITY];
+}
+
+- (id)initWithCapacity: (NSUInteger)capacity {
+
+	if ((self = [super init])) {
+
+		_capacity = MAX(capacity, 16);
+		_bytes = malloc(_capacity);
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	free(_bytes);
+
+	[super dealloc];
+}
+
+- (const uint8_t *)bytes {
+
+	return _bytes;
+}
+
+- (NSData *)data {
+
+	return [NSData dataWithBytes: _bytes length: _length];
+}
+
+- (NSString *)string {
+
+	return [[[NSString alloc] initWithBytes: _bytes length: _length encoding: NSUTF8StringEncoding] autorelease];
+}
+
+- (void)appendBytes: (const void *)bytes length: (NSUInteger)length {
+
+	memcpy([self reserve: length], bytes, length);
+	_length += length;
+}
+
+- (void)appendEscapedString: (NSString *)text {
+
+	NSUInteger maxLength = [text maximumLengthOfBytesUsingEncoding: NSUTF8StringEncoding];
+
+	if (maxLength == 0) {
+		return;
+	}
+
+	// the text is converted straight into the buffer and escaped there
+	uint8_t *start = [self reserve: maxLength];
+	NSUInteger length = 0;
+
+	[text getBytes: start
+		 maxLength: maxLength
+		usedLength: &length
+		  encoding: NSUTF8StringEncoding
+		   options: 0
+			 range: NSMakeRange(0, text.length)
+	remainingRange: NULL];
+
+	NSUInteger extra = 0;
+
+	for (NSUInteger i = 0; i < length; i++) {
+		extra += EscapedLength(start[i]) - 1;
+	}
+
+	if (extra > 0) {
+
+		start = [self reserve: length + extra];
+		EscapeInPlace(start, length, extra);
+	}
+
+	_length += length + extra;
+}
+
+- (void)appendInteger: (NSInteger)value {
+
+	char *buffer = (char *)[self reserve: 24];
+	_length += snprintf(buffer, 24, "%ld", (long)value);
+}
+
+- (void)appendDouble: (double)value {
+
+	if (isnan(value)) {
+		XML_WRITER_APPEND_LITERAL(self, "NaN");
+	}
+	else if (isinf(value)) {
+
+		if (value > 0) {
+			XML_WRITER_APPEND_LITERAL(self, "INF");
+		}
+		else {
+			XML_WRITER_APPEND_LITERAL(self, "-INF");
+		}
+	}
+	else {
+
+		// 15 significant digits are enough for any value which has been parsed from a decimal
+		char *buffer = (char *)[self reserve: 32];
+		_length += snprintf(buffer, 32, "%.15g", value);
+	}
+}
+
+- (void)appendUtcDate: (NSDate *)date {
+
+	if (!date) {
+		return;
+	}
+
+	char *buffer = (char *)[self reserve: DATE_TIME_UTC_STRING_LENGTH];
+	_length += [DateTimeUtils formatUtcTime: [date timeIntervalSinceReferenceDate] toBuffer: buffer];
+}
+
+- (void)appendBase64: (NSData *)data {
+
+	if (data.length == 0) {
+		return;
+	}
+
+	NSUInteger length = [Base64 encodedLengthOfLength: data.length options: 0];
+	char *buffer = (char *)[self reserve: length];
+
+	_length += [Base64 encodeBase64WithBytes: data.bytes length: data.length toBuffer: buffer options: 0];
+}
+
+#pragma mark Private
+
+- (uint8_t *)reserve: (NSUInteger)length {
+
+	if (_length + length > _capacity) {
+
+		while (_length + length > _capacity) {
+			_capacity *= 2;
+		}
+
+		_bytes = realloc(_bytes, _capacity);
+	}
+
+	return _bytes + _length;
+}
+
+#pragma mark Private End
+
+@end
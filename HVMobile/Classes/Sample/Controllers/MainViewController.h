@@ -20,6 +20,7 @@
 
 
 @class WeightPickerView;
+@class HealthVaultThingSync;
 
 /// Represents app Main screen. Contains info about person record.
 @interface MainViewController : UIViewController <UITextFieldDelegate> {
@@ -53,6 +54,12 @@
 	
 	/// Contains weights for current record.
 	NSMutableArray *_weights;
+
+	/// Weights which are being deleted.
+	NSArray *_deletingWeights;
+
+	/// Brings cached weights up to date.
+	HealthVaultThingSync *_weightSync;
 	
 	/// Shown if error occurred in authentication process.
 	UIAlertView *_authAlert;
@@ -26,6 +26,7 @@
 
 #import "Weight.h"
 #import "RecordImage.h"
+#import "HealthVaultConfig.h"
 
 
 /// Weight default value.
@@ -93,6 +94,23 @@ enum {
 /// Hides Weight picker view.
 - (void)hideWeightPickerView;
 
+/// Shows cached weights and starts bringing the cache up to date.
+- (void)loadWeights;
+
+/// Shows the first page of cached weights, the rest follow page by page.
+- (void)showCachedWeights;
+
+/// Appends the next page of cached weights to the list.
+- (void)showNextCachedWeights;
+
+/// Adds saved weight to the list and the cache without loading weights again.
+/// @param weight - the weight with its thing key.
+/// @returns NO if the position of the weight isn't known yet, so weights have to be loaded.
+- (BOOL)showSavedWeight: (Weight *)weight;
+
+/// Shows the newest weight in the new weight text field.
+- (void)updateNewWeightTextField;
+
 @end
 
 @implementation MainViewController
@@ -100,7 +118,12 @@ enum {
 
 - (void)dealloc {
 
+	[NSObject cancelPreviousPerformRequestsWithTarget: self];
+	[[WeightTrackerAppDelegate healthVaultService] setWriteJournalTarget: nil callBack: nil];
+	[_weightSync cancel];
+	[_weightSync release];
 	[_weights release];
+	[_deletingWeights release];
 	[_weightPickerView release];
 	[_lastWeightValue release];
 	
@@ -119,6 +142,10 @@ enum {
 	_recordInfoTableView.backgroundColor = [UIColor clearColor];
 	
 	[self updateNewWeightDateLabel];
+
+	// Weights saved offline show up once they have been delivered.
+	[[WeightTrackerAppDelegate healthVaultService] setWriteJournalTarget: self
+																callBack: @selector(writeJournalReplayed:)];
 	
 	/// Updates newWeightDateLabel each 10 seconds.
 	const int UpdateNewWeightLabelTimerInterval = 10;
@@ -231,6 +258,10 @@ enum {
 	service.sharedSecret = nil;
 	service.appIdInstance = nil;
 	service.currentRecord = nil;
+
+	// Cached responses and unsent writes belong to the previous application instance.
+	[service.responseCache removeAllResponses];
+	[service.writeJournal removeAllEntries];
 	
 	[service saveSettings: @"Default"];
 	
@@ -277,7 +308,7 @@ enum {
 			_recordNameLabel.text = service.currentRecord.recordName;
 		
 			// Loads weights data and image for current record.
-			[Weight loadWeights: self callBack: @selector(loadWeightsCompleted:)];
+			[self loadWeights];
 			[RecordImage loadRecordImage: self callBack: @selector(loadRecordImageCompleted:)];
 		
 			[WeightTrackerAppDelegate showProgressView];
@@ -332,56 +363,199 @@ enum {
 
 	[WeightTrackerAppDelegate hideProgressView];
 
+	// The weight is kept and saved when HealthVault is reachable.
+	if (response.isJournaled) {
+		[self showAlertWithMessage: @"Your weight will be saved as soon as HealthVault is reachable."];
+		return;
+	}
+
+	// The weight may have been saved, the loaded list shows whether it has.
+	if (response.isDeliveryUncertain) {
+		[self showAlertWithMessage: @"It couldn't be confirmed that your weight has been saved, please check the list before adding it again."];
+		[self loadWeights];
+		return;
+	}
+
 	if (response.hasError) {
 		[WeightTrackerAppDelegate showAlertWithError: response.errorText target: self];
 		return;
 	}
 
-	// Reloads weights list.
-	[Weight loadWeights: self callBack: @selector(loadWeightsCompleted:)];
+	// The new weight is merged into the list, weights are loaded again only if it can't be placed.
+	Weight *weight = [Weight weightFromPutResponse: response];
+
+	if (!weight || ![self showSavedWeight: weight]) {
+		[self loadWeights];
+	}
 }
 
-/// Callback for deleting all weight server request.
+/// Callback for writes sent again from the write journal.
 /// @param response - HealthVaultResponse object.
-- (void)deleteAllWeightsCompleted: (HealthVaultResponse *)response {
+- (void)writeJournalReplayed: (HealthVaultResponse *)response {
 
-	[WeightTrackerAppDelegate hideProgressView];
+	// The write is still waiting, it is sent again later.
+	if (response.isJournaled) {
+		return;
+	}
 
 	if (response.hasError) {
 		[WeightTrackerAppDelegate showAlertWithError: response.errorText target: self];
+	}
+
+	// Reloads weights list once all of them have been sent.
+	if ([WeightTrackerAppDelegate healthVaultService].writeJournal.pendingCount == 0) {
+		[self loadWeights];
+	}
+}
+
+/// Callback for deleting all weight server request.
+/// @param operation - HealthVaultBulkOperation object.
+- (void)deleteAllWeightsCompleted: (HealthVaultBulkOperation *)operation {
+
+	[WeightTrackerAppDelegate hideProgressView];
+
+	NSArray *deletedWeights = [_deletingWeights autorelease];
+	_deletingWeights = nil;
+
+	if (operation.hasError) {
+
+		// Some chunks may have been deleted, or a weight has been changed meanwhile, so the list is loaded again.
+		[self loadWeights];
+		[WeightTrackerAppDelegate showAlertWithError: operation.errorText target: self];
 		return;
 	}
 
-	// After deleting clear weights list and reload table.
-	[_weights removeAllObjects];
+	// Deleted weights are dropped from the list and the cache, weights which haven't been shown yet stay.
+	NSMutableSet *deletedIds = [NSMutableSet setWithCapacity: deletedWeights.count];
+
+	for (Weight *weight in deletedWeights) {
+		[deletedIds addObject: weight.weightId];
+	}
+
+	if (![[Weight weightCache] removeThingIds: deletedIds]) {
+
+		[self loadWeights];
+		return;
+	}
+
+	NSMutableArray *remainingWeights = [NSMutableArray arrayWithCapacity: _weights.count];
+
+	for (Weight *weight in _weights) {
+
+		if (![deletedIds containsObject: weight.weightId]) {
+			[remainingWeights addObject: weight];
+		}
+	}
+
+	[_weights setArray: remainingWeights];
 	[_recordInfoTableView reloadData];
-	// Clears new weight text field.
-	_newWeightTextField.text = @"";
+	[self updateNewWeightTextField];
 
 	[self showAlertWithMessage: @"Your saved weights have been successfully deleted."];
 }
 
-/// Callback for loading weight server request.
-/// @param response - HealthVaultResponse object.
-- (void)loadWeightsCompleted: (HealthVaultResponse *)response {
+- (void)loadWeights {
+
+	[_weightSync cancel];
+	[_weightSync release];
+
+	// Cached weights are shown while the cache is brought up to date.
+	[self showCachedWeights];
+
+	_weightSync = [[Weight weightSync: self callBack: @selector(loadWeightsCompleted:)] retain];
+	[_weightSync start];
+}
+
+/// Callback for weight cache sync.
+/// @param sync - HealthVaultThingSync object.
+- (void)loadWeightsCompleted: (HealthVaultThingSync *)sync {
 
 	[WeightTrackerAppDelegate hideProgressView];
 
-	if (response.hasError) {
-		[WeightTrackerAppDelegate showAlertWithError: response.errorText target: self];
+	if (sync.hasError) {
+		[WeightTrackerAppDelegate showAlertWithError: sync.errorText target: self];
 		return;
 	}
 
-	// Parses received xml with weights.
-	if (_weights) {
-		[_weights release];
+	if (sync.changedThingCount > 0 || sync.removedThingCount > 0) {
+		[self showCachedWeights];
+	}
+}
+
+- (void)showCachedWeights {
+
+	[NSObject cancelPreviousPerformRequestsWithTarget: self
+											 selector: @selector(showNextCachedWeights)
+											   object: nil];
+	if (!_weights) {
+		_weights = [NSMutableArray new];
+	}
+
+	[_weights removeAllObjects];
+	[self showNextCachedWeights];
+}
+
+- (void)showNextCachedWeights {
+
+	// Only the page is read from the cache, whatever the count of weights is.
+	HealthVaultThingCache *cache = [Weight weightCache];
+	NSString *xml = [cache infoXmlWithThingsInRange: NSMakeRange(_weights.count, DEFAULT_THING_PAGE_SIZE)];
+
+	[_weights addObjectsFromArray: [Weight parseWeightsFromXml: xml]];
+
+	// Older weights are read while the first ones are shown.
+	if (_weights.count < cache.count) {
+
+		[self performSelector: @selector(showNextCachedWeights)
+				   withObject: nil
+				   afterDelay: 0];
 	}
-	_weights = [[Weight parseWeightsFromXml: response.infoXml] retain];
 
 	// Shows hidden table and reload it.
 	_recordInfoTableView.hidden = NO;
 	[_recordInfoTableView reloadData];
 
+	[self updateNewWeightTextField];
+}
+
+- (BOOL)showSavedWeight: (Weight *)weight {
+
+	HealthVaultThingCache *cache = [Weight weightCache];
+	NSUInteger index = [Weight insertionIndexOfWeight: weight inWeights: _weights];
+
+	// Weights beyond the shown ones are still being read from the cache, so their order isn't known.
+	if (!_weights || (index == _weights.count && _weights.count < cache.count)) {
+		return NO;
+	}
+
+	// The weight may have been loaded by the sync already, weights of the same time follow one another.
+	for (NSUInteger i = index; i < _weights.count; i++) {
+
+		Weight *shownWeight = [_weights objectAtIndex: i];
+
+		if ([shownWeight.effDate compare: weight.effDate] != NSOrderedSame) {
+			break;
+		}
+
+		if ([shownWeight.weightId isEqualToString: weight.weightId]) {
+			return YES;
+		}
+	}
+
+	// The cache and the list keep the same order, so pages read later stay in place.
+	if (![cache insertThing: [weight thingXml] thingId: weight.weightId versionStamp: weight.versionStamp atIndex: index]) {
+		return NO;
+	}
+
+	[_weights insertObject: weight atIndex: index];
+	[_recordInfoTableView reloadData];
+	[self updateNewWeightTextField];
+
+	return YES;
+}
+
+- (void)updateNewWeightTextField {
+
 	if (_weights.count > 0) {
 
 		Weight *lastWeight = [_weights objectAtIndex: 0];
@@ -401,7 +575,7 @@ enum {
 		return;
 	}
 
-	RecordImage *recordImage = [RecordImage parseImageFromXml: response.infoXml];
+	RecordImage *recordImage = response.result;
 
 	if (recordImage) {
 		_recordImageView.image = recordImage.image;
@@ -707,8 +881,11 @@ enum {
 
 			[WeightTrackerAppDelegate showProgressView];
 		
-			// Performs deleting.
-			[Weight deleteAllWeights: _weights target: self callBack: @selector(deleteAllWeightsCompleted:)];
+			// Performs deleting, the weights shown now are dropped once they are deleted.
+			[_deletingWeights release];
+			_deletingWeights = [_weights copy];
+
+			[Weight deleteAllWeights: _deletingWeights target: self callBack: @selector(deleteAllWeightsCompleted:)];
 			_deleteAllConfirmAlert = nil;
 		}
 	}
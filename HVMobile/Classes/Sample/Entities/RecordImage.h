@@ -18,15 +18,28 @@
 
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
+#import "XmlElement.h"
+#import "HealthVaultResponse.h"
 
 /// Represents HealthVault Record Image thing.
 @interface RecordImage : NSObject {
 
 	UIImage *_image;
+	NSData *_imageData;
+	NSString *_contentType;
 }
 
-/// Gets or sets record image (avatar).
-@property(retain) UIImage *image;
+/// Gets record image (avatar), decoded from the image data when first requested.
+@property(readonly) UIImage *image;
+
+/// Gets or sets encoded image data, as stored in the blob.
+@property(retain) NSData *imageData;
+
+/// Gets or sets content type of the image data.
+@property(retain) NSString *contentType;
+
+/// Gets length of the image data.
+@property(readonly) NSInteger contentLength;
 
 /// Loads image(avatar) for current record.
 /// @param target - callback method owner.
@@ -38,4 +51,14 @@
 /// @returns RecordImage instance.
 + (RecordImage *)parseImageFromXml: (NSString *)xml;
 
+/// Returns new RecordImage object from the info section already parsed by HealthVaultResponse.
+/// @param infoNode - info section with image in Base64 string.
+/// @returns RecordImage instance.
++ (RecordImage *)parseImageFromInfo: (XmlElement *)infoNode;
+
+/// Returns new RecordImage object from the response, used as the result parser of the request.
+/// @param response - response with image in Base64 string.
+/// @returns RecordImage instance.
++ (RecordImage *)parseImageFromResponse: (HealthVaultResponse *)response;
+
 @end
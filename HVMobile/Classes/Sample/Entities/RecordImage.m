@@ -17,22 +17,52 @@
 // limitations under the License.
 
 #import "RecordImage.h"
-#import "XmlTextReader.h"
-#import "Base64.h"
+#import "RecordImageMapper.h"
 #import "WeightTrackerAppDelegate.h"
 
 
 @implementation RecordImage
 
-@synthesize image = _image;
+@synthesize imageData = _imageData;
+@synthesize contentType = _contentType;
 
 - (void)dealloc {
 
-	self.image = nil;
+	[_image release];
+	self.imageData = nil;
+	self.contentType = nil;
 
 	[super dealloc];
 }
 
+- (UIImage *)image {
+
+	if (!_image && _imageData) {
+
+		_image = [[UIImage alloc] initWithData: _imageData];
+	}
+
+	return _image;
+}
+
+- (void)setImageData: (NSData *)imageData {
+
+	if (_imageData != imageData) {
+
+		[_imageData release];
+		_imageData = [imageData retain];
+
+		// The decoded image belongs to the old data.
+		[_image release];
+		_image = nil;
+	}
+}
+
+- (NSInteger)contentLength {
+
+	return _imageData.length;
+}
+
 
 #pragma mark Xml Logic
 
@@ -41,9 +71,26 @@
 /// @returns RecordImage instance.
 + (RecordImage *)parseImageFromXml: (NSString *)xml {
 
-	// Parses response and retrives record image.
-	XmlTextReader *xmlReader = [[XmlTextReader new] autorelease];
-	XmlElement *infoNode = [xmlReader read: xml];
+	// Parses response and retrives record image, the base64 text is decoded as it is read.
+	for (RecordImage *recordImage in [RecordImageMapper parseThingsFromXml: xml]) {
+
+		if (recordImage.imageData) {
+
+			// Decodes image here, off the main thread if the service has a processing queue.
+			[recordImage image];
+
+			return recordImage;
+		}
+	}
+
+	return nil;
+}
+
+/// Returns new RecordImage object from the info section already parsed by HealthVaultResponse.
+/// @param infoNode - info section with image in Base64 string.
+/// @returns RecordImage instance.
++ (RecordImage *)parseImageFromInfo: (XmlElement *)infoNode {
+
 	XmlElement *groupNode = [infoNode selectSingleNode: @"group"];
 	NSArray *blobNodes = [[groupNode selectSingleNode: @"thing"] selectNodes: @"blob-payload"];
 
@@ -54,8 +101,9 @@
 
 			RecordImage *recordImage = [RecordImage new];
 
-			NSString *base64ImageString = base64DataNode.text;
-			recordImage.image = [UIImage imageWithData: [Base64 decodeBase64WithString: base64ImageString]];
+			// image is decoded straight from the response buffer
+			recordImage.imageData = base64DataNode.base64Value;
+			[recordImage image];
 
 			return [recordImage autorelease];
 		}
@@ -64,6 +112,14 @@
 	return nil;
 }
 
+/// Returns new RecordImage object from the response, used as the result parser of the request.
+/// @param response - response with image in Base64 string.
+/// @returns RecordImage instance.
++ (RecordImage *)parseImageFromResponse: (HealthVaultResponse *)response {
+
+	return [self parseImageFromInfo: response.infoElement];
+}
+
 #pragma mark Xml Logic End
 
 
@@ -101,7 +157,12 @@
 																	 infoSection: xml
 																		  target: target
 																		callBack: callBack];
-	[[WeightTrackerAppDelegate healthVaultService] sendRequest: request];
+
+	// The image is decoded with the response, off the main thread if the service has a processing queue.
+	request.resultTarget = self;
+	request.resultParser = @selector(parseImageFromResponse:);
+
+	[[WeightTrackerAppDelegate requestBatcher] sendRequest: request];
 	[request release];
 }
 
@@ -0,0 +1,36 @@
+//
+//  RecordImageMapper.h
+//  Generated by ThingMapperGenerator.py from RecordImage.thing, do not edit.
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "HealthVaultThingMapper.h"
+#import "RecordImage.h"
+
+/// Maps RecordImage things, type a5294488-f865-4ce3-92fa-187cd3b58930, to xml and back.
+@interface RecordImageMapper : HealthVaultThingMapper {
+
+	/// The thing being parsed and its properties which have been set.
+	RecordImage *_thing;
+	uint32_t _assigned;
+}
+
+/// Writes <thing> element of the RecordImage.
+/// @param thing - the thing.
+/// @param writer - the writer to write to.
++ (void)appendThing: (RecordImage *)thing toWriter: (XmlWriter *)writer;
+
+@end
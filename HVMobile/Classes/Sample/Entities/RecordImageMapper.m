@@ -0,0 +1,176 @@
+//
+//  RecordImageMapper.m
+//  Generated by ThingMapperGenerator.py from RecordImage.thing, do not edit.
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "RecordImageMapper.h"
+#import "XmlWriter.h"
+
+/// States of the parser, one for every element on the paths of parsed values.
+enum {
+
+	RecordImageStateRoot = THING_MAPPER_STATE_FIRST,
+	RecordImageStateGroup,
+	RecordImageStateThing,
+	RecordImageStateBlobPayload,
+	RecordImageStateBlobPayloadBlob,
+	RecordImageStateBlobPayloadBlobBlobInfo,
+	RecordImageStateBlobPayloadBlobBlobInfoContentType,
+	RecordImageStateBlobPayloadBlobBase64data
+};
+
+/// Bits of the properties which have been set, only the first value of a property is kept.
+enum {
+
+	RecordImageAssignedContentType = 1 << 0,
+	RecordImageAssignedImageData = 1 << 1
+};
+
+
+@implementation RecordImageMapper
+
+- (void)dealloc {
+
+	[_thing release];
+
+	[super dealloc];
+}
+
++ (NSString *)typeId {
+
+	return @"a5294488-f865-4ce3-92fa-187cd3b58930";
+}
+
+#pragma mark Writing
+
++ (void)appendThing: (RecordImage *)thing toWriter: (XmlWriter *)writer {
+
+	XML_WRITER_APPEND_LITERAL(writer, "<thing><type-id>a5294488-f865-4ce3-92fa-187cd3b58930</type-id><thing-state>Active</thing-state><flags>0</flags><data-xml><personal-image/><common/></data-xml><blob-payload><blob><blob-info><name/>");
+	if (thing.contentType) {
+		XML_WRITER_APPEND_LITERAL(writer, "<content-type>");
+		[writer appendEscapedString: thing.contentType];
+		XML_WRITER_APPEND_LITERAL(writer, "</content-type>");
+	}
+	XML_WRITER_APPEND_LITERAL(writer, "</blob-info><content-length>");
+	[writer appendInteger: thing.contentLength];
+	XML_WRITER_APPEND_LITERAL(writer, "</content-length>");
+	if (thing.imageData) {
+		XML_WRITER_APPEND_LITERAL(writer, "<base64data>");
+		[writer appendBase64: thing.imageData];
+		XML_WRITER_APPEND_LITERAL(writer, "</base64data>");
+	}
+	XML_WRITER_APPEND_LITERAL(writer, "</blob></blob-payload></thing>");
+}
+
+#pragma mark Writing End
+
+#pragma mark Parsing
+
+- (NSInteger)stateForElement: (NSString *)name inState: (NSInteger)state {
+
+	switch (state) {
+
+		case THING_MAPPER_STATE_DOCUMENT:
+			return RecordImageStateRoot;
+
+		case RecordImageStateRoot:
+			return [name isEqualToString: @"group"] ? RecordImageStateGroup : THING_MAPPER_STATE_NONE;
+
+		case RecordImageStateGroup:
+			return [name isEqualToString: @"thing"] ? RecordImageStateThing : THING_MAPPER_STATE_NONE;
+
+		case RecordImageStateThing:
+			if ([name isEqualToString: @"blob-payload"]) return RecordImageStateBlobPayload;
+			break;
+
+		case RecordImageStateBlobPayload:
+			if ([name isEqualToString: @"blob"]) return RecordImageStateBlobPayloadBlob;
+			break;
+
+		case RecordImageStateBlobPayloadBlob:
+			if ([name isEqualToString: @"blob-info"]) return RecordImageStateBlobPayloadBlobBlobInfo;
+			if ([name isEqualToString: @"base64data"]) return RecordImageStateBlobPayloadBlobBase64data;
+			break;
+
+		case RecordImageStateBlobPayloadBlobBlobInfo:
+			if ([name isEqualToString: @"content-type"]) return RecordImageStateBlobPayloadBlobBlobInfoContentType;
+			break;
+	}
+
+	return THING_MAPPER_STATE_NONE;
+}
+
+- (void)enterState: (NSInteger)state attributes: (NSDictionary *)attributes {
+
+	switch (state) {
+
+		case RecordImageStateThing:
+			[_thing release];
+			_thing = [RecordImage new];
+			_assigned = 0;
+			break;
+
+		case RecordImageStateBlobPayloadBlobBlobInfoContentType:
+			[self collectText];
+			break;
+
+		case RecordImageStateBlobPayloadBlobBase64data:
+			[self collectBase64];
+			break;
+	}
+}
+
+- (void)leaveState: (NSInteger)state {
+
+	switch (state) {
+
+		case RecordImageStateThing:
+			[self addThing: _thing];
+			[_thing release];
+			_thing = nil;
+			break;
+
+		case RecordImageStateBlobPayloadBlobBlobInfoContentType: {
+
+			NSString *text = self.text;
+
+			if (text && !(_assigned & RecordImageAssignedContentType)) {
+
+				_thing.contentType = text;
+				_assigned |= RecordImageAssignedContentType;
+			}
+
+			break;
+		}
+
+		case RecordImageStateBlobPayloadBlobBase64data: {
+
+			NSData *value = self.base64Data;
+
+			if (value && !(_assigned & RecordImageAssignedImageData)) {
+
+				_thing.imageData = value;
+				_assigned |= RecordImageAssignedImageData;
+			}
+
+			break;
+		}
+	}
+}
+
+#pragma mark Parsing End
+
+@end
@@ -17,6 +17,10 @@
 // limitations under the License.
 
 #import <Foundation/Foundation.h>
+#import "XmlElement.h"
+#import "HealthVaultThingPager.h"
+#import "HealthVaultBulkOperation.h"
+#import "HealthVaultThingSync.h"
 
 
 /// Represents HealthVault Weight thing.
@@ -44,6 +48,9 @@
 /// Gets or sets version stamp.
 @property(retain) NSString *versionStamp;
 
+/// Gets weight in kilograms, converted from the display value in pounds.
+@property(readonly) double kg;
+
 /// Puts new weight to HealthVault server for current record.
 /// @param pounds - pounds value.
 /// @param target - callback method owner.
@@ -52,7 +59,20 @@
 		   target: (NSObject *)target
 		 callBack: (SEL)callBack;
 
+/// Creates weight saved by putWeight from the PutThings response, so it can be shown
+/// without loading weights again.
+/// @param response - response to the request sent by putWeight.
+/// @returns Weight instance, or nil if the response doesn't contain the thing key.
++ (Weight *)weightFromPutResponse: (HealthVaultResponse *)response;
+
+/// Finds position of the weight in a list sorted the way GetThings returns weights, newest first.
+/// @param weight - the weight.
+/// @param weights - sorted array of Weight.
+/// @returns index of the first weight which isn't newer than the given one.
++ (NSUInteger)insertionIndexOfWeight: (Weight *)weight inWeights: (NSArray *)weights;
+
 /// Deletes specified weights for current record.
+/// Weights are deleted in chunks, the callback gets HealthVaultBulkOperation.
 /// @param weights - array of Weight which should be deleted.
 /// @param target - callback method owner.
 /// @param callBack - callback which invoked when operation is completed.
@@ -65,9 +85,36 @@
 /// @param callBack - callback which is invoked when operation is completed.
 + (void)loadWeights: (NSObject *)target callBack: (SEL)callBack;
 
+/// Creates pager which loads weights of current record page by page.
+/// The pager isn't started.
+/// @param target - callback method owner.
+/// @param callBack - callback which is invoked for every page.
+/// @returns HealthVaultThingPager instance.
++ (HealthVaultThingPager *)weightPager: (NSObject *)target callBack: (SEL)callBack;
+
+/// Returns cache of weights of current record.
+/// @returns HealthVaultThingCache instance.
++ (HealthVaultThingCache *)weightCache;
+
+/// Creates sync which brings the weight cache of current record up to date.
+/// The sync isn't started.
+/// @param target - callback method owner.
+/// @param callBack - callback which is invoked when the cache is up to date.
+/// @returns HealthVaultThingSync instance.
++ (HealthVaultThingSync *)weightSync: (NSObject *)target callBack: (SEL)callBack;
+
 /// Parses xml and returns array of Weight objects.
 /// @param xml - xml with weights.
 /// @returns array of Weight instances.
 + (NSArray *)parseWeightsFromXml: (NSString *)xml;
 
+/// Returns array of Weight objects from the info section already parsed by HealthVaultResponse.
+/// @param infoNode - info section with weights.
+/// @returns array of Weight instances.
++ (NSArray *)parseWeightsFromInfo: (XmlElement *)infoNode;
+
+/// Returns xml of the weight thing the way GetThings returns it, so it can be cached.
+/// @returns <thing> xml.
+- (NSString *)thingXml;
+
 @end
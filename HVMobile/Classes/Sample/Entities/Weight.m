@@ -17,17 +17,62 @@
 // limitations under the License.
 
 #import "Weight.h"
-#import "XmlTextReader.h"
+#import "WeightMapper.h"
+#import "XmlWriter.h"
+#import "XmlPath.h"
 #import "DateTimeUtils.h"
 #import "WeightTrackerAppDelegate.h"
 
+/// Type id of weight things.
+#define WEIGHT_TYPE_ID @"3d34d87e-7fc1-4153-800f-f56592cb0d17"
+
+/// Selects active weights.
+#define WEIGHT_FILTER_XML \
+	@"<filter>" \
+		"<type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>" \
+		"<thing-state>Active</thing-state>" \
+	"</filter>"
+
+/// Requests core section and xml of weights.
+#define WEIGHT_FORMAT_XML \
+	@"<format>" \
+		"<section>core</section>" \
+		"<xml/>" \
+		"<type-version-format>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-version-format>" \
+	"</format>"
+
+/// Values extracted from every weight thing, in the order of WEIGHT_VALUE_PATHS.
+typedef enum {
+
+	WeightValueThingId,
+	WeightValueVersionStamp,
+	WeightValueDisplay,
+	WeightValueUnits,
+	WeightValueEffDate,
+	WeightValueCount
+
+} WeightValue;
+
+/// Paths of the values read from weight thing.
+#define WEIGHT_VALUE_PATHS \
+	[NSArray arrayWithObjects: \
+		@"thing-id", \
+		@"thing-id/@version-stamp", \
+		@"data-xml/weight/value/display", \
+		@"data-xml/weight/value/display/@units", \
+		@"eff-date", \
+		nil]
+
+/// Extracts WEIGHT_VALUE_PATHS from thing nodes, created once.
+static XmlPathExtractor *_weightExtractor = nil;
+
 
 @interface Weight (Private)
 
-/// Generates xml with date in HealthVault format.
-/// @param date - specified date.
-/// @returns xml with date in HealthVault format.
-+ (NSString *)getWhenXmlForDate: (NSDate *)date;
+/// Creates Weight object from the values extracted from thing node.
+/// @param values - WeightValueCount values.
+/// @returns Weight instance, autoreleased.
++ (Weight *)weightFromValues: (NSString **)values;
 
 @end
 
@@ -39,6 +84,13 @@
 @synthesize units = _units;
 @synthesize versionStamp = _versionStamp;
 
++ (void)initialize {
+
+	if (self == [Weight class]) {
+		_weightExtractor = [[XmlPathExtractor alloc] initWithPaths: WEIGHT_VALUE_PATHS];
+	}
+}
+
 - (void)dealloc {
 
 	self.weightId = nil;
@@ -50,6 +102,14 @@
 	[super dealloc];
 }
 
+- (double)kg {
+
+	// Converts pounds to kgs.
+	const double PoundsToKgsRatio = 2.204;
+
+	return [self.display doubleValue] / PoundsToKgsRatio;
+}
+
 
 #pragma mark Xml Logic
 
@@ -58,87 +118,54 @@
 /// @returns array of Weight instances.
 + (NSArray *)parseWeightsFromXml: (NSString *)xml {
 
-	XmlTextReader *xmlReader = [XmlTextReader new];
-
-	XmlElement *infoNode = [xmlReader read: xml];
-	XmlElement *groupNode = [infoNode selectSingleNode: @"group"];
-	NSArray *thingNodes = [groupNode selectNodes: @"thing"];
+	// Weights are set while the xml is being parsed, so no tree is built.
+	NSArray *weights = [WeightMapper parseThingsFromXml: xml];
 
-	NSMutableArray *weights = [[NSMutableArray new] autorelease];
-
-	for (XmlElement *thingNode in thingNodes) {
+	return weights ? weights : [NSArray array];
+}
 
-		Weight *weight = [Weight new];
+/// Returns array of Weight objects from the info section already parsed by HealthVaultResponse.
+/// @param infoNode - info section with weights.
+/// @returns array of Weight instances.
++ (NSArray *)parseWeightsFromInfo: (XmlElement *)infoNode {
 
-		XmlElement *thingIdNode = [thingNode selectSingleNode: @"thing-id"];
-		weight.weightId = thingIdNode.text;
-		weight.versionStamp = [thingIdNode.attributes objectForKey: @"version-stamp"];
+	NSArray *thingNodes = [[infoNode selectSingleNode: @"group"] selectNodes: @"thing"];
+	NSMutableArray *weights = [NSMutableArray arrayWithCapacity: thingNodes.count];
 
-		XmlElement *displayNode = [[[[thingNode selectSingleNode: @"data-xml"]
-				selectSingleNode: @"weight"] selectSingleNode: @"value"] selectSingleNode: @"display"];
+	if (thingNodes.count == 0) {
+		return weights;
+	}
 
-		weight.display = displayNode.text;
-		weight.units = [displayNode.attributes objectForKey: @"units"];
+	// Values of all things are extracted in one pass, names are looked up once per response.
+	NSString **values = malloc(thingNodes.count * WeightValueCount * sizeof(NSString *));
+	[_weightExtractor extractValuesFromElements: thingNodes values: values];
 
-		NSString *effDateString = [thingNode selectSingleNode: @"eff-date"].text;
-		weight.effDate = [DateTimeUtils UtcStringToDate: effDateString];
+	for (NSUInteger i = 0; i < thingNodes.count; i++) {
 
-		[weights addObject: weight];
-		[weight release];
+		[weights addObject: [self weightFromValues: values + i * WeightValueCount]];
 	}
 
-	[xmlReader release];
+	free(values);
 
 	return weights;
 }
 
-/// Generates xml with date in HealthVault format.
-/// @param date - specified date.
-/// @returns xml with date in HealthVault format.
-+ (NSString *)getWhenXmlForDate: (NSDate *)date {
++ (Weight *)weightFromValues: (NSString **)values {
 
-	// Retrieves date values.
-	NSUInteger calendarUnits = NSDayCalendarUnit | NSMonthCalendarUnit | 
-		NSYearCalendarUnit | NSHourCalendarUnit | NSMinuteCalendarUnit | 
-		NSSecondCalendarUnit;
-	
-	// We are using UTC for timestamp.
-	NSCalendar *calendar = [[NSCalendar alloc]   initWithCalendarIdentifier: NSGregorianCalendar];
-	[calendar setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
+	Weight *weight = [[Weight new] autorelease];
 
-	NSDateComponents *components = [calendar components: calendarUnits
-											   fromDate: date];
-	[calendar release];
-	
-	NSInteger year = [components year];
-	NSInteger month = [components month];
-	NSInteger day = [components day];
-
-	NSInteger hour = [components hour];
-	NSInteger minute = [components minute];
-	NSInteger second = [components second];
-	NSInteger milliSecond = 0;
-	
-	
+	weight.weightId = values[WeightValueThingId];
+	weight.versionStamp = values[WeightValueVersionStamp];
+	weight.display = values[WeightValueDisplay];
+	weight.units = values[WeightValueUnits];
+	weight.effDate = [DateTimeUtils UtcStringToDate: values[WeightValueEffDate]];
 
-	// Prepares xml.
-	NSString *xml = [NSString stringWithFormat: 
-				@"<when>"
-					 "<date>"
-						"<y>%i</y>"
-						"<m>%i</m>"
-						"<d>%i</d>"
-					"</date>"
-					 "<time>"
-						"<h>%i</h>"
-						"<m>%i</m>"
-						"<s>%i</s>"
-						"<f>%i</f>"
-					 "</time>"
-				"</when>",
-			year, month, day, hour, minute, second, milliSecond];
-	
-	return xml;
+	return weight;
+}
+
+- (NSString *)thingXml {
+
+	return [WeightMapper xmlOfThing: self];
 }
 
 #pragma mark XML Logic
@@ -154,39 +181,23 @@
 		   target: (NSObject *)target
 		 callBack: (SEL)callBack {
 
-	NSString *poundsString = [NSString stringWithFormat: @"%.2f", pounds];
+	// 'when' has no fraction of a second, so the weight shown before it is loaded again has none either.
+	NSDate *dateNow = [NSDate dateWithTimeIntervalSinceReferenceDate: floor([NSDate timeIntervalSinceReferenceDate])];
 
-	// Converts pounds to kgs.
-	const double PoundsToKgsRatio = 2.204;
-	double kgs = pounds / PoundsToKgsRatio;
-	NSString *kgsString = [NSString stringWithFormat: @"%f", kgs];
-
-	NSDate *dateNow = [NSDate date];
-	NSString *whenString = [self getWhenXmlForDate: dateNow];
-
-	// Prepares weight thing xml. It should contain:
-	// weight in pounds
-	// weight in kgs
-	// creation date ('when' tag).
-	NSString *xml = [NSString stringWithFormat:
-					 @"<info>"
-						"<thing>"
-							"<type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
-							"<thing-state>Active</thing-state>"
-							"<flags>0</flags>"
-							"<data-xml>"
-								"<weight>"
-									"%@"
-									"<value>"
-										"<kg>%@</kg>"
-										"<display units=\"pounds\">%@</display>"
-									"</value>"
-								"</weight>"
-								"<common/>"
-							"</data-xml>"
-						"</thing>"
-					 "</info>", 
-					 whenString, kgsString, poundsString];
+	Weight *weight = [Weight new];
+	weight.effDate = dateNow;
+	weight.display = [NSString stringWithFormat: @"%.2f", pounds];
+	weight.units = @"pounds";
+
+	// Prepares weight thing xml, the new weight has no thing-id yet.
+	XmlWriter *writer = [XmlWriter new];
+
+	XML_WRITER_APPEND_LITERAL(writer, "<info>");
+	[WeightMapper appendThing: weight toWriter: writer];
+	XML_WRITER_APPEND_LITERAL(writer, "</info>");
+
+	NSString *xml = writer.string;
+	[writer release];
 
 	// Sends request for putting.
 	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"PutThings"
@@ -194,10 +205,62 @@
 																	 infoSection: xml
 																		  target: target
 																		callBack: callBack];
-	[[WeightTrackerAppDelegate healthVaultService] sendRequest: request];
+	// The weight is completed with its key from the response.
+	request.userState = weight;
+	[weight release];
+
+	[[WeightTrackerAppDelegate requestBatcher] sendRequest: request];
 	[request release];
 }
 
+/// Creates weight saved by putWeight from the PutThings response.
+/// @param response - response to the request sent by putWeight.
+/// @returns Weight instance, or nil if the response doesn't contain the thing key.
++ (Weight *)weightFromPutResponse: (HealthVaultResponse *)response {
+
+	Weight *sentWeight = (Weight *)response.request.userState;
+	XmlElement *thingIdNode = [response.infoElement selectSingleNode: @"thing-id"];
+	NSString *versionStamp = [thingIdNode.attributes objectForKey: @"version-stamp"];
+
+	if (![sentWeight isKindOfClass: [Weight class]] || !thingIdNode.text || !versionStamp) {
+		return nil;
+	}
+
+	Weight *weight = [[Weight new] autorelease];
+	weight.weightId = thingIdNode.text;
+	weight.versionStamp = versionStamp;
+	weight.effDate = sentWeight.effDate;
+	weight.display = sentWeight.display;
+	weight.units = sentWeight.units;
+
+	return weight;
+}
+
+/// Finds position of the weight in a list sorted newest first.
+/// @param weight - the weight.
+/// @param weights - sorted array of Weight.
+/// @returns index of the first weight which isn't newer than the given one.
++ (NSUInteger)insertionIndexOfWeight: (Weight *)weight inWeights: (NSArray *)weights {
+
+	NSUInteger low = 0;
+	NSUInteger high = weights.count;
+
+	while (low < high) {
+
+		NSUInteger middle = low + (high - low) / 2;
+		Weight *middleWeight = [weights objectAtIndex: middle];
+
+		if ([middleWeight.effDate compare: weight.effDate] == NSOrderedDescending) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
 /// Deletes specified weights for current record.
 /// @param weights - array of Weight which should be deleted.
 /// @param target - callback method owner.
@@ -206,29 +269,24 @@
 				  target: (NSObject *)target
 				callBack: (SEL)callBack {
 
-	// Prepares xml for deleting weights.
-	NSMutableString *xml = [[NSMutableString new] autorelease];
-
-	[xml appendString: @"<info>"];
+	// Every weight is one element, they are sent in chunks.
+	NSMutableArray *thingIds = [NSMutableArray arrayWithCapacity: weights.count];
 
-	// Puts thing id to xml.
 	for (Weight *weight in weights) {
 
-		NSString *thingId = [NSString stringWithFormat: @"<thing-id version-stamp='%@'>%@</thing-id>",
-				weight.versionStamp, weight.weightId];
-		[xml appendString: thingId];
+		[thingIds addObject: [HealthVaultBulkOperation thingIdElement: weight.weightId
+														  versionStamp: weight.versionStamp]];
 	}
 
-	[xml appendString: @"</info>"];
-
-	// Sends request for deleting.
-	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"RemoveThings"
-																   methodVersion: 1
-																	 infoSection: xml
-																		  target: target
-																		callBack: callBack];
-	[[WeightTrackerAppDelegate healthVaultService] sendRequest: request];
-	[request release];
+	// Sends requests for deleting.
+	HealthVaultBulkOperation *operation = [[HealthVaultBulkOperation alloc] initWithService: [WeightTrackerAppDelegate healthVaultService]
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: thingIds
+																					 target: target
+																				   callBack: callBack];
+	[operation start];
+	[operation release];
 }
 
 /// Composes HealthVaultRequest to load weights.
@@ -238,20 +296,7 @@
 + (HealthVaultRequest *)getLoadWeightsRequest: (NSObject *)target
 									 callBack: (SEL)callBack {
 	// Prepares xml for retrieving weights.
-	NSString *xml = 
-	@"<info>"
-		"<group>"
-			"<filter>"
-				"<type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id>"
-				"<thing-state>Active</thing-state>"
-			"</filter>"
-			"<format>"
-				"<section>core</section>"
-				"<xml/>"
-				"<type-version-format>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-version-format>"
-			"</format>"
-		"</group>"
-	"</info>";
+	NSString *xml = @"<info><group>" WEIGHT_FILTER_XML WEIGHT_FORMAT_XML @"</group></info>";
 	
 	// Request for retrieving weights.
 	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
@@ -270,7 +315,50 @@
 	
 	HealthVaultRequest *request = [self getLoadWeightsRequest: target
 													 callBack: callBack];
-	[[WeightTrackerAppDelegate healthVaultService] sendRequest: request];
+	[[WeightTrackerAppDelegate requestBatcher] sendRequest: request];
+}
+
+/// Creates pager which loads weights of current record page by page.
+/// @param target - callback method owner.
+/// @param callBack - callback which is invoked for every page.
+/// @returns HealthVaultThingPager instance.
++ (HealthVaultThingPager *)weightPager: (NSObject *)target callBack: (SEL)callBack {
+
+	HealthVaultThingPager *pager = [[HealthVaultThingPager alloc] initWithService: [WeightTrackerAppDelegate healthVaultService]
+																		filterXml: WEIGHT_FILTER_XML
+																		formatXml: WEIGHT_FORMAT_XML
+																		   target: target
+																		 callBack: callBack];
+
+	// The first page can share a round trip with other requests sent at the same time.
+	pager.requestBatcher = [WeightTrackerAppDelegate requestBatcher];
+
+	return [pager autorelease];
+}
+
+/// Returns cache of weights of current record.
+/// @returns HealthVaultThingCache instance.
++ (HealthVaultThingCache *)weightCache {
+
+	HealthVaultThingCache *cache = [[HealthVaultThingCache alloc] initWithDirectory: [HealthVaultThingCache defaultDirectory]
+																		   recordId: [WeightTrackerAppDelegate healthVaultService].currentRecord.recordId
+																			 typeId: WEIGHT_TYPE_ID];
+	return [cache autorelease];
+}
+
+/// Creates sync which brings the weight cache of current record up to date.
+/// @param target - callback method owner.
+/// @param callBack - callback which is invoked when the cache is up to date.
+/// @returns HealthVaultThingSync instance.
++ (HealthVaultThingSync *)weightSync: (NSObject *)target callBack: (SEL)callBack {
+
+	HealthVaultThingSync *sync = [[HealthVaultThingSync alloc] initWithService: [WeightTrackerAppDelegate healthVaultService]
+																		 cache: [self weightCache]
+																	 filterXml: WEIGHT_FILTER_XML
+																	 formatXml: WEIGHT_FORMAT_XML
+																		target: target
+																	  callBack: callBack];
+	return [sync autorelease];
 }
 
 #pragma mark Server Logic End
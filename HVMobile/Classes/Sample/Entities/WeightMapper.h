@@ -0,0 +1,39 @@
+//
+//  WeightMapper.h
+//  Generated by ThingMapperGenerator.py from Weight.thing, do not edit.
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import "HealthVaultThingMapper.h"
+#import "Weight.h"
+
+/// Maps Weight things, type 3d34d87e-7fc1-4153-800f-f56592cb0d17, to xml and back.
+@interface WeightMapper : HealthVaultThingMapper {
+
+	/// The thing being parsed and its properties which have been set.
+	Weight *_thing;
+	uint32_t _assigned;
+
+	/// Components of structured dates and times being parsed.
+	NSInteger _when0[THING_MAPPER_WHEN_COMPONENTS];
+}
+
+/// Writes <thing> element of the Weight.
+/// @param thing - the thing.
+/// @param writer - the writer to write to.
++ (void)appendThing: (Weight *)thing toWriter: (XmlWriter *)writer;
+
+@end
@@ -0,0 +1,343 @@
+//
+//  WeightMapper.m
+//  Generated by ThingMapperGenerator.py from Weight.thing, do not edit.
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "WeightMapper.h"
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+
+/// States of the parser, one for every element on the paths of parsed values.
+enum {
+
+	WeightStateRoot = THING_MAPPER_STATE_FIRST,
+	WeightStateGroup,
+	WeightStateThing,
+	WeightStateThingId,
+	WeightStateEffDate,
+	WeightStateDataXml,
+	WeightStateDataXmlWeight,
+	WeightStateDataXmlWeightWhen,
+	WeightStateDataXmlWeightWhenDate,
+	WeightStateDataXmlWeightWhenDateY,
+	WeightStateDataXmlWeightWhenDateM,
+	WeightStateDataXmlWeightWhenDateD,
+	WeightStateDataXmlWeightWhenTime,
+	WeightStateDataXmlWeightWhenTimeH,
+	WeightStateDataXmlWeightWhenTimeM,
+	WeightStateDataXmlWeightWhenTimeS,
+	WeightStateDataXmlWeightWhenTimeF,
+	WeightStateDataXmlWeightValue,
+	WeightStateDataXmlWeightValueDisplay
+};
+
+/// Bits of the properties which have been set, only the first value of a property is kept.
+enum {
+
+	WeightAssignedWeightId = 1 << 0,
+	WeightAssignedVersionStamp = 1 << 1,
+	WeightAssignedEffDate = 1 << 2,
+	WeightAssignedDisplay = 1 << 3,
+	WeightAssignedUnits = 1 << 4
+};
+
+
+@implementation WeightMapper
+
+- (void)dealloc {
+
+	[_thing release];
+
+	[super dealloc];
+}
+
++ (NSString *)typeId {
+
+	return @"3d34d87e-7fc1-4153-800f-f56592cb0d17";
+}
+
+#pragma mark Writing
+
++ (void)appendThing: (Weight *)thing toWriter: (XmlWriter *)writer {
+
+	XML_WRITER_APPEND_LITERAL(writer, "<thing>");
+	if (thing.weightId || thing.versionStamp) {
+		XML_WRITER_APPEND_LITERAL(writer, "<thing-id");
+		if (thing.versionStamp) {
+			XML_WRITER_APPEND_LITERAL(writer, " version-stamp=\"");
+			[writer appendEscapedString: thing.versionStamp];
+			XML_WRITER_APPEND_LITERAL(writer, "\"");
+		}
+		XML_WRITER_APPEND_LITERAL(writer, ">");
+		[writer appendEscapedString: thing.weightId];
+		XML_WRITER_APPEND_LITERAL(writer, "</thing-id>");
+	}
+	XML_WRITER_APPEND_LITERAL(writer, "<type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id><thing-state>Active</thing-state><flags>0</flags><data-xml><weight>");
+	if (thing.effDate) {
+		XML_WRITER_APPEND_LITERAL(writer, "<when>");
+		[HealthVaultThingMapper appendWhenOfDate: thing.effDate toWriter: writer];
+		XML_WRITER_APPEND_LITERAL(writer, "</when>");
+	}
+	XML_WRITER_APPEND_LITERAL(writer, "<value><kg>");
+	[writer appendDouble: thing.kg];
+	XML_WRITER_APPEND_LITERAL(writer, "</kg>");
+	if (thing.display || thing.units) {
+		XML_WRITER_APPEND_LITERAL(writer, "<display");
+		if (thing.units) {
+			XML_WRITER_APPEND_LITERAL(writer, " units=\"");
+			[writer appendEscapedString: thing.units];
+			XML_WRITER_APPEND_LITERAL(writer, "\"");
+		}
+		XML_WRITER_APPEND_LITERAL(writer, ">");
+		[writer appendEscapedString: thing.display];
+		XML_WRITER_APPEND_LITERAL(writer, "</display>");
+	}
+	XML_WRITER_APPEND_LITERAL(writer, "</value></weight><common/></data-xml></thing>");
+}
+
+#pragma mark Writing End
+
+#pragma mark Parsing
+
+- (NSInteger)stateForElement: (NSString *)name inState: (NSInteger)state {
+
+	switch (state) {
+
+		case THING_MAPPER_STATE_DOCUMENT:
+			return WeightStateRoot;
+
+		case WeightStateRoot:
+			return [name isEqualToString: @"group"] ? WeightStateGroup : THING_MAPPER_STATE_NONE;
+
+		case WeightStateGroup:
+			return [name isEqualToString: @"thing"] ? WeightStateThing : THING_MAPPER_STATE_NONE;
+
+		case WeightStateThing:
+			if ([name isEqualToString: @"thing-id"]) return WeightStateThingId;
+			if ([name isEqualToString: @"eff-date"]) return WeightStateEffDate;
+			if ([name isEqualToString: @"data-xml"]) return WeightStateDataXml;
+			break;
+
+		case WeightStateDataXml:
+			if ([name isEqualToString: @"weight"]) return WeightStateDataXmlWeight;
+			break;
+
+		case WeightStateDataXmlWeight:
+			if ([name isEqualToString: @"when"]) return WeightStateDataXmlWeightWhen;
+			if ([name isEqualToString: @"value"]) return WeightStateDataXmlWeightValue;
+			break;
+
+		case WeightStateDataXmlWeightWhen:
+			if ([name isEqualToString: @"date"]) return WeightStateDataXmlWeightWhenDate;
+			if ([name isEqualToString: @"time"]) return WeightStateDataXmlWeightWhenTime;
+			break;
+
+		case WeightStateDataXmlWeightWhenDate:
+			if ([name isEqualToString: @"y"]) return WeightStateDataXmlWeightWhenDateY;
+			if ([name isEqualToString: @"m"]) return WeightStateDataXmlWeightWhenDateM;
+			if ([name isEqualToString: @"d"]) return WeightStateDataXmlWeightWhenDateD;
+			break;
+
+		case WeightStateDataXmlWeightWhenTime:
+			if ([name isEqualToString: @"h"]) return WeightStateDataXmlWeightWhenTimeH;
+			if ([name isEqualToString: @"m"]) return WeightStateDataXmlWeightWhenTimeM;
+			if ([name isEqualToString: @"s"]) return WeightStateDataXmlWeightWhenTimeS;
+			if ([name isEqualToString: @"f"]) return WeightStateDataXmlWeightWhenTimeF;
+			break;
+
+		case WeightStateDataXmlWeightValue:
+			if ([name isEqualToString: @"display"]) return WeightStateDataXmlWeightValueDisplay;
+			break;
+	}
+
+	return THING_MAPPER_STATE_NONE;
+}
+
+- (void)enterState: (NSInteger)state attributes: (NSDictionary *)attributes {
+
+	switch (state) {
+
+		case WeightStateThing:
+			[_thing release];
+			_thing = [Weight new];
+			_assigned = 0;
+			break;
+
+		case WeightStateThingId: {
+
+			[self collectText];
+
+			NSString *attribute = [attributes objectForKey: @"version-stamp"];
+
+			if (attribute && !(_assigned & WeightAssignedVersionStamp)) {
+
+				_thing.versionStamp = attribute;
+				_assigned |= WeightAssignedVersionStamp;
+			}
+
+			break;
+		}
+
+		case WeightStateEffDate:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhen:
+			memset(_when0, 0, sizeof(_when0));
+			break;
+
+		case WeightStateDataXmlWeightValueDisplay: {
+
+			[self collectText];
+
+			NSString *attribute = [attributes objectForKey: @"units"];
+
+			if (attribute && !(_assigned & WeightAssignedUnits)) {
+
+				_thing.units = attribute;
+				_assigned |= WeightAssignedUnits;
+			}
+
+			break;
+		}
+
+		case WeightStateDataXmlWeightWhenDateY:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenDateM:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenDateD:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeH:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeM:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeS:
+			[self collectText];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeF:
+			[self collectText];
+			break;
+	}
+}
+
+- (void)leaveState: (NSInteger)state {
+
+	switch (state) {
+
+		case WeightStateThing:
+			[self addThing: _thing];
+			[_thing release];
+			_thing = nil;
+			break;
+
+		case WeightStateThingId: {
+
+			NSString *text = self.text;
+
+			if (text && !(_assigned & WeightAssignedWeightId)) {
+
+				_thing.weightId = text;
+				_assigned |= WeightAssignedWeightId;
+			}
+
+			break;
+		}
+
+		case WeightStateEffDate: {
+
+			NSString *text = self.text;
+
+			NSDate *value = [DateTimeUtils UtcStringToDate: text];
+
+			if (value && !(_assigned & WeightAssignedEffDate)) {
+
+				_thing.effDate = value;
+				_assigned |= WeightAssignedEffDate;
+			}
+
+			break;
+		}
+
+		case WeightStateDataXmlWeightWhen: {
+
+			NSDate *value = [HealthVaultThingMapper dateWithWhenComponents: _when0];
+
+			if (value && !(_assigned & WeightAssignedEffDate)) {
+
+				_thing.effDate = value;
+				_assigned |= WeightAssignedEffDate;
+			}
+
+			break;
+		}
+
+		case WeightStateDataXmlWeightValueDisplay: {
+
+			NSString *text = self.text;
+
+			if (text && !(_assigned & WeightAssignedDisplay)) {
+
+				_thing.display = text;
+				_assigned |= WeightAssignedDisplay;
+			}
+
+			break;
+		}
+
+		case WeightStateDataXmlWeightWhenDateY:
+			_when0[0] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenDateM:
+			_when0[1] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenDateD:
+			_when0[2] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeH:
+			_when0[3] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeM:
+			_when0[4] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeS:
+			_when0[5] = [self.text integerValue];
+			break;
+
+		case WeightStateDataXmlWeightWhenTimeF:
+			_when0[6] = [self.text integerValue];
+			break;
+	}
+}
+
+#pragma mark Parsing End
+
+@end
@@ -22,6 +22,13 @@
 
 #define HEALTH_VAULT_MASTER_APPLICATION_ID @"cf36aef7-5d87-4688-88b2-f9b57c086d7d"
 
+/// How long authorized people are answered from the response cache, in seconds.
+#define AUTHORIZED_PEOPLE_CACHE_TIME_TO_LIVE (24 * 60 * 60)
+
+/// How long things are answered from the response cache, in seconds.
+/// Own writes drop cached things of the record at once.
+#define THINGS_CACHE_TIME_TO_LIVE (10 * 60)
+
 /// Enables/Disables debug logic in app.
 /// #define DEBUG_MODE 1
 
@@ -33,6 +40,9 @@
 	/// Enables memory tracker.
 	#define ENABLE_MEMORY_TRACKER 1
 
+	/// Enables timing of HealthVault requests, the report is logged when the app goes to background.
+	#define ENABLE_REQUEST_METRICS 1
+
 #endif
 
 /// Interval between tracking memory by tracker.
@@ -18,6 +18,7 @@
 
 #import <UIKit/UIKit.h>
 #import "HealthVaultService.h"
+#import "HealthVaultRequestBatcher.h"
 
 
 /// Application delegate.
@@ -45,6 +46,10 @@
 /// @returns HealthVaultService instance.
 + (HealthVaultService *)healthVaultService;
 
+/// Returns batcher which merges data requests sent to HealthVault service.
+/// @returns HealthVaultRequestBatcher instance.
++ (HealthVaultRequestBatcher *)requestBatcher;
+
 /// Shows progress view.
 + (void)showProgressView;
 
@@ -18,6 +18,9 @@
 
 #import "WeightTrackerAppDelegate.h"
 #import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+#import "HealthVaultMetricsHistogram.h"
+#import "Logger.h"
 
 #import "IntroViewController.h"
 
@@ -46,6 +49,14 @@
 /// Initialized by initHealthVault method.
 static HealthVaultService *_healthVaultService = nil;
 
+/// Latency histograms of requests sent to HealthVault service, nil unless ENABLE_REQUEST_METRICS is set.
+/// Initialized by initHealthVault method.
+static HealthVaultMetricsHistogram *_metricsHistogram = nil;
+
+/// Batcher of requests sent to HealthVault service.
+/// Initialized by initHealthVault method.
+static HealthVaultRequestBatcher *_requestBatcher = nil;
+
 
 #pragma mark Application Lifecycle
 
@@ -65,6 +76,19 @@ static HealthVaultService *_healthVaultService = nil;
 	return YES;
 }
 
+- (void)applicationDidBecomeActive: (UIApplication *)application {
+
+	// Writes made offline are sent when the app comes back.
+	[_healthVaultService replayWriteJournal];
+}
+
+- (void)applicationDidEnterBackground: (UIApplication *)application {
+
+	if (_metricsHistogram) {
+		[Logger write: [_metricsHistogram report]];
+	}
+}
+
 #pragma mark Application Lifecycle End
 
 
@@ -77,6 +101,37 @@ static HealthVaultService *_healthVaultService = nil;
 	// Loads default settings for service.
 	[_healthVaultService loadSettings: @"Default"];
 
+	// Authorized people and the record image rarely change, so they aren't requested on every launch.
+	HealthVaultResponseCache *responseCache = [[HealthVaultResponseCache alloc] initWithDirectory: [HealthVaultResponseCache defaultDirectory]];
+	[responseCache setTimeToLive: AUTHORIZED_PEOPLE_CACHE_TIME_TO_LIVE forMethod: @"GetAuthorizedPeople"];
+	[responseCache setTimeToLive: THINGS_CACHE_TIME_TO_LIVE forMethod: @"GetThings"];
+	_healthVaultService.responseCache = responseCache;
+	[responseCache release];
+
+	// Weights saved while HealthVault isn't reachable are kept until they can be sent.
+	HealthVaultWriteJournal *writeJournal = [[HealthVaultWriteJournal alloc] initWithPath: [HealthVaultWriteJournal defaultPath]];
+	_healthVaultService.writeJournal = writeJournal;
+	[writeJournal release];
+
+	// Dropped connections and busy servers are retried with backoff before the user sees an error.
+	HealthVaultRetryPolicy *retryPolicy = [HealthVaultRetryPolicy new];
+	_healthVaultService.retryPolicy = retryPolicy;
+	[retryPolicy release];
+
+	// Requests are signed and responses parsed off the main thread, so large ones don't stall the UI.
+	NSOperationQueue *processingQueue = [NSOperationQueue new];
+	processingQueue.maxConcurrentOperationCount = DEFAULT_MAX_CONCURRENT_PROCESSING;
+	_healthVaultService.processingQueue = processingQueue;
+	[processingQueue release];
+
+#ifdef ENABLE_REQUEST_METRICS
+	_metricsHistogram = [HealthVaultMetricsHistogram new];
+	_healthVaultService.metricsSink = _metricsHistogram;
+#endif
+
+	// Data requests issued back to back share one round trip.
+	_requestBatcher = [[HealthVaultRequestBatcher alloc] initWithService: _healthVaultService];
+
 #ifdef LOG_SERVER_REQUEST_AND_RESPONSE
 	//where to trace communication with HealthVault messages or not
 	[WebTransport setRequestResponseLogEnabled: LOG_SERVER_REQUEST_AND_RESPONSE];
@@ -98,6 +153,13 @@ static HealthVaultService *_healthVaultService = nil;
 	return _healthVaultService;
 }
 
+/// Returns batcher which merges data requests sent to HealthVault service.
+/// @returns HealthVaultRequestBatcher instance.
++ (HealthVaultRequestBatcher *)requestBatcher {
+
+	return _requestBatcher;
+}
+
 /// Shows progress view.
 + (void)showProgressView {
 
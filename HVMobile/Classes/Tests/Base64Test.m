@@ -0,0 +1,126 @@
+//
+//  Base64Test.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "Base64Test.h"
+#import "Base64.h"
+#import "XmlDocument.h"
+
+
+@implementation Base64Test
+
+- (NSData *)dataWithString: (NSString *)string {
+	return [string dataUsingEncoding: NSUTF8StringEncoding];
+}
+
+- (void)testEncode {
+	STAssertNil([Base64 encodeBase64WithData: [NSData data]], @"Empty data has been encoded");
+	STAssertEqualObjects([Base64 encodeBase64WithData: [self dataWithString: @"f"]], @"Zg==", @"Encoded text isn't equal to expected");
+	STAssertEqualObjects([Base64 encodeBase64WithData: [self dataWithString: @"fo"]], @"Zm8=", @"Encoded text isn't equal to expected");
+	STAssertEqualObjects([Base64 encodeBase64WithData: [self dataWithString: @"foo"]], @"Zm9v", @"Encoded text isn't equal to expected");
+	STAssertEqualObjects([Base64 encodeBase64WithData: [self dataWithString: @"The quick brown fox jumps over the lazy dog."]],
+						 @"VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZy4=", @"Encoded text isn't equal to expected");
+}
+
+- (void)testEncodeOptions {
+	const uint8_t bytes[] = { 0xfb, 0xff, 0xbf, 0xfb };
+	NSData *data = [NSData dataWithBytes: bytes length: sizeof(bytes)];
+
+	STAssertEqualObjects([Base64 encodeBase64WithData: data options: 0], @"+/+/+w==", @"Standard alphabet isn't used");
+	STAssertEqualObjects([Base64 encodeBase64WithData: data options: Base64EncodingUrlSafe], @"-_-_-w==", @"URL-safe alphabet isn't used");
+	STAssertEqualObjects([Base64 encodeBase64WithData: data options: Base64EncodingUrlSafe | Base64EncodingNoPadding], @"-_-_-w", @"Padding hasn't been omitted");
+}
+
+- (void)testEncodeToBuffer {
+	char buffer[16];
+	memset(buffer, '#', sizeof(buffer));
+
+	NSUInteger expectedLength = [Base64 encodedLengthOfLength: 5 options: 0];
+	NSUInteger length = [Base64 encodeBase64WithBytes: "fooba" length: 5 toBuffer: buffer options: 0];
+
+	STAssertEquals(length, expectedLength, @"Count of written characters isn't equal to expected");
+	STAssertEquals(memcmp(buffer, "Zm9vYmE=#", 9), 0, @"Buffer content isn't equal to expected");
+	STAssertEquals([Base64 encodedLengthOfLength: 5 options: Base64EncodingNoPadding], (NSUInteger)7, @"Unpadded length isn't equal to expected");
+}
+
+- (void)testRoundTrip {
+	NSMutableData *data = [NSMutableData data];
+
+	for (NSUInteger length = 1; length <= 100; length++) {
+
+		uint8_t byte = (uint8_t)(length * 37);
+		[data appendBytes: &byte length: 1];
+
+		for (Base64EncodingOptions options = 0; options < 4; options++) {
+
+			NSString *text = [Base64 encodeBase64WithData: data options: options];
+			STAssertEquals(text.length, [Base64 encodedLengthOfLength: length options: options], @"Length of text isn't equal to expected");
+			STAssertEqualObjects([Base64 decodeBase64WithString: text], data, @"Decoded data of length %u isn't equal to original", length);
+		}
+	}
+}
+
+- (void)testDecode {
+	STAssertEqualObjects([Base64 decodeBase64WithString: @""], [NSData data], @"Empty text isn't decoded to empty data");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zg=="], [self dataWithString: @"f"], @"Decoded data isn't equal to expected");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zm8="], [self dataWithString: @"fo"], @"Decoded data isn't equal to expected");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zm9v"], [self dataWithString: @"foo"], @"Decoded data isn't equal to expected");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zm9vYmFy"], [self dataWithString: @"foobar"], @"Decoded data isn't equal to expected");
+}
+
+- (void)testDecodeWhiteSpaceAndAlphabets {
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zm9v\r\nYmE=\n"], [self dataWithString: @"fooba"], @"Wrapped text isn't decoded");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"Zm9vYg"], [self dataWithString: @"foob"], @"Unpadded text isn't decoded");
+
+	const uint8_t bytes[] = { 0xfb, 0xff, 0xbf };
+	NSData *expected = [NSData dataWithBytes: bytes length: sizeof(bytes)];
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"+/+/"], expected, @"Standard alphabet isn't decoded");
+	STAssertEqualObjects([Base64 decodeBase64WithString: @"-_-_"], expected, @"URL-safe alphabet isn't decoded");
+}
+
+- (void)testDecodeInvalidText {
+	STAssertNil([Base64 decodeBase64WithString: @"Z"], @"Single character has been decoded");
+	STAssertNil([Base64 decodeBase64WithString: @"Zm9v$mFy"], @"Invalid character has been decoded");
+	STAssertNil([Base64 decodeBase64WithString: @"Zg==Zg=="], @"Data after padding has been decoded");
+	STAssertNil([Base64 decodeBase64WithString: @"Z==="], @"Excessive padding has been decoded");
+	STAssertNil([Base64 decodeBase64WithString: @"Zm9vé"], @"Non-ASCII character has been decoded");
+}
+
+- (void)testStreamingDecode {
+	const char *text = "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZy4=";
+	NSData *expected = [self dataWithString: @"The quick brown fox jumps over the lazy dog."];
+
+	for (NSUInteger chunkSize = 1; chunkSize <= 8; chunkSize++) {
+		Base64Decoder *decoder = [[Base64Decoder alloc] initWithCapacity: 0];
+
+		for (NSUInteger offset = 0; offset < strlen(text); offset += chunkSize) {
+			STAssertTrue([decoder decodeBytes: text + offset length: MIN(chunkSize, strlen(text) - offset)], @"Couldn't decode chunk");
+		}
+
+		STAssertEqualObjects([decoder finish], expected, @"Data decoded in chunks of %u isn't equal to expected", chunkSize);
+		[decoder release];
+	}
+}
+
+- (void)testDecodeFromDocument {
+	XmlDocument *document = [XmlDocument documentWithString: @"<blob><base64data>Zm9v\nYmFy<!-- split -->Zm9v</base64data></blob>"];
+	XmlElement *node = [document.rootElement selectSingleNode: @"base64data"];
+
+	STAssertEqualObjects(node.base64Value, [self dataWithString: @"foobarfoo"], @"Text of element isn't decoded");
+}
+
+@end
@@ -0,0 +1,98 @@
+//
+//  DateTimeUtilsTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "DateTimeUtilsTest.h"
+#import "DateTimeUtils.h"
+
+
+@implementation DateTimeUtilsTest
+
+- (NSDateFormatter *)formatterWithFormat: (NSString *)format {
+	NSDateFormatter *formatter = [[NSDateFormatter new] autorelease];
+	[formatter setLocale: [[[NSLocale alloc] initWithLocaleIdentifier: @"en_US_POSIX"] autorelease]];
+	[formatter setTimeZone: [NSTimeZone timeZoneWithAbbreviation: @"UTC"]];
+	[formatter setDateFormat: format];
+	return formatter;
+}
+
+- (void)testFormat {
+	STAssertEqualObjects([DateTimeUtils dateToUtcString: [NSDate dateWithTimeIntervalSinceReferenceDate: 0]],
+						 @"2001-01-01T00:00:00.000Z", @"Reference date isn't formatted as expected");
+	STAssertEqualObjects([DateTimeUtils dateToUtcString: [NSDate dateWithTimeIntervalSinceReferenceDate: -0.001]],
+						 @"2000-12-31T23:59:59.999Z", @"Date before the reference date isn't formatted as expected");
+	STAssertEqualObjects([DateTimeUtils dateToUtcString: [NSDate dateWithTimeIntervalSinceReferenceDate: 5155200.25]],
+						 @"2001-03-01T16:00:00.250Z", @"Date isn't formatted as expected");
+	STAssertNil([DateTimeUtils dateToUtcString: nil], @"Missing date has been formatted");
+
+	char buffer[DATE_TIME_UTC_STRING_LENGTH];
+	STAssertTrue([DateTimeUtils formatUtcTime: 0 toBuffer: buffer] == DATE_TIME_UTC_STRING_LENGTH, @"Wrong count of characters has been written");
+	STAssertTrue([DateTimeUtils formatUtcTime: 1e12 toBuffer: buffer] == 0, @"Year out of range has been formatted");
+}
+
+- (void)testParseVariants {
+	NSTimeInterval expected = [[self formatterWithFormat: @"yyyy-MM-dd'T'HH:mm:ss"] dateFromString: @"2011-04-21T10:00:00"].timeIntervalSinceReferenceDate;
+
+	STAssertEquals([DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00"].timeIntervalSinceReferenceDate, expected, @"Timestamp without fraction isn't parsed");
+	STAssertEquals([DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00Z"].timeIntervalSinceReferenceDate, expected, @"Timestamp with Z isn't parsed");
+	STAssertEqualsWithAccuracy([DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00.5"].timeIntervalSinceReferenceDate, expected + 0.5, 1e-6, @"Fraction isn't parsed");
+	STAssertEqualsWithAccuracy([DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00.123Z"].timeIntervalSinceReferenceDate, expected + 0.123, 1e-6, @"Milliseconds aren't parsed");
+	STAssertEqualsWithAccuracy([DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00.1234567"].timeIntervalSinceReferenceDate, expected + 0.1234567, 1e-6, @"Seven digit fraction isn't parsed");
+	STAssertEquals([DateTimeUtils UtcStringToDate: @"2011-04-21T12:30:00+02:30"].timeIntervalSinceReferenceDate, expected, @"Time zone offset isn't applied");
+	STAssertEquals([DateTimeUtils UtcStringToDate: @"2011-04-21T07:00:00-03:00"].timeIntervalSinceReferenceDate, expected, @"Negative time zone offset isn't applied");
+
+	NSMutableString *mutableString = [NSMutableString stringWithString: @"2011-04-21T10:00:00"];
+	STAssertEquals([DateTimeUtils UtcStringToDate: mutableString].timeIntervalSinceReferenceDate, expected, @"Mutable string isn't parsed");
+}
+
+- (void)testParseInvalid {
+	NSString *invalid[] = { @"", @"2011-04-21", @"2011-04-21T10:00", @"2011-04-21 10:00:00", @"2011-13-01T00:00:00",
+		@"2011-02-29T00:00:00", @"2011-04-21T24:00:00", @"2011-04-21T10:00:00.", @"2011-04-21T10:00:00+0200",
+		@"2011-04-21T10:00:00ZZ", @"2011-04-21T10:0a:00", @"0000-01-01T00:00:00" };
+
+	for (NSUInteger i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		STAssertNil([DateTimeUtils UtcStringToDate: invalid[i]], @"Invalid timestamp %@ has been parsed", invalid[i]);
+	}
+
+	STAssertNil([DateTimeUtils UtcStringToDate: nil], @"Missing timestamp has been parsed");
+	STAssertNotNil([DateTimeUtils UtcStringToDate: @"2012-02-29T00:00:00"], @"Leap day hasn't been parsed");
+}
+
+- (void)testRoundTrip {
+	NSDateFormatter *formatter = [self formatterWithFormat: @"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'"];
+
+	// Dates from 1901 to 2099, a bit more than 17 days apart; half seconds are exact, so rounding can't differ.
+	for (NSTimeInterval time = -3155673600.0; time < 3124137600.0; time += 1501234.5) {
+		NSDate *date = [NSDate dateWithTimeIntervalSinceReferenceDate: time];
+		NSString *string = [DateTimeUtils dateToUtcString: date];
+
+		STAssertEqualObjects(string, [formatter stringFromDate: date], @"Timestamp differs from NSDateFormatter");
+		STAssertEqualsWithAccuracy([DateTimeUtils UtcStringToDate: string].timeIntervalSinceReferenceDate, time, 0.0005, @"Timestamp %@ isn't parsed back", string);
+	}
+}
+
+- (void)testBulkParse {
+	NSArray *strings = [NSArray arrayWithObjects: @"2011-04-21T10:00:00", @"invalid", @"2011-04-21T10:00:01.5Z", nil];
+	NSTimeInterval times[3];
+
+	STAssertTrue([DateTimeUtils parseUtcStrings: strings times: times] == 2, @"Wrong count of valid timestamps");
+	STAssertEquals(times[0], [DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00"].timeIntervalSinceReferenceDate, @"Timestamp isn't parsed");
+	STAssertTrue(isnan(times[1]), @"Invalid timestamp has been parsed");
+	STAssertEqualsWithAccuracy(times[2], times[0] + 1.5, 1e-6, @"Timestamp isn't parsed");
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  HealthVaultBulkOperationTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+
+/// Implements tests for HealthVaultBulkOperation class.
+/// Contains tests to check chunking, parallelism and partial failures against a local server.
+@interface HealthVaultBulkOperationTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+
+	/// Count of elements in every received request.
+	NSMutableArray *_chunkSizes;
+	NSUInteger _progressCount;
+	BOOL _isDone;
+}
+
+@end
@@ -0,0 +1,197 @@
+//
+//  HealthVaultBulkOperationTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultBulkOperationTest.h"
+#import "HealthVaultBulkOperation.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+/// Thing id the server refuses to remove.
+#define FAILING_THING_ID @"failing"
+
+
+@interface HealthVaultBulkOperationTest (Private)
+
+/// Creates RemoveThings elements for things t0...t(count - 1).
++ (NSArray *)thingIdElements: (NSUInteger)count;
+
+@end
+
+
+@implementation HealthVaultBulkOperationTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	_chunkSizes = [NSMutableArray new];
+	_progressCount = 0;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_hvService release];
+	[_server stop];
+	[_server release];
+	[_chunkSizes release];
+}
+
++ (NSArray *)thingIdElements: (NSUInteger)count {
+	NSMutableArray *elements = [NSMutableArray arrayWithCapacity: count];
+
+	for (NSUInteger i = 0; i < count; i++) {
+		[elements addObject: [HealthVaultBulkOperation thingIdElement: [NSString stringWithFormat: @"t%u", i]
+														  versionStamp: @"1"]];
+	}
+
+	return elements;
+}
+
+/// Fails requests which contain FAILING_THING_ID and succeeds the rest.
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	XmlElement *info = [[XmlDocument documentWithString: requestBody].rootElement selectSingleNode: @"info"];
+	NSArray *thingIds = [info selectNodes: @"thing-id"];
+
+	[_chunkSizes addObject: [NSNumber numberWithUnsignedInteger: thingIds.count]];
+
+	for (XmlElement *thingId in thingIds) {
+		if ([thingId.text isEqualToString: FAILING_THING_ID]) {
+			return @"<response><status><code>3</code><error><message>Failed</message></error></status></response>";
+		}
+	}
+
+	return @"<response><status><code>0</code></status></response>";
+}
+
+- (void)chunkCompleted: (HealthVaultResponse *)response {
+	_progressCount++;
+}
+
+- (void)operationCompleted: (HealthVaultBulkOperation *)operation {
+	_isDone = YES;
+}
+
+- (void)testChunksByCount {
+	HealthVaultBulkOperation *operation = [[[HealthVaultBulkOperation alloc] initWithService: _hvService
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: [HealthVaultBulkOperationTest thingIdElements: 250]
+																					 target: self
+																				   callBack: @selector(operationCompleted:)] autorelease];
+	operation.maxChunkElements = 100;
+	[operation setProgressTarget: self callBack: @selector(chunkCompleted:)];
+	[operation start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(operation.chunkCount == 3, @"Unexpected count of chunks: %u", operation.chunkCount);
+	STAssertTrue(_server.requestCount == 3, @"Unexpected count of requests: %u", _server.requestCount);
+	STAssertTrue(_progressCount == 3, @"Progress hasn't been reported for every chunk");
+	STAssertTrue([[_chunkSizes valueForKeyPath: @"@sum.unsignedIntegerValue"] unsignedIntegerValue] == 250,
+				 @"Not all elements have been sent");
+	STAssertTrue([[_chunkSizes valueForKeyPath: @"@max.unsignedIntegerValue"] unsignedIntegerValue] == 100,
+				 @"Chunk exceeds maxChunkElements");
+	STAssertFalse(operation.hasError, @"Operation has failed");
+	STAssertTrue(operation.responses.count == 3, @"Responses of all chunks aren't available");
+}
+
+- (void)testChunksByLength {
+	NSArray *elements = [HealthVaultBulkOperationTest thingIdElements: 40];
+	NSUInteger elementLength = [[elements lastObject] length];
+
+	HealthVaultBulkOperation *operation = [[[HealthVaultBulkOperation alloc] initWithService: _hvService
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: elements
+																					 target: self
+																				   callBack: @selector(operationCompleted:)] autorelease];
+	// room for 10 elements of the longest length
+	operation.maxChunkLength = 13 + 10 * elementLength;
+	[operation start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(operation.chunkCount >= 4, @"Chunks aren't bounded by length");
+	STAssertTrue([[_chunkSizes valueForKeyPath: @"@sum.unsignedIntegerValue"] unsignedIntegerValue] == 40,
+				 @"Not all elements have been sent");
+	STAssertFalse(operation.hasError, @"Operation has failed");
+}
+
+- (void)testConcurrency {
+	_server.responseDelay = 0.1;
+
+	HealthVaultBulkOperation *operation = [[[HealthVaultBulkOperation alloc] initWithService: _hvService
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: [HealthVaultBulkOperationTest thingIdElements: 100]
+																					 target: self
+																				   callBack: @selector(operationCompleted:)] autorelease];
+	operation.maxChunkElements = 10;
+	operation.maxConcurrentChunks = 3;
+	[operation start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 10, @"Unexpected count of requests: %u", _server.requestCount);
+	STAssertTrue(_server.maxActiveRequestCount <= 3, @"Too many chunks in flight: %u", _server.maxActiveRequestCount);
+	STAssertTrue(_server.maxActiveRequestCount > 1, @"Chunks haven't been sent in parallel");
+}
+
+- (void)testPartialFailure {
+	NSMutableArray *elements = [NSMutableArray arrayWithArray: [HealthVaultBulkOperationTest thingIdElements: 30]];
+	[elements replaceObjectAtIndex: 15 withObject: [HealthVaultBulkOperation thingIdElement: FAILING_THING_ID versionStamp: @"1"]];
+
+	HealthVaultBulkOperation *operation = [[[HealthVaultBulkOperation alloc] initWithService: _hvService
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: elements
+																					 target: self
+																				   callBack: @selector(operationCompleted:)] autorelease];
+	operation.maxChunkElements = 10;
+	[operation start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(operation.hasError, @"Error hasn't been reported");
+	STAssertNotNil(operation.errorText, @"Error text hasn't been set");
+	STAssertTrue(operation.completedChunkCount == 3, @"Not all chunks have completed");
+	STAssertTrue(operation.failedChunkCount == 1, @"Unexpected count of failed chunks");
+	STAssertEqualObjects(operation.failedElements, [elements subarrayWithRange: NSMakeRange(10, 10)],
+						 @"Failed elements aren't elements of the failed chunk");
+}
+
+- (void)testNoElements {
+	HealthVaultBulkOperation *operation = [[[HealthVaultBulkOperation alloc] initWithService: _hvService
+																				 methodName: @"RemoveThings"
+																			  methodVersion: 1
+																				   elements: [NSArray array]
+																					 target: self
+																				   callBack: @selector(operationCompleted:)] autorelease];
+	[operation start];
+
+	STAssertTrue(_isDone, @"Empty operation hasn't completed at once");
+	STAssertTrue(_server.requestCount == 0, @"Request has been sent");
+	STAssertFalse(operation.hasError, @"Empty operation has failed");
+}
+
+@end
@@ -0,0 +1,207 @@
+//
+//  HealthVaultMetricsHistogramTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultMetricsHistogramTest.h"
+#import "HealthVaultMetricsHistogram.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "MobilePlatformTest.h"
+
+/// Body the local server answers with.
+#define RESPONSE_BODY @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"/></response>"
+
+
+@interface HealthVaultMetricsHistogramTest (Private)
+
+/// Creates span of the method with the given total duration.
++ (HealthVaultRequestMetrics *)metrics: (NSString *)methodName total: (NSTimeInterval)duration;
+
+/// Sends request to the local server and waits for the response.
+- (HealthVaultRequest *)send: (NSString *)methodName;
+
+@end
+
+
+@implementation HealthVaultMetricsHistogramTest
+
+- (void)setUp {
+
+	_server = [LocalHttpServer new];
+	_server.responseBody = RESPONSE_BODY;
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	_metrics = [NSMutableArray new];
+	_isDone = NO;
+}
+
+- (void)tearDown {
+
+	[_hvService release];
+	[_server stop];
+	[_server release];
+	[_metrics release];
+	[_response release];
+}
+
++ (HealthVaultRequestMetrics *)metrics: (NSString *)methodName total: (NSTimeInterval)duration {
+
+	HealthVaultRequestMetrics *metrics = [[[HealthVaultRequestMetrics alloc] initWithMethodName: methodName] autorelease];
+	[metrics addDuration: duration toStage: HealthVaultRequestStageTotal];
+
+	return metrics;
+}
+
+- (void)testPercentiles {
+
+	HealthVaultMetricsHistogram *histogram = [[HealthVaultMetricsHistogram new] autorelease];
+
+	// 1 ms to 1 s, shuffled by the stride
+	for (NSUInteger i = 0; i < 1000; i++) {
+
+		NSUInteger milliseconds = 1 + (i * 7) % 1000;
+		HealthVaultRequestMetrics *metrics = [HealthVaultMetricsHistogramTest metrics: @"GetThings" total: milliseconds / 1000.0];
+		metrics.hasError = milliseconds % 100 == 0;
+
+		[histogram requestCompleted: metrics];
+	}
+
+	[histogram requestCompleted: [HealthVaultMetricsHistogramTest metrics: @"PutThings" total: 0.2]];
+
+	STAssertTrue([histogram countForMethod: @"GetThings"] == 1000, @"Unexpected count: %u", [histogram countForMethod: @"GetThings"]);
+	STAssertTrue([histogram errorCountForMethod: @"GetThings"] == 10, @"Unexpected count of errors");
+	STAssertTrue([histogram countForMethod: @"GetPersonInfo"] == 0, @"Method without requests has count");
+	STAssertEqualObjects(histogram.methodNames, ([NSArray arrayWithObjects: @"GetThings", @"PutThings", nil]), @"Unexpected methods");
+
+	double percentiles[] = { 50, 95, 99 };
+
+	for (NSUInteger i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+
+		NSTimeInterval expected = percentiles[i] / 100;
+		NSTimeInterval actual = [histogram percentile: percentiles[i] ofStage: HealthVaultRequestStageTotal forMethod: @"GetThings"];
+
+		STAssertTrue(actual >= expected && actual <= expected * 1.1, @"p%.0f is %f, expected %f", percentiles[i], actual, expected);
+	}
+
+	STAssertEqualsWithAccuracy([histogram percentile: 100 ofStage: HealthVaultRequestStageTotal forMethod: @"GetThings"], 1.0, 0.000001,
+							   @"p100 isn't the maximum");
+	STAssertEqualsWithAccuracy([histogram percentile: 50 ofStage: HealthVaultRequestStageTotal forMethod: @"PutThings"], 0.2, 0.000001,
+							   @"Percentile of a single request isn't its duration");
+	STAssertTrue([histogram percentile: 99 ofStage: HealthVaultRequestStageParse forMethod: @"GetThings"] == 0, @"Empty stage has duration");
+
+	STAssertTrue([[histogram report] rangeOfString: @"PutThings"].location != NSNotFound, @"Report doesn't list the method");
+
+	[histogram reset];
+	STAssertTrue(histogram.methodNames.count == 0, @"Histogram hasn't been reset");
+}
+
+- (void)requestCompleted: (HealthVaultRequestMetrics *)metrics {
+
+	[_metrics addObject: metrics];
+}
+
+- (void)responseReceived: (HealthVaultResponse *)response {
+
+	[_response release];
+	_response = [response retain];
+	_isDone = YES;
+}
+
+- (HealthVaultRequest *)send: (NSString *)methodName {
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: methodName
+																	 methodVersion: 3
+																	   infoSection: @"<info><group/></info>"
+																			target: self
+																		  callBack: @selector(responseReceived:)] autorelease];
+	_isDone = NO;
+	[_hvService sendRequest: request];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request hasn't been completed");
+
+	return request;
+}
+
+- (void)testNoSink {
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																	 methodVersion: 3
+																	   infoSection: @"<info/>"
+																			target: self
+																		  callBack: @selector(responseReceived:)] autorelease];
+	[_hvService sendRequest: request];
+
+	STAssertNil(request.metrics, @"Span has been collected without a sink");
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request hasn't been completed");
+}
+
+- (void)testSpan {
+
+	_hvService.metricsSink = self;
+	_server.responseDelay = 0.1;
+
+	HealthVaultRequest *request = [self send: @"GetThings"];
+
+	STAssertFalse(_response.hasError, @"Request has failed: %@", _response.errorText);
+	STAssertNil(request.metrics, @"Span hasn't been taken off the completed request");
+	STAssertTrue(_metrics.count == 1, @"Unexpected count of spans: %u", _metrics.count);
+
+	HealthVaultRequestMetrics *metrics = [_metrics lastObject];
+
+	STAssertEqualObjects(metrics.methodName, @"GetThings", @"Unexpected method");
+	STAssertTrue(metrics.requestBytes == [request toXmlData].length, @"Unexpected request size: %u", metrics.requestBytes);
+	STAssertTrue(metrics.responseBytes == [RESPONSE_BODY lengthOfBytesUsingEncoding: NSUTF8StringEncoding],
+				 @"Unexpected response size: %u", metrics.responseBytes);
+	STAssertFalse(metrics.hasError, @"Span has error");
+	STAssertTrue(metrics.retryCount == 0, @"Span has retries");
+
+	// the server delay is spent waiting for the first byte
+	NSTimeInterval total = [metrics durationOfStage: HealthVaultRequestStageTotal];
+	STAssertTrue([metrics durationOfStage: HealthVaultRequestStageFirstByte] >= 0.09, @"Server delay isn't in first byte time");
+	STAssertTrue(total >= 0.1, @"Total time %f is shorter than server delay", total);
+
+	NSTimeInterval sum = 0;
+	for (NSUInteger stage = 0; stage < HealthVaultRequestStageTotal; stage++) {
+		sum += [metrics durationOfStage: stage];
+	}
+
+	STAssertTrue(sum <= total, @"Stages %f overlap, total %f", sum, total);
+}
+
+- (void)testRetriesAndHistogram {
+
+	HealthVaultMetricsHistogram *histogram = [[HealthVaultMetricsHistogram new] autorelease];
+	_hvService.metricsSink = histogram;
+
+	HealthVaultRetryPolicy *policy = [[HealthVaultRetryPolicy new] autorelease];
+	policy.baseDelay = 0.01;
+	_hvService.retryPolicy = policy;
+
+	_server.fault = LocalHttpFaultServiceUnavailable;
+	_server.faultCount = 1;
+
+	[self send: @"GetThings"];
+	[self send: @"GetThings"];
+
+	STAssertFalse(_response.hasError, @"Request has failed: %@", _response.errorText);
+	STAssertTrue([histogram countForMethod: @"GetThings"] == 2, @"Retry has been counted as a request");
+	STAssertTrue([[histogram report] rangeOfString: @"1 retries"].location != NSNotFound, @"Retry isn't in the report: %@", [histogram report]);
+	STAssertTrue([histogram percentile: 50 ofStage: HealthVaultRequestStageTotal forMethod: @"GetThings"] > 0, @"Total time hasn't been recorded");
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  HealthVaultProcessingQueueTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+
+/// Implements tests for the processing queue of HealthVaultService.
+/// Contains tests to check that requests are serialized and responses parsed off the service thread,
+/// that requests are still sent in order and that callBacks are invoked on the chosen queue.
+@interface HealthVaultProcessingQueueTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+	NSOperationQueue *_processingQueue;
+
+	/// Numbers of requests in the order the server has received them.
+	NSMutableArray *_receivedNumbers;
+	/// Responses in the order they have reached the callBack.
+	NSMutableArray *_responses;
+	NSUInteger _expectedCount;
+
+	BOOL _hasParsedOnServiceThread;
+	BOOL _hasCalledBackOnServiceThread;
+	BOOL _isDone;
+}
+
+@end
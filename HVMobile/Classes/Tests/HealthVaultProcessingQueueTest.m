@@ -0,0 +1,222 @@
+//
+//  HealthVaultProcessingQueueTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultProcessingQueueTest.h"
+#import "HealthVaultService.h"
+#import "HealthVaultRequestBatcher.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+
+@interface HealthVaultProcessingQueueTest (Private)
+
+/// Creates GetThings request with the number in its info section.
+/// @param number - the number.
+/// @param length - length of padding which makes the request larger.
+- (HealthVaultRequest *)requestWithNumber: (NSUInteger)number paddingLength: (NSUInteger)length;
+
+/// Sends requests and waits till all of them have completed.
+/// @param requests - the requests.
+/// @param batcher - the batcher the requests are sent through, nil to send them to the service.
+- (void)send: (NSArray *)requests batcher: (HealthVaultRequestBatcher *)batcher;
+
+@end
+
+
+@implementation HealthVaultProcessingQueueTest
+
+- (void)setUp {
+
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	// One request at a time, so the server receives them in the order they have been queued.
+	WebRequestQueue *requestQueue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: 1];
+	_hvService.requestQueue = requestQueue;
+	[requestQueue release];
+
+	_processingQueue = [NSOperationQueue new];
+	_processingQueue.maxConcurrentOperationCount = 4;
+	_hvService.processingQueue = _processingQueue;
+
+	_receivedNumbers = [NSMutableArray new];
+	_responses = [NSMutableArray new];
+	_hasParsedOnServiceThread = NO;
+	_hasCalledBackOnServiceThread = NO;
+}
+
+- (void)tearDown {
+
+	[_hvService release];
+	[_processingQueue release];
+	[_server stop];
+	[_server release];
+	[_receivedNumbers release];
+	[_responses release];
+}
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	NSRange infoStart = [requestBody rangeOfString: @"<info>"];
+	NSRange infoEnd = [requestBody rangeOfString: @"</info>" options: NSBackwardsSearch];
+	NSRange content = NSMakeRange(NSMaxRange(infoStart), infoEnd.location - NSMaxRange(infoStart));
+	NSString *info = [requestBody substringWithRange: content];
+
+	XmlElement *infoNode = [XmlDocument documentWithString: [requestBody substringWithRange: NSMakeRange(infoStart.location, NSMaxRange(infoEnd) - infoStart.location)]].rootElement;
+
+	for (XmlElement *groupNode in [infoNode selectNodes: @"group"]) {
+		[_receivedNumbers addObject: [groupNode selectSingleNode: @"n"].text];
+	}
+
+	return [NSString stringWithFormat: @"<response><status><code>0</code></status>"
+			"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\">%@</wc:info></response>", info];
+}
+
+- (NSString *)parseNumber: (HealthVaultResponse *)response {
+
+	if ([NSThread isMainThread]) {
+		_hasParsedOnServiceThread = YES;
+	}
+
+	return [response.infoElement selectSingleNode: @"group/n"].text;
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+
+	if ([NSThread isMainThread]) {
+		_hasCalledBackOnServiceThread = YES;
+	}
+
+	@synchronized (_responses) {
+
+		[_responses addObject: response];
+		_isDone = (_responses.count == _expectedCount);
+	}
+}
+
+- (HealthVaultRequest *)requestWithNumber: (NSUInteger)number paddingLength: (NSUInteger)length {
+
+	NSString *padding = [@"" stringByPaddingToLength: length withString: @"x" startingAtIndex: 0];
+	NSString *info = [NSString stringWithFormat: @"<info><group><n>%u</n><padding>%@</padding></group></info>", number, padding];
+
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																   methodVersion: 3
+																	 infoSection: info
+																		  target: self
+																		callBack: @selector(requestCompleted:)];
+	request.resultTarget = self;
+	request.resultParser = @selector(parseNumber:);
+
+	return [request autorelease];
+}
+
+- (void)send: (NSArray *)requests batcher: (HealthVaultRequestBatcher *)batcher {
+
+	_expectedCount = requests.count;
+	_isDone = NO;
+
+	for (HealthVaultRequest *request in requests) {
+
+		if (batcher) {
+			[batcher sendRequest: request];
+		}
+		else {
+			[_hvService sendRequest: request];
+		}
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+}
+
+- (void)testResultIsParsedOffServiceThread {
+
+	[self send: [NSArray arrayWithObject: [self requestWithNumber: 7 paddingLength: 0]] batcher: nil];
+
+	STAssertTrue(_responses.count == 1, @"Request hasn't completed");
+
+	HealthVaultResponse *response = [_responses lastObject];
+	STAssertFalse(response.hasError, @"Request has failed: %@", response.errorText);
+	STAssertEqualObjects(response.result, @"7", @"Wrong result");
+
+	STAssertFalse(_hasParsedOnServiceThread, @"Response has been parsed on the service thread");
+	STAssertTrue(_hasCalledBackOnServiceThread, @"CallBack hasn't been invoked on the service thread");
+}
+
+- (void)testRequestsAreSentInOrder {
+
+	// The first request takes longest to serialize, the rest would overtake it.
+	NSMutableArray *requests = [NSMutableArray array];
+	[requests addObject: [self requestWithNumber: 0 paddingLength: 1024 * 1024]];
+
+	for (NSUInteger i = 1; i < 8; i++) {
+		[requests addObject: [self requestWithNumber: i paddingLength: 0]];
+	}
+
+	[self send: requests batcher: nil];
+
+	STAssertTrue(_receivedNumbers.count == requests.count, @"Wrong count of requests has been received");
+
+	for (NSUInteger i = 0; i < _receivedNumbers.count; i++) {
+
+		STAssertEqualObjects([_receivedNumbers objectAtIndex: i], ([NSString stringWithFormat: @"%u", i]),
+							 @"Request %u has been sent out of order", i);
+	}
+}
+
+- (void)testCallBackQueue {
+
+	NSOperationQueue *callBackQueue = [NSOperationQueue new];
+
+	HealthVaultRequest *request = [self requestWithNumber: 3 paddingLength: 0];
+	request.callBackQueue = callBackQueue;
+
+	[self send: [NSArray arrayWithObject: request] batcher: nil];
+
+	STAssertFalse(_hasCalledBackOnServiceThread, @"CallBack has been invoked on the service thread");
+	STAssertEqualObjects(((HealthVaultResponse *)[_responses lastObject]).result, @"3", @"Wrong result");
+
+	[callBackQueue release];
+}
+
+- (void)testBatchedResults {
+
+	HealthVaultRequestBatcher *batcher = [[HealthVaultRequestBatcher alloc] initWithService: _hvService];
+
+	NSMutableArray *requests = [NSMutableArray array];
+	for (NSUInteger i = 0; i < 4; i++) {
+		[requests addObject: [self requestWithNumber: i paddingLength: 0]];
+	}
+
+	[self send: requests batcher: batcher];
+
+	STAssertTrue(_server.requestCount == 1, @"Requests haven't been batched");
+	STAssertFalse(_hasParsedOnServiceThread, @"Batched response has been split on the service thread");
+
+	for (HealthVaultResponse *response in _responses) {
+
+		NSUInteger number = [requests indexOfObject: response.request];
+		STAssertEqualObjects(response.result, ([NSString stringWithFormat: @"%u", number]), @"Wrong result of request %u", number);
+	}
+
+	[batcher release];
+}
+
+@end
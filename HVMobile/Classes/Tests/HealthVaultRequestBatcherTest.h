@@ -0,0 +1,47 @@
+//
+//  HealthVaultRequestBatcherTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+@class HealthVaultRequestBatcher;
+
+/// Implements tests for HealthVaultRequestBatcher class.
+/// Contains tests to check that requests are merged and responses are split back,
+/// running against a local server.
+@interface HealthVaultRequestBatcherTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+	HealthVaultRequestBatcher *_batcher;
+
+	/// Responses by name of the request.
+	NSMutableDictionary *_responses;
+	NSUInteger _expectedCount;
+	BOOL _isDone;
+
+	/// Status code returned by the server.
+	NSInteger _statusCode;
+
+	/// Record ids from the headers of requests received by the server.
+	NSMutableArray *_recordIds;
+}
+
+@end
@@ -0,0 +1,226 @@
+//
+//  HealthVaultRequestBatcherTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultRequestBatcherTest.h"
+#import "HealthVaultRequestBatcher.h"
+#import "HealthVaultService.h"
+#import "HealthVaultMetricsHistogram.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+
+@implementation HealthVaultRequestBatcherTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	_batcher = [[HealthVaultRequestBatcher alloc] initWithService: _hvService];
+
+	_responses = [NSMutableDictionary new];
+	_recordIds = [NSMutableArray new];
+	_statusCode = 0;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_batcher release];
+	[_hvService release];
+	[_server stop];
+	[_server release];
+	[_responses release];
+	[_recordIds release];
+}
+
+/// Answers GetThings with an empty group for every requested group and PutThings with a thing id
+/// for every thing; names and ids are taken from the request, so the split can be checked.
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	if (_statusCode != 0) {
+		return [NSString stringWithFormat: @"<response><status><code>%d</code><error><message>Failed</message></error></status></response>", _statusCode];
+	}
+
+	XmlElement *request = [XmlDocument documentWithString: requestBody].rootElement;
+	XmlElement *info = [request selectSingleNode: @"info"];
+	NSString *method = [request selectSingleNode: @"header/method"].text;
+
+	NSString *recordId = [request selectSingleNode: @"header/record-id"].text;
+	[_recordIds addObject: recordId ? recordId : @""];
+
+	NSMutableString *response = [NSMutableString stringWithFormat: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.%@\">", method];
+
+	if ([method isEqualToString: @"GetThings"]) {
+
+		for (XmlElement *group in [info selectNodes: @"group"]) {
+			[response appendFormat: @"<group name=\"%@\" />", [group attrValue: @"name"]];
+		}
+	}
+	else {
+
+		for (XmlElement *thing in [info selectNodes: @"thing"]) {
+			[response appendFormat: @"<thing-id version-stamp=\"1\">%@</thing-id>", [thing selectSingleNode: @"flags"].text];
+		}
+	}
+
+	[response appendString: @"</wc:info></response>"];
+	return response;
+}
+
+- (void)sendRequest: (NSString *)method elements: (NSArray *)names {
+	[self sendRequest: method elements: names recordId: nil];
+}
+
+- (void)sendRequest: (NSString *)method elements: (NSArray *)names recordId: (NSString *)recordId {
+	NSMutableString *info = [NSMutableString stringWithString: @"<info>"];
+
+	for (NSString *name in names) {
+		if ([method isEqualToString: @"GetThings"]) {
+			[info appendFormat: @"<group name=\"%@\"><filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter></group>", name];
+		}
+		else {
+			[info appendFormat: @"<thing><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id><flags>%@</flags></thing>", name];
+		}
+	}
+
+	[info appendString: @"</info>"];
+
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: method
+																   methodVersion: [method isEqualToString: @"GetThings"] ? 3 : 2
+																	 infoSection: info
+																		  target: self
+																		callBack: @selector(requestCompleted:)];
+	request.userState = [names componentsJoinedByString: @","];
+	request.recordId = recordId;
+
+	[_batcher sendRequest: request];
+	[request release];
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+	[_responses setObject: response forKey: response.request.userState];
+	_isDone = (_responses.count == _expectedCount);
+}
+
+/// Gets names of groups or ids of things in the response of the request.
+- (NSArray *)namesInResponse: (NSString *)requestName element: (NSString *)element {
+	HealthVaultResponse *response = [_responses objectForKey: requestName];
+	NSMutableArray *names = [NSMutableArray array];
+
+	for (XmlElement *node in [response.infoElement selectNodes: element]) {
+		[names addObject: [element isEqualToString: @"group"] ? [node attrValue: @"name"] : node.text];
+	}
+
+	return names;
+}
+
+- (void)testGetThingsAreMerged {
+	_expectedCount = 3;
+
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"b", @"c", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"d", nil]];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 1, @"Requests haven't been merged");
+	STAssertTrue(_batcher.sentRequestCount == 1, @"Unexpected count of sent requests");
+
+	STAssertEqualObjects([self namesInResponse: @"a" element: @"group"], [NSArray arrayWithObjects: @"a", nil], @"Wrong groups");
+	STAssertEqualObjects([self namesInResponse: @"b,c" element: @"group"], ([NSArray arrayWithObjects: @"b", @"c", nil]), @"Wrong groups");
+	STAssertEqualObjects([self namesInResponse: @"d" element: @"group"], [NSArray arrayWithObjects: @"d", nil], @"Wrong groups");
+}
+
+- (void)testMetricsOfOriginalRequestsAreReported {
+	HealthVaultMetricsHistogram *histogram = [[HealthVaultMetricsHistogram new] autorelease];
+	_hvService.metricsSink = histogram;
+	_expectedCount = 3;
+
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"b", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"c", nil]];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	// the batched request is reported as well
+	STAssertTrue([histogram countForMethod: @"GetThings"] == 4, @"Metrics of original requests haven't been reported");
+}
+
+- (void)testPutThingsAreMergedSeparatelyFromGetThings {
+	_expectedCount = 3;
+
+	[self sendRequest: @"PutThings" elements: [NSArray arrayWithObjects: @"1", @"2", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil]];
+	[self sendRequest: @"PutThings" elements: [NSArray arrayWithObjects: @"3", nil]];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 2, @"Unexpected count of server requests: %u", _server.requestCount);
+	STAssertEqualObjects([self namesInResponse: @"1,2" element: @"thing-id"], ([NSArray arrayWithObjects: @"1", @"2", nil]), @"Wrong thing ids");
+	STAssertEqualObjects([self namesInResponse: @"3" element: @"thing-id"], [NSArray arrayWithObjects: @"3", nil], @"Wrong thing ids");
+	STAssertFalse([[_responses objectForKey: @"a"] hasError], @"Single request has failed");
+}
+
+- (void)testRequestsOfDifferentRecordsAreNotMerged {
+	_expectedCount = 3;
+
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil] recordId: @"r1"];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"b", nil] recordId: @"r2"];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"c", nil] recordId: @"r1"];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 2, @"Unexpected count of server requests: %u", _server.requestCount);
+	STAssertTrue([_recordIds containsObject: @"r1"] && [_recordIds containsObject: @"r2"], @"Batch hasn't been sent to its record");
+	STAssertEqualObjects([self namesInResponse: @"a" element: @"group"], [NSArray arrayWithObjects: @"a", nil], @"Wrong groups");
+	STAssertEqualObjects([self namesInResponse: @"c" element: @"group"], [NSArray arrayWithObjects: @"c", nil], @"Wrong groups");
+}
+
+- (void)testErrorIsReturnedToEveryCaller {
+	_expectedCount = 2;
+	_statusCode = 3;
+
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"b", nil]];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	for (HealthVaultResponse *response in [_responses allValues]) {
+		STAssertTrue(response.hasError, @"Error hasn't been passed");
+		STAssertTrue(response.statusCode == 3, @"Status code hasn't been passed");
+	}
+}
+
+- (void)testFullBatchIsSentImmediately {
+	_batcher.maxBatchSize = 2;
+	_batcher.batchWindow = 60;
+	_expectedCount = 2;
+
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"a", nil]];
+	[self sendRequest: @"GetThings" elements: [NSArray arrayWithObjects: @"b", nil]];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Full batch has waited for the window");
+	STAssertTrue(_server.requestCount == 1, @"Requests haven't been merged");
+
+	// cancels the scheduled flush
+	[_batcher flush];
+}
+
+@end
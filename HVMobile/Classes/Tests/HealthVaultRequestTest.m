@@ -133,4 +133,34 @@
 	STAssertTrue(languageRange.location != NSNotFound, @"Language isn't equal to expected.");
 }
 
+- (void)testXmlDataIsUtf8Envelope {
+	HealthVaultRequest *hvRequest = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																	 methodVersion: 2
+																	   infoSection: @"<info>caf\u00e9</info>"
+																			target: nil
+																		  callBack: nil];
+	hvRequest.authorizationSessionToken = @"ASAAADNt1Jwbx+wsXjPFs00soe9w==";
+	hvRequest.sessionSharedSecret = [Base64 encodeBase64WithData: [@"My test key" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	NSData *requestData = [hvRequest toXmlData];
+	NSString *requestXml = [[[NSString alloc] initWithData: requestData encoding: NSUTF8StringEncoding] autorelease];
+
+	STAssertEqualObjects(requestXml, [hvRequest toXml], @"Request data isn't equal to request xml");
+	STAssertTrue([requestXml hasSuffix: @"<info>caf\u00e9</info></wc-request:request>"], @"Info section isn't encoded as UTF-8");
+
+	// the hash is computed over UTF-8 bytes of the info section
+	NSRange hashRange = [requestXml rangeOfString: @"<hash-data algName=\"SHA256\">8ROSCvO0N++/Hki2zgZev1NZLl+R2uP2NUeD6R3am3E=</hash-data>"];
+	STAssertTrue(hashRange.location != NSNotFound, @"Hash data isn't equal to expected.");
+
+	// the header is signed as it is written in the envelope
+	NSRange headerStart = [requestXml rangeOfString: @"<header>"];
+	NSRange headerEnd = [requestXml rangeOfString: @"</header>"];
+	NSString *header = [requestXml substringWithRange: NSMakeRange(headerStart.location, NSMaxRange(headerEnd) - headerStart.location)];
+	NSString *hmac = [MobilePlatform computeSha256HmacAndWrap: [Base64 decodeBase64WithString: hvRequest.sessionSharedSecret] : header];
+
+	STAssertTrue([requestXml rangeOfString: [NSString stringWithFormat: @"<auth>%@</auth>", hmac]].location != NSNotFound, @"HMac data isn't equal to expected.");
+
+	[hvRequest release];
+}
+
 @end
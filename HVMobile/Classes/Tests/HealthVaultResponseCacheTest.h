@@ -0,0 +1,35 @@
+//
+//  HealthVaultResponseCacheTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class HealthVaultResponseCache;
+
+/// Implements tests for HealthVaultResponseCache class.
+/// Contains tests to check expiry, eviction, invalidation and the cache in HealthVaultService.
+@interface HealthVaultResponseCacheTest : SenTestCase {
+
+	NSString *_directory;
+	HealthVaultResponseCache *_cache;
+	BOOL _isDone;
+	BOOL _isReadDone;
+	BOOL _hasFailed;
+}
+
+@end
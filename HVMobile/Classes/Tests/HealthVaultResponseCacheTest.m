@@ -0,0 +1,287 @@
+//
+//  HealthVaultResponseCacheTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultResponseCacheTest.h"
+#import "HealthVaultResponseCache.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "MobilePlatformTest.h"
+
+
+@interface HealthVaultResponseCacheTest (Private)
+
+/// Creates serialized request, so its info hash is known.
++ (HealthVaultRequest *)request: (NSString *)methodName recordId: (NSString *)recordId info: (NSString *)info;
+
+/// Creates response body of the given length.
++ (NSData *)body: (NSUInteger)length;
+
+/// Sends request with the service and waits for the response.
+- (void)sendAndWait: (HealthVaultService *)service method: (NSString *)methodName;
+
+@end
+
+
+@implementation HealthVaultResponseCacheTest
+
+- (void)setUp {
+	_directory = [[NSTemporaryDirectory() stringByAppendingPathComponent: @"HealthVaultResponseCacheTest"] retain];
+	[[NSFileManager defaultManager] removeItemAtPath: _directory error: NULL];
+
+	_cache = [[HealthVaultResponseCache alloc] initWithDirectory: nil];
+	[_cache setTimeToLive: 60 forMethod: @"GetThings"];
+
+	_isDone = NO;
+	_hasFailed = NO;
+}
+
+- (void)tearDown {
+	[_cache release];
+	[[NSFileManager defaultManager] removeItemAtPath: _directory error: NULL];
+	[_directory release];
+}
+
++ (HealthVaultRequest *)request: (NSString *)methodName recordId: (NSString *)recordId info: (NSString *)info {
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: methodName
+																	methodVersion: 3
+																	  infoSection: info
+																		   target: nil
+																		 callBack: nil] autorelease];
+	request.recordId = recordId;
+	request.msgTime = [NSDate date];
+	[request toXmlData];
+
+	return request;
+}
+
++ (NSData *)body: (NSUInteger)length {
+	return [NSMutableData dataWithLength: length];
+}
+
+- (void)testHitAndMiss {
+	HealthVaultRequest *request = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info><group/></info>"];
+	HealthVaultRequest *otherRequest = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info><group><id>1</id></group></info>"];
+
+	STAssertNotNil(request.infoHash, @"Info hash hasn't been computed");
+	STAssertNil([_cache responseBodyForRequest: request], @"Response has been found in empty cache");
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: request];
+
+	STAssertTrue([_cache responseBodyForRequest: request].length == 10, @"Stored response hasn't been found");
+	STAssertNil([_cache responseBodyForRequest: otherRequest], @"Response to other info section has been found");
+
+	STAssertTrue(_cache.hitCount == 1, @"Unexpected count of hits: %u", _cache.hitCount);
+	STAssertTrue(_cache.missCount == 2, @"Unexpected count of misses: %u", _cache.missCount);
+}
+
+- (void)testUncachedMethod {
+	HealthVaultRequest *request = [HealthVaultResponseCacheTest request: @"GetAuthorizedPeople" recordId: nil info: @"<info/>"];
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: request];
+
+	STAssertNil([_cache responseBodyForRequest: request], @"Response of uncached method has been stored");
+	STAssertTrue(_cache.missCount == 0, @"Request of uncached method has been counted");
+	STAssertTrue(_cache.memorySize == 0, @"Response of uncached method takes memory");
+}
+
+- (void)testExpiry {
+	[_cache setTimeToLive: 0.2 forMethod: @"GetThings"];
+
+	HealthVaultRequest *request = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info/>"];
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: request];
+
+	BOOL isNeverSet = NO;
+	[LocalHttpServer runUntil: &isNeverSet timeout: 0.3];
+
+	STAssertNil([_cache responseBodyForRequest: request], @"Expired response has been returned");
+	STAssertTrue(_cache.memorySize == 0, @"Expired response hasn't been dropped");
+}
+
+- (void)testMemoryEviction {
+	_cache.maxMemorySize = 250;
+
+	HealthVaultRequest *first = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>1</info>"];
+	HealthVaultRequest *second = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>2</info>"];
+	HealthVaultRequest *third = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>3</info>"];
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: first];
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: second];
+
+	// the first response becomes the most recently used one
+	STAssertNotNil([_cache responseBodyForRequest: first], @"Response hasn't been found");
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: third];
+
+	STAssertTrue(_cache.memorySize == 200, @"Unexpected memory size: %u", _cache.memorySize);
+	STAssertNotNil([_cache responseBodyForRequest: first], @"Recently used response has been evicted");
+	STAssertNil([_cache responseBodyForRequest: second], @"Least recently used response hasn't been evicted");
+	STAssertNotNil([_cache responseBodyForRequest: third], @"New response has been evicted");
+}
+
+- (void)testDisk {
+	HealthVaultResponseCache *cache = [[[HealthVaultResponseCache alloc] initWithDirectory: _directory] autorelease];
+	[cache setTimeToLive: 60 forMethod: @"GetThings"];
+	cache.maxDiskSize = 250;
+
+	HealthVaultRequest *first = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>1</info>"];
+	HealthVaultRequest *second = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>2</info>"];
+	HealthVaultRequest *third = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info>3</info>"];
+
+	[cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: first];
+	[cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: second];
+	[cache storeResponseBody: [HealthVaultResponseCacheTest body: 100] forRequest: third];
+
+	STAssertTrue(cache.diskSize == 200, @"Unexpected disk size: %u", cache.diskSize);
+
+	// a new cache, as after the next launch, reads responses from disk
+	HealthVaultResponseCache *nextCache = [[[HealthVaultResponseCache alloc] initWithDirectory: _directory] autorelease];
+	[nextCache setTimeToLive: 60 forMethod: @"GetThings"];
+
+	STAssertTrue(nextCache.diskSize == 200, @"Disk index hasn't been read");
+	STAssertNil([nextCache responseBodyForRequest: first], @"Least recently used response hasn't been evicted from disk");
+	STAssertTrue([nextCache responseBodyForRequest: third].length == 100, @"Response hasn't been read from disk");
+	STAssertTrue(nextCache.memorySize == 100, @"Response read from disk hasn't been kept in memory");
+}
+
+- (void)testInvalidation {
+	HealthVaultRequest *first = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info/>"];
+	HealthVaultRequest *second = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r2" info: @"<info/>"];
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: first];
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: second];
+
+	[_cache invalidateForRequest: [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info/>"]];
+	STAssertNotNil([_cache responseBodyForRequest: first], @"Read has invalidated the record");
+
+	[_cache invalidateForRequest: [HealthVaultResponseCacheTest request: @"PutThings" recordId: @"r1" info: @"<info/>"]];
+	STAssertNil([_cache responseBodyForRequest: first], @"Write hasn't invalidated its record");
+	STAssertNotNil([_cache responseBodyForRequest: second], @"Write has invalidated other record");
+}
+
+- (void)testInvalidationDuringRead {
+	HealthVaultRequest *request = [HealthVaultResponseCacheTest request: @"GetThings" recordId: @"r1" info: @"<info/>"];
+	NSUInteger generation = [_cache generationOfRecord: @"r1"];
+
+	// the write completes while the read is in flight
+	[_cache invalidateForRequest: [HealthVaultResponseCacheTest request: @"PutThings" recordId: @"r1" info: @"<info/>"]];
+	STAssertTrue([_cache generationOfRecord: @"r1"] == generation + 1, @"Write hasn't changed generation of its record");
+	STAssertTrue([_cache generationOfRecord: @"r2"] == 0, @"Write has changed generation of other record");
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: request generation: generation];
+	STAssertNil([_cache responseBodyForRequest: request], @"Response which raced a write has been stored");
+
+	[_cache storeResponseBody: [HealthVaultResponseCacheTest body: 10] forRequest: request generation: generation + 1];
+	STAssertNotNil([_cache responseBodyForRequest: request], @"Response sent after the write hasn't been stored");
+}
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	// reads are answered after the write
+	server.responseDelay = [requestBody rangeOfString: @"GetThings"].location != NSNotFound ? 0.3 : 0;
+
+	return @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group/></wc:info></response>";
+}
+
+- (void)readCompleted: (HealthVaultResponse *)response {
+
+	if (response.hasError) {
+		_hasFailed = YES;
+	}
+
+	_isReadDone = YES;
+}
+
+- (void)testServiceWriteDuringRead {
+	LocalHttpServer *server = [[LocalHttpServer new] autorelease];
+	[server setResponseTarget: self callBack: @selector(server:responseForRequest:)];
+	HealthVaultService *service = [server startWithSession];
+	STAssertNotNil(service, @"Couldn't start local server");
+	service.responseCache = _cache;
+
+	HealthVaultRequest *read = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																methodVersion: 3
+																  infoSection: @"<info><group/></info>"
+																	   target: self
+																	 callBack: @selector(readCompleted:)];
+	_isReadDone = NO;
+	[service sendRequest: read];
+	[read release];
+
+	[self sendAndWait: service method: @"PutThings"];
+	STAssertFalse(_isReadDone, @"Read has been completed before the write");
+	STAssertTrue([LocalHttpServer runUntil: &_isReadDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"GetThings hasn't been completed");
+
+	// the response of the read may hold the data from before the write
+	[self sendAndWait: service method: @"GetThings"];
+
+	STAssertTrue(server.requestCount == 3, @"Response which raced a write has been cached: %u", server.requestCount);
+	STAssertTrue(_cache.hitCount == 0, @"Unexpected count of hits: %u", _cache.hitCount);
+	STAssertFalse(_hasFailed, @"Request has failed");
+
+	[service cancelSessionTokenRenewal];
+	[server stop];
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+
+	if (response.hasError) {
+		_hasFailed = YES;
+	}
+
+	_isDone = YES;
+}
+
+- (void)sendAndWait: (HealthVaultService *)service method: (NSString *)methodName {
+
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: methodName
+																   methodVersion: 3
+																	 infoSection: @"<info><group/></info>"
+																		  target: self
+																		callBack: @selector(requestCompleted:)];
+	_isDone = NO;
+	[service sendRequest: request];
+	[request release];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"%@ hasn't been completed", methodName);
+}
+
+- (void)testService {
+	LocalHttpServer *server = [[LocalHttpServer new] autorelease];
+	server.responseBody = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group/></wc:info></response>";
+	HealthVaultService *service = [server startWithSession];
+	STAssertNotNil(service, @"Couldn't start local server");
+	service.responseCache = _cache;
+
+	[self sendAndWait: service method: @"GetThings"];
+	[self sendAndWait: service method: @"GetThings"];
+
+	STAssertTrue(server.requestCount == 1, @"Cached response hasn't been used");
+	STAssertTrue(_cache.hitCount == 1, @"Unexpected count of hits: %u", _cache.hitCount);
+
+	// the write drops the cached response
+	[self sendAndWait: service method: @"PutThings"];
+	[self sendAndWait: service method: @"GetThings"];
+
+	STAssertTrue(server.requestCount == 3, @"Cached response has been used after write: %u", server.requestCount);
+	STAssertFalse(_hasFailed, @"Request has failed");
+
+	[service cancelSessionTokenRenewal];
+	[server stop];
+}
+
+@end
@@ -17,6 +17,9 @@
 // limitations under the License.
 
 #import "HealthVaultResponseTest.h"
+#import "XmlDocument.h"
+#import "XmlTextReader.h"
+#import "Weight.h"
 
 
 @implementation HealthVaultResponseTest
@@ -52,4 +55,159 @@
 	[webResponse release];
 }
 
+- (void)testResponseParsedOnce {
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\">"
+		"<group><thing><thing-id version-stamp=\"1\">a</thing-id><eff-date>2011-04-20T12:25:29.218</eff-date>"
+		"<data-xml><weight><value><kg>65.7894736842105</kg><display units=\"pounds\">145</display></value></weight></data-xml></thing>"
+		"<thing><thing-id version-stamp=\"2\">b</thing-id><eff-date>2011-04-20T08:18:44</eff-date>"
+		"<data-xml><weight><value><kg>63.520871</kg><display units=\"pounds\">140</display></value></weight></data-xml></thing>"
+		"</group></wc:info></response>";
+
+	NSUInteger documentsBefore = [XmlDocument parseCount];
+	NSUInteger readsBefore = [XmlTextReader parseCount];
+
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	NSArray *weights = [Weight parseWeightsFromInfo: hvResponse.infoElement];
+
+	STAssertTrue(weights.count == 2, @"Received incorrect count of weights");
+	STAssertEqualObjects([[weights objectAtIndex: 1] display], @"140", @"Display data isn't equal to expected");
+	STAssertTrue([XmlDocument parseCount] - documentsBefore == 1, @"Response has been parsed more than once");
+	STAssertTrue([XmlTextReader parseCount] == readsBefore, @"Info section has been parsed again");
+
+	// raw info xml is still available for callers which need it
+	STAssertTrue([hvResponse.infoXml hasPrefix: @"<wc:info"], @"Info xml isn't equal to expected");
+
+	[hvResponse release];
+	[hvRequest release];
+	[webResponse release];
+}
+
+- (void)testIncrementallyParsedResponse {
+	NSString *xml = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\">"
+		"<group><thing><thing-id version-stamp=\"1\">a</thing-id><eff-date>2011-04-20T12:25:29.218</eff-date>"
+		"<data-xml><weight><value><kg>65.7894736842105</kg><display units=\"pounds\">145</display></value></weight></data-xml></thing>"
+		"</group></wc:info></response>";
+	NSData *data = [xml dataUsingEncoding: NSUTF8StringEncoding];
+
+	// simulate the transport feeding received chunks into the document
+	NSMutableData *body = [NSMutableData data];
+	XmlDocument *document = [[XmlDocument alloc] initWithGrowingData: body];
+
+	for (NSUInteger offset = 0; offset < data.length; offset += 16) {
+		[body appendBytes: (const uint8_t *)data.bytes + offset length: MIN(16, data.length - offset)];
+		STAssertTrue([document parseAppendedData], @"Couldn't parse received chunk");
+	}
+	STAssertTrue([document finishParsing], @"Couldn't finish parsing");
+
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseBody = body;
+	webResponse.responseDocument = document;
+
+	NSUInteger documentsBefore = [XmlDocument parseCount];
+
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	STAssertFalse(hvResponse.hasError, @"Response has error");
+	STAssertTrue(hvResponse.statusCode == 0, @"Status code isn't equal to expected");
+
+	NSArray *weights = [Weight parseWeightsFromInfo: hvResponse.infoElement];
+	STAssertTrue(weights.count == 1, @"Received incorrect count of weights");
+	STAssertTrue([XmlDocument parseCount] == documentsBefore, @"Received document has been parsed again");
+
+	// raw xml is decoded from the received body on demand
+	STAssertEqualObjects(hvResponse.responseXml, xml, @"Response xml isn't equal to expected");
+
+	[hvResponse release];
+	[hvRequest release];
+	[webResponse release];
+	[document release];
+}
+
+- (void)testCastResponseParsedOnce {
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.CreateAuthenticatedSessionToken2\">"
+		"<token app-id=\"99999999-9999-9999-9999-999999999999\">token</token><shared-secret>secret</shared-secret></wc:info></response>";
+
+	NSUInteger documentsBefore = [XmlDocument parseCount];
+	NSUInteger readsBefore = [XmlTextReader parseCount];
+
+	HealthVaultService *service = [HealthVaultService new];
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	[service saveCastCallResultsFromInfo: hvResponse.infoElement];
+
+	STAssertEqualObjects(service.authorizationSessionToken, @"token", @"Authorization session token isn't equal to expected");
+	STAssertEqualObjects(service.sessionSharedSecret, @"secret", @"Shared secret isn't equal to expected");
+	STAssertTrue([XmlDocument parseCount] - documentsBefore == 1, @"Response has been parsed more than once");
+	STAssertTrue([XmlTextReader parseCount] == readsBefore, @"Info section has been parsed again");
+
+	[hvResponse release];
+	[hvRequest release];
+	[service release];
+	[webResponse release];
+}
+
+- (void)testStatusCodeDoesNotParseInfo {
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings2\">"
+		"<thing-id version-stamp=\"1\">a</thing-id></wc:info></response>";
+
+	NSUInteger documentsBefore = [XmlDocument parseCount];
+
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	STAssertTrue(hvResponse.statusCode == 0, @"Status code isn't equal to expected");
+	STAssertTrue([XmlDocument parseCount] == documentsBefore, @"Response has been parsed for status code");
+
+	STAssertFalse(hvResponse.hasError, @"Unexpected error");
+	STAssertEqualObjects([hvResponse.infoElement selectSingleNode: @"thing-id"].text, @"a", @"Thing id isn't equal to expected");
+	STAssertTrue([XmlDocument parseCount] - documentsBefore == 1, @"Response hasn't been parsed exactly once");
+
+	[hvResponse release];
+	[hvRequest release];
+	[webResponse release];
+}
+
+- (void)testInvalidInfoReportedByHasError {
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info><group></wc:info></response>";
+
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	// callers check hasError before reading the info section
+	STAssertTrue(hvResponse.hasError, @"Invalid info section isn't reported");
+	STAssertNil(hvResponse.infoElement, @"Invalid info section has been parsed");
+
+	[hvResponse release];
+	[hvRequest release];
+	[webResponse release];
+}
+
+- (void)testNotHealthVaultResponse {
+	WebResponse *webResponse = [WebResponse new];
+	webResponse.responseData = @"<html><body>Service Unavailable</body>";
+
+	HealthVaultRequest *hvRequest = [HealthVaultRequest new];
+	HealthVaultResponse *hvResponse = [[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: hvRequest];
+
+	STAssertTrue(hvResponse.hasError, @"Invalid response isn't reported");
+
+	[hvResponse release];
+	[hvRequest release];
+	[webResponse release];
+}
+
 @end
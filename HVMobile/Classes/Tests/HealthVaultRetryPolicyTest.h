@@ -0,0 +1,45 @@
+//
+//  HealthVaultRetryPolicyTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+@class HealthVaultRetryPolicy;
+@class HealthVaultResponse;
+
+/// Implements tests for HealthVaultRetryPolicy class and retries of HealthVaultService.
+/// Contains tests to check failure classification, backoff, the budget and retries against
+/// a local server which injects faults.
+@interface HealthVaultRetryPolicyTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+	HealthVaultRetryPolicy *_policy;
+
+	/// Count of requests the server answers with busy status.
+	NSUInteger _busyResponseCount;
+	/// Bodies of requests which have reached the response callBack.
+	NSMutableArray *_requestBodies;
+
+	HealthVaultResponse *_response;
+	BOOL _isDone;
+}
+
+@end
@@ -0,0 +1,304 @@
+//
+//  HealthVaultRetryPolicyTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultRetryPolicyTest.h"
+#import "HealthVaultRetryPolicy.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+/// HealthVault status the server answers with while it is busy.
+#define BUSY_STATUS_CODE 55
+
+
+@interface HealthVaultRetryPolicyTest (Private)
+
+/// Creates request which is failed with the given response.
++ (HealthVaultRequest *)request: (NSString *)methodName retryCount: (NSUInteger)retryCount;
+
+/// Creates transport response with connection error.
++ (WebResponse *)webResponseWithErrorCode: (NSInteger)errorCode;
+
+/// Creates failed HealthVault response.
++ (HealthVaultResponse *)failedResponse: (int)statusCode;
+
+/// Sends request to the local server and waits for the response.
+- (HealthVaultRequest *)send: (NSString *)methodName;
+
+@end
+
+
+@implementation HealthVaultRetryPolicyTest
+
+- (void)setUp {
+
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+
+	_policy = [HealthVaultRetryPolicy new];
+	_policy.baseDelay = 0.02;
+	[_policy.retryableStatusCodes addObject: [NSNumber numberWithInt: BUSY_STATUS_CODE]];
+
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+	_hvService.retryPolicy = _policy;
+
+	_requestBodies = [NSMutableArray new];
+	_busyResponseCount = 0;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+
+	[_hvService release];
+	[_policy release];
+	[_server stop];
+	[_server release];
+	[_requestBodies release];
+	[_response release];
+}
+
++ (HealthVaultRequest *)request: (NSString *)methodName retryCount: (NSUInteger)retryCount {
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: methodName
+																	 methodVersion: 1
+																	   infoSection: @"<info/>"
+																			target: nil
+																		  callBack: nil] autorelease];
+	request.retryCount = retryCount;
+
+	return request;
+}
+
++ (WebResponse *)webResponseWithErrorCode: (NSInteger)errorCode {
+
+	WebResponse *webResponse = [[WebResponse new] autorelease];
+	webResponse.errorText = @"Connection error";
+	webResponse.errorCode = errorCode;
+
+	return webResponse;
+}
+
++ (HealthVaultResponse *)failedResponse: (int)statusCode {
+
+	HealthVaultResponse *response = [[HealthVaultResponse new] autorelease];
+	response.statusCode = statusCode;
+	response.errorText = @"Failed";
+
+	return response;
+}
+
+- (void)testClassification {
+
+	HealthVaultResponse *failed = [HealthVaultRetryPolicyTest failedResponse: 0];
+
+	STAssertTrue([_policy failureKindOfResponse: [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorCannotConnectToHost]
+									   response: failed] == HealthVaultFailureNotSent, @"Refused connection isn't classified as not sent");
+	STAssertTrue([_policy failureKindOfResponse: [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorTimedOut]
+									   response: failed] == HealthVaultFailureUncertain, @"Timeout isn't classified as uncertain");
+	STAssertTrue([_policy failureKindOfResponse: [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorCancelled]
+									   response: failed] == HealthVaultFailurePermanent, @"Cancelled request would be retried");
+
+	WebResponse *unavailable = [[WebResponse new] autorelease];
+	unavailable.httpStatusCode = 503;
+	STAssertTrue([_policy failureKindOfResponse: unavailable response: failed] == HealthVaultFailureBusy, @"HTTP 503 isn't classified as busy");
+
+	WebResponse *received = [[WebResponse new] autorelease];
+	received.httpStatusCode = 200;
+	STAssertTrue([_policy failureKindOfResponse: received response: [HealthVaultRetryPolicyTest failedResponse: BUSY_STATUS_CODE]] == HealthVaultFailureBusy,
+				 @"Retryable status isn't classified as busy");
+	STAssertTrue([_policy failureKindOfResponse: received response: [HealthVaultRetryPolicyTest failedResponse: 3]] == HealthVaultFailurePermanent,
+				 @"Invalid xml status would be retried");
+}
+
+- (void)testIdempotency {
+
+	WebResponse *timedOut = [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorTimedOut];
+	WebResponse *refused = [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorCannotConnectToHost];
+	HealthVaultResponse *failed = [HealthVaultRetryPolicyTest failedResponse: 0];
+
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"GetThings" retryCount: 0]
+								   webResponse: timedOut
+									  response: failed] >= 0, @"Idempotent read hasn't been retried");
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"PutThings" retryCount: 0]
+								   webResponse: timedOut
+									  response: failed] < 0, @"Write which may have been processed has been retried");
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"PutThings" retryCount: 0]
+								   webResponse: refused
+									  response: failed] >= 0, @"Write which hasn't been sent hasn't been retried");
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"GetThings" retryCount: _policy.maxRetryCount]
+								   webResponse: refused
+									  response: failed] < 0, @"Request has been retried more than maxRetryCount times");
+}
+
+- (void)testBackoff {
+
+	_policy.baseDelay = 1;
+	_policy.maxDelay = 8;
+
+	for (NSUInteger i = 0; i < 6; i++) {
+
+		NSTimeInterval cap = MIN(8, 1 << i);
+
+		for (NSUInteger j = 0; j < 20; j++) {
+
+			NSTimeInterval delay = [_policy backoffDelay: i];
+			STAssertTrue(delay >= cap / 2 && delay <= cap, @"Delay %f of retry %u is out of [%f, %f]", delay, i, cap / 2, cap);
+		}
+	}
+
+	// the server asks to wait longer than the policy allows
+	WebResponse *unavailable = [[WebResponse new] autorelease];
+	unavailable.httpStatusCode = 503;
+	unavailable.retryAfter = 60;
+
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"GetThings" retryCount: 0]
+								   webResponse: unavailable
+									  response: [HealthVaultRetryPolicyTest failedResponse: 0]] < 0, @"Retry-After beyond maxDelay has been ignored");
+
+	unavailable.retryAfter = 5;
+	STAssertTrue([_policy retryDelayForRequest: [HealthVaultRetryPolicyTest request: @"GetThings" retryCount: 0]
+								   webResponse: unavailable
+									  response: [HealthVaultRetryPolicyTest failedResponse: 0]] == 5, @"Retry-After hasn't been respected");
+}
+
+- (void)testBudget {
+
+	_policy.retryBudget = 2;
+	_policy.retryBudgetRatio = 0.5;
+
+	WebResponse *refused = [HealthVaultRetryPolicyTest webResponseWithErrorCode: NSURLErrorCannotConnectToHost];
+	HealthVaultResponse *failed = [HealthVaultRetryPolicyTest failedResponse: 0];
+	HealthVaultResponse *succeeded = [[HealthVaultResponse new] autorelease];
+	HealthVaultRequest *request = [HealthVaultRetryPolicyTest request: @"GetThings" retryCount: 0];
+
+	STAssertTrue([_policy retryDelayForRequest: request webResponse: refused response: failed] >= 0, @"Retry has been refused");
+	STAssertTrue([_policy retryDelayForRequest: request webResponse: refused response: failed] >= 0, @"Retry has been refused");
+	STAssertTrue([_policy retryDelayForRequest: request webResponse: refused response: failed] < 0, @"Budget hasn't been enforced");
+	STAssertTrue(_policy.refusedRetryCount == 1, @"Refused retry hasn't been counted");
+
+	// two successful requests earn one retry
+	[_policy retryDelayForRequest: request webResponse: [[WebResponse new] autorelease] response: succeeded];
+	[_policy retryDelayForRequest: request webResponse: [[WebResponse new] autorelease] response: succeeded];
+
+	STAssertTrue([_policy retryDelayForRequest: request webResponse: refused response: failed] >= 0, @"Budget hasn't been refilled");
+	STAssertTrue([_policy retryDelayForRequest: request webResponse: refused response: failed] < 0, @"Budget has been overfilled");
+	STAssertTrue(_policy.retryCount == 3, @"Unexpected count of retries: %u", _policy.retryCount);
+}
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	[_requestBodies addObject: requestBody];
+
+	if (_busyResponseCount > 0) {
+
+		_busyResponseCount--;
+		return [NSString stringWithFormat: @"<response><status><code>%d</code><error><message>Busy</message></error></status></response>", BUSY_STATUS_CODE];
+	}
+
+	return @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"/></response>";
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+
+	[_response release];
+	_response = [response retain];
+	_isDone = YES;
+}
+
+- (HealthVaultRequest *)send: (NSString *)methodName {
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: methodName
+																	 methodVersion: 3
+																	   infoSection: @"<info><group/></info>"
+																			target: self
+																		  callBack: @selector(requestCompleted:)] autorelease];
+	_isDone = NO;
+	[_hvService sendRequest: request];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request hasn't been completed");
+
+	return request;
+}
+
+- (void)testRetryIsSignedAnew {
+
+	_busyResponseCount = 2;
+
+	HealthVaultRequest *request = [self send: @"GetThings"];
+
+	STAssertFalse(_response.hasError, @"Request has failed: %@", _response.errorText);
+	STAssertTrue(request.retryCount == 2, @"Unexpected count of retries: %u", request.retryCount);
+	STAssertTrue(_requestBodies.count == 3, @"Unexpected count of attempts: %u", _requestBodies.count);
+
+	NSMutableSet *msgTimes = [NSMutableSet set];
+	NSMutableSet *signatures = [NSMutableSet set];
+
+	for (NSString *body in _requestBodies) {
+
+		XmlElement *root = [XmlDocument documentWithString: body].rootElement;
+		[msgTimes addObject: [root selectSingleNode: @"header/msg-time"].text];
+		[signatures addObject: [root selectSingleNode: @"auth/hmac-data"].text];
+	}
+
+	STAssertTrue(msgTimes.count == 3, @"Retry hasn't been stamped anew");
+	STAssertTrue(signatures.count == 3, @"Retry hasn't been signed anew");
+}
+
+- (void)testDroppedConnection {
+
+	_server.fault = LocalHttpFaultDropConnection;
+	_server.faultCount = 1;
+
+	[self send: @"GetThings"];
+
+	STAssertFalse(_response.hasError, @"Read hasn't been retried: %@", _response.errorText);
+	STAssertTrue(_server.requestCount == 2, @"Unexpected count of attempts: %u", _server.requestCount);
+
+	// the write may have been processed before the connection was lost
+	_server.faultCount = 1;
+
+	[self send: @"PutThings"];
+
+	STAssertTrue(_response.hasError, @"Write which may have been processed has been retried");
+	STAssertTrue(_server.requestCount == 3, @"Unexpected count of attempts: %u", _server.requestCount);
+}
+
+- (void)testServiceUnavailable {
+
+	_server.fault = LocalHttpFaultServiceUnavailable;
+	_server.faultCount = 1;
+
+	[self send: @"PutThings"];
+
+	STAssertFalse(_response.hasError, @"Write rejected by busy server hasn't been retried: %@", _response.errorText);
+	STAssertTrue(_server.requestCount == 2, @"Unexpected count of attempts: %u", _server.requestCount);
+
+	// the server stays unavailable
+	_policy.maxRetryCount = 2;
+	_server.faultCount = 10;
+
+	HealthVaultRequest *request = [self send: @"GetThings"];
+
+	STAssertTrue(_response.hasError, @"Error hasn't been returned");
+	STAssertTrue(request.retryCount == 2, @"Unexpected count of retries: %u", request.retryCount);
+	STAssertTrue(_server.injectedFaultCount == 4, @"Unexpected count of attempts: %u", _server.injectedFaultCount);
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  HealthVaultThingCacheTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+@class HealthVaultThingCache;
+@class HealthVaultThingSync;
+
+/// Implements tests for HealthVaultThingCache and HealthVaultThingSync classes.
+/// Contains tests to check reading ranges of the cache, handling of corrupt files and delta sync against a local server.
+@interface HealthVaultThingCacheTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+	HealthVaultThingCache *_cache;
+
+	/// Version stamps of things on the server by thing id, and their order.
+	NSMutableDictionary *_serverThings;
+	NSMutableArray *_serverThingIds;
+
+	/// Count of things requested by id.
+	NSUInteger _requestedThingCount;
+	BOOL _failsRequests;
+	BOOL _isDone;
+}
+
+@end
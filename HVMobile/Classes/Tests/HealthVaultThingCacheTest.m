@@ -0,0 +1,326 @@
+//
+//  HealthVaultThingCacheTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingCacheTest.h"
+#import "HealthVaultThingCache.h"
+#import "HealthVaultThingSync.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+
+@interface HealthVaultThingCacheTest (Private)
+
+/// Returns xml of a weight thing.
++ (NSString *)thingXml: (NSString *)thingId versionStamp: (NSString *)versionStamp;
+
+/// Writes three things and returns content of the cache file.
+- (NSMutableData *)writeThreeThings;
+
+/// Runs sync against the local server.
+/// @returns the completed sync.
+- (HealthVaultThingSync *)sync;
+
+@end
+
+
+@implementation HealthVaultThingCacheTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent: @"HealthVaultThingCacheTest"];
+	_cache = [[HealthVaultThingCache alloc] initWithDirectory: directory
+													 recordId: @"record"
+													   typeId: @"3d34d87e-7fc1-4153-800f-f56592cb0d17"];
+	[_cache clear];
+
+	_serverThings = [NSMutableDictionary new];
+	_serverThingIds = [NSMutableArray new];
+
+	for (NSUInteger i = 0; i < 75; i++) {
+		NSString *thingId = [NSString stringWithFormat: @"t%u", i];
+		[_serverThingIds addObject: thingId];
+		[_serverThings setObject: @"1" forKey: thingId];
+	}
+
+	_requestedThingCount = 0;
+	_failsRequests = NO;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_cache clear];
+	[_cache release];
+	[_hvService release];
+	[_server stop];
+	[_server release];
+	[_serverThings release];
+	[_serverThingIds release];
+}
+
++ (NSString *)thingXml: (NSString *)thingId versionStamp: (NSString *)versionStamp {
+	return [NSString stringWithFormat: @"<thing><thing-id version-stamp=\"%@\">%@</thing-id>"
+		"<data-xml><weight><value><display units=\"pounds\">%@</display></value></weight></data-xml></thing>",
+		versionStamp, thingId, versionStamp];
+}
+
+/// Returns keys of things for the filter request and full things for requests by id.
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	if (_failsRequests) {
+		return @"<response><status><code>3</code><error><message>Failed</message></error></status></response>";
+	}
+
+	XmlElement *group = [[XmlDocument documentWithString: requestBody].rootElement selectSingleNode: @"info/group"];
+	NSMutableString *response = [NSMutableString stringWithString: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"];
+
+	NSArray *idNodes = [group selectNodes: @"id"];
+
+	if (idNodes.count > 0) {
+
+		for (XmlElement *idNode in idNodes) {
+
+			NSString *versionStamp = [_serverThings objectForKey: idNode.text];
+			if (versionStamp) {
+				[response appendString: [HealthVaultThingCacheTest thingXml: idNode.text versionStamp: versionStamp]];
+			}
+		}
+
+		_requestedThingCount += idNodes.count;
+	}
+	else {
+
+		// The first things are returned with the core section, keys of the rest follow.
+		for (NSUInteger i = 0; i < _serverThingIds.count; i++) {
+
+			NSString *thingId = [_serverThingIds objectAtIndex: i];
+			NSString *format = i < 10
+					? @"<thing><thing-id version-stamp=\"%@\">%@</thing-id><eff-date>2011-05-01T10:00:00</eff-date></thing>"
+					: @"<unprocessed-thing-key-info><thing-id version-stamp=\"%@\">%@</thing-id></unprocessed-thing-key-info>";
+
+			[response appendFormat: format, [_serverThings objectForKey: thingId], thingId];
+		}
+	}
+
+	[response appendString: @"</group></wc:info></response>"];
+	return response;
+}
+
+- (void)syncCompleted: (HealthVaultThingSync *)sync {
+	_isDone = YES;
+}
+
+- (HealthVaultThingSync *)sync {
+	_isDone = NO;
+	_requestedThingCount = 0;
+
+	HealthVaultThingSync *sync = [[[HealthVaultThingSync alloc] initWithService: _hvService
+																		 cache: _cache
+																	 filterXml: @"<filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter>"
+																	 formatXml: @"<format><section>core</section><xml/></format>"
+																		target: self
+																	  callBack: @selector(syncCompleted:)] autorelease];
+	[sync start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	return sync;
+}
+
+- (void)testWriteAndReadRange {
+	NSArray *thingIds = [NSArray arrayWithObjects: @"a", @"b", @"c", @"d", nil];
+	NSArray *versionStamps = [NSArray arrayWithObjects: @"1", @"1", @"2", @"3", nil];
+	NSMutableDictionary *things = [NSMutableDictionary dictionary];
+
+	for (NSUInteger i = 0; i < thingIds.count; i++) {
+		[things setObject: [HealthVaultThingCacheTest thingXml: [thingIds objectAtIndex: i] versionStamp: [versionStamps objectAtIndex: i]]
+				   forKey: [thingIds objectAtIndex: i]];
+	}
+
+	STAssertTrue([_cache writeThingIds: thingIds versionStamps: versionStamps things: things], @"Cache hasn't been written");
+	STAssertTrue(_cache.count == 4, @"Unexpected count of things: %u", _cache.count);
+
+	NSArray *range = [_cache thingsInRange: NSMakeRange(1, 2)];
+	STAssertTrue(range.count == 2, @"Unexpected count of things in range");
+	STAssertEqualObjects([range objectAtIndex: 0], [things objectForKey: @"b"], @"Thing xml isn't equal to expected");
+	STAssertEqualObjects([range objectAtIndex: 1], [things objectForKey: @"c"], @"Thing xml isn't equal to expected");
+
+	STAssertTrue([_cache thingsInRange: NSMakeRange(3, 10)].count == 1, @"Range hasn't been clipped");
+	STAssertTrue([_cache thingsInRange: NSMakeRange(10, 10)].count == 0, @"Range beyond the end isn't empty");
+
+	STAssertEqualObjects([[_cache versionStamps] objectForKey: @"d"], @"3", @"Version stamp isn't equal to expected");
+
+	XmlElement *info = [XmlDocument documentWithString: [_cache infoXmlWithThingsInRange: NSMakeRange(0, 4)]].rootElement;
+	STAssertTrue([[info selectSingleNode: @"group"] selectNodes: @"thing"].count == 4, @"Info xml doesn't contain all things");
+}
+
+- (void)testUnchangedThingsAreCopied {
+	NSArray *thingIds = [NSArray arrayWithObjects: @"a", @"b", nil];
+	NSArray *versionStamps = [NSArray arrayWithObjects: @"1", @"1", nil];
+	NSDictionary *things = [NSDictionary dictionaryWithObjectsAndKeys:
+							[HealthVaultThingCacheTest thingXml: @"a" versionStamp: @"1"], @"a",
+							[HealthVaultThingCacheTest thingXml: @"b" versionStamp: @"1"], @"b", nil];
+
+	STAssertTrue([_cache writeThingIds: thingIds versionStamps: versionStamps things: things], @"Cache hasn't been written");
+
+	// b is gone, c is new, a is copied from the current content
+	NSString *newThing = [HealthVaultThingCacheTest thingXml: @"c" versionStamp: @"1"];
+	STAssertTrue([_cache writeThingIds: [NSArray arrayWithObjects: @"c", @"a", nil]
+						 versionStamps: versionStamps
+								things: [NSDictionary dictionaryWithObject: newThing forKey: @"c"]], @"Cache hasn't been updated");
+
+	NSArray *cached = [_cache thingsInRange: NSMakeRange(0, 10)];
+	STAssertTrue(cached.count == 2, @"Unexpected count of things");
+	STAssertEqualObjects([cached objectAtIndex: 0], newThing, @"New thing isn't first");
+	STAssertEqualObjects([cached objectAtIndex: 1], [things objectForKey: @"a"], @"Unchanged thing hasn't been copied");
+
+	STAssertFalse([_cache writeThingIds: [NSArray arrayWithObject: @"x"] versionStamps: [NSArray arrayWithObject: @"1"] things: nil],
+				  @"Thing which isn't cached has been written");
+}
+
+- (void)testInsertAndRemove {
+	NSString *a = [HealthVaultThingCacheTest thingXml: @"a" versionStamp: @"1"];
+	NSString *b = [HealthVaultThingCacheTest thingXml: @"b" versionStamp: @"2"];
+	NSString *c = [HealthVaultThingCacheTest thingXml: @"c" versionStamp: @"3"];
+
+	// an empty cache takes the first thing
+	STAssertTrue([_cache insertThing: b thingId: @"b" versionStamp: @"2" atIndex: 0], @"Thing hasn't been inserted");
+	STAssertTrue([_cache insertThing: a thingId: @"a" versionStamp: @"1" atIndex: 0], @"Thing hasn't been inserted first");
+	STAssertTrue([_cache insertThing: c thingId: @"c" versionStamp: @"3" atIndex: 2], @"Thing hasn't been inserted last");
+	STAssertFalse([_cache insertThing: c thingId: @"d" versionStamp: @"3" atIndex: 4], @"Thing has been inserted beyond the end");
+
+	NSArray *cached = [_cache thingsInRange: NSMakeRange(0, 10)];
+	STAssertEqualObjects(cached, ([NSArray arrayWithObjects: a, b, c, nil]), @"Things aren't in order");
+	STAssertEqualObjects([[_cache versionStamps] objectForKey: @"c"], @"3", @"Version stamp isn't equal to expected");
+
+	STAssertTrue([_cache removeThingIds: [NSSet setWithObjects: @"b", @"x", nil]], @"Thing hasn't been removed");
+
+	cached = [_cache thingsInRange: NSMakeRange(0, 10)];
+	STAssertEqualObjects(cached, ([NSArray arrayWithObjects: a, c, nil]), @"Remaining things aren't in order");
+	STAssertTrue([_cache thingsInRange: NSMakeRange(1, 1)].count == 1, @"Range after the removed thing can't be read");
+
+	STAssertTrue([_cache removeThingIds: [NSSet setWithObjects: @"a", @"c", nil]], @"Things haven't been removed");
+	STAssertTrue(_cache.count == 0, @"Cache isn't empty");
+}
+
+- (NSMutableData *)writeThreeThings {
+	NSArray *thingIds = [NSArray arrayWithObjects: @"a", @"b", @"c", nil];
+	NSArray *versionStamps = [NSArray arrayWithObjects: @"1", @"2", @"3", nil];
+	NSMutableDictionary *things = [NSMutableDictionary dictionary];
+
+	for (NSUInteger i = 0; i < thingIds.count; i++) {
+		[things setObject: [HealthVaultThingCacheTest thingXml: [thingIds objectAtIndex: i] versionStamp: [versionStamps objectAtIndex: i]]
+				   forKey: [thingIds objectAtIndex: i]];
+	}
+
+	STAssertTrue([_cache writeThingIds: thingIds versionStamps: versionStamps things: things], @"Cache hasn't been written");
+
+	return [NSMutableData dataWithContentsOfFile: _cache.path];
+}
+
+- (void)testCorruptEntryIsDetected {
+	NSMutableData *file = [self writeThreeThings];
+
+	// length of the second entry: 16 byte header, 112 byte entries, two 48 byte keys and 8 byte offset before it
+	uint32_t length = 0x7fffffff;
+	[file replaceBytesInRange: NSMakeRange(16 + 112 + 104, sizeof(length)) withBytes: &length];
+	[file writeToFile: _cache.path atomically: YES];
+
+	STAssertTrue([_cache thingsInRange: NSMakeRange(0, 3)].count == 0, @"Things of a corrupt cache have been read");
+	STAssertTrue([_cache removeThingIds: [NSSet setWithObject: @"a"]], @"Corrupt cache hasn't been ignored");
+
+	// the corrupt cache is replaced
+	NSString *thing = [HealthVaultThingCacheTest thingXml: @"d" versionStamp: @"1"];
+	STAssertTrue([_cache insertThing: thing thingId: @"d" versionStamp: @"1" atIndex: 0], @"Thing hasn't been inserted");
+	STAssertEqualObjects([_cache thingsInRange: NSMakeRange(0, 10)], [NSArray arrayWithObject: thing], @"Corrupt cache hasn't been replaced");
+}
+
+- (void)testInvalidKeyIsSkipped {
+	NSMutableData *file = [self writeThreeThings];
+
+	// the first byte of the thing id of the first entry
+	uint8_t invalid = 0xff;
+	[file replaceBytesInRange: NSMakeRange(16, 1) withBytes: &invalid];
+	[file writeToFile: _cache.path atomically: YES];
+
+	NSDictionary *versionStamps = [_cache versionStamps];
+	STAssertTrue(versionStamps.count == 2, @"Entry with invalid thing id hasn't been skipped");
+	STAssertEqualObjects([versionStamps objectForKey: @"b"], @"2", @"Version stamp isn't equal to expected");
+}
+
+- (void)testSync {
+	HealthVaultThingSync *sync = [self sync];
+
+	STAssertFalse(sync.hasError, @"Sync has failed: %@", sync.errorText);
+	STAssertTrue(_cache.count == 75, @"Unexpected count of cached things: %u", _cache.count);
+	STAssertTrue(sync.changedThingCount == 75, @"Unexpected count of changed things");
+	STAssertTrue(_server.requestCount == 4, @"Unexpected count of requests: %u", _server.requestCount);
+
+	// one thing is changed, one removed and one added
+	[_serverThings setObject: @"2" forKey: @"t5"];
+	[_serverThings removeObjectForKey: @"t40"];
+	[_serverThingIds removeObject: @"t40"];
+	[_serverThings setObject: @"1" forKey: @"t75"];
+	[_serverThingIds insertObject: @"t75" atIndex: 0];
+
+	NSUInteger requestCount = _server.requestCount;
+	sync = [self sync];
+
+	STAssertFalse(sync.hasError, @"Sync has failed: %@", sync.errorText);
+	STAssertTrue(_server.requestCount - requestCount == 2, @"Unchanged things have been requested");
+	STAssertTrue(_requestedThingCount == 2, @"Unexpected count of requested things: %u", _requestedThingCount);
+	STAssertTrue(sync.changedThingCount == 2, @"Unexpected count of changed things");
+	STAssertTrue(sync.removedThingCount == 1, @"Unexpected count of removed things");
+
+	STAssertTrue(_cache.count == 75, @"Unexpected count of cached things: %u", _cache.count);
+	STAssertEqualObjects([[_cache versionStamps] objectForKey: @"t5"], @"2", @"Changed thing hasn't been updated");
+	STAssertNil([[_cache versionStamps] objectForKey: @"t40"], @"Removed thing is still cached");
+
+	XmlElement *firstThing = [XmlDocument documentWithString: [[_cache thingsInRange: NSMakeRange(0, 1)] lastObject]].rootElement;
+	STAssertEqualObjects([firstThing selectSingleNode: @"thing-id"].text, @"t75", @"New thing isn't in the order of results");
+	STAssertEqualObjects([firstThing selectSingleNode: @"data-xml/weight/value/display"].text, @"1", @"Data xml hasn't been cached");
+	STAssertEqualObjects([[_cache thingsInRange: NSMakeRange(0, 1)] lastObject], [HealthVaultThingCacheTest thingXml: @"t75" versionStamp: @"1"],
+						 @"Thing hasn't been cached as it has been received");
+
+	// nothing has changed
+	requestCount = _server.requestCount;
+	sync = [self sync];
+
+	STAssertTrue(_server.requestCount - requestCount == 1, @"Things have been requested while nothing has changed");
+	STAssertTrue(sync.changedThingCount == 0, @"Unexpected count of changed things");
+}
+
+- (void)testSyncError {
+	[self sync];
+
+	_failsRequests = YES;
+	[_serverThings setObject: @"2" forKey: @"t5"];
+
+	HealthVaultThingSync *sync = [self sync];
+
+	STAssertTrue(sync.hasError, @"Error hasn't been reported");
+	STAssertTrue(_cache.count == 75, @"Cache has been changed by the failed sync");
+	STAssertEqualObjects([[_cache versionStamps] objectForKey: @"t5"], @"1", @"Cache has been changed by the failed sync");
+}
+
+@end
@@ -0,0 +1,133 @@
+//
+//  HealthVaultThingMapperTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#import "HealthVaultThingMapperTest.h"
+#import "WeightMapper.h"
+#import "RecordImageMapper.h"
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+
+
+@implementation HealthVaultThingMapperTest
+
+- (void)testWeightRoundTrip {
+	Weight *weight = [[Weight new] autorelease];
+	weight.weightId = @"e2a124d8-0390-4c4b-aad6-766e75c9942d";
+	weight.versionStamp = @"<&\"";
+	weight.effDate = [DateTimeUtils UtcStringToDate: @"2011-04-20T12:25:29.218"];
+	weight.display = @"145";
+	weight.units = @"pounds";
+
+	NSString *xml = [WeightMapper xmlOfThing: weight];
+	NSRange range = [xml rangeOfString: @"<thing-id version-stamp=\"&lt;&amp;&quot;\">e2a124d8-0390-4c4b-aad6-766e75c9942d</thing-id>"];
+	STAssertTrue(range.location != NSNotFound, @"Thing id isn't escaped");
+	range = [xml rangeOfString: @"<when><date><y>2011</y><m>4</m><d>20</d></date><time><h>12</h><m>25</m><s>29</s><f>218</f></time></when>"];
+	STAssertTrue(range.location != NSNotFound, @"When isn't equal to expected");
+
+	NSArray *weights = [WeightMapper parseThingsFromXml: [NSString stringWithFormat: @"<info><group>%@</group></info>", xml]];
+	STAssertTrue(weights.count == 1, @"Received incorrect count of weights");
+
+	Weight *parsedWeight = [weights objectAtIndex: 0];
+	STAssertEqualObjects(parsedWeight.weightId, weight.weightId, @"Thing id isn't equal to expected");
+	STAssertEqualObjects(parsedWeight.versionStamp, @"<&\"", @"Version stamp isn't equal to expected");
+	STAssertEqualObjects(parsedWeight.effDate, weight.effDate, @"EffDate isn't equal to expected");
+	STAssertEqualObjects(parsedWeight.display, @"145", @"Display isn't equal to expected");
+	STAssertEqualObjects(parsedWeight.units, @"pounds", @"Units aren't equal to expected");
+}
+
+- (void)testMissingValuesAreOmitted {
+	Weight *weight = [[Weight new] autorelease];
+	weight.display = @"150.00";
+
+	XmlWriter *writer = [[XmlWriter new] autorelease];
+	[WeightMapper appendThing: weight toWriter: writer];
+
+	NSRange range = [writer.string rangeOfString: @"<thing-id"];
+	STAssertTrue(range.location == NSNotFound, @"Thing id of the new weight has been written");
+	range = [writer.string rangeOfString: @"<when>"];
+	STAssertTrue(range.location == NSNotFound, @"Missing date has been written");
+	range = [writer.string rangeOfString: @"<display>150.00</display>"];
+	STAssertTrue(range.location != NSNotFound, @"Display without units isn't equal to expected");
+}
+
+- (void)testFirstValueWins {
+	NSString *xml = @"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"
+		"<thing><eff-date>2011-04-20T12:25:29</eff-date><data-xml><weight>"
+		"<when><date><y>2010</y><m>1</m><d>2</d></date><time><h>3</h><m>4</m><s>5</s></time></when>"
+		"<value><display units=\"pounds\">145</display></value></weight></data-xml></thing>"
+		"<thing><data-xml><weight>"
+		"<when><date><y>2010</y><m>1</m><d>2</d></date><time><h>3</h><m>4</m><s>5</s></time></when>"
+		"</weight></data-xml></thing>"
+		"</group></wc:info>";
+
+	NSArray *weights = [WeightMapper parseThingsFromXml: xml];
+	STAssertTrue(weights.count == 2, @"Received incorrect count of weights");
+
+	Weight *weight = [weights objectAtIndex: 0];
+	STAssertEqualObjects([DateTimeUtils dateToUtcString: weight.effDate], @"2011-04-20T12:25:29.000Z", @"EffDate isn't taken from eff-date");
+
+	weight = [weights objectAtIndex: 1];
+	STAssertEqualObjects([DateTimeUtils dateToUtcString: weight.effDate], @"2010-01-02T03:04:05.000Z", @"EffDate isn't taken from when");
+	STAssertNil(weight.display, @"Missing display has been set");
+}
+
+- (void)testUnknownElementsAreSkipped {
+	NSString *xml = @"<info><group><thing>"
+		"<thing-id>a</thing-id><data-xml><weight><value><display>1</display></value></weight>"
+		"<extension><thing><thing-id>b</thing-id></thing><value><display>2</display></value></extension></data-xml>"
+		"</thing></group><thing><thing-id>c</thing-id></thing></info>";
+
+	NSArray *weights = [WeightMapper parseThingsFromXml: xml];
+	STAssertTrue(weights.count == 1, @"Things outside of group/thing have been parsed");
+
+	Weight *weight = [weights objectAtIndex: 0];
+	STAssertEqualObjects(weight.weightId, @"a", @"Thing id isn't equal to expected");
+	STAssertEqualObjects(weight.display, @"1", @"Display isn't equal to expected");
+}
+
+- (void)testInvalidXml {
+	STAssertNil([WeightMapper parseThingsFromXml: @"<info><group><thing></group>"], @"Invalid xml has been parsed");
+	STAssertNil([WeightMapper parseThingsFromXml: nil], @"Missing xml has been parsed");
+
+	NSArray *weights = [WeightMapper parseThingsFromXml: @"<info/>"];
+	STAssertTrue(weights != nil && weights.count == 0, @"Empty response isn't parsed as no things");
+}
+
+- (void)testRecordImageRoundTrip {
+	NSMutableData *data = [NSMutableData dataWithLength: 10000];
+	uint8_t *bytes = data.mutableBytes;
+	for (NSUInteger i = 0; i < data.length; i++) {
+		bytes[i] = (uint8_t)(i * 7);
+	}
+
+	RecordImage *image = [[RecordImage new] autorelease];
+	image.imageData = data;
+	image.contentType = @"image/jpeg";
+
+	NSString *xml = [RecordImageMapper xmlOfThing: image];
+	NSRange range = [xml rangeOfString: @"<content-length>10000</content-length>"];
+	STAssertTrue(range.location != NSNotFound, @"Content length isn't equal to expected");
+
+	NSArray *images = [RecordImageMapper parseThingsFromXml: [NSString stringWithFormat: @"<info><group>%@</group></info>", xml]];
+	STAssertTrue(images.count == 1, @"Received incorrect count of images");
+
+	RecordImage *parsedImage = [images objectAtIndex: 0];
+	STAssertEqualObjects(parsedImage.imageData, data, @"Image data isn't equal to expected");
+	STAssertEqualObjects(parsedImage.contentType, @"image/jpeg", @"Content type isn't equal to expected");
+}
+
+@end
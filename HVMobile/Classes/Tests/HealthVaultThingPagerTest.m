@@ -0,0 +1,175 @@
+//
+//  HealthVaultThingPagerTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultThingPagerTest.h"
+#import "HealthVaultThingPager.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+
+@implementation HealthVaultThingPagerTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	_pager = [[HealthVaultThingPager alloc] initWithService: _hvService
+												  filterXml: @"<filter><type-id>3d34d87e-7fc1-4153-800f-f56592cb0d17</type-id></filter>"
+												  formatXml: @"<format><section>core</section><xml/></format>"
+													 target: self
+												   callBack: @selector(pageLoaded:)];
+	_pager.pageSize = 30;
+
+	_pages = [NSMutableArray new];
+	_thingCount = 75;
+	_loadsNextPage = YES;
+	_hasFailed = NO;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_pager cancel];
+	[_pager release];
+	[_hvService release];
+	[_server stop];
+	[_server release];
+	[_pages release];
+}
+
+/// Returns full things up to max-full and keys of the rest for the first request,
+/// and full things for requests by id.
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	if (_thingCount == NSNotFound) {
+		return @"<response><status><code>3</code><error><message>Failed</message></error></status></response>";
+	}
+
+	XmlElement *group = [[XmlDocument documentWithString: requestBody].rootElement selectSingleNode: @"info/group"];
+	NSMutableString *response = [NSMutableString stringWithString: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"];
+
+	NSArray *idNodes = [group selectNodes: @"id"];
+
+	if (idNodes.count > 0) {
+
+		for (XmlElement *idNode in idNodes) {
+			[response appendFormat: @"<thing><thing-id version-stamp=\"1\">%@</thing-id></thing>", idNode.text];
+		}
+	}
+	else {
+
+		NSUInteger maxFull = [[group attrValue: @"max-full"] integerValue];
+
+		for (NSUInteger i = 0; i < _thingCount; i++) {
+			if (i < maxFull) {
+				[response appendFormat: @"<thing><thing-id version-stamp=\"1\">t%u</thing-id></thing>", i];
+			}
+			else {
+				[response appendFormat: @"<unprocessed-thing-key-info><thing-id version-stamp=\"1\">t%u</thing-id></unprocessed-thing-key-info>", i];
+			}
+		}
+	}
+
+	[response appendString: @"</group></wc:info></response>"];
+	return response;
+}
+
+- (void)pageLoaded: (HealthVaultResponse *)response {
+	if (response.hasError) {
+		_hasFailed = YES;
+	}
+
+	NSMutableArray *ids = [NSMutableArray array];
+	for (XmlElement *thing in [[response.infoElement selectSingleNode: @"group"] selectNodes: @"thing"]) {
+		[ids addObject: [thing selectSingleNode: @"thing-id"].text];
+	}
+	[_pages addObject: ids];
+
+	_isDone = (_pages.count == _expectedPageCount);
+
+	if (_loadsNextPage && _pager.hasMorePages) {
+		[_pager loadNextPage];
+	}
+}
+
+- (void)testPages {
+	_expectedPageCount = 3;
+
+	[_pager start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 3, @"Unexpected count of requests: %u", _server.requestCount);
+	STAssertTrue([[_pages objectAtIndex: 0] count] == 30, @"First page size isn't equal to expected");
+	STAssertTrue([[_pages objectAtIndex: 1] count] == 30, @"Second page size isn't equal to expected");
+	STAssertTrue([[_pages objectAtIndex: 2] count] == 15, @"Last page size isn't equal to expected");
+	STAssertEqualObjects([[_pages objectAtIndex: 2] lastObject], @"t74", @"Things aren't delivered in order");
+	STAssertTrue(_pager.loadedThingCount == 75, @"Unexpected count of loaded things");
+	STAssertFalse(_pager.hasMorePages, @"Pager reports more pages");
+	STAssertFalse(_hasFailed, @"Page has failed");
+}
+
+- (void)testSinglePage {
+	_expectedPageCount = 1;
+	_thingCount = 10;
+
+	[_pager start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue([[_pages objectAtIndex: 0] count] == 10, @"Page size isn't equal to expected");
+	STAssertFalse(_pager.hasMorePages, @"Pager reports more pages");
+}
+
+- (void)testPrefetch {
+	_expectedPageCount = 1;
+	_loadsNextPage = NO;
+	_pager.prefetchesNextPage = YES;
+
+	[_pager start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	// the second page is loaded while nobody has asked for it
+	BOOL isNeverSet = NO;
+	[LocalHttpServer runUntil: &isNeverSet timeout: 0.5];
+
+	STAssertTrue(_server.requestCount == 2, @"Next page hasn't been prefetched");
+	STAssertTrue(_pager.loadedPageCount == 1, @"Prefetched page has been delivered before it was asked for");
+	STAssertTrue(_pager.remainingThingCount == 45, @"Unexpected count of remaining things: %u", _pager.remainingThingCount);
+
+	[_pager loadNextPage];
+	STAssertTrue(_pages.count == 2, @"Prefetched page hasn't been delivered at once");
+}
+
+- (void)testError {
+	_expectedPageCount = 1;
+	_thingCount = NSNotFound;
+
+	[_pager start];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_hasFailed, @"Error hasn't been delivered");
+	STAssertFalse(_pager.hasMorePages, @"Pager reports more pages after error");
+}
+
+@end
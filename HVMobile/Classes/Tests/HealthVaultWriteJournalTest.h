@@ -0,0 +1,44 @@
+//
+//  HealthVaultWriteJournalTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class HealthVaultWriteJournal;
+@class HealthVaultResponse;
+
+/// Implements tests for HealthVaultWriteJournal class and journal replay of HealthVaultService.
+/// Contains tests to check reloading, torn appends, fsync batching, coalescing, replay
+/// and that writes which may have been made aren't replayed.
+@interface HealthVaultWriteJournalTest : SenTestCase {
+
+	NSString *_path;
+	HealthVaultWriteJournal *_journal;
+
+	/// Bodies of requests received by the local server.
+	NSMutableArray *_requestBodies;
+	HealthVaultResponse *_lastResponse;
+	BOOL _isDone;
+
+	/// The last response passed to the journal target.
+	HealthVaultResponse *_replayResponse;
+	NSUInteger _replayedResponseCount;
+	BOOL _isReplayed;
+}
+
+@end
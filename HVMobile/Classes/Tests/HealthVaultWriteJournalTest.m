@@ -0,0 +1,309 @@
+//
+//  HealthVaultWriteJournalTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "HealthVaultWriteJournalTest.h"
+#import "HealthVaultWriteJournal.h"
+#import "HealthVaultService.h"
+#import "LocalHttpServer.h"
+#import "XmlDocument.h"
+#import "MobilePlatformTest.h"
+
+
+@interface HealthVaultWriteJournalTest (Private)
+
+/// Creates PutThings or RemoveThings request.
+/// @param methodName - the method.
+/// @param recordId - the record.
+/// @param element - the element put into the info section.
++ (HealthVaultRequest *)request: (NSString *)methodName recordId: (NSString *)recordId element: (NSString *)element;
+
+/// Sends PutThings request and waits for the response.
+- (void)putThing: (NSString *)thingId service: (HealthVaultService *)service;
+
+@end
+
+
+@implementation HealthVaultWriteJournalTest
+
+- (void)setUp {
+
+	_path = [[NSTemporaryDirectory() stringByAppendingPathComponent: @"HealthVaultWriteJournalTest.log"] retain];
+	[[NSFileManager defaultManager] removeItemAtPath: _path error: NULL];
+
+	_journal = [[HealthVaultWriteJournal alloc] initWithPath: _path];
+	_requestBodies = [NSMutableArray new];
+	_replayedResponseCount = 0;
+	_isDone = NO;
+	_isReplayed = NO;
+}
+
+- (void)tearDown {
+
+	[_journal release];
+	[[NSFileManager defaultManager] removeItemAtPath: _path error: NULL];
+	[_path release];
+	[_requestBodies release];
+	[_lastResponse release];
+	[_replayResponse release];
+}
+
++ (HealthVaultRequest *)request: (NSString *)methodName recordId: (NSString *)recordId element: (NSString *)element {
+
+	HealthVaultRequest *request = [[[HealthVaultRequest alloc] initWithMethodName: methodName
+																	 methodVersion: [methodName isEqualToString: @"PutThings"] ? 2 : 1
+																	   infoSection: [NSString stringWithFormat: @"<info>%@</info>", element]
+																			target: nil
+																		  callBack: nil] autorelease];
+	request.recordId = recordId;
+	request.msgTime = [NSDate date];
+	request.authorizationSessionToken = @"token";
+
+	return request;
+}
+
+- (void)testReload {
+
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>1</thing>"] isSending: NO];
+	uint32_t sequence = [_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>2</thing>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"RemoveThings" recordId: @"r2" element: @"<thing-id>3</thing-id>"] isSending: YES];
+
+	[_journal removeSequences: [NSArray arrayWithObject: [NSNumber numberWithUnsignedInt: sequence]]];
+	[_journal synchronize];
+
+	// the header isn't journaled
+	NSString *contents = [[[NSString alloc] initWithData: [NSData dataWithContentsOfFile: _path] encoding: NSISOLatin1StringEncoding] autorelease];
+	STAssertTrue([contents rangeOfString: @"token"].location == NSNotFound, @"Session token has been journaled");
+
+	HealthVaultWriteJournal *journal = [[[HealthVaultWriteJournal alloc] initWithPath: _path] autorelease];
+
+	STAssertTrue(journal.pendingCount == 2, @"Unexpected count of pending requests: %u", journal.pendingCount);
+	STAssertTrue(journal.waitingCount == 2, @"Requests in flight haven't been reloaded as waiting");
+
+	NSArray *sequences = nil;
+	HealthVaultRequest *request = [journal nextReplayRequest: &sequences];
+
+	STAssertEqualObjects(request.methodName, @"PutThings", @"Requests have been reordered");
+	STAssertEqualObjects(request.infoXml, @"<info><thing>1</thing></info>", @"Removed request has been reloaded");
+	STAssertEqualObjects(request.recordId, @"r1", @"Record hasn't been reloaded");
+	STAssertTrue(request.methodVersion == 2, @"Method version hasn't been reloaded");
+	STAssertNil(request.msgTime, @"Request isn't created anew");
+
+	// sequence numbers go on after the reloaded ones
+	uint32_t nextSequence = [journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>4</thing>"] isSending: NO];
+	STAssertTrue(nextSequence > sequence + 1, @"Sequence number has been reused");
+}
+
+- (void)testTornAppend {
+
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>1</thing>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>2</thing>"] isSending: NO];
+	[_journal synchronize];
+
+	// the app has been killed in the middle of the third append
+	NSData *partialRecord = [[NSData dataWithContentsOfFile: _path] subdataWithRange: NSMakeRange(8, 20)];
+	NSFileHandle *file = [NSFileHandle fileHandleForWritingAtPath: _path];
+	[file seekToEndOfFile];
+	[file writeData: partialRecord];
+	[file closeFile];
+
+	HealthVaultWriteJournal *journal = [[[HealthVaultWriteJournal alloc] initWithPath: _path] autorelease];
+	STAssertTrue(journal.pendingCount == 2, @"Unexpected count of pending requests: %u", journal.pendingCount);
+
+	[journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>3</thing>"] isSending: NO];
+	[journal synchronize];
+
+	journal = [[[HealthVaultWriteJournal alloc] initWithPath: _path] autorelease];
+	STAssertTrue(journal.pendingCount == 3, @"Append after the torn record has been lost");
+}
+
+- (void)testSyncBatching {
+
+	_journal.syncInterval = 0.1;
+
+	for (NSUInteger i = 0; i < 10; i++) {
+
+		NSString *element = [NSString stringWithFormat: @"<thing>%u</thing>", i];
+		[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: element] isSending: NO];
+	}
+
+	STAssertTrue(_journal.syncCount == 0, @"Append has been synchronized at once");
+
+	BOOL isNeverSet = NO;
+	[LocalHttpServer runUntil: &isNeverSet timeout: 0.3];
+
+	STAssertTrue(_journal.syncCount == 1, @"Appends haven't shared one sync: %u", _journal.syncCount);
+}
+
+- (void)testCoalescing {
+
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>1</thing>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>2</thing>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r1" element: @"<thing>3</thing>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"RemoveThings" recordId: @"r1" element: @"<thing-id>1</thing-id>"] isSending: NO];
+	[_journal appendRequest: [HealthVaultWriteJournalTest request: @"PutThings" recordId: @"r2" element: @"<thing>4</thing>"] isSending: NO];
+
+	NSArray *putSequences = nil;
+	HealthVaultRequest *request = [_journal nextReplayRequest: &putSequences];
+
+	STAssertTrue(putSequences.count == 3, @"Puts haven't been coalesced");
+	STAssertEqualObjects(request.infoXml, @"<info><thing>1</thing><thing>2</thing><thing>3</thing></info>", @"Unexpected info section");
+
+	// the removal waits for the puts of its record
+	NSArray *sequences = nil;
+	STAssertNil([_journal nextReplayRequest: &sequences], @"Removal has overtaken puts of its record");
+
+	[_journal removeSequences: putSequences];
+
+	request = [_journal nextReplayRequest: &sequences];
+	STAssertEqualObjects(request.methodName, @"RemoveThings", @"Removal hasn't been sent after the puts");
+	STAssertTrue(sequences.count == 1, @"Requests of different methods have been coalesced");
+
+	request = [_journal nextReplayRequest: &sequences];
+	STAssertEqualObjects(request.recordId, @"r2", @"Requests of different records have been coalesced");
+
+	// the removal hasn't reached the service and is sent again
+	[_journal resetSequences: [NSArray arrayWithObject: [NSNumber numberWithUnsignedInt: 4]]];
+	STAssertTrue(_journal.waitingCount == 1, @"Request hasn't been reset");
+	STAssertEqualObjects([_journal nextReplayRequest: &sequences].methodName, @"RemoveThings", @"Reset request isn't sent again");
+}
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	[_requestBodies addObject: requestBody];
+
+	return @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings\"><thing-id>1</thing-id></wc:info></response>";
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+
+	[_lastResponse release];
+	_lastResponse = [response retain];
+	_isDone = YES;
+}
+
+- (void)writeJournalReplayed: (HealthVaultResponse *)response {
+
+	[_replayResponse release];
+	_replayResponse = [response retain];
+	_replayedResponseCount++;
+	_isReplayed = YES;
+}
+
+- (void)putThing: (NSString *)thingId service: (HealthVaultService *)service {
+
+	NSString *info = [NSString stringWithFormat: @"<info><thing><thing-id>%@</thing-id></thing></info>", thingId];
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"PutThings"
+																   methodVersion: 2
+																	 infoSection: info
+																		  target: self
+																		callBack: @selector(requestCompleted:)];
+	_isDone = NO;
+	[service sendRequest: request];
+	[request release];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request hasn't been completed");
+}
+
+- (void)testReplay {
+
+	// nothing listens on the port of the stopped server
+	LocalHttpServer *server = [[LocalHttpServer new] autorelease];
+	[server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	HealthVaultService *service = [server startWithSession];
+	STAssertNotNil(service, @"Couldn't start local server");
+	[server stop];
+
+	service.writeJournal = _journal;
+	[service setWriteJournalTarget: self callBack: @selector(writeJournalReplayed:)];
+
+	[self putThing: @"t1" service: service];
+
+	STAssertTrue(_lastResponse.isJournaled, @"Failed write hasn't been journaled");
+	STAssertTrue(_journal.waitingCount == 1, @"Failed write doesn't wait for replay");
+
+	// the next write waits behind the first one and tries to replay both
+	[self putThing: @"t2" service: service];
+
+	STAssertTrue(_lastResponse.isJournaled, @"Write has overtaken the waiting one");
+	STAssertTrue(_journal.pendingCount == 2, @"Unexpected count of pending requests: %u", _journal.pendingCount);
+
+	STAssertTrue([LocalHttpServer runUntil: &_isReplayed timeout: ASYNC_TEST_TIMEOUT_SEC], @"Journal hasn't been replayed");
+	STAssertTrue(_replayResponse.isJournaled, @"Failed replay hasn't kept the writes");
+	STAssertTrue(_journal.waitingCount == 2, @"Writes of the failed replay don't wait");
+
+	// connectivity returns and the token has been refreshed meanwhile
+	STAssertTrue([server start], @"Couldn't start local server");
+	service.healthServiceUrl = server.url;
+	service.authorizationSessionToken = @"new token";
+
+	_isReplayed = NO;
+	[service replayWriteJournal];
+	STAssertTrue([LocalHttpServer runUntil: &_isReplayed timeout: ASYNC_TEST_TIMEOUT_SEC], @"Journal hasn't been replayed");
+
+	STAssertFalse(_replayResponse.hasError, @"Replay has failed: %@", _replayResponse.errorText);
+	STAssertTrue(_requestBodies.count == 1, @"Waiting writes haven't been coalesced: %u", _requestBodies.count);
+	STAssertTrue(_journal.pendingCount == 0, @"Delivered writes are still pending");
+
+	XmlElement *root = [XmlDocument documentWithString: [_requestBodies lastObject]].rootElement;
+	STAssertEqualObjects([root selectSingleNode: @"header/auth-session/auth-token"].text, @"new token", @"Replayed request hasn't been signed anew");
+	STAssertNotNil([root selectSingleNode: @"auth/hmac-data"].text, @"Replayed request hasn't been signed");
+	STAssertTrue([root selectNodes: @"info/thing"].count == 2, @"Unexpected count of replayed things");
+
+	// online writes are sent at once
+	[self putThing: @"t3" service: service];
+
+	STAssertFalse(_lastResponse.hasError, @"Write has failed: %@", _lastResponse.errorText);
+	STAssertTrue(_replayedResponseCount == 2, @"Online write has been replayed");
+	STAssertTrue(_journal.pendingCount == 0, @"Delivered write is still pending");
+
+	[service cancelWriteJournalReplay];
+	[server stop];
+}
+
+- (void)testUncertainWriteIsNotReplayed {
+
+	LocalHttpServer *server = [[LocalHttpServer new] autorelease];
+	[server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	HealthVaultService *service = [server startWithSession];
+	STAssertNotNil(service, @"Couldn't start local server");
+	service.writeJournal = _journal;
+	[service setWriteJournalTarget: self callBack: @selector(writeJournalReplayed:)];
+
+	// the write reaches the server, but the connection is lost before the response
+	server.fault = LocalHttpFaultDropConnection;
+	server.faultCount = 1;
+
+	[self putThing: @"t1" service: service];
+
+	STAssertTrue(_lastResponse.hasError, @"Dropped write has succeeded");
+	STAssertFalse(_lastResponse.isJournaled, @"Write which may have been made has been journaled");
+	STAssertTrue(_lastResponse.isDeliveryUncertain, @"Uncertain write hasn't been reported");
+	STAssertTrue(_journal.pendingCount == 0, @"Write which may have been made waits for replay");
+
+	// the next write isn't preceded by a replay of the first one
+	[self putThing: @"t2" service: service];
+
+	STAssertFalse(_lastResponse.hasError, @"Write has failed: %@", _lastResponse.errorText);
+	STAssertTrue(server.requestCount == 2, @"Uncertain write has been replayed: %u requests", server.requestCount);
+	STAssertTrue(_replayedResponseCount == 0, @"Uncertain write has been replayed");
+
+	[service cancelWriteJournalReplay];
+	[server stop];
+}
+
+@end
@@ -0,0 +1,122 @@
+//
+//  LocalHttpServer.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+
+@class HealthVaultService;
+
+
+/// Faults LocalHttpServer can answer requests with.
+typedef enum {
+
+	/// Closes the connection without a response.
+	LocalHttpFaultDropConnection,
+
+	/// Answers with HTTP 503 Service Unavailable.
+	LocalHttpFaultServiceUnavailable
+} LocalHttpFault;
+
+
+/// Minimal HTTP/1.1 server listening on the loopback interface.
+/// Used by tests as a stand-in for HealthVault platform: it answers POST requests
+/// with a canned or computed body after an optional delay, supports keep-alive
+/// connections and counts connections and requests.
+/// All work is done on the run loop of the thread which has started the server.
+@interface LocalHttpServer : NSObject {
+
+	int _socket;
+	NSFileHandle *_listeningHandle;
+	NSUInteger _port;
+
+	/// Open client connections.
+	NSMutableArray *_connections;
+
+	NSString *_responseBody;
+	NSTimeInterval _responseDelay;
+	NSObject *_target;
+	SEL _responseCallBack;
+
+	NSUInteger _connectionCount;
+	NSUInteger _requestCount;
+	NSUInteger _activeRequestCount;
+	NSUInteger _maxActiveRequestCount;
+
+	LocalHttpFault _fault;
+	NSUInteger _faultCount;
+	NSUInteger _injectedFaultCount;
+	NSTimeInterval _retryAfter;
+}
+
+/// Gets port the server is listening on.
+@property (readonly) NSUInteger port;
+
+/// Gets URL of the server.
+@property (readonly) NSString *url;
+
+/// Gets or sets body returned for every request if there is no response callBack.
+@property (retain) NSString *responseBody;
+
+/// Gets or sets delay before the response is sent, in seconds.
+@property (assign) NSTimeInterval responseDelay;
+
+/// Gets count of accepted connections.
+@property (readonly) NSUInteger connectionCount;
+
+/// Gets count of received requests.
+@property (readonly) NSUInteger requestCount;
+
+/// Gets the maximum count of requests which have been waiting for response at the same time.
+@property (readonly) NSUInteger maxActiveRequestCount;
+
+/// Gets or sets the fault injected instead of a response.
+@property (assign) LocalHttpFault fault;
+
+/// Gets or sets count of the next requests which are answered with the fault.
+@property (assign) NSUInteger faultCount;
+
+/// Gets count of requests which have been answered with a fault.
+@property (readonly) NSUInteger injectedFaultCount;
+
+/// Gets or sets Retry-After header of HTTP 503 responses, in seconds; 0 omits the header.
+@property (assign) NSTimeInterval retryAfter;
+
+/// Sets method which computes response body.
+/// @param target - callBack method owner.
+/// @param callBack - method to call for each request, e.g.
+/// - (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody.
+- (void)setResponseTarget: (NSObject *)target callBack: (SEL)callBack;
+
+/// Starts listening on a free port.
+/// @returns YES if the server has been started.
+- (BOOL)start;
+
+/// Closes all connections and stops listening.
+- (void)stop;
+
+/// Starts the server and creates HealthVaultService which sends requests to it
+/// with a test session token and shared secret, so requests are signed as after authentication.
+/// @returns HealthVaultService instance, autoreleased, or nil if the server couldn't be started.
+- (HealthVaultService *)startWithSession;
+
+/// Runs current run loop until the condition is met or timeout is reached.
+/// @param flag - the condition.
+/// @param timeout - timeout in seconds.
+/// @returns YES if the condition has been met.
++ (BOOL)runUntil: (BOOL *)flag timeout: (NSTimeInterval)timeout;
+
+@end
@@ -0,0 +1,389 @@
+//
+//  LocalHttpServer.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "LocalHttpServer.h"
+#import "HealthVaultService.h"
+#import "Base64.h"
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+#import <unistd.h>
+
+
+/// Client connection of LocalHttpServer.
+@interface LocalHttpConnection : NSObject {
+
+	NSFileHandle *_handle;
+	NSMutableData *_buffer;
+	LocalHttpServer *_server;
+	BOOL _isClosed;
+}
+
+@property (readonly) NSFileHandle *handle;
+
+- (id)initWithHandle: (NSFileHandle *)handle server: (LocalHttpServer *)server;
+
+- (void)close;
+
+@end
+
+@interface LocalHttpServer (Private)
+
+- (void)connectionAccepted: (NSNotification *)notification;
+
+- (void)connectionClosed: (LocalHttpConnection *)connection;
+
+- (void)requestReceived: (NSString *)body connection: (LocalHttpConnection *)connection;
+
+- (void)sendResponse: (NSArray *)arguments;
+
+- (void)injectFault: (LocalHttpConnection *)connection;
+
+@end
+
+
+@implementation LocalHttpConnection
+
+@synthesize handle = _handle;
+
+- (id)initWithHandle: (NSFileHandle *)handle server: (LocalHttpServer *)server {
+
+	if ((self = [super init])) {
+
+		_handle = [handle retain];
+		_server = server;
+		_buffer = [NSMutableData new];
+
+		[[NSNotificationCenter defaultCenter] addObserver: self
+												 selector: @selector(dataReceived:)
+													 name: NSFileHandleReadCompletionNotification
+												   object: _handle];
+		[_handle readInBackgroundAndNotify];
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+	[_handle release];
+	[_buffer release];
+
+	[super dealloc];
+}
+
+- (void)close {
+
+	_isClosed = YES;
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+	[_handle closeFile];
+}
+
+- (void)dataReceived: (NSNotification *)notification {
+
+	NSData *data = [[notification userInfo] objectForKey: NSFileHandleNotificationDataItem];
+
+	if (data.length == 0) {
+
+		// the server releases the connection
+		[[self retain] autorelease];
+
+		[self close];
+		[_server connectionClosed: self];
+		return;
+	}
+
+	[_buffer appendData: data];
+
+	// several requests can arrive on a keep-alive connection
+	while (YES) {
+
+		NSData *separator = [@"\r\n\r\n" dataUsingEncoding: NSASCIIStringEncoding];
+		NSRange headerEnd = [_buffer rangeOfData: separator options: 0 range: NSMakeRange(0, _buffer.length)];
+
+		if (headerEnd.location == NSNotFound) {
+			break;
+		}
+
+		NSString *header = [[[NSString alloc] initWithBytes: _buffer.bytes
+													 length: headerEnd.location
+												   encoding: NSASCIIStringEncoding] autorelease];
+
+		NSUInteger contentLength = 0;
+		for (NSString *line in [header componentsSeparatedByString: @"\r\n"]) {
+
+			if ([[line lowercaseString] hasPrefix: @"content-length:"]) {
+				contentLength = [[line substringFromIndex: 15] integerValue];
+			}
+		}
+
+		NSUInteger requestLength = NSMaxRange(headerEnd) + contentLength;
+		if (_buffer.length < requestLength) {
+			break;
+		}
+
+		NSString *body = [[[NSString alloc] initWithBytes: (const char *)_buffer.bytes + NSMaxRange(headerEnd)
+												   length: contentLength
+												 encoding: NSUTF8StringEncoding] autorelease];
+
+		[_buffer replaceBytesInRange: NSMakeRange(0, requestLength) withBytes: NULL length: 0];
+
+		[_server requestReceived: body connection: self];
+
+		// the server may have dropped the connection
+		if (_isClosed) {
+			return;
+		}
+	}
+
+	[_handle readInBackgroundAndNotify];
+}
+
+@end
+
+
+@implementation LocalHttpServer
+
+@synthesize port = _port;
+@synthesize responseBody = _responseBody;
+@synthesize responseDelay = _responseDelay;
+@synthesize connectionCount = _connectionCount;
+@synthesize requestCount = _requestCount;
+@synthesize maxActiveRequestCount = _maxActiveRequestCount;
+@synthesize fault = _fault;
+@synthesize faultCount = _faultCount;
+@synthesize injectedFaultCount = _injectedFaultCount;
+@synthesize retryAfter = _retryAfter;
+
+- (id)init {
+
+	if ((self = [super init])) {
+
+		_socket = -1;
+		_connections = [NSMutableArray new];
+		self.responseBody = @"<response><status><code>0</code></status></response>";
+	}
+
+	return self;
+}
+
+- (void)dealloc {
+
+	[self stop];
+
+	[_connections release];
+	[_responseBody release];
+	[_target release];
+
+	[super dealloc];
+}
+
+- (NSString *)url {
+
+	return [NSString stringWithFormat: @"http://127.0.0.1:%u/platform/wildcat.ashx", _port];
+}
+
+- (void)setResponseTarget: (NSObject *)target callBack: (SEL)callBack {
+
+	[_target release];
+	_target = [target retain];
+	_responseCallBack = callBack;
+}
+
+- (BOOL)start {
+
+	_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (_socket < 0) {
+		return NO;
+	}
+
+	int reuse = 1;
+	setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_port = 0;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	socklen_t addressLength = sizeof(address);
+
+	if (bind(_socket, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		listen(_socket, 64) != 0 ||
+		getsockname(_socket, (struct sockaddr *)&address, &addressLength) != 0) {
+
+		close(_socket);
+		_socket = -1;
+		return NO;
+	}
+
+	_port = ntohs(address.sin_port);
+
+	_listeningHandle = [[NSFileHandle alloc] initWithFileDescriptor: _socket closeOnDealloc: YES];
+
+	[[NSNotificationCenter defaultCenter] addObserver: self
+											 selector: @selector(connectionAccepted:)
+												 name: NSFileHandleConnectionAcceptedNotification
+											   object: _listeningHandle];
+	[_listeningHandle acceptConnectionInBackgroundAndNotify];
+
+	return YES;
+}
+
+- (void)stop {
+
+	[NSObject cancelPreviousPerformRequestsWithTarget: self];
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+
+	for (LocalHttpConnection *connection in _connections) {
+		[connection close];
+	}
+	[_connections removeAllObjects];
+
+	[_listeningHandle release];
+	_listeningHandle = nil;
+	_socket = -1;
+}
+
+- (void)connectionAccepted: (NSNotification *)notification {
+
+	NSFileHandle *handle = [[notification userInfo] objectForKey: NSFileHandleNotificationFileHandleItem];
+
+	LocalHttpConnection *connection = [[LocalHttpConnection alloc] initWithHandle: handle server: self];
+	[_connections addObject: connection];
+	[connection release];
+
+	_connectionCount++;
+
+	[_listeningHandle acceptConnectionInBackgroundAndNotify];
+}
+
+- (void)connectionClosed: (LocalHttpConnection *)connection {
+
+	[_connections removeObjectIdenticalTo: connection];
+}
+
+- (void)requestReceived: (NSString *)body connection: (LocalHttpConnection *)connection {
+
+	_requestCount++;
+
+	if (_faultCount > 0) {
+
+		_faultCount--;
+		_injectedFaultCount++;
+
+		[self injectFault: connection];
+		return;
+	}
+
+	_activeRequestCount++;
+	_maxActiveRequestCount = MAX(_maxActiveRequestCount, _activeRequestCount);
+
+	NSString *responseBody = self.responseBody;
+	if (_target && [_target respondsToSelector: _responseCallBack]) {
+		responseBody = [_target performSelector: _responseCallBack withObject: self withObject: body];
+	}
+
+	NSArray *arguments = [NSArray arrayWithObjects: connection, (responseBody ? responseBody : @""), nil];
+
+	if (_responseDelay > 0) {
+		[self performSelector: @selector(sendResponse:) withObject: arguments afterDelay: _responseDelay];
+	}
+	else {
+		[self sendResponse: arguments];
+	}
+}
+
+- (void)sendResponse: (NSArray *)arguments {
+
+	LocalHttpConnection *connection = [arguments objectAtIndex: 0];
+	NSData *body = [[arguments objectAtIndex: 1] dataUsingEncoding: NSUTF8StringEncoding];
+
+	_activeRequestCount--;
+
+	NSString *header = [NSString stringWithFormat: @"HTTP/1.1 200 OK\r\nContent-Type: text/xml; charset=utf-8\r\n"
+		"Content-Length: %u\r\nConnection: keep-alive\r\n\r\n", body.length];
+
+	NSMutableData *response = [NSMutableData dataWithData: [header dataUsingEncoding: NSASCIIStringEncoding]];
+	[response appendData: body];
+
+	@try {
+		[connection.handle writeData: response];
+	}
+	@catch (NSException *exception) {
+		// the client has gone away
+		[connection close];
+		[self connectionClosed: connection];
+	}
+}
+
+- (void)injectFault: (LocalHttpConnection *)connection {
+
+	if (_fault == LocalHttpFaultDropConnection) {
+
+		[[connection retain] autorelease];
+
+		[connection close];
+		[self connectionClosed: connection];
+		return;
+	}
+
+	NSString *retryAfter = _retryAfter > 0 ? [NSString stringWithFormat: @"Retry-After: %.0f\r\n", _retryAfter] : @"";
+	NSString *response = [NSString stringWithFormat: @"HTTP/1.1 503 Service Unavailable\r\n%@"
+		"Content-Length: 0\r\nConnection: keep-alive\r\n\r\n", retryAfter];
+
+	@try {
+		[connection.handle writeData: [response dataUsingEncoding: NSASCIIStringEncoding]];
+	}
+	@catch (NSException *exception) {
+		[connection close];
+		[self connectionClosed: connection];
+	}
+}
+
+- (HealthVaultService *)startWithSession {
+
+	if (![self start]) {
+		return nil;
+	}
+
+	HealthVaultService *service = [[HealthVaultService alloc] initWithUrl: self.url
+																 shellUrl: nil
+															  masterAppId: @"c55cf02c-7de7-487a-8b8f-f694a7d9d737"];
+	service.authorizationSessionToken = @"token";
+	service.sessionSharedSecret = [Base64 encodeBase64WithData: [@"session secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	return [service autorelease];
+}
+
++ (BOOL)runUntil: (BOOL *)flag timeout: (NSTimeInterval)timeout {
+
+	NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow: timeout];
+
+	while (!*flag && [deadline timeIntervalSinceNow] > 0) {
+
+		[[NSRunLoop currentRunLoop] runMode: NSDefaultRunLoopMode
+								 beforeDate: [NSDate dateWithTimeIntervalSinceNow: 0.05]];
+	}
+
+	return *flag;
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  SessionTokenRefreshTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+@class HealthVaultService;
+
+/// Implements tests for session token refreshing of HealthVaultService class.
+/// Contains tests to check that requests failed with expired token share one CAST call
+/// and that the token is renewed ahead of expiry, running against a local server.
+@interface SessionTokenRefreshTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	HealthVaultService *_hvService;
+
+	NSUInteger _castCount;
+	NSUInteger _expiredCount;
+	NSUInteger _completedCount;
+	NSUInteger _failedCount;
+	NSUInteger _expectedCount;
+	NSUInteger _expectedCastCount;
+
+	/// Count of requests to send while the CAST call is being handled.
+	NSUInteger _lateRequestCount;
+	BOOL _isDone;
+}
+
+@end
@@ -0,0 +1,178 @@
+//
+//  SessionTokenRefreshTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "SessionTokenRefreshTest.h"
+#import "LocalHttpServer.h"
+#import "HealthVaultService.h"
+#import "HealthVaultConfig.h"
+#import "Base64.h"
+#import "MobilePlatformTest.h"
+
+#define EXPIRED_TOKEN @"expired-token"
+#define REFRESHED_TOKEN @"refreshed-token"
+
+
+@implementation SessionTokenRefreshTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	[_server setResponseTarget: self callBack: @selector(server: responseForRequest:)];
+	_hvService = [[_server startWithSession] retain];
+	STAssertNotNil(_hvService, @"Couldn't start local server");
+
+	_hvService.appIdInstance = @"f63e8825-d1c7-4f45-973d-d102ca886ba3";
+	_hvService.sharedSecret = [Base64 encodeBase64WithData: [@"application secret" dataUsingEncoding: NSUTF8StringEncoding]];
+	_hvService.authorizationSessionToken = EXPIRED_TOKEN;
+	_hvService.sessionSharedSecret = [Base64 encodeBase64WithData: [@"expired secret" dataUsingEncoding: NSUTF8StringEncoding]];
+
+	_castCount = 0;
+	_expiredCount = 0;
+	_completedCount = 0;
+	_failedCount = 0;
+	_lateRequestCount = 0;
+	_expectedCount = 0;
+	_expectedCastCount = 0;
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_hvService cancelSessionTokenRenewal];
+	[_hvService release];
+	[_server stop];
+	[_server release];
+}
+
+- (NSString *)server: (LocalHttpServer *)server responseForRequest: (NSString *)requestBody {
+
+	if ([requestBody rangeOfString: @"<method>CreateAuthenticatedSessionToken</method>"].location != NSNotFound) {
+
+		_castCount++;
+		STAssertTrue(_hvService.isRefreshingSessionToken, @"Service doesn't report refreshing");
+
+		// the renewed token is still valid, but CAST must be authenticated by the application
+		STAssertTrue([requestBody rangeOfString: @"<app-id>f63e8825-d1c7-4f45-973d-d102ca886ba3</app-id>"].location != NSNotFound,
+					 @"CAST call doesn't have app-id header");
+		STAssertTrue([requestBody rangeOfString: @"<auth-session>"].location == NSNotFound, @"CAST call has been sent with session token");
+
+		if (_castCount == _expectedCastCount) {
+			_isDone = YES;
+		}
+
+		for (NSUInteger i = 0; i < _lateRequestCount; i++) {
+			[self sendRequest];
+		}
+
+		NSString *secret = [Base64 encodeBase64WithData: [@"refreshed secret" dataUsingEncoding: NSUTF8StringEncoding]];
+		return [NSString stringWithFormat: @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.CreateAuthenticatedSessionToken2\"><token>%@</token><shared-secret>%@</shared-secret></wc:info></response>",
+				REFRESHED_TOKEN, secret];
+	}
+
+	if ([requestBody rangeOfString: @"<auth-token>" REFRESHED_TOKEN @"</auth-token>"].location != NSNotFound) {
+		return @"<response><status><code>0</code></status></response>";
+	}
+
+	_expiredCount++;
+	return @"<response><status><code>65</code><error><message>Token expired</message></error></status></response>";
+}
+
+- (void)sendRequest {
+	HealthVaultRequest *request = [[HealthVaultRequest alloc] initWithMethodName: @"GetThings"
+																   methodVersion: 3
+																	 infoSection: @"<info><group /></info>"
+																		  target: self
+																		callBack: @selector(requestCompleted:)];
+	[_hvService sendRequest: request];
+	[request release];
+}
+
+- (void)requestCompleted: (HealthVaultResponse *)response {
+	if (response.hasError) {
+		_failedCount++;
+	}
+
+	_completedCount++;
+	_isDone = (_completedCount == _expectedCount);
+}
+
+- (void)testExpiredBurstMakesSingleCastCall {
+	_expectedCount = 50;
+
+	for (NSUInteger i = 0; i < _expectedCount; i++) {
+		[self sendRequest];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_castCount == 1, @"Unexpected count of CAST calls: %u", _castCount);
+	STAssertTrue(_expiredCount == 50, @"Unexpected count of expired requests: %u", _expiredCount);
+	STAssertTrue(_failedCount == 0, @"Requests haven't been replayed with the new token");
+	STAssertEqualObjects(_hvService.authorizationSessionToken, REFRESHED_TOKEN, @"Token hasn't been saved");
+	STAssertFalse(_hvService.isRefreshingSessionToken, @"Service still reports refreshing");
+}
+
+- (void)testRequestsWaitForRefresh {
+	_expectedCount = 15;
+	_lateRequestCount = 10;
+
+	for (NSUInteger i = 0; i < 5; i++) {
+		[self sendRequest];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	// requests sent during the refresh must not reach the server with the old token
+	STAssertTrue(_castCount == 1, @"Unexpected count of CAST calls: %u", _castCount);
+	STAssertTrue(_expiredCount == 5, @"Unexpected count of expired requests: %u", _expiredCount);
+	STAssertTrue(_failedCount == 0, @"Requests haven't been sent with the new token");
+}
+
+- (void)testRenewalBeforeRequests {
+	_expectedCount = 10;
+
+	// the token is older than its lifetime minus the margin, so it is renewed before anything is sent
+	_hvService.sessionTokenTime = [NSDate dateWithTimeIntervalSinceNow: -DEFAULT_SESSION_TOKEN_LIFETIME];
+
+	for (NSUInteger i = 0; i < _expectedCount; i++) {
+		[self sendRequest];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_castCount == 1, @"Unexpected count of CAST calls: %u", _castCount);
+	STAssertTrue(_expiredCount == 0, @"Requests have been sent with the expiring token");
+	STAssertTrue(_failedCount == 0, @"Requests have failed");
+	STAssertTrue(_hvService.sessionTokenRenewalCount == 1, @"Renewal hasn't been counted");
+	STAssertTrue(_hvService.sessionTokenRefreshCount == 0, @"Unexpected refresh after failed request");
+	STAssertTrue(_hvService.avoidedExpiredRequestCount == 10, @"Unexpected count of avoided expired requests: %u",
+				 _hvService.avoidedExpiredRequestCount);
+}
+
+- (void)testScheduledRenewal {
+	_expectedCastCount = 2;
+
+	// the renewed token is renewed again half a second later
+	_hvService.sessionTokenLifetime = 1;
+	_hvService.sessionTokenRenewalMargin = 0.5;
+
+	[_hvService renewSessionToken];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Token hasn't been renewed on time");
+	STAssertTrue(_hvService.sessionTokenRenewalCount == 2, @"Unexpected count of renewals");
+}
+
+@end
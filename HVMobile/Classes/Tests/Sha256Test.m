@@ -0,0 +1,80 @@
+//
+//  Sha256Test.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "Sha256Test.h"
+#import "MobilePlatform.h"
+#import "Base64.h"
+#import "Sha256VectorTest.h"
+
+
+@implementation Sha256Test
+
+- (void)testHashVectors {
+	STAssertEqualObjects([MobilePlatform computeSha256Hash: @"abc"], @"ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0=", @"Hash isn't equal to expected");
+
+	// one million 'a' characters fed in chunks which do not align with blocks
+	char chunk[7];
+	memset(chunk, 'a', sizeof(chunk));
+
+	Sha256Context context;
+	Sha256Init(&context);
+
+	for (NSUInteger remaining = 1000000; remaining > 0; ) {
+		NSUInteger count = MIN(remaining, sizeof(chunk));
+		Sha256Update(&context, chunk, count);
+		remaining -= count;
+	}
+
+	STAssertEqualObjects([MobilePlatform finishSha256Hash: &context], @"zcduXJkU+5KBocfihNc+Z/GAmkiklyAOBG05zMcRLNA=", @"Chunked hash isn't equal to expected");
+}
+
+- (void)testPlainCVectors {
+	// the same check is built with cc on platforms without SenTestingKit, see Sha256VectorTest.h
+	STAssertTrue(Sha256CheckVectors() == 0, @"Digests of test vectors aren't equal to expected");
+}
+
+- (void)testHashWithEmbeddedNul {
+	const char bytes[] = { 'a', 0, 'b' };
+
+	STAssertEqualObjects([MobilePlatform computeSha256HashOfBytes: bytes length: sizeof(bytes)], @"WbJxrhu8sdMdQZKYF/Sxb7Q5608xUgta0dXOmJIKcTg=", @"Hash isn't equal to expected");
+}
+
+- (void)testHmacVectors {
+	// RFC 4231, test case 1
+	uint8_t key[20];
+	memset(key, 0x0b, sizeof(key));
+	NSData *keyData = [NSData dataWithBytes: key length: sizeof(key)];
+
+	STAssertEqualObjects([MobilePlatform computeSha256Hmac: keyData : @"Hi There"], @"sDRMYdjbOFNcqK/OrwvxK4gdwgDJgz2nJuk3bC4yz/c=", @"HMAC isn't equal to expected");
+
+	// RFC 4231, test case 6: key longer than block, data fed byte by byte
+	uint8_t longKey[131];
+	memset(longKey, 0xaa, sizeof(longKey));
+	const char *message = "Test Using Larger Than Block-Size Key - Hash Key First";
+
+	HmacSha256Context context;
+	HmacSha256Init(&context, longKey, sizeof(longKey));
+
+	for (size_t i = 0; i < strlen(message); i++) {
+		HmacSha256Update(&context, message + i, 1);
+	}
+
+	STAssertEqualObjects([MobilePlatform finishSha256Hmac: &context], @"YOQxWR7gtn8Niiaqy/W3f44LxiE3KMUUBUYEDw7jf1Q=", @"Chunked HMAC isn't equal to expected");
+}
+
+@end
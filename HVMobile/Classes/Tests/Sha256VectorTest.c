@@ -0,0 +1,126 @@
+//
+//  Sha256VectorTest.c
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Sha256VectorTest.h"
+#include "Sha256.h"
+#include <stdio.h>
+#include <string.h>
+
+/// Compares digest with the expected hex string, prints the vector name if they differ.
+/// @returns 1 if the digest isn't equal to expected, 0 otherwise.
+static int Sha256CheckDigest(const char *name, const uint8_t *digest, const char *expected) {
+
+	char hex[SHA256_DIGEST_SIZE * 2 + 1];
+
+	for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+		sprintf(hex + i * 2, "%02x", digest[i]);
+	}
+
+	if (strcmp(hex, expected) != 0) {
+
+		printf("%s: digest %s isn't equal to expected %s\n", name, hex, expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+/// Hashes the message in chunks of the given size, so block boundaries fall inside chunks.
+static int Sha256CheckMessage(const char *name, const char *message, size_t chunkSize, const char *expected) {
+
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	size_t length = strlen(message);
+
+	Sha256Context context;
+	Sha256Init(&context);
+
+	for (size_t offset = 0; offset < length; offset += chunkSize) {
+		Sha256Update(&context, message + offset, length - offset < chunkSize ? length - offset : chunkSize);
+	}
+
+	Sha256Final(&context, digest);
+
+	return Sha256CheckDigest(name, digest, expected);
+}
+
+int Sha256CheckVectors(void) {
+
+	int failures = 0;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	// FIPS 180-2, appendix B
+	failures += Sha256CheckMessage("empty", "", 1,
+		"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	failures += Sha256CheckMessage("abc", "abc", 3,
+		"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	failures += Sha256CheckMessage("448-bit", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	failures += Sha256CheckMessage("448-bit chunked", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 5,
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+	// one million 'a' characters fed in chunks which do not align with blocks
+	char chunk[1007];
+	memset(chunk, 'a', sizeof(chunk));
+
+	Sha256Context context;
+	Sha256Init(&context);
+
+	for (int i = 0; i < 1000; i++) {
+		Sha256Update(&context, chunk, i % 2 ? sizeof(chunk) - 14 : sizeof(chunk));
+	}
+
+	Sha256Final(&context, digest);
+	failures += Sha256CheckDigest("million a", digest,
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+	// RFC 4231, test case 1
+	uint8_t key[20];
+	memset(key, 0x0b, sizeof(key));
+
+	HmacSha256Context hmac;
+	HmacSha256Init(&hmac, key, sizeof(key));
+	HmacSha256Update(&hmac, "Hi There", 8);
+	HmacSha256Final(&hmac, digest);
+	failures += Sha256CheckDigest("HMAC case 1", digest,
+		"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+
+	// RFC 4231, test case 6: key longer than block
+	uint8_t longKey[131];
+	memset(longKey, 0xaa, sizeof(longKey));
+	const char *message = "Test Using Larger Than Block-Size Key - Hash Key First";
+
+	HmacSha256Init(&hmac, longKey, sizeof(longKey));
+	HmacSha256Update(&hmac, message, strlen(message));
+	HmacSha256Final(&hmac, digest);
+	failures += Sha256CheckDigest("HMAC case 6", digest,
+		"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+
+	return failures;
+}
+
+#ifdef SHA256_VECTOR_TEST_MAIN
+
+int main(void) {
+
+	int failures = Sha256CheckVectors();
+	printf(failures ? "%d SHA 256 vectors failed\n" : "All SHA 256 vectors passed\n", failures);
+
+	return failures ? 1 : 0;
+}
+
+#endif
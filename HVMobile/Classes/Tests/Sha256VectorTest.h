@@ -0,0 +1,44 @@
+//
+//  Sha256VectorTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HV_SHA256_VECTOR_TEST_H
+#define HV_SHA256_VECTOR_TEST_H
+
+/// Plain C test of Sha256.c against FIPS 180-2 and RFC 4231 test vectors.
+/// It has no Objective-C dependencies, so the portable implementation can be checked
+/// on any platform with a C compiler:
+///
+///   cd HVMobile/Classes
+///   cc -DSHA256_VECTOR_TEST_MAIN -IHVMobile/Support HVMobile/Support/Sha256.c Tests/Sha256VectorTest.c -o sha256test
+///   ./sha256test
+///
+/// On Apple platforms add -DSHA256_PORTABLE to test the portable implementation instead of CommonCrypto.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Checks digests of all test vectors, failures are printed to stdout.
+/// @returns count of failed vectors.
+int Sha256CheckVectors(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+//
+//  WebRequestQueueTest.h
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import <Foundation/Foundation.h>
+#import <SenTestingKit/SenTestingKit.h>
+
+@class LocalHttpServer;
+
+/// Implements tests for WebRequestQueue class.
+/// Contains tests to check concurrency limit, ordering, connection reuse and cancellation against a local server.
+@interface WebRequestQueueTest : SenTestCase {
+
+	LocalHttpServer *_server;
+	NSMutableArray *_completed;
+	NSUInteger _expectedCount;
+	BOOL _isDone;
+}
+
+@end
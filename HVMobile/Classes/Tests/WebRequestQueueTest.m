@@ -0,0 +1,147 @@
+//
+//  WebRequestQueueTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "WebRequestQueueTest.h"
+#import "LocalHttpServer.h"
+#import "WebRequestQueue.h"
+#import "WebResponse.h"
+#import "MobilePlatformTest.h"
+
+
+@implementation WebRequestQueueTest
+
+- (void)setUp {
+	_server = [LocalHttpServer new];
+	STAssertTrue([_server start], @"Couldn't start local server");
+
+	_completed = [NSMutableArray new];
+	_isDone = NO;
+}
+
+- (void)tearDown {
+	[_server stop];
+	[_server release];
+	[_completed release];
+}
+
+- (void)requestCompleted: (WebResponse *)response context: (NSString *)name {
+	STAssertFalse(response.hasError, @"Request has failed: %@", response.errorText);
+
+	[_completed addObject: name];
+	_isDone = (_completed.count == _expectedCount);
+}
+
+- (void)testConcurrencyLimit {
+	WebRequestQueue *queue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: 2];
+	_server.responseDelay = 0.2;
+	_expectedCount = 10;
+
+	for (NSUInteger i = 0; i < _expectedCount; i++) {
+		[queue sendRequestForURL: _server.url
+						withData: @"<request />"
+						priority: WEB_REQUEST_PRIORITY_NORMAL
+						 context: [NSString stringWithFormat: @"%u", i]
+						  target: self
+						callBack: @selector(requestCompleted: context:)];
+	}
+
+	STAssertTrue(queue.runningCount == 2, @"Count of running requests isn't equal to the limit");
+	STAssertTrue(queue.pendingCount == 8, @"Count of pending requests isn't equal to expected");
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	STAssertTrue(_server.requestCount == 10, @"Server received unexpected count of requests");
+	STAssertTrue(_server.maxActiveRequestCount <= 2, @"Concurrency limit has been exceeded");
+	STAssertTrue(_server.connectionCount <= 2, @"Connections haven't been reused");
+	STAssertTrue(queue.runningCount == 0 && queue.pendingCount == 0, @"Queue isn't empty");
+
+	[queue release];
+}
+
+- (void)testPriorityOrder {
+	WebRequestQueue *queue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: 1];
+	_expectedCount = 4;
+
+	NSString *names[] = { @"first", @"normal1", @"normal2", @"high" };
+	NSInteger priorities[] = { WEB_REQUEST_PRIORITY_NORMAL, WEB_REQUEST_PRIORITY_NORMAL, WEB_REQUEST_PRIORITY_NORMAL, WEB_REQUEST_PRIORITY_HIGH };
+
+	for (NSUInteger i = 0; i < _expectedCount; i++) {
+		[queue sendRequestForURL: _server.url
+						withData: @"<request />"
+						priority: priorities[i]
+						 context: names[i]
+						  target: self
+						callBack: @selector(requestCompleted: context:)];
+	}
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	// the first request is already running when the others are submitted
+	NSArray *expected = [NSArray arrayWithObjects: @"first", @"high", @"normal1", @"normal2", nil];
+	STAssertEqualObjects(_completed, expected, @"Requests haven't been sent in priority order");
+
+	[queue release];
+}
+
+- (void)testTiming {
+	WebRequestQueue *queue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: 1];
+	_server.responseDelay = 0.1;
+	_expectedCount = 1;
+
+	[queue sendRequestForURL: _server.url
+					withData: @"<request />"
+					priority: WEB_REQUEST_PRIORITY_NORMAL
+					 context: @"timed"
+					  target: self
+					callBack: @selector(timedRequestCompleted: context:)];
+
+	STAssertTrue([LocalHttpServer runUntil: &_isDone timeout: ASYNC_TEST_TIMEOUT_SEC], @"Request timeout");
+
+	[queue release];
+}
+
+- (void)testReleaseWithRequestsInFlight {
+	WebRequestQueue *queue = [[WebRequestQueue alloc] initWithMaxConcurrentRequests: 1];
+	_server.responseDelay = 0.2;
+	_expectedCount = 3;
+
+	for (NSUInteger i = 0; i < _expectedCount; i++) {
+		[queue sendRequestForURL: _server.url
+						withData: @"<request />"
+						priority: WEB_REQUEST_PRIORITY_NORMAL
+						 context: [NSString stringWithFormat: @"%u", i]
+						  target: self
+						callBack: @selector(requestCompleted: context:)];
+	}
+
+	// running and pending requests are cancelled, so nothing calls back into the released queue
+	[queue release];
+
+	STAssertFalse([LocalHttpServer runUntil: &_isDone timeout: 1], @"Cancelled request has completed");
+	STAssertTrue(_completed.count == 0, @"Cancelled request has called back");
+}
+
+- (void)timedRequestCompleted: (WebResponse *)response context: (NSString *)name {
+	STAssertTrue(response.firstByteTime >= 0.1, @"Time to first byte isn't measured");
+	STAssertTrue(response.totalTime >= response.firstByteTime, @"Total time isn't measured");
+	STAssertTrue(response.queueTime >= 0, @"Queue time isn't measured");
+
+	[self requestCompleted: response context: name];
+}
+
+@end
@@ -75,4 +75,65 @@
 	STAssertEqualObjects(weight.units, @"pounds", @"Units data isn't equal to expected");
 }
 
+- (void)testWeightFromPutResponse {
+	Weight *sentWeight = [[Weight new] autorelease];
+	sentWeight.effDate = [DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00"];
+	sentWeight.display = @"150.00";
+	sentWeight.units = @"pounds";
+
+	HealthVaultRequest *request = [[HealthVaultRequest new] autorelease];
+	request.userState = sentWeight;
+
+	WebResponse *webResponse = [[WebResponse new] autorelease];
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings\">"
+		"<thing-id version-stamp=\"6fa3752a-deeb-4900-9774-2ffb165107d7\">e2a124d8-0390-4c4b-aad6-766e75c9942d</thing-id></wc:info></response>";
+
+	HealthVaultResponse *response = [[[HealthVaultResponse alloc] initWithWebResponse: webResponse
+																			   request: request] autorelease];
+	Weight *weight = [Weight weightFromPutResponse: response];
+
+	STAssertEqualObjects(weight.weightId, @"e2a124d8-0390-4c4b-aad6-766e75c9942d", @"Thing id isn't equal to expected");
+	STAssertEqualObjects(weight.versionStamp, @"6fa3752a-deeb-4900-9774-2ffb165107d7", @"Version stamp isn't equal to expected");
+	STAssertEqualObjects(weight.display, @"150.00", @"Display data isn't equal to expected");
+
+	// the cached thing is read back the same way as things from HealthVault
+	NSArray *weights = [Weight parseWeightsFromXml: [NSString stringWithFormat: @"<info><group>%@</group></info>", [weight thingXml]]];
+
+	STAssertTrue(weights.count == 1, @"Thing xml couldn't be parsed");
+	Weight *cachedWeight = [weights objectAtIndex: 0];
+	STAssertEqualObjects(cachedWeight.weightId, weight.weightId, @"Thing id isn't equal to expected");
+	STAssertEqualObjects(cachedWeight.versionStamp, weight.versionStamp, @"Version stamp isn't equal to expected");
+	STAssertEqualObjects(cachedWeight.display, @"150.00", @"Display data isn't equal to expected");
+	STAssertEqualObjects(cachedWeight.effDate, sentWeight.effDate, @"EffDate isn't equal to expected");
+
+	webResponse.responseData = @"<response><status><code>0</code></status><wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.PutThings\"/></response>";
+	response = [[[HealthVaultResponse alloc] initWithWebResponse: webResponse request: request] autorelease];
+
+	STAssertNil([Weight weightFromPutResponse: response], @"Weight without thing key has been created");
+}
+
+- (void)testInsertionIndex {
+	NSMutableArray *weights = [NSMutableArray array];
+	NSString *dates[] = { @"2011-04-22T10:00:00", @"2011-04-21T10:00:00", @"2011-04-21T10:00:00", @"2011-04-20T10:00:00" };
+
+	for (NSUInteger i = 0; i < sizeof(dates) / sizeof(dates[0]); i++) {
+		Weight *weight = [[Weight new] autorelease];
+		weight.effDate = [DateTimeUtils UtcStringToDate: dates[i]];
+		[weights addObject: weight];
+	}
+
+	Weight *weight = [[Weight new] autorelease];
+
+	weight.effDate = [DateTimeUtils UtcStringToDate: @"2011-04-23T10:00:00"];
+	STAssertTrue([Weight insertionIndexOfWeight: weight inWeights: weights] == 0, @"Newest weight isn't first");
+
+	weight.effDate = [DateTimeUtils UtcStringToDate: @"2011-04-21T10:00:00"];
+	STAssertTrue([Weight insertionIndexOfWeight: weight inWeights: weights] == 1, @"Weight isn't placed before weights of the same time");
+
+	weight.effDate = [DateTimeUtils UtcStringToDate: @"2011-04-19T10:00:00"];
+	STAssertTrue([Weight insertionIndexOfWeight: weight inWeights: weights] == 4, @"Oldest weight isn't last");
+
+	STAssertTrue([Weight insertionIndexOfWeight: weight inWeights: [NSArray array]] == 0, @"Weight isn't first in empty list");
+}
+
 @end
@@ -0,0 +1,160 @@
+//
+//  XmlDocumentTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlDocumentTest.h"
+#import "XmlDocument.h"
+
+
+@implementation XmlDocumentTest
+
+- (NSString *)getThingsXml {
+	return @"<?xml version=\"1.0\" encoding=\"utf-8\"?><!-- response -->"
+		"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"
+		"<thing><thing-id version-stamp=\"1\">a</thing-id><data-xml><weight><value><display units=\"pounds\">145</display></value></weight><common /></data-xml></thing>"
+		"<filtered>true</filtered>"
+		"<thing><thing-id version-stamp='2'>b</thing-id><data-xml><note>1 &lt; 2 &amp;&#x20;3<![CDATA[ <raw> ]]>end</note></data-xml></thing>"
+		"</group></wc:info>";
+}
+
+- (void)testSelectNodes {
+	XmlDocument *document = [XmlDocument documentWithString: [self getThingsXml]];
+	STAssertNotNil(document, @"Couldn't parse xml");
+
+	XmlElement *root = document.rootElement;
+	STAssertEqualObjects(root.name, @"info", @"Root name isn't equal to expected");
+
+	NSArray *things = [[root selectSingleNode: @"group"] selectNodes: @"thing"];
+	STAssertTrue(things.count == 2, @"Received incorrect count of things");
+	STAssertNil([root selectNodes: @"missing"], @"Missing nodes have been found");
+
+	STAssertTrue([[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 1] == [things objectAtIndex: 1], @"Element for the same node isn't reused");
+	STAssertNil([[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 2], @"Missing thing has been found");
+	STAssertEqualObjects([root selectSingleNode: @"group/thing/data-xml/weight/value/display"].text, @"145", @"Display isn't equal to expected");
+	STAssertEqualObjects([root selectSingleNode: @"group/filtered"].text, @"true", @"Filtered isn't equal to expected");
+	STAssertNil([root selectSingleNode: @"group/thing/data-xml/common"].text, @"Empty element has text");
+}
+
+- (void)testAttributesAndText {
+	XmlElement *root = [XmlDocument documentWithString: [self getThingsXml]].rootElement;
+	XmlElement *first = [[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 0];
+	XmlElement *second = [[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 1];
+
+	STAssertEqualObjects([[first selectSingleNode: @"thing-id"] attrValue: @"version-stamp"], @"1", @"Version stamp isn't equal to expected");
+	STAssertEqualObjects([[second selectSingleNode: @"thing-id"] attrValue: @"version-stamp"], @"2", @"Version stamp isn't equal to expected");
+	STAssertNil([[first selectSingleNode: @"thing-id"] attrValue: @"missing"], @"Missing attribute has been found");
+	STAssertEqualObjects([[first selectSingleNode: @"data-xml/weight/value/display"].attributes objectForKey: @"units"], @"pounds", @"Units aren't equal to expected");
+
+	STAssertEqualObjects([second selectSingleNode: @"data-xml/note"].text, @"1 < 2 & 3 <raw> end", @"Decoded text isn't equal to expected");
+}
+
+- (void)testChildren {
+	XmlElement *root = [XmlDocument documentWithString: [self getThingsXml]].rootElement;
+	NSDictionary *children = [root selectSingleNode: @"group"].children;
+
+	STAssertTrue(children.count == 2, @"Received incorrect count of child names");
+	STAssertTrue([[children objectForKey: @"thing"] count] == 2, @"Received incorrect count of things");
+	STAssertTrue([[children objectForKey: @"filtered"] count] == 1, @"Received incorrect count of filtered elements");
+}
+
+- (void)testXml {
+	XmlElement *thing = [[XmlDocument documentWithString: [self getThingsXml]].rootElement selectSingleNode: @"group/thing"];
+	XmlElement *copy = [XmlDocument documentWithString: [thing xml]].rootElement;
+
+	STAssertEqualObjects(copy.name, @"thing", @"Name hasn't been written");
+	STAssertEqualObjects([copy selectSingleNode: @"thing-id"].text, [thing selectSingleNode: @"thing-id"].text, @"Text hasn't been written");
+	STAssertEqualObjects([[copy selectSingleNode: @"thing-id"] attrValue: @"version-stamp"],
+						 [[thing selectSingleNode: @"thing-id"] attrValue: @"version-stamp"], @"Attribute hasn't been written");
+	STAssertEqualObjects([copy selectSingleNode: @"data-xml/weight/value/display"].text, @"145", @"Nested element hasn't been written");
+	STAssertNotNil([copy selectSingleNode: @"data-xml/common"], @"Empty element hasn't been written");
+
+	// elements of the document are written as they are in the buffer, in document order
+	STAssertEqualObjects([thing xml], @"<thing><thing-id version-stamp=\"1\">a</thing-id><data-xml><weight><value><display units=\"pounds\">145</display></value></weight><common /></data-xml></thing>",
+						 @"Thing hasn't been written in document order");
+	STAssertEqualObjects([[thing selectSingleNode: @"data-xml/common"] xml], @"<common />", @"Empty element hasn't been written as it is");
+
+	XmlElement *escaped = [XmlDocument documentWithString: @"<a b=\"&quot;1&amp;2&quot;\">&lt;c&gt; &amp; d</a>"].rootElement;
+	XmlElement *escapedCopy = [XmlDocument documentWithString: [escaped xml]].rootElement;
+
+	STAssertEqualObjects(escapedCopy.text, @"<c> & d", @"Text hasn't been escaped");
+	STAssertEqualObjects([escapedCopy attrValue: @"b"], @"\"1&2\"", @"Attribute hasn't been escaped");
+}
+
+- (void)testInvalidXml {
+	STAssertNil([XmlDocument documentWithString: @"<info><group><thing></group></info>"], @"Mismatched tags have been parsed");
+	STAssertNil([XmlDocument documentWithString: @"<info></info><info></info>"], @"Two root elements have been parsed");
+	STAssertNil([XmlDocument documentWithString: @"<info><group>"], @"Unclosed elements have been parsed");
+	STAssertNil([XmlDocument documentWithString: @""], @"Empty document has been parsed");
+}
+
+- (void)testMalformedAttribute {
+	const char xml[] = "<info units=\"\xff\xfe\" id=\"1\"><value>\xc3</value></info>";
+	XmlDocument *document = [XmlDocument documentWithData: [NSData dataWithBytes: xml length: sizeof(xml) - 1]];
+	STAssertNotNil(document, @"Couldn't parse xml");
+
+	XmlElement *root = document.rootElement;
+	STAssertEqualObjects([root.attributes objectForKey: @"id"], @"1", @"Id isn't equal to expected");
+	STAssertTrue([[root attrValue: @"units"] length] == 2, @"Invalid UTF-8 attribute hasn't been decoded as Latin-1");
+	STAssertNotNil([root selectSingleNode: @"value"].text, @"Invalid UTF-8 text hasn't been decoded");
+}
+
+- (XmlDocument *)parseXml: (NSString *)xml inChunksOf: (NSUInteger)chunkSize {
+	NSData *data = [xml dataUsingEncoding: NSUTF8StringEncoding];
+	NSMutableData *buffer = [NSMutableData data];
+	XmlDocument *document = [[[XmlDocument alloc] initWithGrowingData: buffer] autorelease];
+
+	for (NSUInteger offset = 0; offset < data.length; offset += chunkSize) {
+		NSUInteger length = MIN(chunkSize, data.length - offset);
+		[buffer appendBytes: (const uint8_t *)data.bytes + offset length: length];
+
+		if (![document parseAppendedData]) {
+			return nil;
+		}
+	}
+
+	return [document finishParsing] ? document : nil;
+}
+
+- (void)testIncrementalParsing {
+	NSString *xml = [self getThingsXml];
+	NSString *splitXml = @"<root><item note=\"a > b\" name='x'>caf\u00e9 &amp; cr\u00e8me</item><!-- a > b --><empty/></root>";
+
+	NSUInteger chunkSizes[] = { 1, 2, 3, 7, 64 };
+
+	for (NSUInteger i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); i++) {
+
+		XmlElement *root = [self parseXml: xml inChunksOf: chunkSizes[i]].rootElement;
+		STAssertNotNil(root, @"Couldn't parse xml in chunks of %u bytes", chunkSizes[i]);
+
+		XmlElement *second = [[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 1];
+		STAssertEqualObjects([second selectSingleNode: @"data-xml/note"].text, @"1 < 2 & 3 <raw> end", @"Decoded text isn't equal to expected");
+		STAssertEqualObjects([root selectSingleNode: @"group/thing/data-xml/weight/value/display"].text, @"145", @"Display isn't equal to expected");
+
+		XmlElement *item = [[self parseXml: splitXml inChunksOf: chunkSizes[i]].rootElement selectSingleNode: @"item"];
+		STAssertEqualObjects([item attrValue: @"note"], @"a > b", @"Attribute isn't equal to expected");
+		STAssertEqualObjects([item attrValue: @"name"], @"x", @"Attribute isn't equal to expected");
+		STAssertEqualObjects(item.text, @"caf\u00e9 & cr\u00e8me", @"Text split between chunks isn't equal to expected");
+	}
+}
+
+- (void)testIncrementalInvalidXml {
+	STAssertNil([self parseXml: @"<info><group><thing></group></info>" inChunksOf: 4], @"Mismatched tags have been parsed");
+	STAssertNil([self parseXml: @"<info><group>" inChunksOf: 4], @"Unclosed elements have been parsed");
+	STAssertNil([self parseXml: @"<info a=\"1></info>" inChunksOf: 4], @"Unterminated attribute has been parsed");
+}
+
+@end
@@ -0,0 +1,153 @@
+//
+//  XmlPathTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlPathTest.h"
+#import "XmlPath.h"
+#import "XmlDocument.h"
+#import "XmlTextReader.h"
+
+
+@implementation XmlPathTest
+
+- (NSString *)getThingsXml {
+	return @"<info><group>"
+		"<thing><thing-id version-stamp=\"1\">a</thing-id><eff-date>2011-04-20T12:25:29</eff-date>"
+		"<data-xml><weight><value><display units=\"pounds\">145</display></value></weight><common /></data-xml></thing>"
+		"<thing><thing-id version-stamp=\"2\">b</thing-id><data-xml><weight><value><display>150</display></value></weight></data-xml></thing>"
+		"<thing><thing-id>c</thing-id><data-xml><note>1 &lt; 2</note></data-xml></thing>"
+		"</group></info>";
+}
+
+/// Returns root of the things xml, as compact document or as tree.
+- (XmlElement *)rootOfThings: (BOOL)useDocument reader: (XmlTextReader *)reader {
+	if (useDocument) {
+		return [XmlDocument documentWithString: [self getThingsXml]].rootElement;
+	}
+
+	return [reader read: [self getThingsXml]];
+}
+
+- (void)testParsePath {
+	XmlPath *path = [XmlPath pathWithString: @"data-xml/weight/value/display/@units"];
+	STAssertNotNil(path, @"Couldn't parse path");
+	STAssertTrue(path.steps.count == 4, @"Received incorrect count of steps");
+	STAssertEqualObjects([path.steps objectAtIndex: 3], @"display", @"Step isn't equal to expected");
+	STAssertEqualObjects(path.attributeName, @"units", @"Attribute name isn't equal to expected");
+	STAssertEqualObjects(path.string, @"data-xml/weight/value/display/@units", @"Path text isn't equal to expected");
+
+	path = [XmlPath pathWithString: @"@version-stamp"];
+	STAssertTrue(path.steps.count == 0, @"Attribute of the element itself has steps");
+	STAssertEqualObjects(path.attributeName, @"version-stamp", @"Attribute name isn't equal to expected");
+
+	STAssertNil([XmlPath pathWithString: nil], @"Missing path has been parsed");
+	STAssertNil([XmlPath pathWithString: @""], @"Empty path has been parsed");
+	STAssertNil([XmlPath pathWithString: @"a//b"], @"Empty step has been parsed");
+	STAssertNil([XmlPath pathWithString: @"a/"], @"Trailing separator has been parsed");
+	STAssertNil([XmlPath pathWithString: @"@a/b"], @"Attribute in the middle has been parsed");
+	STAssertNil([XmlPath pathWithString: @"a/@"], @"Empty attribute name has been parsed");
+}
+
+- (void)checkSelect: (BOOL)useDocument {
+	XmlTextReader *reader = [XmlTextReader new];
+	XmlElement *root = [self rootOfThings: useDocument reader: reader];
+
+	XmlPath *displayPath = [XmlPath pathWithString: @"group/thing/data-xml/weight/value/display"];
+	XmlPath *unitsPath = [XmlPath pathWithString: @"group/thing/data-xml/weight/value/display/@units"];
+	XmlPath *thingPath = [XmlPath pathWithString: @"group/thing"];
+
+	STAssertEqualObjects([root valueAtPath: displayPath], @"145", @"Display isn't equal to expected");
+	STAssertEqualObjects([root valueAtPath: unitsPath], @"pounds", @"Units aren't equal to expected");
+	STAssertEqualObjects([root selectSingleNodeAtPath: unitsPath].text, @"145", @"Attribute of the path hasn't been ignored");
+	STAssertNil([root valueAtPath: [XmlPath pathWithString: @"group/missing/value"]], @"Missing element has been found");
+	STAssertNil([root valueAtPath: [XmlPath pathWithString: @"group/thing/@missing"]], @"Missing attribute has been found");
+
+	NSArray *things = [root selectNodesAtPath: thingPath];
+	STAssertTrue(things.count == 3, @"Received incorrect count of things");
+	STAssertTrue([things objectAtIndex: 1] == [[root selectSingleNode: @"group"] selectSingleNode: @"thing" at: 1], @"Things aren't in document order");
+
+	// every branch of the path is followed, not only the first one
+	NSArray *displays = [root selectNodesAtPath: displayPath];
+	STAssertTrue(displays.count == 2, @"Received incorrect count of displays");
+	STAssertEqualObjects([[displays objectAtIndex: 1] text], @"150", @"Second display isn't equal to expected");
+	STAssertNil([root selectNodesAtPath: [XmlPath pathWithString: @"group/thing/missing"]], @"Missing elements have been found");
+
+	[reader release];
+}
+
+- (void)testSelectFromDocument {
+	[self checkSelect: YES];
+}
+
+- (void)testSelectFromTree {
+	[self checkSelect: NO];
+}
+
+- (void)checkExtract: (BOOL)useDocument {
+	XmlTextReader *reader = [XmlTextReader new];
+	XmlElement *root = [self rootOfThings: useDocument reader: reader];
+
+	NSArray *paths = [NSArray arrayWithObjects: @"thing-id", @"thing-id/@version-stamp", @"data-xml/weight/value/display",
+		[XmlPath pathWithString: @"data-xml/weight/value/display/@units"], @"eff-date", @"thing-id", nil];
+	XmlPathExtractor *extractor = [[XmlPathExtractor alloc] initWithPaths: paths];
+	STAssertTrue(extractor.count == 6, @"Received incorrect count of paths");
+
+	NSArray *things = [[root selectSingleNode: @"group"] selectNodes: @"thing"];
+	NSString *values[18];
+	[extractor extractValuesFromElements: things values: values];
+
+	STAssertEqualObjects(values[0], @"a", @"Thing id isn't equal to expected");
+	STAssertEqualObjects(values[1], @"1", @"Version stamp isn't equal to expected");
+	STAssertEqualObjects(values[2], @"145", @"Display isn't equal to expected");
+	STAssertEqualObjects(values[3], @"pounds", @"Units aren't equal to expected");
+	STAssertEqualObjects(values[4], @"2011-04-20T12:25:29", @"Eff date isn't equal to expected");
+	STAssertEqualObjects(values[5], @"a", @"Repeated path hasn't got the value");
+
+	STAssertEqualObjects(values[8], @"150", @"Display of the second thing isn't equal to expected");
+	STAssertNil(values[9], @"Missing attribute has a value");
+	STAssertNil(values[10], @"Missing element has a value");
+
+	STAssertEqualObjects(values[12], @"c", @"Thing id of the third thing isn't equal to expected");
+	STAssertNil(values[13], @"Missing attribute has a value");
+	STAssertNil(values[14], @"Missing element has a value");
+
+	// the buffer is cleared before values are extracted
+	[extractor extractValuesFrom: [things objectAtIndex: 2] values: values];
+	STAssertEqualObjects(values[0], @"c", @"Thing id isn't equal to expected");
+	STAssertNil(values[2], @"Value of previous element hasn't been cleared");
+
+	[extractor release];
+	[reader release];
+}
+
+- (void)testExtractFromDocument {
+	[self checkExtract: YES];
+}
+
+- (void)testExtractFromTree {
+	[self checkExtract: NO];
+}
+
+- (void)testInvalidExtractorPath {
+	NSArray *paths = [NSArray arrayWithObjects: @"thing-id", @"a//b", nil];
+	XmlPathExtractor *extractor = [[XmlPathExtractor alloc] initWithPaths: paths];
+
+	STAssertNil(extractor, @"Extractor with invalid path has been created");
+	[extractor release];
+}
+
+@end
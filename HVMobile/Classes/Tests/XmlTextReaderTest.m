@@ -0,0 +1,86 @@
+//
+//  XmlTextReaderTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#import "XmlTextReaderTest.h"
+#import "XmlTextReader.h"
+
+
+@implementation XmlTextReaderTest
+
+- (NSString *)getThingsXml {
+	return @"<wc:info xmlns:wc=\"urn:com.microsoft.wc.methods.response.GetThings3\"><group>"
+		"<thing><thing-id version-stamp=\"1\">a</thing-id><data-xml><weight><value><display units=\"pounds\">145</display></value></weight></data-xml></thing>"
+		"<filtered>true</filtered>"
+		"<thing><thing-id version-stamp=\"2\">b</thing-id><data-xml><thing><thing-id>nested</thing-id></thing></data-xml></thing>"
+		"</group><thing><thing-id>outside</thing-id></thing></wc:info>";
+}
+
+- (void)testReadTree {
+	XmlTextReader *xmlReader = [XmlTextReader new];
+	XmlElement *root = [xmlReader read: [self getThingsXml]];
+
+	STAssertNotNil(root, @"Couldn't parse xml");
+	STAssertEqualObjects(root.name, @"info", @"Root name isn't equal to expected");
+	STAssertTrue([[[root selectSingleNode: @"group"] selectNodes: @"thing"] count] == 2, @"Received incorrect count of things");
+	STAssertEqualObjects([root selectSingleNode: @"group/thing/data-xml/weight/value/display"].text, @"145", @"Display isn't equal to expected");
+
+	[xmlReader release];
+}
+
+- (void)streamNodeRead: (XmlElement *)node context: (NSMutableArray *)nodes {
+	[nodes addObject: node];
+}
+
+- (void)testReadStream {
+	NSMutableArray *nodes = [NSMutableArray array];
+
+	XmlTextReader *xmlReader = [XmlTextReader new];
+	BOOL result = [xmlReader read: [self getThingsXml]
+					  nodesAtPath: @"group/thing"
+						  context: nodes
+						   target: self
+						 callBack: @selector(streamNodeRead: context:)];
+	[xmlReader release];
+
+	STAssertTrue(result, @"Couldn't parse xml");
+	STAssertTrue(nodes.count == 2, @"Received incorrect count of streamed nodes");
+
+	XmlElement *first = [nodes objectAtIndex: 0];
+	STAssertEqualObjects(first.name, @"thing", @"Node name isn't equal to expected");
+	STAssertEqualObjects([first selectSingleNode: @"thing-id"].text, @"a", @"Thing id isn't equal to expected");
+	STAssertEqualObjects([[first selectSingleNode: @"thing-id"] attrValue: @"version-stamp"], @"1", @"Version stamp isn't equal to expected");
+	STAssertEqualObjects([first selectSingleNode: @"data-xml/weight/value/display"].text, @"145", @"Display isn't equal to expected");
+
+	XmlElement *second = [nodes objectAtIndex: 1];
+	STAssertEqualObjects([second selectSingleNode: @"thing-id"].text, @"b", @"Thing id isn't equal to expected");
+	STAssertEqualObjects([second selectSingleNode: @"data-xml/thing/thing-id"].text, @"nested", @"Nested thing isn't a part of the streamed node");
+}
+
+- (void)testReadStreamInvalidXml {
+	XmlTextReader *xmlReader = [XmlTextReader new];
+	BOOL result = [xmlReader read: @"<info><group><thing></group></info>"
+					  nodesAtPath: @"group/thing"
+						  context: nil
+						   target: self
+						 callBack: @selector(streamNodeRead: context:)];
+	[xmlReader release];
+
+	STAssertFalse(result, @"Invalid xml has been parsed");
+}
+
+@end
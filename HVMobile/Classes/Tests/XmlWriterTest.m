@@ -0,0 +1,92 @@
+//
+//  XmlWriterTest.m
+//  HealthVault Mobile Library for iOS
+//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+// http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#import "XmlWriterTest.h"
+#import "XmlWriter.h"
+#import "DateTimeUtils.h"
+
+
+@implementation XmlWriterTest
+
+- (void)testMarkupAndEscaping {
+	XmlWriter *writer = [[XmlWriter alloc] initWithCapacity: 4];
+
+	XML_WRITER_APPEND_LITERAL(writer, "<a b=\"");
+	[writer appendEscapedString: @"\"1\" & 2"];
+	XML_WRITER_APPEND_LITERAL(writer, "\">");
+	[writer appendEscapedString: @"x < y > z, café"];
+	[writer appendEscapedString: nil];
+	XML_WRITER_APPEND_LITERAL(writer, "</a>");
+
+	STAssertEqualObjects(writer.string, @"<a b=\"&quot;1&quot; &amp; 2\">x &lt; y &gt; z, café</a>", @"Xml isn't equal to expected");
+	STAssertTrue(writer.length == [writer.string lengthOfBytesUsingEncoding: NSUTF8StringEncoding], @"Length isn't count of UTF-8 bytes");
+	STAssertEqualObjects(writer.data, [writer.string dataUsingEncoding: NSUTF8StringEncoding], @"Data isn't equal to the string");
+
+	[writer release];
+}
+
+- (void)testLongTextGrowsBuffer {
+	XmlWriter *writer = [XmlWriter new];
+	NSMutableString *text = [NSMutableString string];
+	NSMutableString *expected = [NSMutableString string];
+
+	for (NSUInteger i = 0; i < 1000; i++) {
+		[text appendString: @"<&>"];
+		[expected appendString: @"&lt;&amp;&gt;"];
+	}
+
+	[writer appendEscapedString: text];
+	STAssertEqualObjects(writer.string, expected, @"Escaped text isn't equal to expected");
+
+	[writer release];
+}
+
+- (void)testNumbers {
+	XmlWriter *writer = [XmlWriter new];
+
+	[writer appendInteger: 0];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendInteger: -1234567];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendDouble: 65.7894736842105];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendDouble: 145];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendDouble: 1.0 / 0.0];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendDouble: 0.0 / 0.0];
+
+	STAssertEqualObjects(writer.string, @"0 -1234567 65.7894736842105 145 INF NaN", @"Numbers aren't equal to expected");
+
+	[writer release];
+}
+
+- (void)testDateAndBase64 {
+	XmlWriter *writer = [XmlWriter new];
+
+	[writer appendUtcDate: [DateTimeUtils UtcStringToDate: @"2011-04-20T12:25:29.218"]];
+	XML_WRITER_APPEND_LITERAL(writer, " ");
+	[writer appendBase64: [@"HealthVault" dataUsingEncoding: NSUTF8StringEncoding]];
+	[writer appendUtcDate: nil];
+	[writer appendBase64: nil];
+
+	STAssertEqualObjects(writer.string, @"2011-04-20T12:25:29.218Z SGVhbHRoVmF1bHQ=", @"Values aren't equal to expected");
+
+	[writer release];
+}
+
+@end
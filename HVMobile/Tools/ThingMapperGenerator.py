@@ -0,0 +1,860 @@
+#!/usr/bin/env python
+#
+#  ThingMapperGenerator.py
+#  HealthVault Mobile Library for iOS
+#
+# Copyright 2011 Microsoft Corp.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Generates HealthVaultThingMapper subclasses from thing type descriptions.
+
+Usage: ThingMapperGenerator.py [--output DIRECTORY] DESCRIPTION...
+
+Description (.thing file), one declaration per line, # starts a comment:
+
+    thing <Class> <type-id>
+    <path> <value-type> <property> [in | out]
+    <path> const [<text>]
+    <path> type-id
+
+The class is the existing model class the things are mapped to, its properties
+are set and read directly. Paths are relative to the <thing> element, the last
+step may be an attribute, e.g. data-xml/weight/value/display/@units.
+
+Value types:
+
+    string   NSString
+    int      NSInteger
+    double   double
+    date     NSDate, UTC timestamp
+    when     NSDate, HealthVault structured date and time, date/y, m, d and time/h, m, s, f
+    base64   NSData, decoded while the text is being read
+    const    the text is written as is, the element is written even if it is empty
+    type-id  the type id of the thing
+
+Fields are parsed and written unless they are marked 'in' (parsed only) or
+'out' (written only); const and type-id fields are only written. Elements are
+written in the order their paths first appear, an element is omitted when all
+values under it are nil. When the document has several values for a property,
+the first one is kept.
+
+<Class>Mapper.h and <Class>Mapper.m are written next to the description or
+into the output directory; files whose content hasn't changed aren't touched,
+so the generator can run on every build.
+"""
+
+import os
+import re
+import sys
+
+VALUE_TYPES = ('string', 'int', 'double', 'date', 'when', 'base64', 'const', 'type-id')
+
+# Objective-C declarations of the property types.
+PROPERTY_TYPES = {
+    'string': 'NSString *',
+    'int': 'NSInteger ',
+    'double': 'double ',
+    'date': 'NSDate *',
+    'when': 'NSDate *',
+    'base64': 'NSData *',
+}
+
+# Types whose values may be nil, elements holding only such values are omitted when they are nil.
+NULLABLE_TYPES = ('string', 'date', 'when', 'base64')
+
+# Types which may be used for attributes.
+ATTRIBUTE_TYPES = ('string', 'int', 'double', 'date')
+
+# Children of HealthVault structured date and time and indexes of their components.
+WHEN_COMPONENTS = (('date', (('y', 0), ('m', 1), ('d', 2))),
+                   ('time', (('h', 3), ('m', 4), ('s', 5), ('f', 6))))
+
+LICENSE = """//
+// Copyright 2011 Microsoft Corp.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+"""
+
+
+class DescriptionError(Exception):
+    """Error in the description, line is 0 when it concerns the whole description."""
+
+    def __init__(self, message, line_number=0):
+        Exception.__init__(self, message)
+        self.line_number = line_number
+
+
+class Field(object):
+    """Value declared by one line of the description."""
+
+    def __init__(self, line_number, steps, attribute, value_type, argument, direction):
+        self.line_number = line_number
+        self.steps = steps
+        self.attribute = attribute
+        self.value_type = value_type
+        self.direction = direction
+
+        # const text or property name
+        self.text = argument if value_type == 'const' else None
+        self.property = argument if value_type not in ('const', 'type-id') else None
+
+        # index of the when components ivar, set for parsed when fields
+        self.when_index = None
+
+    def parsed(self):
+        return self.property is not None and self.direction != 'out'
+
+    def written(self):
+        return self.direction != 'in'
+
+    def nullable(self):
+        return self.value_type in NULLABLE_TYPES
+
+
+class Element(object):
+    """Element on the paths of fields."""
+
+    def __init__(self, name, steps):
+        self.name = name
+        self.steps = steps
+        self.children = []
+        self.attributes = []
+        self.values = []
+        self.state = None
+
+    def child(self, name):
+        for child in self.children:
+            if child.name == name:
+                return child
+
+        child = Element(name, self.steps + [name])
+        self.children.append(child)
+        return child
+
+
+class Thing(object):
+    """Parsed description."""
+
+    def __init__(self, source):
+        self.source = source
+        self.class_name = None
+        self.type_id = None
+        self.fields = []
+
+
+def fail(thing, line_number, message):
+    raise DescriptionError(message, line_number)
+
+
+def parse_description(path):
+    thing = Thing(os.path.basename(path))
+
+    with open(path) as description:
+        lines = description.read().splitlines()
+
+    for number, line in enumerate(lines, 1):
+        words = line.split('#', 1)[0].split()
+
+        if not words:
+            continue
+
+        if words[0] == 'thing':
+            if thing.class_name or len(words) != 3:
+                fail(thing, number, 'expected one "thing <Class> <type-id>" declaration')
+            if not re.match(r'^[A-Za-z_]\w*$', words[1]):
+                fail(thing, number, 'invalid class name %s' % words[1])
+            if not re.match(r'^[0-9a-fA-F]{8}(-[0-9a-fA-F]{4}){3}-[0-9a-fA-F]{12}$', words[2]):
+                fail(thing, number, 'invalid type id %s' % words[2])
+
+            thing.class_name, thing.type_id = words[1], words[2].lower()
+            continue
+
+        if not thing.class_name:
+            fail(thing, number, 'fields must follow the "thing" declaration')
+
+        if len(words) < 2 or words[1] not in VALUE_TYPES:
+            fail(thing, number, 'expected "<path> <value-type> ..." with value type one of %s' % ', '.join(VALUE_TYPES))
+
+        path, value_type = words[0], words[1]
+        steps = path.split('/')
+        attribute = None
+
+        if steps[-1].startswith('@'):
+            attribute = steps.pop()[1:]
+
+        for step in steps + ([attribute] if attribute is not None else []):
+            if not re.match(r'^[A-Za-z_][\w.-]*$', step):
+                fail(thing, number, 'invalid path %s' % path)
+
+        if not steps:
+            fail(thing, number, 'attributes of the thing element are not supported')
+
+        if value_type == 'const':
+            if attribute is not None:
+                fail(thing, number, 'const attributes are not supported')
+            fields = [Field(number, steps, None, value_type, ' '.join(words[2:]), 'out')]
+        elif value_type == 'type-id':
+            if len(words) != 2 or attribute is not None:
+                fail(thing, number, 'expected "<path> type-id"')
+            fields = [Field(number, steps, None, value_type, None, 'out')]
+        else:
+            if len(words) not in (3, 4) or not re.match(r'^[A-Za-z_]\w*$', words[2]):
+                fail(thing, number, 'expected "<path> %s <property> [in | out]"' % value_type)
+            if len(words) == 4 and words[3] not in ('in', 'out'):
+                fail(thing, number, 'direction must be "in" or "out"')
+            if attribute is not None and value_type not in ATTRIBUTE_TYPES:
+                fail(thing, number, 'attributes must be one of %s' % ', '.join(ATTRIBUTE_TYPES))
+            fields = [Field(number, steps, attribute, value_type, words[2], words[3] if len(words) == 4 else None)]
+
+        thing.fields.extend(fields)
+
+    if not thing.class_name:
+        raise DescriptionError('"thing <Class> <type-id>" declaration is missing')
+
+    # a property keeps one type, whatever element it is read from
+    types = {}
+    for field in thing.fields:
+        if field.property:
+            known = types.setdefault(field.property, field.value_type)
+            if PROPERTY_TYPES[known] != PROPERTY_TYPES[field.value_type]:
+                fail(thing, field.line_number, 'property %s has been declared with another type' % field.property)
+
+    return thing
+
+
+def build_tree(thing, fields):
+    """Merges paths of the fields into the tree of elements below <thing>."""
+
+    root = Element('thing', [])
+
+    for field in fields:
+        element = root
+        for step in field.steps:
+            element = element.child(step)
+
+        if field.attribute is not None:
+            element.attributes.append(field)
+        else:
+            element.values.append(field)
+
+    def check(element):
+        for field in element.values:
+            if element.children:
+                fail(thing, field.line_number, 'element %s has both a value and child elements' % '/'.join(element.steps))
+            if field.value_type == 'when' and element.attributes:
+                fail(thing, field.line_number, 'element %s has both structured date and attributes' % '/'.join(element.steps))
+
+        for child in element.children:
+            check(child)
+
+    check(root)
+    return root
+
+
+def camel_case(steps):
+    return ''.join(part[:1].upper() + part[1:] for step in steps for part in re.split(r'[-_.]', step))
+
+
+def objc_string(text):
+    return '"%s"' % text.replace('\\', '\\\\').replace('"', '\\"')
+
+
+def xml_escape(text):
+    return text.replace('&', '&amp;').replace('<', '&lt;').replace('>', '&gt;').replace('"', '&quot;')
+
+
+class Code(object):
+    """Lines of generated code."""
+
+    def __init__(self):
+        self.lines = []
+        self.level = 0
+
+    def line(self, text=''):
+        self.lines.append(('\t' * self.level + text) if text else '')
+
+    def indent(self):
+        self.level += 1
+
+    def dedent(self):
+        self.level -= 1
+
+    def text(self):
+        return '\n'.join(self.lines) + '\n'
+
+
+class Generator(object):
+
+    def __init__(self, thing):
+        self.thing = thing
+        self.class_name = thing.class_name
+        self.mapper_name = thing.class_name + 'Mapper'
+
+        self.parsed_fields = [field for field in thing.fields if field.parsed()]
+        self.written_fields = [field for field in thing.fields if field.written()]
+
+        self.parse_tree = build_tree(thing, self.parsed_fields)
+        self.write_tree = build_tree(thing, self.written_fields)
+
+        # every parsed property has a bit telling whether it has been set
+        self.properties = []
+        for field in self.parsed_fields:
+            if field.property not in self.properties:
+                self.properties.append(field.property)
+
+        if len(self.properties) > 32:
+            raise DescriptionError('more than 32 parsed properties')
+
+        # elements of the parser, <info> and <group> precede the thing
+        self.states = []
+        self.when_count = 0
+        self.add_state('Root', None)
+        self.add_state('Group', None)
+        self.add_state('Thing', self.parse_tree)
+        self.add_states(self.parse_tree)
+
+    def add_state(self, suffix, element, when_field=None, when_component=None):
+        name = '%sState%s' % (self.class_name, suffix)
+        names = [state[0] for state in self.states]
+        unique = name
+        count = 2
+
+        while unique in names:
+            unique = '%s%d' % (name, count)
+            count += 1
+
+        self.states.append((unique, element, when_field, when_component))
+        return unique
+
+    def add_states(self, element):
+        for child in element.children:
+            child.state = self.add_state(camel_case(child.steps), child)
+
+            when_fields = [field for field in child.values if field.value_type == 'when']
+            for field in when_fields:
+                field.when_index = self.when_count
+                self.when_count += 1
+
+            # structured date and time is read into components, the date is made when the element ends
+            if when_fields:
+                child.when_states = []
+                for group, components in WHEN_COMPONENTS:
+                    group_state = self.add_state(camel_case(child.steps + [group]), None)
+                    component_states = []
+                    for component, index in components:
+                        component_state = self.add_state(camel_case(child.steps + [group, component]), None,
+                                                         when_fields, index)
+                        component_states.append((component, component_state))
+                    child.when_states.append((group, group_state, component_states))
+
+            self.add_states(child)
+
+    def assigned(self, property_name):
+        return '%sAssigned%s' % (self.class_name, property_name[:1].upper() + property_name[1:])
+
+    # Header
+
+    def header(self):
+        code = Code()
+        code.line('//')
+        code.line('//  %s.h' % self.mapper_name)
+        code.line('//  Generated by ThingMapperGenerator.py from %s, do not edit.' % self.thing.source)
+        code.lines.extend(LICENSE.rstrip('\n').split('\n'))
+        code.line()
+        code.line('#import <Foundation/Foundation.h>')
+        code.line('#import "HealthVaultThingMapper.h"')
+        code.line('#import "%s.h"' % self.class_name)
+        code.line()
+        code.line('/// Maps %s things, type %s, to xml and back.' % (self.class_name, self.thing.type_id))
+        code.line('@interface %s : HealthVaultThingMapper {' % self.mapper_name)
+        code.line()
+        code.indent()
+        code.line('/// The thing being parsed and its properties which have been set.')
+        code.line('%s *_thing;' % self.class_name)
+        code.line('uint32_t _assigned;')
+
+        if self.when_count:
+            code.line()
+            code.line('/// Components of structured dates and times being parsed.')
+            for index in range(self.when_count):
+                code.line('NSInteger _when%d[THING_MAPPER_WHEN_COMPONENTS];' % index)
+
+        code.dedent()
+        code.line('}')
+        code.line()
+        code.line('/// Writes <thing> element of the %s.' % self.class_name)
+        code.line('/// @param thing - the thing.')
+        code.line('/// @param writer - the writer to write to.')
+        code.line('+ (void)appendThing: (%s *)thing toWriter: (XmlWriter *)writer;' % self.class_name)
+        code.line()
+        code.line('@end')
+        return code.text()
+
+    # Implementation
+
+    def implementation(self):
+        code = Code()
+        code.line('//')
+        code.line('//  %s.m' % self.mapper_name)
+        code.line('//  Generated by ThingMapperGenerator.py from %s, do not edit.' % self.thing.source)
+        code.lines.extend(LICENSE.rstrip('\n').split('\n'))
+        code.line()
+        code.line('#import "%s.h"' % self.mapper_name)
+        code.line('#import "XmlWriter.h"')
+
+        if any(field.value_type == 'date' for field in self.parsed_fields):
+            code.line('#import "DateTimeUtils.h"')
+
+        code.line()
+        code.line('/// States of the parser, one for every element on the paths of parsed values.')
+        code.line('enum {')
+        code.line()
+        code.indent()
+        for index, state in enumerate(self.states):
+            code.line('%s%s%s' % (state[0], ' = THING_MAPPER_STATE_FIRST' if index == 0 else '',
+                                  ',' if index + 1 < len(self.states) else ''))
+        code.dedent()
+        code.line('};')
+
+        if self.properties:
+            code.line()
+            code.line('/// Bits of the properties which have been set, only the first value of a property is kept.')
+            code.line('enum {')
+            code.line()
+            code.indent()
+            for index, property_name in enumerate(self.properties):
+                code.line('%s = 1 << %d%s' % (self.assigned(property_name), index,
+                                              ',' if index + 1 < len(self.properties) else ''))
+            code.dedent()
+            code.line('};')
+
+        code.line()
+        code.line()
+        code.line('@implementation %s' % self.mapper_name)
+        code.line()
+        code.line('- (void)dealloc {')
+        code.line()
+        code.line('\t[_thing release];')
+        code.line()
+        code.line('\t[super dealloc];')
+        code.line('}')
+        code.line()
+        code.line('+ (NSString *)typeId {')
+        code.line()
+        code.line('\treturn @"%s";' % self.thing.type_id)
+        code.line('}')
+        code.line()
+        code.line('#pragma mark Writing')
+        code.line()
+        self.write_method(code)
+        code.line()
+        code.line('#pragma mark Writing End')
+        code.line()
+        code.line('#pragma mark Parsing')
+        code.line()
+        self.state_method(code)
+        code.line()
+        self.enter_method(code)
+        code.line()
+        self.leave_method(code)
+        code.line()
+        code.line('#pragma mark Parsing End')
+        code.line()
+        code.line('@end')
+        return code.text()
+
+    # Writing
+
+    def presence(self, element):
+        """Returns conditions under which the element is written, None if it is always written."""
+
+        conditions = []
+
+        for field in element.values + element.attributes:
+            if not field.nullable():
+                return None
+            condition = 'thing.%s' % field.property
+            if condition not in conditions:
+                conditions.append(condition)
+
+        for child in element.children:
+            child_conditions = self.presence(child)
+            if child_conditions is None:
+                return None
+            for condition in child_conditions:
+                if condition not in conditions:
+                    conditions.append(condition)
+
+        return conditions
+
+    def value_statement(self, field):
+        value = 'thing.%s' % field.property
+
+        if field.value_type == 'type-id':
+            return None
+        if field.value_type == 'string':
+            return '[writer appendEscapedString: %s];' % value
+        if field.value_type == 'int':
+            return '[writer appendInteger: %s];' % value
+        if field.value_type == 'double':
+            return '[writer appendDouble: %s];' % value
+        if field.value_type == 'date':
+            return '[writer appendUtcDate: %s];' % value
+        if field.value_type == 'base64':
+            return '[writer appendBase64: %s];' % value
+        if field.value_type == 'when':
+            return '[HealthVaultThingMapper appendWhenOfDate: %s toWriter: writer];' % value
+
+    def write_element(self, element, operations, conditional=True):
+        conditions = self.presence(element) if conditional else None
+
+        if conditions:
+            operations.append(('if', ' || '.join(conditions)))
+
+        operations.append(('literal', '<' + element.name))
+
+        for field in element.attributes:
+            if field.nullable():
+                operations.append(('if', 'thing.%s' % field.property))
+            operations.append(('literal', ' %s="' % field.attribute))
+            operations.append(('code', self.value_statement(field)))
+            operations.append(('literal', '"'))
+            if field.nullable():
+                operations.append(('end', None))
+
+        has_content = element.children or any(field.value_type != 'const' or field.text for field in element.values)
+
+        if not has_content:
+            operations.append(('literal', '/>'))
+        else:
+            operations.append(('literal', '>'))
+
+            for field in element.values:
+                if field.value_type == 'const':
+                    operations.append(('literal', xml_escape(field.text)))
+                elif field.value_type == 'type-id':
+                    operations.append(('literal', self.thing.type_id))
+                else:
+                    operations.append(('code', self.value_statement(field)))
+
+            for child in element.children:
+                self.write_element(child, operations)
+
+            operations.append(('literal', '</%s>' % element.name))
+
+        if conditions:
+            operations.append(('end', None))
+
+    def write_method(self, code):
+        operations = []
+        self.write_element(self.write_tree, operations, conditional=False)
+
+        # adjacent markup is written at once
+        merged = []
+        for operation in operations:
+            if operation[0] == 'literal' and merged and merged[-1][0] == 'literal':
+                merged[-1] = ('literal', merged[-1][1] + operation[1])
+            else:
+                merged.append(operation)
+
+        code.line('+ (void)appendThing: (%s *)thing toWriter: (XmlWriter *)writer {' % self.class_name)
+        code.line()
+        code.indent()
+
+        for kind, argument in merged:
+            if kind == 'literal':
+                code.line('XML_WRITER_APPEND_LITERAL(writer, %s);' % objc_string(argument))
+            elif kind == 'code':
+                code.line(argument)
+            elif kind == 'if':
+                code.line('if (%s) {' % argument)
+                code.indent()
+            else:
+                code.dedent()
+                code.line('}')
+
+        code.dedent()
+        code.line('}')
+
+    # Parsing
+
+    def state_method(self, code):
+        code.line('- (NSInteger)stateForElement: (NSString *)name inState: (NSInteger)state {')
+        code.line()
+        code.line('\tswitch (state) {')
+        code.line()
+        code.indent()
+        code.indent()
+
+        code.line('case THING_MAPPER_STATE_DOCUMENT:')
+        code.line('\treturn %s;' % self.states[0][0])
+        code.line()
+        code.line('case %s:' % self.states[0][0])
+        code.line('\treturn [name isEqualToString: @"group"] ? %s : THING_MAPPER_STATE_NONE;' % self.states[1][0])
+        code.line()
+        code.line('case %s:' % self.states[1][0])
+        code.line('\treturn [name isEqualToString: @"thing"] ? %s : THING_MAPPER_STATE_NONE;' % self.states[2][0])
+
+        def transitions(state, children):
+            if not children:
+                return
+            code.line()
+            code.line('case %s:' % state)
+            code.indent()
+            for name, child_state in children:
+                code.line('if ([name isEqualToString: @"%s"]) return %s;' % (name, child_state))
+            code.line('break;')
+            code.dedent()
+
+        def element_transitions(element, state):
+            children = [(child.name, child.state) for child in element.children]
+
+            if hasattr(element, 'when_states'):
+                children += [(group, group_state) for group, group_state, _ in element.when_states]
+
+            transitions(state, children)
+
+            if hasattr(element, 'when_states'):
+                for group, group_state, components in element.when_states:
+                    transitions(group_state, components)
+
+            for child in element.children:
+                element_transitions(child, child.state)
+
+        element_transitions(self.parse_tree, self.states[2][0])
+
+        code.dedent()
+        code.line('}')
+        code.dedent()
+        code.line()
+        code.line('\treturn THING_MAPPER_STATE_NONE;')
+        code.line('}')
+
+    def assign(self, code, field, value, condition):
+        """Writes statements which set the property unless it has been set."""
+
+        bit = self.assigned(field.property)
+        code.line('if (%s && !(_assigned & %s)) {' % (condition, bit))
+        code.line()
+        code.indent()
+        code.line('_thing.%s = %s;' % (field.property, value))
+        code.line('_assigned |= %s;' % bit)
+        code.dedent()
+        code.line('}')
+
+    def converted(self, field, text):
+        """Returns expression converting the text to the value of the field and the condition it is set under."""
+
+        if field.value_type == 'string':
+            return text, text
+        if field.value_type == 'int':
+            return '[%s integerValue]' % text, text
+        if field.value_type == 'double':
+            return '[%s doubleValue]' % text, text
+        if field.value_type == 'date':
+            return '[DateTimeUtils UtcStringToDate: %s]' % text, None
+
+    def assign_text(self, code, field, text, variable):
+        value, condition = self.converted(field, text)
+
+        if condition is None:
+            code.line('%s%s = %s;' % (PROPERTY_TYPES[field.value_type], variable, value))
+            code.line()
+            value, condition = variable, variable
+
+        self.assign(code, field, value, condition)
+
+    def elements(self, element):
+        for child in element.children:
+            yield child
+            for descendant in self.elements(child):
+                yield descendant
+
+    def enter_method(self, code):
+        code.line('- (void)enterState: (NSInteger)state attributes: (NSDictionary *)attributes {')
+        code.line()
+        code.line('\tswitch (state) {')
+        code.line()
+        code.indent()
+        code.indent()
+
+        code.line('case %s:' % self.states[2][0])
+        code.line('\t[_thing release];')
+        code.line('\t_thing = [%s new];' % self.class_name)
+        code.line('\t_assigned = 0;')
+        code.line('\tbreak;')
+
+        for element in self.elements(self.parse_tree):
+            text_fields = [field for field in element.values if field.value_type in ('string', 'int', 'double', 'date')]
+            base64_fields = [field for field in element.values if field.value_type == 'base64']
+            when_fields = [field for field in element.values if field.value_type == 'when']
+
+            if not (text_fields or base64_fields or when_fields or element.attributes):
+                continue
+
+            code.line()
+            code.line('case %s:%s' % (element.state, ' {' if element.attributes else ''))
+            code.indent()
+
+            if element.attributes:
+                code.line()
+
+            if text_fields:
+                code.line('[self collectText];')
+            if base64_fields:
+                code.line('[self collectBase64];')
+            for field in when_fields:
+                code.line('memset(_when%d, 0, sizeof(_when%d));' % (field.when_index, field.when_index))
+
+            if element.attributes:
+                code.line()
+                for index, field in enumerate(element.attributes):
+                    attribute = 'attribute%d' % index if len(element.attributes) > 1 else 'attribute'
+                    code.line('NSString *%s = [attributes objectForKey: @"%s"];' % (attribute, field.attribute))
+                    code.line()
+                    self.assign_text(code, field, attribute, attribute + 'Value')
+                    code.line()
+
+            code.line('break;')
+            code.dedent()
+
+            if element.attributes:
+                code.line('}')
+
+        for name, element, when_fields, component in self.states:
+            if when_fields is not None:
+                code.line()
+                code.line('case %s:' % name)
+                code.line('\t[self collectText];')
+                code.line('\tbreak;')
+
+        code.dedent()
+        code.line('}')
+        code.dedent()
+        code.line('}')
+
+    def leave_method(self, code):
+        code.line('- (void)leaveState: (NSInteger)state {')
+        code.line()
+        code.line('\tswitch (state) {')
+        code.line()
+        code.indent()
+        code.indent()
+
+        code.line('case %s:' % self.states[2][0])
+        code.line('\t[self addThing: _thing];')
+        code.line('\t[_thing release];')
+        code.line('\t_thing = nil;')
+        code.line('\tbreak;')
+
+        for element in self.elements(self.parse_tree):
+            if not element.values:
+                continue
+
+            code.line()
+            code.line('case %s: {' % element.state)
+            code.indent()
+
+            if any(field.value_type in ('string', 'int', 'double', 'date') for field in element.values):
+                code.line()
+                code.line('NSString *text = self.text;')
+
+            for index, field in enumerate(element.values):
+                variable = 'value%d' % index if len(element.values) > 1 else 'value'
+                code.line()
+
+                if field.value_type == 'base64':
+                    code.line('NSData *%s = self.base64Data;' % variable)
+                    code.line()
+                    self.assign(code, field, variable, variable)
+                elif field.value_type == 'when':
+                    code.line('NSDate *%s = [HealthVaultThingMapper dateWithWhenComponents: _when%d];'
+                              % (variable, field.when_index))
+                    code.line()
+                    self.assign(code, field, variable, variable)
+                else:
+                    self.assign_text(code, field, 'text', variable)
+
+            code.line()
+            code.line('break;')
+            code.dedent()
+            code.line('}')
+
+        for name, element, when_fields, component in self.states:
+            if when_fields is not None:
+                code.line()
+                code.line('case %s:' % name)
+                for field in when_fields:
+                    code.line('\t_when%d[%d] = [self.text integerValue];' % (field.when_index, component))
+                code.line('\tbreak;')
+
+        code.dedent()
+        code.line('}')
+        code.dedent()
+        code.line('}')
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as existing:
+            if existing.read() == text:
+                return False
+
+    with open(path, 'w') as output:
+        output.write(text)
+
+    return True
+
+
+def main(arguments):
+    output_directory = None
+
+    if len(arguments) >= 2 and arguments[0] == '--output':
+        output_directory = arguments[1]
+        arguments = arguments[2:]
+
+    if not arguments:
+        sys.stderr.write(__doc__)
+        return 2
+
+    for path in arguments:
+        try:
+            generator = Generator(parse_description(path))
+        except DescriptionError as error:
+            # the format is the one Xcode shows in the build results
+            location = '%s:%d' % (path, error.line_number) if error.line_number else path
+            sys.stderr.write('%s: error: %s\n' % (location, error))
+            return 1
+
+        directory = output_directory or os.path.dirname(path)
+        for extension, text in (('.h', generator.header()), ('.m', generator.implementation())):
+            output = os.path.join(directory, generator.mapper_name + extension)
+            if write_if_changed(output, text):
+                sys.stdout.write('Generated %s\n' % output)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))